@@ -34,6 +34,24 @@ enum backing_store_flags {
 	BACKING_STORE_META = 1,
 };
 
+/**
+ * Asynchronous store completion callback.
+ *
+ * Called from the scheduler on the main thread once an object passed
+ * to the store_async method has been written, or has failed to be
+ * written, to the backing store.
+ *
+ * @param url The url the object was stored under.
+ * @param flags The flags the object was stored with.
+ * @param res NSERROR_OK if the object was written or error code on failure.
+ * @param written The number of bytes written.
+ * @param elapsed The time in milliseconds the write took.
+ * @param pw The context passed to the store_async method.
+ */
+typedef void (backing_store_complete_cb)(struct nsurl *url,
+		enum backing_store_flags flags, nserror res,
+		size_t written, unsigned long elapsed, void *pw);
+
 /**
  * low level cache backing store operation table
  *
@@ -80,6 +98,29 @@ struct gui_llcache_table {
 	nserror (*store)(struct nsurl *url, enum backing_store_flags flags,
 			 uint8_t *data, const size_t datalen);
 
+	/**
+	 * Place an object in the backing store asynchronously.
+	 *
+	 * Optional operation with the same data ownership semantics as
+	 *  the store method. The write is performed in the background
+	 *  and \a cb is called from the scheduler once it is complete.
+	 *
+	 * If the backing store cannot accept another request until
+	 *  outstanding writes complete NSERROR_NOSPACE is returned and
+	 *  the store has not taken a reference to the data.
+	 *
+	 * @param[in] url The url is used as the unique primary key for the data.
+	 * @param[in] flags The flags to control how the object is stored.
+	 * @param[in] data The objects data.
+	 * @param[in] datalen The length of the \a data.
+	 * @param[in] cb The completion callback.
+	 * @param[in] pw The context passed to \a cb.
+	 * @return NSERROR_OK if the write was queued or error code on failure.
+	 */
+	nserror (*store_async)(struct nsurl *url, enum backing_store_flags flags,
+			       uint8_t *data, const size_t datalen,
+			       backing_store_complete_cb *cb, void *pw);
+
 	/**
 	 * Retrieve an object from the backing store.
 	 *
@@ -1334,6 +1334,12 @@ const uint8_t *content__get_source_data(struct content *c, size_t *size)
 	if (c == NULL)
 		return NULL;
 
+	/* a content may need its source before the fetch completes */
+	if (llcache_handle_coalesce_source(c->llcache) != NSERROR_OK) {
+		*size = 0;
+		return NULL;
+	}
+
 	return llcache_handle_get_source_data(c->llcache, size);
 }
 
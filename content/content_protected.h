@@ -257,6 +257,8 @@ int content__get_available_width(struct content *c);
 /**
  * Retrieve source of content.
  *
+ * Must only be called from the main thread.
+ *
  * \param c    Content to retrieve source of.
  * \param size Pointer to location to receive byte size of source.
  * \return Pointer to source data.
@@ -26,9 +26,17 @@
  * around the fetcher specific methods.
  *
  * Active fetches are held in the circular linked list ::fetch_ring. There may
- * be at most nsoption max_fetchers_per_host active requests per Host: header.
- * There may be at most nsoption max_fetchers active requests overall. Inactive
- * fetches are stored in the ::queue_ring waiting for use.
+ * be at most nsoption max_fetchers_per_host active requests per Host: header,
+ * or nsoption max_streams_per_host once the host's fetches are known to be
+ * multiplexed on a shared connection. There may be at most nsoption
+ * max_fetchers active requests overall.
+ *
+ * Inactive fetches wait in per host queues, one ring for each fetch
+ * priority. Hosts with fetches are held in the ::host_ring. When there is
+ * room to start a fetch the most urgent priority with a dispatchable fetch
+ * is chosen and the hosts are visited round robin from the one after the
+ * host which was last dispatched from, so a host with many queued fetches
+ * cannot starve the others.
  */
 
 #include <stdlib.h>
@@ -39,6 +47,7 @@
 #include <strings.h>
 #include <time.h>
 #include <libwapcaplet/libwapcaplet.h>
+#include <nsutils/time.h>
 
 #include "utils/config.h"
 #include "utils/corestrings.h"
@@ -85,6 +94,29 @@ typedef struct scheme_fetcher_s {
 
 static scheme_fetcher fetchers[MAX_FETCHERS];
 
+/**
+ * Fetch scheduling state for a host.
+ */
+struct fetch_host {
+	lwc_string *host;	/**< Host name, interned, or NULL */
+	/** Rings of queued fetches, one for each priority */
+	struct fetch *queue[FETCH_PRIORITY_COUNT];
+	unsigned int queued;	/**< Number of queued fetches */
+	unsigned int active;	/**< Number of active fetches */
+	bool multiplexed;	/**< Fetches share a multiplexed connection */
+	struct fetch_host *r_prev; /**< Previous host in ::host_ring */
+	struct fetch_host *r_next; /**< Next host in ::host_ring */
+};
+
+/**
+ * Queue wait time statistics for a fetch priority.
+ */
+struct fetch_wait_stats {
+	unsigned int count;	/**< Number of fetches dispatched */
+	uint64_t total;		/**< Total time waited in ms */
+	uint64_t max;		/**< Longest time waited in ms */
+};
+
 /** Information for a single fetch. */
 struct fetch {
 	fetch_callback callback;/**< Callback function. */
@@ -98,12 +130,24 @@ struct fetch {
 	int fetcherd;           /**< Fetcher descriptor for this fetch */
 	void *fetcher_handle;	/**< The handle for the fetcher. */
 	bool fetch_is_active;	/**< This fetch is active. */
-	struct fetch *r_prev;	/**< Previous active fetch in ::fetch_ring. */
-	struct fetch *r_next;	/**< Next active fetch in ::fetch_ring. */
+	enum fetch_priority priority; /**< Priority of the fetch when queued */
+	struct fetch_host *fhost; /**< Scheduling state of the fetch host */
+	uint64_t queue_time;	/**< Time the fetch was queued in ms */
+	struct fetch *r_prev;	/**< Previous fetch in ring. */
+	struct fetch *r_next;	/**< Next fetch in ring. */
 };
 
 static struct fetch *fetch_ring = NULL;	/**< Ring of active fetches. */
-static struct fetch *queue_ring = NULL;	/**< Ring of queued fetches */
+/** Ring of hosts with fetches, next host to consider for dispatch first */
+static struct fetch_host *host_ring = NULL;
+static unsigned int fetch_active_count = 0; /**< Number of active fetches */
+static unsigned int fetch_queued_count = 0; /**< Number of queued fetches */
+/** Number of active fetches whose fetcher must be polled */
+static unsigned int fetch_polled_count = 0;
+/** A fetcher deferred starting a fetch which must be retried */
+static bool fetch_start_deferred = false;
+/** Queue wait time statistics by fetch priority */
+static struct fetch_wait_stats fetch_wait[FETCH_PRIORITY_COUNT];
 
 /******************************************************************************
  * fetch internals							      *
@@ -142,76 +186,167 @@ static int get_fetcher_for_scheme(lwc_string *scheme)
 	return -1;
 }
 
+/**
+ * Get the scheduling state for a host, creating it if necessary.
+ *
+ * \param host The host name or NULL
+ * \return The host scheduling state or NULL on memory exhaustion.
+ */
+static struct fetch_host *fetch_host_get(lwc_string *host)
+{
+	struct fetch_host *fhost;
+
+	RING_FINDBYLWCHOST(host_ring, fhost, host);
+	if (fhost != NULL) {
+		return fhost;
+	}
+
+	fhost = calloc(1, sizeof(*fhost));
+	if (fhost == NULL) {
+		return NULL;
+	}
+	if (host != NULL) {
+		fhost->host = lwc_string_ref(host);
+	}
+
+	RING_INSERT(host_ring, fhost);
+
+	return fhost;
+}
+
+/**
+ * Release host scheduling state once it has no fetches.
+ *
+ * \param fhost The host scheduling state
+ */
+static void fetch_host_release(struct fetch_host *fhost)
+{
+	if ((fhost->queued != 0) || (fhost->active != 0)) {
+		return;
+	}
+
+	RING_REMOVE(host_ring, fhost);
+	if (fhost->host != NULL) {
+		lwc_string_unref(fhost->host);
+	}
+	free(fhost);
+}
+
 /**
  * Dispatch a single job
  */
 static bool fetch_dispatch_job(struct fetch *fetch)
 {
-	RING_REMOVE(queue_ring, fetch);
+	struct fetch_host *fhost = fetch->fhost;
+	struct fetch_wait_stats *stats = &fetch_wait[fetch->priority];
+	uint64_t now;
+	uint64_t waited;
+
 	NSLOG(fetch, DEBUG,
 	      "Attempting to start fetch %p, fetcher %p, url %s", fetch,
 	      fetch->fetcher_handle,
 	      nsurl_access(fetch->url));
 
 	if (!fetchers[fetch->fetcherd].ops.start(fetch->fetcher_handle)) {
-		RING_INSERT(queue_ring, fetch); /* Put it back on the end of the queue */
+		/* Put it back on the end of the queue */
+		RING_REMOVE(fhost->queue[fetch->priority], fetch);
+		RING_INSERT(fhost->queue[fetch->priority], fetch);
+		fetch_start_deferred = true;
 		return false;
-	} else {
-		RING_INSERT(fetch_ring, fetch);
-		fetch->fetch_is_active = true;
-		return true;
 	}
+
+	RING_REMOVE(fhost->queue[fetch->priority], fetch);
+	fhost->queued--;
+	fetch_queued_count--;
+
+	RING_INSERT(fetch_ring, fetch);
+	fhost->active++;
+	fetch_active_count++;
+	if (fetchers[fetch->fetcherd].ops.poll != NULL) {
+		fetch_polled_count++;
+	}
+	fetch->fetch_is_active = true;
+
+	nsu_getmonotonic_ms(&now);
+	waited = now - fetch->queue_time;
+	stats->count++;
+	stats->total += waited;
+	if (waited > stats->max) {
+		stats->max = waited;
+	}
+
+	NSLOG(fetch, DEBUG, "fetch %p priority %d waited %ums", fetch,
+	      fetch->priority, (unsigned int)waited);
+
+	return true;
 }
 
 /**
  * Choose and dispatch a single job. Return false if we failed to dispatch
  * anything.
  *
+ * The most urgent queued fetch on a host with room for another active
+ * fetch is chosen. Hosts are considered round robin so each host gets a
+ * turn at dispatching fetches of the same priority.
+ *
  * We don't check the overall dispatch size here because we're not called unless
  * there is room in the fetch queue for us.
  */
 static bool fetch_choose_and_dispatch(void)
 {
-	bool same_host;
-	struct fetch *queueitem;
-	queueitem = queue_ring;
-	do {
-		/* We can dispatch the selected item if there is room in the
-		 * fetch ring
-		 */
-		int countbyhost;
-		RING_COUNTBYLWCHOST(struct fetch, fetch_ring, countbyhost,
-				    queueitem->host);
-		if (countbyhost < nsoption_int(max_fetchers_per_host)) {
-			/* We can dispatch this item in theory */
-			return fetch_dispatch_job(queueitem);
-		}
-		/* skip over other items with the same host */
-		same_host = true;
-		while (same_host == true && queueitem->r_next != queue_ring) {
-			if (lwc_string_isequal(queueitem->host,
-					       queueitem->r_next->host, &same_host) ==
-			    lwc_error_ok && same_host == true) {
-				queueitem = queueitem->r_next;
+	int max_per_host = nsoption_int(max_fetchers_per_host);
+	int max_streams = nsoption_int(max_streams_per_host);
+	struct fetch_host *fhost;
+	int priority;
+
+	if (host_ring == NULL) {
+		return false;
+	}
+
+	for (priority = 0; priority < FETCH_PRIORITY_COUNT; priority++) {
+		fhost = host_ring;
+		do {
+			if ((fhost->queue[priority] != NULL) &&
+			    ((int)fhost->active < (fhost->multiplexed ?
+						   max_streams :
+						   max_per_host))) {
+				/* next host gets the first chance next time */
+				host_ring = fhost->r_next;
+				return fetch_dispatch_job(fhost->queue[priority]);
 			}
-		}
-		queueitem = queueitem->r_next;
-	} while (queueitem != queue_ring);
+			fhost = fhost->r_next;
+		} while (fhost != host_ring);
+	}
+
 	return false;
 }
 
 static void dump_rings(void)
 {
+	struct fetch_host *h;
 	struct fetch *q;
 	struct fetch *f;
+	int priority;
 
-	q = queue_ring;
-	if (q) {
+	h = host_ring;
+	if (h) {
 		do {
-			NSLOG(fetch, DEBUG, "queue_ring: %s",
-			      nsurl_access(q->url));
-			q = q->r_next;
-		} while (q != queue_ring);
+			for (priority = 0;
+			     priority < FETCH_PRIORITY_COUNT;
+			     priority++) {
+				q = h->queue[priority];
+				if (q == NULL) {
+					continue;
+				}
+				do {
+					NSLOG(fetch, DEBUG,
+					      "queue %d: %s", priority,
+					      nsurl_access(q->url));
+					q = q->r_next;
+				} while (q != h->queue[priority]);
+			}
+			h = h->r_next;
+		} while (h != host_ring);
 	}
 	f = fetch_ring;
 	if (f) {
@@ -226,37 +361,36 @@ static void dump_rings(void)
 /**
  * Dispatch as many jobs as we have room to dispatch.
  *
+ * Fetchers without a poll operation make progress from file
+ * descriptor readiness and are not counted as requiring polling. A
+ * fetch whose start was deferred requires polling to be retried.
+ *
  * @return true if there are active fetchers that require polling else false.
  */
 static bool fetch_dispatch_jobs(void)
 {
-	int all_active;
-	int all_queued;
-
-	RING_GETSIZE(struct fetch, queue_ring, all_queued);
-	RING_GETSIZE(struct fetch, fetch_ring, all_active);
+	fetch_start_deferred = false;
 
 	NSLOG(fetch, DEBUG,
-	      "queue_ring %i, fetch_ring %i",
-	      all_queued,
-	      all_active);
+	      "queued %u, active %u",
+	      fetch_queued_count,
+	      fetch_active_count);
 	dump_rings();
 
-	while ((all_queued != 0) &&
-	       (all_active < nsoption_int(max_fetchers)) &&
+	while ((fetch_queued_count != 0) &&
+	       ((int)fetch_active_count < nsoption_int(max_fetchers)) &&
 	       fetch_choose_and_dispatch()) {
-			all_queued--;
-			all_active++;
 			NSLOG(fetch, DEBUG,
-			      "%d queued, %d fetching",
-			      all_queued,
-			      all_active);
+			      "%u queued, %u fetching",
+			      fetch_queued_count,
+			      fetch_active_count);
 	}
 
-	NSLOG(fetch, DEBUG, "Fetch ring is now %d elements.", all_active);
-	NSLOG(fetch, DEBUG, "Queue ring is now %d elements.", all_queued);
+	NSLOG(fetch, DEBUG, "Fetch ring is now %u elements.",
+	      fetch_active_count);
+	NSLOG(fetch, DEBUG, "Queue is now %u elements.", fetch_queued_count);
 
-	return (all_active > 0);
+	return ((fetch_polled_count > 0) || fetch_start_deferred);
 }
 
 static void fetcher_poll(void *unused)
@@ -266,7 +400,8 @@ static void fetcher_poll(void *unused)
 	if (fetch_dispatch_jobs()) {
 		NSLOG(fetch, DEBUG, "Polling fetchers");
 		for (fetcherd = 0; fetcherd < MAX_FETCHERS; fetcherd++) {
-			if (fetchers[fetcherd].refcount > 0) {
+			if ((fetchers[fetcherd].refcount > 0) &&
+			    (fetchers[fetcherd].ops.poll != NULL)) {
 				/* fetcher present */
 				fetchers[fetcherd].ops.poll(fetchers[fetcherd].scheme);
 			}
@@ -322,6 +457,21 @@ nserror fetcher_init(void)
 void fetcher_quit(void)
 {
 	int fetcherd; /* fetcher index */
+	int priority;
+
+	for (priority = 0; priority < FETCH_PRIORITY_COUNT; priority++) {
+		struct fetch_wait_stats *stats = &fetch_wait[priority];
+
+		if (stats->count == 0) {
+			continue;
+		}
+		NSLOG(fetch, INFO,
+		      "Priority %d fetches %u queue wait mean %ums max %ums",
+		      priority,
+		      stats->count,
+		      (unsigned int)(stats->total / stats->count),
+		      (unsigned int)stats->max);
+	}
 	for (fetcherd = 0; fetcherd < MAX_FETCHERS; fetcherd++) {
 		if (fetchers[fetcherd].refcount > 1) {
 			/* fetcher still has reference at quit. This
@@ -390,6 +540,10 @@ fetch_fdset(fd_set *read_fd_set,
 	int maxfd = -1;
 	int fetcherd; /* fetcher index */
 
+	FD_ZERO(read_fd_set);
+	FD_ZERO(write_fd_set);
+	FD_ZERO(except_fd_set);
+
 	if (!fetch_dispatch_jobs()) {
 		NSLOG(fetch, DEBUG, "No jobs");
 		*maxfd_out = -1;
@@ -399,16 +553,13 @@ fetch_fdset(fd_set *read_fd_set,
 	NSLOG(fetch, DEBUG, "Polling fetchers");
 
 	for (fetcherd = 0; fetcherd < MAX_FETCHERS; fetcherd++) {
-		if (fetchers[fetcherd].refcount > 0) {
+		if ((fetchers[fetcherd].refcount > 0) &&
+		    (fetchers[fetcherd].ops.poll != NULL)) {
 			/* fetcher present */
 			fetchers[fetcherd].ops.poll(fetchers[fetcherd].scheme);
 		}
 	}
 
-	FD_ZERO(read_fd_set);
-	FD_ZERO(write_fd_set);
-	FD_ZERO(except_fd_set);
-
 	for (fetcherd = 0; fetcherd < MAX_FETCHERS; fetcherd++) {
 		if ((fetchers[fetcherd].refcount > 0) &&
 		    (fetchers[fetcherd].ops.fdset != NULL)) {
@@ -456,6 +607,7 @@ fetch_start(nsurl *url,
 	    bool verifiable,
 	    bool downgrade_tls,
 	    const char *headers[],
+	    enum fetch_priority priority,
 	    struct fetch **fetch_out)
 {
 	struct fetch *fetch;
@@ -493,8 +645,14 @@ fetch_start(nsurl *url,
 	fetch->send_referer = false;
 	fetch->fetcher_handle = NULL;
 	fetch->fetch_is_active = false;
+	fetch->priority = priority;
+	fetch->fhost = NULL;
 	fetch->host = nsurl_get_component(url, NSURL_HOST);
 
+	if (fetch->priority >= FETCH_PRIORITY_COUNT) {
+		fetch->priority = FETCH_PRIORITY_IMAGE;
+	}
+
 	if (referer != NULL) {
 		lwc_string *ref_scheme;
 		fetch->referer = nsurl_ref(referer);
@@ -538,12 +696,29 @@ fetch_start(nsurl *url,
 	/* these aren't needed past here */
 	lwc_string_unref(scheme);
 
+	/* obtain the scheduling state of the host */
+	fetch->fhost = fetch_host_get(fetch->host);
+	if (fetch->fhost == NULL) {
+		if (fetch->host != NULL)
+			lwc_string_unref(fetch->host);
+
+		nsurl_unref(fetch->url);
+
+		if (fetch->referer != NULL)
+			nsurl_unref(fetch->referer);
+
+		free(fetch);
+
+		return NSERROR_NOMEM;
+	}
+
 	/* try and set up the fetch */
 	fetch->fetcher_handle = fetchers[fetch->fetcherd].ops.setup(fetch, url,
 						only_2xx, downgrade_tls,
 						post_urlenc, post_multipart,
 						headers);
 	if (fetch->fetcher_handle == NULL) {
+		fetch_host_release(fetch->fhost);
 
 		if (fetch->host != NULL)
 			lwc_string_unref(fetch->host);
@@ -567,7 +742,10 @@ fetch_start(nsurl *url,
 	fetch_ref_fetcher(fetch->fetcherd);
 
 	/* Dump new fetch in the queue. */
-	RING_INSERT(queue_ring, fetch);
+	nsu_getmonotonic_ms(&fetch->queue_time);
+	RING_INSERT(fetch->fhost->queue[fetch->priority], fetch);
+	fetch->fhost->queued++;
+	fetch_queued_count++;
 
 	/* Ask the queue to run. */
 	if (fetch_dispatch_jobs()) {
@@ -795,27 +973,44 @@ fetch_send_callback(const fetch_msg *msg, struct fetch *fetch)
 /* exported interface documented in content/fetch.h */
 void fetch_remove_from_queues(struct fetch *fetch)
 {
-	int all_active;
-	int all_queued;
+	struct fetch_host *fhost = fetch->fhost;
 
 	NSLOG(fetch, DEBUG,
 	      "Fetch %p, fetcher %p can be freed",
 	      fetch,
 	      fetch->fetcher_handle);
 
+	if (fhost == NULL) {
+		/* already removed */
+		return;
+	}
+
 	/* Go ahead and free the fetch properly now */
 	if (fetch->fetch_is_active) {
 		RING_REMOVE(fetch_ring, fetch);
+		fhost->active--;
+		fetch_active_count--;
+		if (fetchers[fetch->fetcherd].ops.poll != NULL) {
+			fetch_polled_count--;
+		}
 	} else {
-		RING_REMOVE(queue_ring, fetch);
+		RING_REMOVE(fhost->queue[fetch->priority], fetch);
+		fhost->queued--;
+		fetch_queued_count--;
 	}
+	fetch->fhost = NULL;
+	fetch_host_release(fhost);
 
+	NSLOG(fetch, DEBUG, "Fetch ring is now %u elements.",
+	      fetch_active_count);
+	NSLOG(fetch, DEBUG, "Queue is now %u elements.", fetch_queued_count);
 
-	RING_GETSIZE(struct fetch, fetch_ring, all_active);
-	RING_GETSIZE(struct fetch, queue_ring, all_queued);
-
-	NSLOG(fetch, DEBUG, "Fetch ring is now %d elements.", all_active);
-	NSLOG(fetch, DEBUG, "Queue ring is now %d elements.", all_queued);
+	if (fetch_queued_count > 0) {
+		/* event driven fetchers are not polled so the queue
+		 * must be run now there may be room for another fetch
+		 */
+		guit->misc->schedule(0, fetcher_poll, NULL);
+	}
 }
 
 
@@ -827,6 +1022,26 @@ void fetch_set_http_code(struct fetch *fetch, long http_code)
 	fetch->http_code = http_code;
 }
 
+/* exported interface documented in content/fetch.h */
+void fetch_set_multiplexed(struct fetch *fetch)
+{
+	struct fetch_host *fhost = fetch->fhost;
+
+	if ((fhost == NULL) || fhost->multiplexed) {
+		return;
+	}
+
+	NSLOG(fetch, DEBUG, "Fetches to %s are multiplexed",
+	      (fhost->host != NULL) ? lwc_string_data(fhost->host) : "");
+
+	fhost->multiplexed = true;
+
+	if (fhost->queued > 0) {
+		/* more of this host's queued fetches may be started */
+		guit->misc->schedule(0, fetcher_poll, NULL);
+	}
+}
+
 /* exported interface documented in content/fetch.h */
 const char *fetch_get_referer_to_send(struct fetch *fetch)
 {
@@ -89,6 +89,19 @@ struct fetch_multipart_data {
 	bool file; /**< Item is a file */
 };
 
+/**
+ * Fetch priority
+ *
+ * Queued fetches are dispatched in priority order, most urgent first.
+ */
+enum fetch_priority {
+	FETCH_PRIORITY_DOCUMENT = 0, /**< Documents and unclassified fetches */
+	FETCH_PRIORITY_STYLESHEET, /**< Stylesheets */
+	FETCH_PRIORITY_SCRIPT, /**< Scripts */
+	FETCH_PRIORITY_IMAGE, /**< Images and other subresources */
+	FETCH_PRIORITY_COUNT /**< Number of fetch priorities */
+};
+
 typedef void (*fetch_callback)(const fetch_msg *msg, void *p);
 
 /**
@@ -119,6 +132,7 @@ typedef void (*fetch_callback)(const fetch_msg *msg, void *p);
  * \param verifiable
  * \param downgrade_tls
  * \param headers
+ * \param priority The priority of the fetch when it is queued.
  * \param fetch_out ponter to recive new fetch object.
  * \return NSERROR_OK and fetch_out updated else appropriate error code
  */
@@ -126,7 +140,8 @@ nserror fetch_start(nsurl *url, nsurl *referer, fetch_callback callback,
 		    void *p, bool only_2xx, const char *post_urlenc,
 		    const struct fetch_multipart_data *post_multipart,
 		    bool verifiable, bool downgrade_tls,
-		    const char *headers[], struct fetch **fetch_out);
+		    const char *headers[], enum fetch_priority priority,
+		    struct fetch **fetch_out);
 
 /**
  * Abort a fetch.
@@ -212,6 +227,17 @@ void fetch_free(struct fetch *f);
  */
 void fetch_set_http_code(struct fetch *fetch, long http_code);
 
+/**
+ * Note a fetch is multiplexed on a connection with other fetches.
+ *
+ * Fetchers call this once a fetch is known to be carried as a stream
+ * on a shared connection, such as with HTTP/2. The fetch's host is
+ * then limited by the number of streams rather than connections.
+ *
+ * \param fetch The fetch which is multiplexed.
+ */
+void fetch_set_multiplexed(struct fetch *fetch);
+
 /**
  * get the referer from the fetch
  */
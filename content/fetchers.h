@@ -87,6 +87,9 @@ struct fetcher_operation_table {
 
 	/**
 	 * poll a fetcher to let it make progress.
+	 *
+	 * May be NULL for fetchers which make progress from file
+	 * descriptor readiness notifications instead.
 	 */
 	void (*poll)(lwc_string *scheme);
 
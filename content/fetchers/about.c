@@ -319,6 +319,7 @@ static bool fetch_about_imagecache_handler(struct fetch_about_context *ctx)
 				"(from %v images converted more than once)"
 				"</p>\n"
 		"<p>Bitmap of size %w had most (%x) conversions</p>\n"
+		"<p>Entry lookups %y, bitmaps evicted %z (size %A)</p>\n"
 		"<h2>Current image cache contents</h2>\n");
 	if (slen >= (int) (sizeof(buffer))) {
 		goto fetch_about_imagecache_handler_aborted; /* overflow */
@@ -176,6 +176,9 @@ static int curl_fetchers_registered = 0;
 /** Flag for runtime detection of openssl usage */
 static bool curl_with_openssl;
 
+/** Flag for HTTP/2 being negotiated with servers */
+static bool curl_with_http2 = false;
+
 /** Error buffer for cURL. */
 static char fetch_error_buffer[CURL_ERROR_SIZE];
 
@@ -185,6 +188,11 @@ static char fetch_proxy_userpwd[100];
 /** Interlock to prevent initiation during callbacks */
 static bool inside_curl = false;
 
+/** Fetches are driven by socket readiness instead of polling */
+static bool curl_socket_mode = false;
+
+static void fetch_curl_timeout(void *p);
+
 
 /**
  * Initialise a cURL fetcher.
@@ -218,6 +226,10 @@ static void fetch_curl_finalise(lwc_string *scheme)
 
 		curl_easy_cleanup(fetch_blank_curl);
 
+		if (curl_socket_mode) {
+			guit->misc->schedule(-1, fetch_curl_timeout, NULL);
+		}
+
 		codem = curl_multi_cleanup(fetch_curl_multi);
 		if (codem != CURLM_OK)
 			NSLOG(netsurf, INFO,
@@ -1128,6 +1140,21 @@ static bool fetch_curl_process_headers(struct curl_fetch_info *f)
 	http_code = f->http_code;
 	NSLOG(netsurf, INFO, "HTTP status code %li", http_code);
 
+#if LIBCURL_VERSION_NUM >= 0x073200
+	/* 7.50.0 or later can report the negotiated HTTP version */
+	if (curl_with_http2) {
+		long http_version;
+
+		code = curl_easy_getinfo(f->curl_handle,
+					 CURLINFO_HTTP_VERSION,
+					 &http_version);
+		if ((code == CURLE_OK) &&
+		    (http_version == CURL_HTTP_VERSION_2_0)) {
+			fetch_set_multiplexed(f->fetch_handle);
+		}
+	}
+#endif
+
 	if (http_code == 304 && !f->post_urlenc && !f->post_multipart) {
 		/* Not Modified && GET request */
 		msg.type = FETCH_NOTMODIFIED;
@@ -1274,16 +1301,39 @@ static void fetch_curl_done(CURL *curl_handle, CURLcode result)
 }
 
 
+/**
+ * Process messages for completed transfers.
+ */
+static void fetch_curl_process_msgs(void)
+{
+	int queue;
+	CURLMsg *curl_msg;
+
+	curl_msg = curl_multi_info_read(fetch_curl_multi, &queue);
+	while (curl_msg) {
+		switch (curl_msg->msg) {
+			case CURLMSG_DONE:
+				fetch_curl_done(curl_msg->easy_handle,
+						curl_msg->data.result);
+				break;
+			default:
+				break;
+		}
+		curl_msg = curl_multi_info_read(fetch_curl_multi, &queue);
+	}
+}
+
+
 /**
  * Do some work on current fetches.
  *
- * Must be called regularly to make progress on fetches.
+ * Must be called regularly to make progress on fetches when they are
+ * not driven by socket readiness.
  */
 static void fetch_curl_poll(lwc_string *scheme_ignored)
 {
-	int running, queue;
+	int running;
 	CURLMcode codem;
-	CURLMsg *curl_msg;
 
 	if (nsoption_bool(suppress_curl_debug) == false) {
 		fd_set read_fd_set, write_fd_set, exc_fd_set;
@@ -1336,23 +1386,142 @@ static void fetch_curl_poll(lwc_string *scheme_ignored)
 		}
 	} while (codem == CURLM_CALL_MULTI_PERFORM);
 
-	/* process curl results */
-	curl_msg = curl_multi_info_read(fetch_curl_multi, &queue);
-	while (curl_msg) {
-		switch (curl_msg->msg) {
-			case CURLMSG_DONE:
-				fetch_curl_done(curl_msg->easy_handle,
-						curl_msg->data.result);
-				break;
-			default:
-				break;
-		}
-		curl_msg = curl_multi_info_read(fetch_curl_multi, &queue);
+	fetch_curl_process_msgs();
+	inside_curl = false;
+}
+
+
+/**
+ * Perform socket action on the multi handle and process any results.
+ *
+ * \param fd The socket with activity or CURL_SOCKET_TIMEOUT
+ * \param ev_bitmask The CURL_CSELECT_* activity on the socket
+ */
+static void fetch_curl_socket_action(curl_socket_t fd, int ev_bitmask)
+{
+	int running;
+	CURLMcode codem;
+
+	inside_curl = true;
+	codem = curl_multi_socket_action(fetch_curl_multi,
+					 fd,
+					 ev_bitmask,
+					 &running);
+	if (codem != CURLM_OK) {
+		NSLOG(netsurf, WARNING,
+		      "curl_multi_socket_action: %i %s",
+		      codem, curl_multi_strerror(codem));
 	}
+
+	fetch_curl_process_msgs();
 	inside_curl = false;
 }
 
 
+/**
+ * Socket readiness callback from the frontend.
+ *
+ * \param fd The socket which is ready
+ * \param events The ::gui_fd_event readiness of the socket
+ * \param p unused
+ */
+static void fetch_curl_socket_ready(int fd, unsigned int events, void *p)
+{
+	int ev_bitmask = 0;
+
+	if ((events & GUI_FD_READ) != 0) {
+		ev_bitmask |= CURL_CSELECT_IN;
+	}
+	if ((events & GUI_FD_WRITE) != 0) {
+		ev_bitmask |= CURL_CSELECT_OUT;
+	}
+	if ((events & GUI_FD_ERROR) != 0) {
+		ev_bitmask |= CURL_CSELECT_ERR;
+	}
+
+	fetch_curl_socket_action(fd, ev_bitmask);
+}
+
+
+/**
+ * Scheduled callback when the timeout requested by cURL expires.
+ *
+ * \param p unused
+ */
+static void fetch_curl_timeout(void *p)
+{
+	fetch_curl_socket_action(CURL_SOCKET_TIMEOUT, 0);
+}
+
+
+/**
+ * cURL socket callback, updates the frontend socket watch.
+ *
+ * \param easy The easy handle the socket is used by
+ * \param fd The socket
+ * \param what The CURL_POLL_* events cURL is waiting for
+ * \param userp unused
+ * \param socketp unused
+ * \return 0 on success or -1 on error
+ */
+static int
+fetch_curl_socket(CURL *easy, curl_socket_t fd, int what,
+		  void *userp, void *socketp)
+{
+	unsigned int events = 0;
+	nserror res;
+
+	switch (what) {
+	case CURL_POLL_IN:
+		events = GUI_FD_READ;
+		break;
+
+	case CURL_POLL_OUT:
+		events = GUI_FD_WRITE;
+		break;
+
+	case CURL_POLL_INOUT:
+		events = GUI_FD_READ | GUI_FD_WRITE;
+		break;
+
+	case CURL_POLL_REMOVE:
+	default:
+		events = 0;
+		break;
+	}
+
+	res = guit->misc->fd_watch(fd, events, fetch_curl_socket_ready, NULL);
+	if (res != NSERROR_OK) {
+		NSLOG(netsurf, WARNING, "Unable to watch socket %d", fd);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * cURL timer callback, schedules the next timeout action.
+ *
+ * \param multi The multi handle
+ * \param timeout_ms The timeout in ms, 0 for immediately or -1 to
+ *                   remove the timeout.
+ * \param userp unused
+ * \return 0 on success
+ */
+static int
+fetch_curl_timer(CURLM *multi, long timeout_ms, void *userp)
+{
+	if (timeout_ms < 0) {
+		guit->misc->schedule(-1, fetch_curl_timeout, NULL);
+	} else {
+		guit->misc->schedule(timeout_ms, fetch_curl_timeout, NULL);
+	}
+
+	return 0;
+}
+
+
 
 
 /**
@@ -1584,7 +1753,7 @@ nserror fetch_curl_register(void)
 	curl_version_info_data *data;
 	int i;
 	lwc_string *scheme;
-	const struct fetcher_operation_table fetcher_ops = {
+	struct fetcher_operation_table fetcher_ops = {
 		.initialise = fetch_curl_initialise,
 		.acceptable = fetch_curl_can_fetch,
 		.setup = fetch_curl_setup,
@@ -1622,6 +1791,16 @@ nserror fetch_curl_register(void)
 		return NSERROR_INIT_FAILED;
 	}
 
+	data = curl_version_info(CURLVERSION_NOW);
+
+#if LIBCURL_VERSION_NUM >= 0x073200
+	/* 7.50.0 or later can multiplex HTTP/2 and report the version used */
+	if (nsoption_bool(enable_http2) &&
+	    ((data->features & CURL_VERSION_HTTP2) != 0)) {
+		curl_with_http2 = true;
+	}
+#endif
+
 #if LIBCURL_VERSION_NUM >= 0x071e00
 	/* built against 7.30.0 or later: configure caching */
 	{
@@ -1641,6 +1820,52 @@ nserror fetch_curl_register(void)
 	}
 #endif
 
+#if LIBCURL_VERSION_NUM >= 0x073200
+	if (curl_with_http2) {
+		CURLMcode mcode;
+
+		mcode = curl_multi_setopt(fetch_curl_multi,
+					  CURLMOPT_PIPELINING,
+					  CURLPIPE_MULTIPLEX);
+		if (mcode != CURLM_OK) {
+			NSLOG(netsurf, INFO, "Unable to multiplex, disabling HTTP/2");
+			curl_with_http2 = false;
+		}
+#if LIBCURL_VERSION_NUM >= 0x074300
+		/* 7.67.0 or later can limit the streams on a connection */
+		curl_multi_setopt(fetch_curl_multi,
+				  CURLMOPT_MAX_CONCURRENT_STREAMS,
+				  (long)nsoption_int(max_streams_per_host));
+#endif
+	}
+#endif
+
+	if (guit->misc->fd_watch != NULL) {
+		/* frontend can watch sockets so drive fetches from
+		 * socket readiness instead of polling
+		 */
+		CURLMcode mcode;
+
+		mcode = curl_multi_setopt(fetch_curl_multi,
+					  CURLMOPT_SOCKETFUNCTION,
+					  fetch_curl_socket);
+		if (mcode == CURLM_OK) {
+			mcode = curl_multi_setopt(fetch_curl_multi,
+						  CURLMOPT_TIMERFUNCTION,
+						  fetch_curl_timer);
+		}
+		if (mcode == CURLM_OK) {
+			curl_socket_mode = true;
+			fetcher_ops.poll = NULL;
+			fetcher_ops.fdset = NULL;
+		} else {
+			curl_multi_setopt(fetch_curl_multi,
+					  CURLMOPT_SOCKETFUNCTION, NULL);
+		}
+	}
+	NSLOG(netsurf, INFO, "cURL fetches are %s",
+	      curl_socket_mode ? "event driven" : "polled");
+
 	/* Create a curl easy handle with the options that are common to all
 	 *  fetches.
 	 */
@@ -1664,8 +1889,21 @@ nserror fetch_curl_register(void)
 		SETOPT(CURLOPT_VERBOSE, 1);
 	}
 
-	/* Currently we explode if curl uses HTTP2, so force 1.1. */
-	SETOPT(CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+#if LIBCURL_VERSION_NUM >= 0x073200
+	if (curl_with_http2) {
+		/* negotiate HTTP/2 by ALPN on TLS connections and wait
+		 * for a connection which may be multiplexed rather than
+		 * opening another one.
+		 */
+		SETOPT(CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+		SETOPT(CURLOPT_SSL_ENABLE_ALPN, 1L);
+		SETOPT(CURLOPT_PIPEWAIT, 1L);
+	} else
+#endif
+	{
+		/* HTTP/2 is not enabled, so force 1.1. */
+		SETOPT(CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+	}
 
 	SETOPT(CURLOPT_WRITEFUNCTION, fetch_curl_data);
 	SETOPT(CURLOPT_HEADERFUNCTION, fetch_curl_header);
@@ -1711,11 +1949,11 @@ nserror fetch_curl_register(void)
 
 	NSLOG(netsurf, INFO, "cURL %slinked against openssl",
 	      curl_with_openssl ? "" : "not ");
+	NSLOG(netsurf, INFO, "cURL HTTP/2 %s",
+	      curl_with_http2 ? "enabled" : "disabled");
 
 	/* cURL initialised okay, register the fetchers */
 
-	data = curl_version_info(CURLVERSION_NOW);
-
 	for (i = 0; data->protocols[i]; i++) {
 		if (strcmp(data->protocols[i], "http") == 0) {
 			scheme = lwc_string_ref(corestring_lwc_http);
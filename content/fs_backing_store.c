@@ -22,17 +22,17 @@
  *
  * file based backing store.
  *
- * \todo Consider improving eviction sorting to include objects size
+ * \todo Consider improving eviction ordering to include objects size
  *         and remaining lifetime and other cost metrics.
  *
- * \todo Implement mmap retrieval where supported.
- *
  * \todo Implement static retrieval for metadata objects as their heap
  *         lifetime is typically very short, though this may be obsoleted
  *         by a small object storage strategy.
  *
  */
 
+#include "utils/config.h"
+
 #include <unistd.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -41,7 +41,14 @@
 #include <errno.h>
 #include <time.h>
 #include <stdlib.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#ifdef WITH_FS_BACKING_STORE_THREAD
+#include <pthread.h>
+#endif
 #include <nsutils/unistd.h>
+#include <nsutils/time.h>
 
 #include "netsurf/inttypes.h"
 #include "utils/filepath.h"
@@ -66,6 +73,12 @@
 /** Number of milliseconds after a update before control data maintenance is performed  */
 #define CONTROL_MAINT_TIME 10000
 
+/** Maximum number of outstanding asynchronous write requests */
+#define WRITE_QUEUE_LENGTH 64
+
+/** Number of milliseconds between checks for completed asynchronous writes */
+#define WRITE_POLL_TIME 50
+
 /** Get address from ident */
 #define BS_ADDRESS(ident, state) ((ident) & ((1 << state->ident_bits) - 1))
 
@@ -99,6 +112,9 @@
 /** length in bytes of a block files use map */
 #define BLOCK_USE_MAP_SIZE (1 << (BLOCK_ENTRY_COUNT - 3))
 
+/** smallest mapping made of a block file (1MiB) */
+#define BLOCK_MAP_MIN_SIZE (1 << 20)
+
 /**
  * The type used to store index values referring to store entries. Care
  * must be taken with this type as it is used to build address to
@@ -154,6 +170,54 @@ enum store_entry_flags {
 	ENTRY_FLAGS_INVALID = 1,
 };
 
+#ifdef WITH_FS_BACKING_STORE_THREAD
+/**
+ * Asynchronous write request.
+ *
+ * A request is set up on the main thread, written by the writer
+ * thread and completed back on the main thread. The request holds a
+ * reference to the entry element allocation for its lifetime.
+ */
+struct store_write_req {
+	struct store_write_req *next; /**< next request in queue */
+	nsurl *url; /**< url the object is stored under */
+	enum backing_store_flags flags; /**< flags the object was stored with */
+	entry_ident_t ident; /**< ident of the entry being written */
+	int elem_idx; /**< element index within the entry */
+	int fd; /**< file descriptor to write to */
+	bool close_fd; /**< the fd must be closed once written */
+	off_t offset; /**< offset within the file to write at */
+	const uint8_t *data; /**< data to write */
+	size_t size; /**< length of data to write */
+	backing_store_complete_cb *cb; /**< completion callback */
+	void *pw; /**< completion callback context */
+	ssize_t written; /**< result of the write */
+	int err; /**< errno if the write failed */
+	unsigned long elapsed; /**< time taken by the write in ms */
+};
+
+/**
+ * Background writer thread state.
+ *
+ * The queue and done lists are shared with the writer thread and
+ * must only be accessed with the lock held.
+ */
+struct store_writer {
+	pthread_t thread; /**< the writer thread */
+	pthread_mutex_t lock; /**< lock protecting the request lists */
+	pthread_cond_t cond; /**< signalled when a request is queued */
+	bool quit; /**< writer thread should exit once queue is empty */
+
+	struct store_write_req *queue; /**< requests waiting to be written */
+	struct store_write_req **queue_tail; /**< end of queue list */
+	struct store_write_req *done; /**< requests which have been written */
+	struct store_write_req **done_tail; /**< end of done list */
+
+	/** number of requests not yet completed, main thread only */
+	unsigned int outstanding;
+};
+#endif
+
 /**
  * Backing store entry element.
  *
@@ -200,6 +264,12 @@ struct block_file {
 	int fd;
 	/** map of used and unused entries within the block file */
 	uint8_t use_map[BLOCK_USE_MAP_SIZE];
+#ifdef HAVE_MMAP
+	/** read only mapping of the start of the block file or NULL */
+	uint8_t *map;
+	/** length of the mapping in bytes */
+	size_t map_size;
+#endif
 };
 
 /**
@@ -241,6 +311,24 @@ struct store_state {
 	 */
 	entry_index_t *addrmap;
 
+	/**
+	 * Eviction order index.
+	 *
+	 * A binary min heap of entry indexes ordered by use count and
+	 * then last use time with the root at index 1. The least
+	 * valuable entry is always at the root so eviction does not
+	 * require the entries to be sorted.
+	 */
+	entry_index_t *evict_heap;
+
+	/**
+	 * Position of each entry within the eviction heap indexed by
+	 * entry index or 0 if the entry is not in the heap.
+	 */
+	entry_index_t *evict_pos;
+
+	unsigned int evict_count; /**< number of entries in eviction heap */
+
 
 	/** small block indexes */
 	struct block_file blocks[ENTRY_ELEM_COUNT][BLOCK_FILE_COUNT];
@@ -255,6 +343,10 @@ struct store_state {
 	 */
 	bool blocks_opened;
 
+#ifdef WITH_FS_BACKING_STORE_THREAD
+	/** background writer or NULL if writes are synchronous */
+	struct store_writer *writer;
+#endif
 
 	/* stats */
 	uint64_t total_alloc; /**< total size of all allocated storage. */
@@ -274,6 +366,132 @@ struct store_state {
 struct store_state *storestate;
 
 
+/**
+ * Compare the eviction priority of two entries.
+ *
+ * @param state The store state to use.
+ * @param a The index of the first entry.
+ * @param b The index of the second entry.
+ * @return true if entry \a a should be evicted before entry \a b
+ */
+static inline bool
+evict_before(struct store_state *state, entry_index_t a, entry_index_t b)
+{
+	const struct store_entry *ea = &state->entries[a];
+	const struct store_entry *eb = &state->entries[b];
+
+	if (ea->use_count != eb->use_count) {
+		return ea->use_count < eb->use_count;
+	}
+	return ea->last_used < eb->last_used;
+}
+
+/**
+ * Place an entry at a position in the eviction heap.
+ */
+static inline void
+evict_heap_set(struct store_state *state, unsigned int pos, entry_index_t sei)
+{
+	state->evict_heap[pos] = sei;
+	state->evict_pos[sei] = pos;
+}
+
+/**
+ * Restore eviction heap order for an entry whose priority has changed.
+ *
+ * @param state The store state to use.
+ * @param pos The heap position of the entry.
+ */
+static void evict_heap_update(struct store_state *state, unsigned int pos)
+{
+	entry_index_t sei = state->evict_heap[pos];
+	unsigned int child;
+
+	/* move towards the root */
+	while ((pos > 1) &&
+	       evict_before(state, sei, state->evict_heap[pos / 2])) {
+		evict_heap_set(state, pos, state->evict_heap[pos / 2]);
+		pos /= 2;
+	}
+
+	/* move away from the root */
+	while ((child = pos * 2) <= state->evict_count) {
+		if ((child < state->evict_count) &&
+		    evict_before(state,
+				 state->evict_heap[child + 1],
+				 state->evict_heap[child])) {
+			child++;
+		}
+		if (!evict_before(state, state->evict_heap[child], sei)) {
+			break;
+		}
+		evict_heap_set(state, pos, state->evict_heap[child]);
+		pos = child;
+	}
+
+	evict_heap_set(state, pos, sei);
+}
+
+/**
+ * Add an entry to the eviction heap.
+ *
+ * @param state The store state to use.
+ * @param sei The index of the entry to add.
+ */
+static void evict_heap_insert(struct store_state *state, entry_index_t sei)
+{
+	state->evict_count++;
+	evict_heap_set(state, state->evict_count, sei);
+	evict_heap_update(state, state->evict_count);
+}
+
+/**
+ * Remove an entry from the eviction heap.
+ *
+ * @param state The store state to use.
+ * @param sei The index of the entry to remove.
+ */
+static void evict_heap_remove(struct store_state *state, entry_index_t sei)
+{
+	unsigned int pos = state->evict_pos[sei];
+	entry_index_t last;
+
+	if (pos == 0) {
+		/* not in heap */
+		return;
+	}
+
+	last = state->evict_heap[state->evict_count];
+	state->evict_count--;
+	state->evict_pos[sei] = 0;
+
+	if (pos <= state->evict_count) {
+		/* fill the hole with the last entry and restore order */
+		evict_heap_set(state, pos, last);
+		evict_heap_update(state, pos);
+	}
+}
+
+/**
+ * Build the eviction heap from all the entries.
+ *
+ * @param state The store state to use.
+ */
+static void evict_heap_build(struct store_state *state)
+{
+	unsigned int pos;
+
+	state->evict_count = state->last_entry - 1;
+
+	for (pos = 1; pos < state->last_entry; pos++) {
+		evict_heap_set(state, pos, pos);
+	}
+
+	for (pos = state->evict_count / 2; pos > 0; pos--) {
+		evict_heap_update(state, pos);
+	}
+}
+
 /**
  * Remove a backing store entry from the entry table.
  *
@@ -301,6 +519,9 @@ remove_store_entry(struct store_state *state, struct store_entry **bse)
 	/* remove entry from map */
 	BS_ENTRY_INDEX((*bse)->ident, state) = 0;
 
+	/* remove entry from eviction order */
+	evict_heap_remove(state, sei);
+
 	/* global allocation accounting  */
 	state->total_alloc -= state->entries[sei].elem[ENTRY_ELEM_DATA].size;
 	state->total_alloc -= state->entries[sei].elem[ENTRY_ELEM_META].size;
@@ -321,6 +542,13 @@ remove_store_entry(struct store_state *state, struct store_entry **bse)
 		/* update map for moved entry */
 		BS_ENTRY_INDEX(state->entries[sei].ident, state) = sei;
 
+		/* update eviction heap for moved entry */
+		state->evict_pos[sei] = state->evict_pos[state->last_entry];
+		if (state->evict_pos[sei] != 0) {
+			state->evict_heap[state->evict_pos[sei]] = sei;
+		}
+		state->evict_pos[state->last_entry] = 0;
+
 		*bse = &state->entries[state->last_entry];
 	}
 
@@ -546,52 +774,6 @@ invalidate_entry(struct store_state *state, struct store_entry *bse)
 }
 
 
-/**
- * Quick sort comparison.
- */
-static int compar(const void *va, const void *vb)
-{
-	const struct store_entry *a = &BS_ENTRY(*(entry_ident_t *)va, storestate);
-	const struct store_entry *b = &BS_ENTRY(*(entry_ident_t *)vb, storestate);
-
-	/* consider the allocation flags - if an entry has an
-	 * allocation it is considered more valuable as it cannot be
-	 * freed.
-	 */
-	if ((a->elem[ENTRY_ELEM_DATA].flags == ENTRY_ELEM_FLAG_NONE) &&
-	    (b->elem[ENTRY_ELEM_DATA].flags != ENTRY_ELEM_FLAG_NONE)) {
-		return -1;
-	} else if ((a->elem[ENTRY_ELEM_DATA].flags != ENTRY_ELEM_FLAG_NONE) &&
-		   (b->elem[ENTRY_ELEM_DATA].flags == ENTRY_ELEM_FLAG_NONE)) {
-		return 1;
-	}
-
-	if ((a->elem[ENTRY_ELEM_META].flags == ENTRY_ELEM_FLAG_NONE) &&
-	    (b->elem[ENTRY_ELEM_META].flags != ENTRY_ELEM_FLAG_NONE)) {
-		return -1;
-	} else if ((a->elem[ENTRY_ELEM_META].flags != ENTRY_ELEM_FLAG_NONE) &&
-		   (b->elem[ENTRY_ELEM_META].flags == ENTRY_ELEM_FLAG_NONE)) {
-		return 1;
-	}
-
-	if (a->use_count < b->use_count) {
-		return -1;
-	} else if (a->use_count > b->use_count) {
-		return 1;
-	}
-	/* use count is the same - now consider last use time */
-
-	if (a->last_used < b->last_used) {
-		return -1;
-	} else if (a->last_used > b->last_used) {
-		return 1;
-	}
-
-	/* they are the same */
-	return 0;
-}
-
-
 /**
  * Evict entries from backing store as per configuration.
  *
@@ -608,10 +790,13 @@ static int compar(const void *va, const void *vb)
  */
 static nserror store_evict(struct store_state *state)
 {
-	entry_ident_t *elist; /* sorted list of entry identifiers */
-	unsigned int ent;
-	unsigned int ent_count;
+	entry_ident_t *inuse = NULL; /* entries passed over as in use */
+	unsigned int inuse_count = 0;
+	unsigned int inuse_alloc = 0;
+	unsigned int ent = 0;
+	unsigned int iloop;
 	size_t removed; /* size of removed entries */
+	struct store_entry *bse;
 	nserror ret = NSERROR_OK;
 
 	/* check if the cache has exceeded configured limit */
@@ -626,25 +811,35 @@ static nserror store_evict(struct store_state *state)
 	      state->total_alloc,
 	      state->hysteresis);
 
-	/* allocate storage for the list */
-	elist = malloc(sizeof(entry_ident_t) * state->last_entry);
-	if (elist == NULL) {
-		return NSERROR_NOMEM;
-	}
-
-	/* sort the list avoiding entry 0 which is the empty sentinel */
-	for (ent = 1; ent < state->last_entry; ent++) {
-		elist[ent - 1] = state->entries[ent].ident;
-	}
-	ent_count = ent - 1; /* important to keep this as the entry count will change when entries are removed */
-	qsort(elist, ent_count, sizeof(entry_ident_t), compar);
-
-	/* evict entries in listed order */
+	/* evict the least valuable entries from the heap root */
 	removed = 0;
-	for (ent = 0; ent < ent_count; ent++) {
-		struct store_entry *bse;
+	while ((removed <= state->hysteresis) && (state->evict_count > 0)) {
+		entry_index_t sei = state->evict_heap[1];
+
+		bse = &state->entries[sei];
 
-		bse = &BS_ENTRY(elist[ent], state);
+		/* an entry with an allocation is considered more
+		 * valuable as it cannot be freed so it is set aside
+		 * and only evicted if nothing else remains.
+		 */
+		if ((bse->elem[ENTRY_ELEM_DATA].flags != ENTRY_ELEM_FLAG_NONE) ||
+		    (bse->elem[ENTRY_ELEM_META].flags != ENTRY_ELEM_FLAG_NONE)) {
+			if (inuse_count == inuse_alloc) {
+				entry_ident_t *ninuse;
+
+				inuse_alloc += 16;
+				ninuse = realloc(inuse,
+						 inuse_alloc * sizeof(entry_ident_t));
+				if (ninuse == NULL) {
+					ret = NSERROR_NOMEM;
+					break;
+				}
+				inuse = ninuse;
+			}
+			inuse[inuse_count++] = bse->ident;
+			evict_heap_remove(state, sei);
+			continue;
+		}
 
 		removed += bse->elem[ENTRY_ELEM_DATA].size;
 		removed += bse->elem[ENTRY_ELEM_META].size;
@@ -653,13 +848,28 @@ static nserror store_evict(struct store_state *state)
 		if (ret != NSERROR_OK) {
 			break;
 		}
+		ent++;
+	}
 
-		if (removed > state->hysteresis) {
-			break;
+	/* return entries which were set aside, evicting them in order
+	 * if still required.
+	 */
+	for (iloop = 0; iloop < inuse_count; iloop++) {
+		entry_index_t sei = BS_ENTRY_INDEX(inuse[iloop], state);
+
+		evict_heap_insert(state, sei);
+
+		if ((ret == NSERROR_OK) && (removed <= state->hysteresis)) {
+			bse = &state->entries[sei];
+
+			removed += bse->elem[ENTRY_ELEM_DATA].size;
+			removed += bse->elem[ENTRY_ELEM_META].size;
+
+			ret = invalidate_entry(state, bse);
+			ent++;
 		}
 	}
-
-	free(elist);
+	free(inuse);
 
 	NSLOG(netsurf, INFO, "removed %"PRIsizet" in %d entries", removed,
 	      ent);
@@ -919,6 +1129,11 @@ get_store_entry(struct store_state *state, nsurl *url, struct store_entry **bse)
 	state->entries[sei].last_used = time(NULL);
 	state->entries[sei].use_count++;
 
+	/* entry has become more valuable */
+	if (state->evict_pos[sei] != 0) {
+		evict_heap_update(state, state->evict_pos[sei]);
+	}
+
 	state->entries_dirty = true;
 
 	guit->misc->schedule(CONTROL_MAINT_TIME, control_maintinance, state);
@@ -1049,6 +1264,13 @@ set_store_entry(struct store_state *state,
 	se->use_count = 1;
 	se->last_used = time(NULL);
 
+	/* update eviction order */
+	if (state->evict_pos[sei] == 0) {
+		evict_heap_insert(state, sei);
+	} else {
+		evict_heap_update(state, state->evict_pos[sei]);
+	}
+
 	/* store the data in the element */
 	elem->flags |= ENTRY_ELEM_FLAG_HEAP;
 	elem->data = data;
@@ -1130,7 +1352,8 @@ store_open(struct store_state *state,
  * (its unique key) to filesystem entry.
  *
  * As the entire entry list must be iterated over to construct the map
- * we also compute the total storage in use.
+ * we also compute the total storage in use and build the eviction
+ * order index.
  *
  * @param state The backing store global state.
  * @return NSERROR_OK on success or NSERROR_NOMEM if the map storage
@@ -1150,6 +1373,15 @@ build_entrymap(struct store_state *state)
 		return NSERROR_NOMEM;
 	}
 
+	state->evict_heap = malloc((1 << state->entry_bits) * sizeof(entry_index_t));
+	state->evict_pos = calloc(1 << state->entry_bits, sizeof(entry_index_t));
+	if ((state->evict_heap == NULL) || (state->evict_pos == NULL)) {
+		free(state->evict_heap);
+		free(state->evict_pos);
+		free(state->addrmap);
+		return NSERROR_NOMEM;
+	}
+
 	state->total_alloc = 0;
 
 	for (eloop = 1; eloop < state->last_entry; eloop++) {
@@ -1171,6 +1403,9 @@ build_entrymap(struct store_state *state)
 		state->entries[eloop].elem[ENTRY_ELEM_META].flags &= ~(ENTRY_ELEM_FLAG_HEAP | ENTRY_ELEM_FLAG_MMAP);
 	}
 
+	/* order the entries for eviction */
+	evict_heap_build(state);
+
 	return NSERROR_OK;
 }
 
@@ -1474,6 +1709,489 @@ control_error: /* problem with the control file */
 }
 
 
+/**
+ * release any allocation for an entry
+ */
+static nserror entry_release_alloc(struct store_entry_element *elem)
+{
+	if ((elem->flags & ENTRY_ELEM_FLAG_HEAP) != 0) {
+		elem->ref--;
+		if (elem->ref == 0) {
+			NSLOG(netsurf, INFO, "freeing %p", elem->data);
+			free(elem->data);
+			elem->flags &= ~ENTRY_ELEM_FLAG_HEAP;
+		}
+	} else if ((elem->flags & ENTRY_ELEM_FLAG_MMAP) != 0) {
+		elem->ref--;
+		if (elem->ref == 0) {
+			/* the block file mapping persists, only the
+			 * reference into it is dropped.
+			 */
+			elem->data = NULL;
+			elem->flags &= ~ENTRY_ELEM_FLAG_MMAP;
+		}
+	}
+	return NSERROR_OK;
+}
+
+
+/**
+ * Ensure the file descriptor for a block file is open.
+ *
+ * \param state The backing store state to use.
+ * \param elem_idx The element index the block file stores.
+ * \param bf The block file index.
+ * \return The file descriptor or -1 on error.
+ */
+static int
+store_block_fd(struct store_state *state, int elem_idx, block_index_t bf)
+{
+	if (state->blocks[elem_idx][bf].fd == -1) {
+		state->blocks[elem_idx][bf].fd = store_open(state, bf,
+				elem_idx + ENTRY_ELEM_COUNT, O_CREAT | O_RDWR);
+		if (state->blocks[elem_idx][bf].fd == -1) {
+			NSLOG(netsurf, INFO, "Open failed errno %d", errno);
+			return -1;
+		}
+
+		/* flag that a block file has been opened */
+		state->blocks_opened = true;
+	}
+	return state->blocks[elem_idx][bf].fd;
+}
+
+
+#ifdef HAVE_MMAP
+/**
+ * Check if any element references the mapping of a block file.
+ *
+ * \param state The backing store state to use.
+ * \param elem_idx The element index the block file stores.
+ * \param bf The block file index, or -1 for any block file.
+ * \return true if the mapping is referenced else false.
+ */
+static bool
+store_block_map_referenced(struct store_state *state, int elem_idx, int bf)
+{
+	struct store_entry_element *elem;
+	unsigned int eloop;
+
+	for (eloop = 1; eloop < state->last_entry; eloop++) {
+		elem = &state->entries[eloop].elem[elem_idx];
+		if (((elem->flags & ENTRY_ELEM_FLAG_MMAP) != 0) &&
+		    ((bf == -1) ||
+		     (((elem->block >> BLOCK_ENTRY_COUNT) &
+		       ((1 << BLOCK_FILE_COUNT) - 1)) == bf))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/**
+ * Ensure the start of a block file is mapped into memory.
+ *
+ * Only the written extent of the block file is mapped so the address
+ * space used follows the size of the cache. The mapping is grown, at
+ * least doubling, when a block beyond it is required and nothing
+ * references the existing mapping. When the mapping cannot be made or
+ * grown the caller reads the block instead.
+ *
+ * \param state The backing store state to use.
+ * \param elem_idx The element index the block file stores.
+ * \param bf The block file index.
+ * \param end The offset of the end of the data required in the file.
+ * \return The mapping or NULL if the data is not mapped.
+ */
+static uint8_t *
+store_block_map(struct store_state *state,
+		int elem_idx,
+		block_index_t bf,
+		size_t end)
+{
+	struct block_file *bfile = &state->blocks[elem_idx][bf];
+	size_t extent;
+	size_t map_size;
+	struct stat sb;
+	void *map;
+
+	if ((bfile->map != NULL) && (end <= bfile->map_size)) {
+		return bfile->map;
+	}
+
+	if (store_block_fd(state, elem_idx, bf) == -1) {
+		return NULL;
+	}
+
+	if (fstat(bfile->fd, &sb) != 0) {
+		NSLOG(netsurf, INFO, "Stat failed errno %d", errno);
+		return NULL;
+	}
+
+	if ((off_t)end > sb.st_size) {
+		/* data is not within the file */
+		return NULL;
+	}
+
+	if (bfile->map != NULL) {
+		if (store_block_map_referenced(state, elem_idx, bf)) {
+			/* the existing mapping cannot be replaced */
+			return NULL;
+		}
+		munmap(bfile->map, bfile->map_size);
+		bfile->map = NULL;
+	}
+
+	/* map the written extent, growing by at least double */
+	extent = (size_t)1 << (log2_block_size[elem_idx] + BLOCK_ENTRY_COUNT);
+	map_size = bfile->map_size * 2;
+	if (map_size < BLOCK_MAP_MIN_SIZE) {
+		map_size = BLOCK_MAP_MIN_SIZE;
+	}
+	if (map_size < (size_t)sb.st_size) {
+		map_size = sb.st_size;
+	}
+	if (map_size > extent) {
+		map_size = extent;
+	}
+	bfile->map_size = 0;
+
+	map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, bfile->fd, 0);
+	if (map == MAP_FAILED) {
+		NSLOG(netsurf, INFO, "Map failed errno %d", errno);
+		return NULL;
+	}
+
+	NSLOG(netsurf, INFO, "Mapped %"PRIsizet" bytes of block file %d at %p",
+	      map_size, bf, map);
+
+	bfile->map = map;
+	bfile->map_size = map_size;
+
+	return bfile->map;
+}
+
+
+/**
+ * Unmap all block files.
+ *
+ * The mappings are left in place if any element still references
+ * them as the data must remain valid for its user.
+ *
+ * \param state The backing store state to use.
+ */
+static void store_block_unmap(struct store_state *state)
+{
+	int elem_idx;
+	int bf;
+
+	for (elem_idx = 0; elem_idx < ENTRY_ELEM_COUNT; elem_idx++) {
+		if (store_block_map_referenced(state, elem_idx, -1)) {
+			NSLOG(netsurf, INFO,
+			      "Block file mappings still referenced");
+			return;
+		}
+	}
+
+	for (elem_idx = 0; elem_idx < ENTRY_ELEM_COUNT; elem_idx++) {
+		for (bf = 0; bf < BLOCK_FILE_COUNT; bf++) {
+			if (state->blocks[elem_idx][bf].map != NULL) {
+				munmap(state->blocks[elem_idx][bf].map,
+				       state->blocks[elem_idx][bf].map_size);
+				state->blocks[elem_idx][bf].map = NULL;
+				state->blocks[elem_idx][bf].map_size = 0;
+			}
+		}
+	}
+}
+
+
+/**
+ * Reference an element of an entry within its mapped block file.
+ *
+ * \param state The backing store state to use.
+ * \param bse The entry to reference.
+ * \param elem_idx The element index within the entry.
+ * \return NSERROR_OK on success or error code.
+ */
+static nserror store_map_block(struct store_state *state,
+			       struct store_entry *bse,
+			       int elem_idx)
+{
+	struct store_entry_element *elem = &bse->elem[elem_idx];
+	block_index_t bf = (elem->block >> BLOCK_ENTRY_COUNT) &
+		((1 << BLOCK_FILE_COUNT) - 1); /* block file block resides in */
+	block_index_t bi = elem->block & ((1U << BLOCK_ENTRY_COUNT) - 1); /* block index in file */
+	size_t offset = (size_t)bi << log2_block_size[elem_idx];
+	uint8_t *map;
+
+	map = store_block_map(state, elem_idx, bf, offset + elem->size);
+	if (map == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	elem->data = map + offset;
+	elem->flags |= ENTRY_ELEM_FLAG_MMAP;
+	elem->ref = 1;
+
+	NSLOG(netsurf, INFO, "Mapped %d bytes at %p block %d",
+	      elem->size, elem->data, elem->block);
+
+	return NSERROR_OK;
+}
+#endif
+
+
+#ifdef WITH_FS_BACKING_STORE_THREAD
+
+/**
+ * Background writer thread.
+ *
+ * Performs the writes for queued requests and moves them to the done
+ * list. Only the request and its file descriptor are touched without
+ * the lock held, all store state is left to the main thread.
+ *
+ * \param p The writer state.
+ * \return NULL
+ */
+static void *store_writer_thread(void *p)
+{
+	struct store_writer *writer = p;
+	struct store_write_req *req;
+	uint64_t start_ms;
+	uint64_t end_ms;
+
+	pthread_mutex_lock(&writer->lock);
+	while (true) {
+		while ((writer->queue == NULL) && (writer->quit == false)) {
+			pthread_cond_wait(&writer->cond, &writer->lock);
+		}
+
+		req = writer->queue;
+		if (req == NULL) {
+			/* asked to quit and the queue is drained */
+			break;
+		}
+		writer->queue = req->next;
+		if (writer->queue == NULL) {
+			writer->queue_tail = &writer->queue;
+		}
+		pthread_mutex_unlock(&writer->lock);
+
+		nsu_getmonotonic_ms(&start_ms);
+		req->written = nsu_pwrite(req->fd,
+					  req->data,
+					  req->size,
+					  req->offset);
+		req->err = errno;
+		if (req->close_fd) {
+			close(req->fd);
+		}
+		nsu_getmonotonic_ms(&end_ms);
+		req->elapsed = end_ms - start_ms;
+
+		pthread_mutex_lock(&writer->lock);
+		req->next = NULL;
+		*writer->done_tail = req;
+		writer->done_tail = &req->next;
+	}
+	pthread_mutex_unlock(&writer->lock);
+
+	return NULL;
+}
+
+
+/**
+ * Complete an asynchronous write request on the main thread.
+ *
+ * Drops the reference the request held on the element allocation,
+ * invalidates the entry if the write failed and informs the caller.
+ *
+ * \param state The backing store state to use.
+ * \param req The request to complete, it is freed.
+ */
+static void
+store_writer_complete(struct store_state *state, struct store_write_req *req)
+{
+	struct store_entry *bse = NULL;
+	entry_index_t sei;
+	nserror res = NSERROR_OK;
+
+	if (req->written != (ssize_t)req->size) {
+		NSLOG(netsurf, INFO,
+		      "Write failed %"PRIssizet" of %"PRIsizet" bytes from %p ident 0x%08x errno %d",
+		      req->written,
+		      req->size,
+		      req->data,
+		      req->ident,
+		      req->err);
+		res = NSERROR_SAVE_FAILED;
+	} else {
+		NSLOG(netsurf, INFO,
+		      "Wrote %"PRIssizet" bytes from %p in %lums",
+		      req->written,
+		      req->data,
+		      req->elapsed);
+	}
+
+	/* the entry cannot have been removed while the request held a
+	 * reference to its allocation.
+	 */
+	sei = BS_ENTRY_INDEX(req->ident, state);
+	if ((sei != 0) && (state->entries[sei].ident == req->ident)) {
+		bse = &state->entries[sei];
+	}
+
+	if (bse != NULL) {
+		if (res != NSERROR_OK) {
+			/* the on disc data is bad */
+			bse->flags |= ENTRY_FLAGS_INVALID;
+		}
+
+		entry_release_alloc(&bse->elem[req->elem_idx]);
+
+		if ((bse->flags & ENTRY_FLAGS_INVALID) != 0) {
+			invalidate_entry(state, bse);
+		}
+	}
+
+	state->writer->outstanding--;
+
+	if (req->cb != NULL) {
+		req->cb(req->url,
+			req->flags,
+			res,
+			(res == NSERROR_OK) ? req->size : 0,
+			req->elapsed,
+			req->pw);
+	}
+
+	nsurl_unref(req->url);
+	free(req);
+}
+
+
+/**
+ * Complete all asynchronous writes the writer thread has finished.
+ *
+ * \param state The backing store state to use.
+ */
+static void store_writer_collect(struct store_state *state)
+{
+	struct store_writer *writer = state->writer;
+	struct store_write_req *done;
+	struct store_write_req *next;
+
+	pthread_mutex_lock(&writer->lock);
+	done = writer->done;
+	writer->done = NULL;
+	writer->done_tail = &writer->done;
+	pthread_mutex_unlock(&writer->lock);
+
+	while (done != NULL) {
+		next = done->next;
+		store_writer_complete(state, done);
+		done = next;
+	}
+}
+
+
+/**
+ * Scheduled poll for completed asynchronous writes.
+ *
+ * Reschedules itself while there are requests outstanding.
+ *
+ * \param s The backing store state.
+ */
+static void store_writer_poll(void *s)
+{
+	struct store_state *state = s;
+
+	store_writer_collect(state);
+
+	if (state->writer->outstanding > 0) {
+		guit->misc->schedule(WRITE_POLL_TIME, store_writer_poll, state);
+	}
+}
+
+
+/**
+ * Start the background writer thread.
+ *
+ * \param state The backing store state to use.
+ * \return NSERROR_OK on success or error code on failure.
+ */
+static nserror store_writer_init(struct store_state *state)
+{
+	struct store_writer *writer;
+
+	writer = calloc(1, sizeof(struct store_writer));
+	if (writer == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	writer->queue_tail = &writer->queue;
+	writer->done_tail = &writer->done;
+
+	if (pthread_mutex_init(&writer->lock, NULL) != 0) {
+		free(writer);
+		return NSERROR_INIT_FAILED;
+	}
+
+	if (pthread_cond_init(&writer->cond, NULL) != 0) {
+		pthread_mutex_destroy(&writer->lock);
+		free(writer);
+		return NSERROR_INIT_FAILED;
+	}
+
+	if (pthread_create(&writer->thread, NULL,
+			   store_writer_thread, writer) != 0) {
+		pthread_cond_destroy(&writer->cond);
+		pthread_mutex_destroy(&writer->lock);
+		free(writer);
+		return NSERROR_INIT_FAILED;
+	}
+
+	state->writer = writer;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Stop the background writer thread.
+ *
+ * All queued writes are performed and completed before returning.
+ *
+ * \param state The backing store state to use.
+ */
+static void store_writer_fini(struct store_state *state)
+{
+	struct store_writer *writer = state->writer;
+
+	if (writer == NULL) {
+		return;
+	}
+
+	guit->misc->schedule(-1, store_writer_poll, state);
+
+	pthread_mutex_lock(&writer->lock);
+	writer->quit = true;
+	pthread_cond_signal(&writer->cond);
+	pthread_mutex_unlock(&writer->lock);
+
+	pthread_join(writer->thread, NULL);
+
+	store_writer_collect(state);
+
+	pthread_cond_destroy(&writer->cond);
+	pthread_mutex_destroy(&writer->lock);
+	free(writer);
+	state->writer = NULL;
+}
+
+#endif
 
 
 /* Functions exported in the backing store table */
@@ -1574,6 +2292,8 @@ initialise(const struct llcache_store_parameters *parameters)
 	ret = read_blocks(newstate);
 	if (ret != NSERROR_OK) {
 		/* oh dear */
+		free(newstate->evict_pos);
+		free(newstate->evict_heap);
 		free(newstate->addrmap);
 		free(newstate->entries);
 		free(newstate->path);
@@ -1581,6 +2301,15 @@ initialise(const struct llcache_store_parameters *parameters)
 		return ret;
 	}
 
+#ifdef WITH_FS_BACKING_STORE_THREAD
+	ret = store_writer_init(newstate);
+	if (ret != NSERROR_OK) {
+		/* not fatal, writes are simply performed synchronously */
+		NSLOG(netsurf, INFO, "Unable to start writer thread %s",
+		      messages_get_errorcode(ret));
+	}
+#endif
+
 	storestate = newstate;
 
 	NSLOG(netsurf, INFO, "FS backing store init successful");
@@ -1614,10 +2343,18 @@ finalise(void)
 	unsigned int op_count;
 
 	if (storestate != NULL) {
+#ifdef WITH_FS_BACKING_STORE_THREAD
+		/* complete outstanding writes before the store is torn down */
+		store_writer_fini(storestate);
+#endif
 		guit->misc->schedule(-1, control_maintinance, storestate);
 		write_entries(storestate);
 		write_blocks(storestate);
 
+#ifdef HAVE_MMAP
+		store_block_unmap(storestate);
+#endif
+
 		/* ensure all block files are closed */
 		for (bf = 0; bf < BLOCK_FILE_COUNT; bf++) {
 			if (storestate->blocks[ENTRY_ELEM_DATA][bf].fd != -1) {
@@ -1643,6 +2380,8 @@ finalise(void)
 			      0);
 		}
 
+		free(storestate->evict_pos);
+		free(storestate->evict_heap);
 		free(storestate->addrmap);
 		free(storestate->entries);
 		free(storestate->path);
@@ -1672,16 +2411,8 @@ static nserror store_write_block(struct store_state *state,
 	off_t offst;
 
 	/* ensure the block file fd is good */
-	if (state->blocks[elem_idx][bf].fd == -1) {
-		state->blocks[elem_idx][bf].fd = store_open(state, bf,
-				elem_idx + ENTRY_ELEM_COUNT, O_CREAT | O_RDWR);
-		if (state->blocks[elem_idx][bf].fd == -1) {
-			NSLOG(netsurf, INFO, "Open failed errno %d", errno);
-			return NSERROR_SAVE_FAILED;
-		}
-
-		/* flag that a block file has been opened */
-		state->blocks_opened = true;
+	if (store_block_fd(state, elem_idx, bf) == -1) {
+		return NSERROR_SAVE_FAILED;
 	}
 
 	offst = (unsigned int)bi << log2_block_size[elem_idx];
@@ -1806,22 +2537,133 @@ store(nsurl *url,
 	return ret;
 }
 
+#ifdef WITH_FS_BACKING_STORE_THREAD
 /**
- * release any allocation for an entry
+ * Place an object in the backing store asynchronously.
+ *
+ * The entry is updated and the destination file opened immediately,
+ * the data write is performed by the writer thread. If the writer
+ * thread is not running the object is stored synchronously and the
+ * callback made before returning.
+ *
+ * @param url The url is used as the unique primary key for the data.
+ * @param bsflags The flags to control how the object is stored.
+ * @param data The objects source data.
+ * @param datalen The length of the \a data.
+ * @param cb The completion callback.
+ * @param pw The context passed to \a cb.
+ * @return NSERROR_OK on success or error code on failure.
  */
-static nserror entry_release_alloc(struct store_entry_element *elem)
+static nserror
+store_async(nsurl *url,
+	    enum backing_store_flags bsflags,
+	    uint8_t *data,
+	    const size_t datalen,
+	    backing_store_complete_cb *cb,
+	    void *pw)
 {
-	if ((elem->flags & ENTRY_ELEM_FLAG_HEAP) != 0) {
-		elem->ref--;
-		if (elem->ref == 0) {
-			NSLOG(netsurf, INFO, "freeing %p", elem->data);
-			free(elem->data);
-			elem->flags &= ~ENTRY_ELEM_FLAG_HEAP;
+	nserror ret;
+	struct store_entry *bse;
+	struct store_entry_element *elem;
+	struct store_write_req *req;
+	struct store_writer *writer;
+	block_index_t bf;
+	block_index_t bi;
+	int elem_idx;
+
+	/* check backing store is initialised */
+	if (storestate == NULL) {
+		return NSERROR_INIT_FAILED;
+	}
+
+	writer = storestate->writer;
+	if (writer == NULL) {
+		ret = store(url, bsflags, data, datalen);
+		if ((ret == NSERROR_OK) && (cb != NULL)) {
+			cb(url, bsflags, ret, datalen, 0, pw);
 		}
+		return ret;
 	}
+
+	/* bound the number of outstanding writes */
+	if (writer->outstanding >= WRITE_QUEUE_LENGTH) {
+		return NSERROR_NOSPACE;
+	}
+
+	req = calloc(1, sizeof(struct store_write_req));
+	if (req == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	/* calculate the entry element index */
+	if ((bsflags & BACKING_STORE_META) != 0) {
+		elem_idx = ENTRY_ELEM_META;
+	} else {
+		elem_idx = ENTRY_ELEM_DATA;
+	}
+
+	/* set the store entry up */
+	ret = set_store_entry(storestate, url, elem_idx, data, datalen, &bse);
+	if (ret != NSERROR_OK) {
+		NSLOG(netsurf, INFO, "store entry setting failed");
+		free(req);
+		return ret;
+	}
+	elem = &bse->elem[elem_idx];
+
+	/* the destination is opened here as doing so may alter the
+	 * store state which the writer thread must not touch.
+	 */
+	if (elem->block != 0) {
+		/* small block storage */
+		bf = (elem->block >> BLOCK_ENTRY_COUNT) &
+			((1 << BLOCK_FILE_COUNT) - 1);
+		bi = elem->block & ((1U << BLOCK_ENTRY_COUNT) - 1);
+
+		req->fd = store_block_fd(storestate, elem_idx, bf);
+		req->offset = (unsigned int)bi << log2_block_size[elem_idx];
+		req->close_fd = false;
+	} else {
+		/* separate file in backing store */
+		req->fd = store_open(storestate, bse->ident, elem_idx,
+				     O_CREAT | O_WRONLY);
+		req->offset = 0;
+		req->close_fd = true;
+	}
+	if (req->fd < 0) {
+		NSLOG(netsurf, INFO, "Open failed errno %d", errno);
+		free(req);
+		return NSERROR_SAVE_FAILED;
+	}
+
+	/* the request holds a reference to the allocation until the
+	 * write is complete.
+	 */
+	elem->ref++;
+
+	req->url = nsurl_ref(url);
+	req->flags = bsflags;
+	req->ident = bse->ident;
+	req->elem_idx = elem_idx;
+	req->data = elem->data;
+	req->size = elem->size;
+	req->cb = cb;
+	req->pw = pw;
+
+	pthread_mutex_lock(&writer->lock);
+	*writer->queue_tail = req;
+	writer->queue_tail = &req->next;
+	pthread_cond_signal(&writer->cond);
+	pthread_mutex_unlock(&writer->lock);
+
+	if (writer->outstanding++ == 0) {
+		guit->misc->schedule(WRITE_POLL_TIME, store_writer_poll,
+				     storestate);
+	}
+
 	return NSERROR_OK;
 }
-
+#endif
 
 /**
  * Read an element of an entry from a small block file in the backing storage.
@@ -1842,16 +2684,8 @@ static nserror store_read_block(struct store_state *state,
 	off_t offst;
 
 	/* ensure the block file fd is good */
-	if (state->blocks[elem_idx][bf].fd == -1) {
-		state->blocks[elem_idx][bf].fd = store_open(state, bf,
-				elem_idx + ENTRY_ELEM_COUNT, O_CREAT | O_RDWR);
-		if (state->blocks[elem_idx][bf].fd == -1) {
-			NSLOG(netsurf, INFO, "Open failed errno %d", errno);
-			return NSERROR_SAVE_FAILED;
-		}
-
-		/* flag that a block file has been opened */
-		state->blocks_opened = true;
+	if (store_block_fd(state, elem_idx, bf) == -1) {
+		return NSERROR_SAVE_FAILED;
 	}
 
 	offst = (unsigned int)bi << log2_block_size[elem_idx];
@@ -1974,7 +2808,7 @@ fetch(nsurl *url,
 	elem = &bse->elem[elem_idx];
 
 	/* if an allocation already exists return it */
-	if ((elem->flags & ENTRY_ELEM_FLAG_HEAP) != 0) {
+	if ((elem->flags & (ENTRY_ELEM_FLAG_HEAP | ENTRY_ELEM_FLAG_MMAP)) != 0) {
 		/* use the existing allocation and bump the ref count. */
 		elem->ref++;
 
@@ -1982,6 +2816,13 @@ fetch(nsurl *url,
 		      "Using existing entry (%p) allocation %p refs:%d", bse,
 		      elem->data, elem->ref);
 
+#ifdef HAVE_MMAP
+	} else if ((elem->block != 0) &&
+		   (store_map_block(storestate, bse, elem_idx) == NSERROR_OK)) {
+		/* small block data is used in place from the mapped
+		 * block file avoiding an allocation and copy.
+		 */
+#endif
 	} else {
 		/* allocate from the heap */
 		elem->data = malloc(elem->size);
@@ -2099,6 +2940,9 @@ static struct gui_llcache_table llcache_table = {
 	.initialise = initialise,
 	.finalise = finalise,
 	.store = store,
+#ifdef WITH_FS_BACKING_STORE_THREAD
+	.store_async = store_async,
+#endif
 	.fetch = fetch,
 	.invalidate = invalidate,
 	.release = release,
@@ -0,0 +1,404 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Ancestor bloom filter for CSS selection implementation.
+ *
+ * The filter keeps the chain of elements from the root to the current
+ * element. Each level of the chain has a bloom filter of the names of
+ * its element and every ancestor, copied from the level above when the
+ * element is entered, so leaving an element needs only the level to be
+ * dropped.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "utils/errors.h"
+#include "utils/ascii.h"
+#include "utils/bloom.h"
+
+#include "css/ancestors.h"
+
+/** Size of each level's bloom filter in bytes */
+#define ANCESTOR_BLOOM_SIZE 64
+
+/** Longest element name entered in the filter */
+#define ANCESTOR_NAME_MAX 32
+
+/**
+ * Ancestor filter level
+ */
+struct nscss_ancestor_level {
+	dom_node *node; /**< element at this level */
+	/** names of the element and its ancestors */
+	struct bloom_filter *bloom;
+};
+
+/**
+ * Ancestor filter
+ */
+struct nscss_ancestor_filter {
+	/** chain of elements from the root to the current element */
+	struct nscss_ancestor_level *level;
+	unsigned int depth; /**< number of levels in use */
+	unsigned int allocated; /**< number of levels allocated */
+	/** whether the chain is the current element's ancestors */
+	bool valid;
+	/** empty filter copied for the root level */
+	struct bloom_filter *empty;
+};
+
+
+/**
+ * Get the key entered in the filter for an element name
+ *
+ * \param name  Element name
+ * \param len   Length of name in bytes
+ * \param key   Buffer of ANCESTOR_NAME_MAX bytes to receive the key
+ * \return true if the name has a key, false if it is too long
+ */
+static bool
+nscss_ancestor_filter_key(const char *name, size_t len, char *key)
+{
+	size_t idx;
+
+	if (len > ANCESTOR_NAME_MAX) {
+		return false;
+	}
+
+	for (idx = 0; idx < len; idx++) {
+		key[idx] = ascii_to_lower(name[idx]);
+	}
+
+	return true;
+}
+
+
+/* exported interface documented in css/ancestors.h */
+nserror nscss_ancestor_filter_create(struct nscss_ancestor_filter **filter_out)
+{
+	struct nscss_ancestor_filter *filter;
+
+	filter = calloc(1, sizeof(*filter));
+	if (filter == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	filter->empty = bloom_create(ANCESTOR_BLOOM_SIZE);
+	if (filter->empty == NULL) {
+		free(filter);
+		return NSERROR_NOMEM;
+	}
+
+	*filter_out = filter;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Remove levels from an ancestor filter
+ *
+ * \param filter  Ancestor filter
+ * \param depth   Number of levels to keep
+ */
+static void
+nscss_ancestor_filter_pop(struct nscss_ancestor_filter *filter,
+		unsigned int depth)
+{
+	while (filter->depth > depth) {
+		filter->depth--;
+		dom_node_unref(filter->level[filter->depth].node);
+		filter->level[filter->depth].node = NULL;
+	}
+}
+
+
+/* exported interface documented in css/ancestors.h */
+void nscss_ancestor_filter_destroy(struct nscss_ancestor_filter *filter)
+{
+	unsigned int idx;
+
+	if (filter == NULL) {
+		return;
+	}
+
+	nscss_ancestor_filter_pop(filter, 0);
+
+	for (idx = 0; idx < filter->allocated; idx++) {
+		bloom_destroy(filter->level[idx].bloom);
+	}
+	free(filter->level);
+	bloom_destroy(filter->empty);
+	free(filter);
+}
+
+
+/**
+ * Ensure an ancestor filter has levels allocated
+ *
+ * \param filter  Ancestor filter
+ * \param depth   Number of levels required
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+static nserror
+nscss_ancestor_filter_reserve(struct nscss_ancestor_filter *filter,
+		unsigned int depth)
+{
+	struct nscss_ancestor_level *level;
+	unsigned int allocated;
+
+	if (depth <= filter->allocated) {
+		return NSERROR_OK;
+	}
+
+	allocated = (filter->allocated == 0) ? 32 : filter->allocated * 2;
+	while (allocated < depth) {
+		allocated *= 2;
+	}
+
+	level = realloc(filter->level, allocated * sizeof(*level));
+	if (level == NULL) {
+		return NSERROR_NOMEM;
+	}
+	filter->level = level;
+
+	while (filter->allocated < allocated) {
+		level = &filter->level[filter->allocated];
+		level->node = NULL;
+		level->bloom = bloom_create(ANCESTOR_BLOOM_SIZE);
+		if (level->bloom == NULL) {
+			return NSERROR_NOMEM;
+		}
+		filter->allocated++;
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Fill in the bloom filter of an ancestor filter level
+ *
+ * \param filter  Ancestor filter
+ * \param depth   Index of level, whose element is set
+ */
+static void
+nscss_ancestor_filter_fill(struct nscss_ancestor_filter *filter,
+		unsigned int depth)
+{
+	struct nscss_ancestor_level *level = &filter->level[depth];
+	char key[ANCESTOR_NAME_MAX];
+	dom_string *name;
+	dom_exception err;
+
+	bloom_copy(level->bloom, (depth == 0) ?
+			filter->empty : filter->level[depth - 1].bloom);
+
+	err = dom_node_get_node_name(level->node, &name);
+	if (err != DOM_NO_ERR || name == NULL) {
+		return;
+	}
+
+	/* names too long for a key are never rejected */
+	if (nscss_ancestor_filter_key(dom_string_data(name),
+			dom_string_byte_length(name), key)) {
+		bloom_insert_str(level->bloom, key,
+				dom_string_byte_length(name));
+	}
+
+	dom_string_unref(name);
+}
+
+
+/**
+ * Get the parent of a node, if it is an element
+ *
+ * \param n       Node to get parent of
+ * \param parent  Updated to the parent element or NULL
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror nscss_ancestor_filter_parent(dom_node *n, dom_node **parent)
+{
+	dom_node_type type;
+	dom_exception err;
+
+	err = dom_node_get_parent_node(n, parent);
+	if (err != DOM_NO_ERR) {
+		return NSERROR_DOM;
+	}
+
+	if (*parent != NULL) {
+		err = dom_node_get_node_type(*parent, &type);
+		if (err != DOM_NO_ERR || type != DOM_ELEMENT_NODE) {
+			dom_node_unref(*parent);
+			*parent = NULL;
+		}
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Rebuild an ancestor filter's chain from the root to an element
+ *
+ * \param filter  Ancestor filter, which has no levels
+ * \param n       Element to end chain with
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror
+nscss_ancestor_filter_rebuild(struct nscss_ancestor_filter *filter,
+		dom_node *n)
+{
+	unsigned int depth = 0;
+	unsigned int idx;
+	dom_node *node;
+	dom_node *parent;
+	nserror res;
+
+	/* Count the elements in the chain */
+	node = dom_node_ref(n);
+	while (node != NULL) {
+		depth++;
+		res = nscss_ancestor_filter_parent(node, &parent);
+		dom_node_unref(node);
+		if (res != NSERROR_OK) {
+			return res;
+		}
+		node = parent;
+	}
+
+	res = nscss_ancestor_filter_reserve(filter, depth);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	/* Place the elements from the end of the chain */
+	node = dom_node_ref(n);
+	idx = depth;
+	while (node != NULL && idx > 0) {
+		idx--;
+		filter->level[idx].node = node;
+		res = nscss_ancestor_filter_parent(node, &node);
+		if (res != NSERROR_OK) {
+			node = NULL;
+			break;
+		}
+	}
+
+	if (res == NSERROR_OK && (node != NULL || idx != 0)) {
+		/* the tree changed while it was walked */
+		if (node != NULL) {
+			dom_node_unref(node);
+		}
+		res = NSERROR_DOM;
+	}
+
+	if (res != NSERROR_OK) {
+		while (idx < depth) {
+			dom_node_unref(filter->level[idx].node);
+			filter->level[idx].node = NULL;
+			idx++;
+		}
+		return res;
+	}
+
+	filter->depth = depth;
+
+	for (idx = 0; idx < depth; idx++) {
+		nscss_ancestor_filter_fill(filter, idx);
+	}
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in css/ancestors.h */
+void nscss_ancestor_filter_enter(struct nscss_ancestor_filter *filter,
+		dom_node *n)
+{
+	dom_node *parent;
+	unsigned int depth;
+
+	filter->valid = false;
+
+	if (nscss_ancestor_filter_parent(n, &parent) != NSERROR_OK) {
+		nscss_ancestor_filter_pop(filter, 0);
+		return;
+	}
+
+	/* Leave the previous element's levels which are not ancestors */
+	depth = filter->depth;
+	while (depth > 0 && filter->level[depth - 1].node != parent) {
+		depth--;
+	}
+
+	if (depth == 0 && parent != NULL) {
+		nscss_ancestor_filter_pop(filter, 0);
+		if (nscss_ancestor_filter_rebuild(filter,
+				parent) != NSERROR_OK) {
+			dom_node_unref(parent);
+			return;
+		}
+	} else {
+		nscss_ancestor_filter_pop(filter, depth);
+	}
+
+	if (parent != NULL) {
+		dom_node_unref(parent);
+	}
+
+	if (nscss_ancestor_filter_reserve(filter,
+			filter->depth + 1) != NSERROR_OK) {
+		nscss_ancestor_filter_pop(filter, 0);
+		return;
+	}
+
+	filter->level[filter->depth].node = dom_node_ref(n);
+	nscss_ancestor_filter_fill(filter, filter->depth);
+	filter->depth++;
+
+	filter->valid = true;
+}
+
+
+/* exported interface documented in css/ancestors.h */
+bool nscss_ancestor_filter_may_have(struct nscss_ancestor_filter *filter,
+		const char *name, size_t len)
+{
+	char key[ANCESTOR_NAME_MAX];
+
+	if (filter->valid == false) {
+		return true;
+	}
+
+	if (filter->depth < 2) {
+		/* the current element is the root */
+		return false;
+	}
+
+	if (nscss_ancestor_filter_key(name, len, key) == false) {
+		return true;
+	}
+
+	return bloom_search_str(filter->level[filter->depth - 2].bloom,
+			key, len);
+}
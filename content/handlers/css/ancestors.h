@@ -0,0 +1,86 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Interface to ancestor bloom filter for CSS selection.
+ *
+ * While styles are selected for the elements of a document in depth
+ * first order, the filter holds the names of the current element's
+ * ancestors. Searches for a named ancestor that the filter shows the
+ * element cannot have are rejected without walking up the tree.
+ */
+
+#ifndef NETSURF_CSS_ANCESTORS_H_
+#define NETSURF_CSS_ANCESTORS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <dom/dom.h>
+
+#include "utils/errors.h"
+
+struct nscss_ancestor_filter;
+
+/**
+ * Create an ancestor filter
+ *
+ * The filter must only be used for a single pass over a document which
+ * is not modified during the pass.
+ *
+ * \param filter_out  Updated to the new filter on success
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+nserror nscss_ancestor_filter_create(struct nscss_ancestor_filter **filter_out);
+
+/**
+ * Destroy an ancestor filter
+ *
+ * \param filter  The filter to destroy, or NULL
+ */
+void nscss_ancestor_filter_destroy(struct nscss_ancestor_filter *filter);
+
+/**
+ * Make an element the filter's current element
+ *
+ * Elements are normally entered in document order, when the filter is
+ * updated from the previous element's ancestors. Otherwise the ancestors
+ * are found afresh.
+ *
+ * \param filter  Ancestor filter
+ * \param n       Element styles are about to be selected for
+ */
+void nscss_ancestor_filter_enter(struct nscss_ancestor_filter *filter,
+		dom_node *n);
+
+/**
+ * Determine whether the current element may have an ancestor
+ *
+ * The result also applies to the ancestors and siblings of the current
+ * element, whose ancestors are among its own.
+ *
+ * \param filter  Ancestor filter
+ * \param name    Element name, which is matched case insensitively
+ * \param len     Length of name in bytes
+ * \return false if there is no such ancestor, true if there may be
+ */
+bool nscss_ancestor_filter_may_have(struct nscss_ancestor_filter *filter,
+		const char *name, size_t len);
+
+#endif
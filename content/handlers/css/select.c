@@ -31,6 +31,8 @@
 #include "css/internal.h"
 #include "css/hints.h"
 #include "css/select.h"
+#include "css/siblings.h"
+#include "css/ancestors.h"
 
 static css_error node_name(void *pw, void *node, css_qname *qname);
 static css_error node_classes(void *pw, void *node,
@@ -600,6 +602,17 @@ css_error node_id(void *pw, void *node, lwc_string **id)
 css_error named_ancestor_node(void *pw, void *node,
 		const css_qname *qname, void **ancestor)
 {
+	nscss_select_ctx *ctx = pw;
+
+	/* Reject names that none of the element's ancestors have */
+	if (ctx->ancestors != NULL &&
+			nscss_ancestor_filter_may_have(ctx->ancestors,
+				lwc_string_data(qname->name),
+				lwc_string_length(qname->name)) == false) {
+		*ancestor = NULL;
+		return CSS_OK;
+	}
+
 	dom_element_named_ancestor_node(node, qname->name,
 			(struct dom_element **)ancestor);
 
@@ -1394,42 +1407,6 @@ css_error node_is_root(void *pw, void *node, bool *match)
 	return CSS_OK;
 }
 
-static int
-node_count_siblings_check(dom_node *node,
-			  bool check_name,
-			  dom_string *name)
-{
-	dom_node_type type;
-	int ret = 0;
-	dom_exception exc;
-
-	if (node == NULL)
-		return 0;
-
-	exc = dom_node_get_node_type(node, &type);
-	if ((exc != DOM_NO_ERR) || (type != DOM_ELEMENT_NODE)) {
-		return 0;
-	}
-
-	if (check_name) {
-		dom_string *node_name = NULL;
-		exc = dom_node_get_node_name(node, &node_name);
-
-		if ((exc == DOM_NO_ERR) && (node_name != NULL)) {
-
-			if (dom_string_caseless_isequal(name,
-							node_name)) {
-				ret = 1;
-			}
-			dom_string_unref(node_name);
-		}
-	} else {
-		ret = 1;
-	}
-
-	return ret;
-}
-
 /**
  * Callback to count a node's siblings.
  *
@@ -1445,54 +1422,13 @@ node_count_siblings_check(dom_node *node,
 css_error node_count_siblings(void *pw, void *n, bool same_name,
 		bool after, int32_t *count)
 {
-	int32_t cnt = 0;
-	dom_exception exc;
-	dom_string *node_name = NULL;
-
-	if (same_name) {
-		dom_node *node = n;
-		exc = dom_node_get_node_name(node, &node_name);
-		if ((exc != DOM_NO_ERR) || (node_name == NULL)) {
-			return CSS_NOMEM;
-		}
-	}
-
-	if (after) {
-		dom_node *node = dom_node_ref(n);
-		dom_node *next;
-
-		do {
-			exc = dom_node_get_next_sibling(node, &next);
-			if ((exc != DOM_NO_ERR))
-				break;
-
-			dom_node_unref(node);
-			node = next;
-
-			cnt += node_count_siblings_check(node, same_name, node_name);
-		} while (node != NULL);
-	} else {
-		dom_node *node = dom_node_ref(n);
-		dom_node *next;
-
-		do {
-			exc = dom_node_get_previous_sibling(node, &next);
-			if ((exc != DOM_NO_ERR))
-				break;
-
-			dom_node_unref(node);
-			node = next;
-
-			cnt += node_count_siblings_check(node, same_name, node_name);
-
-		} while (node != NULL);
-	}
+	nscss_select_ctx *ctx = pw;
 
-	if (node_name != NULL) {
-		dom_string_unref(node_name);
+	if (nscss_count_siblings(ctx->siblings, n, same_name, after,
+			count) != NSERROR_OK) {
+		return CSS_NOMEM;
 	}
 
-	*count = cnt;
 	return CSS_OK;
 }
 
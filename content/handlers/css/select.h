@@ -27,6 +27,8 @@
 
 struct content;
 struct nsurl;
+struct nscss_sibling_cache;
+struct nscss_ancestor_filter;
 
 /**
  * Selection context
@@ -39,6 +41,10 @@ typedef struct nscss_select_ctx
 	lwc_string *universal;
 	const css_computed_style *root_style;
 	const css_computed_style *parent_style;
+	/** Sibling position cache, or NULL if positions are not cached */
+	struct nscss_sibling_cache *siblings;
+	/** Filter of the element's ancestors, or NULL if not filtered */
+	struct nscss_ancestor_filter *ancestors;
 } nscss_select_ctx;
 
 css_stylesheet *nscss_create_inline_style(const uint8_t *data, size_t len,
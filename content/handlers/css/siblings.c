@@ -0,0 +1,344 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Counting of element siblings for CSS selection implementation.
+ *
+ * Elements are selected in document order, so the count for an element
+ * is found by walking back to the element last counted for its parent
+ * and adjusting that element's count by the siblings between the two.
+ */
+
+#include <stdlib.h>
+
+#include "utils/errors.h"
+
+#include "css/siblings.h"
+
+/** Number of entries in a sibling position cache */
+#define SIBLING_CACHE_SIZE 8
+
+/**
+ * Sibling position cache entry
+ *
+ * Records the number of element siblings preceding or following an
+ * element, from which the count for a nearby sibling is found by
+ * examining only the siblings between the two.
+ */
+struct nscss_sibling_position {
+	dom_node *parent; /**< parent of element, or NULL if unused */
+	dom_node *node; /**< element whose siblings were counted */
+	dom_string *name; /**< name of siblings counted, or NULL for all */
+	bool after; /**< whether following siblings were counted */
+	int32_t count; /**< number of siblings counted */
+};
+
+/**
+ * Sibling position cache
+ */
+struct nscss_sibling_cache {
+	/** cache entries */
+	struct nscss_sibling_position entry[SIBLING_CACHE_SIZE];
+	/** next entry to be replaced */
+	unsigned int victim;
+};
+
+
+/* exported interface documented in css/siblings.h */
+nserror nscss_sibling_cache_create(struct nscss_sibling_cache **cache_out)
+{
+	struct nscss_sibling_cache *cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	*cache_out = cache;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Release the contents of a sibling position cache entry
+ *
+ * \param entry  The entry to release
+ */
+static void nscss_sibling_position_fini(struct nscss_sibling_position *entry)
+{
+	if (entry->parent == NULL) {
+		return;
+	}
+
+	if (entry->name != NULL) {
+		dom_string_unref(entry->name);
+		entry->name = NULL;
+	}
+	dom_node_unref(entry->node);
+	dom_node_unref(entry->parent);
+	entry->node = NULL;
+	entry->parent = NULL;
+}
+
+
+/* exported interface documented in css/siblings.h */
+void nscss_sibling_cache_destroy(struct nscss_sibling_cache *cache)
+{
+	unsigned int idx;
+
+	if (cache == NULL) {
+		return;
+	}
+
+	for (idx = 0; idx < SIBLING_CACHE_SIZE; idx++) {
+		nscss_sibling_position_fini(&cache->entry[idx]);
+	}
+
+	free(cache);
+}
+
+
+/**
+ * Determine whether a node is an element which should be counted
+ *
+ * \param node        Node to check, or NULL
+ * \param check_name  Whether the node must have the given name
+ * \param name        Name the node must have
+ * \return 1 if the node should be counted, else 0
+ */
+static int
+node_count_siblings_check(dom_node *node,
+			  bool check_name,
+			  dom_string *name)
+{
+	dom_node_type type;
+	int ret = 0;
+	dom_exception exc;
+
+	if (node == NULL)
+		return 0;
+
+	exc = dom_node_get_node_type(node, &type);
+	if ((exc != DOM_NO_ERR) || (type != DOM_ELEMENT_NODE)) {
+		return 0;
+	}
+
+	if (check_name) {
+		dom_string *node_name = NULL;
+		exc = dom_node_get_node_name(node, &node_name);
+
+		if ((exc == DOM_NO_ERR) && (node_name != NULL)) {
+
+			if (dom_string_caseless_isequal(name,
+							node_name)) {
+				ret = 1;
+			}
+			dom_string_unref(node_name);
+		}
+	} else {
+		ret = 1;
+	}
+
+	return ret;
+}
+
+/**
+ * Count a node's siblings by walking the sibling list
+ *
+ * \param n          DOM node
+ * \param same_name  Only count siblings with the same name, or all
+ * \param node_name  Name of node, if same_name is set
+ * \param after      Count anteceding instead of preceding siblings
+ * \return The number of siblings
+ */
+static int32_t
+node_count_siblings_walk(dom_node *n, bool same_name,
+		dom_string *node_name, bool after)
+{
+	int32_t cnt = 0;
+	dom_exception exc;
+
+	if (after) {
+		dom_node *node = dom_node_ref(n);
+		dom_node *next;
+
+		do {
+			exc = dom_node_get_next_sibling(node, &next);
+			if ((exc != DOM_NO_ERR))
+				break;
+
+			dom_node_unref(node);
+			node = next;
+
+			cnt += node_count_siblings_check(node, same_name, node_name);
+		} while (node != NULL);
+	} else {
+		dom_node *node = dom_node_ref(n);
+		dom_node *next;
+
+		do {
+			exc = dom_node_get_previous_sibling(node, &next);
+			if ((exc != DOM_NO_ERR))
+				break;
+
+			dom_node_unref(node);
+			node = next;
+
+			cnt += node_count_siblings_check(node, same_name, node_name);
+
+		} while (node != NULL);
+	}
+
+	return cnt;
+}
+
+/**
+ * Count a node's siblings using a sibling position cache
+ *
+ * The preceding siblings are walked back to the element last counted
+ * for the same parent, whose count is adjusted by the siblings between
+ * them. Should that element not precede the node, preceding siblings
+ * will have been counted by the walk and following ones are counted
+ * afresh.
+ *
+ * \param cache      Sibling position cache
+ * \param n          DOM node
+ * \param same_name  Only count siblings with the same name, or all
+ * \param node_name  Name of node, if same_name is set
+ * \param after      Count anteceding instead of preceding siblings
+ * \return The number of siblings
+ */
+static int32_t
+nscss_sibling_cache_count(struct nscss_sibling_cache *cache, dom_node *n,
+		bool same_name, dom_string *node_name, bool after)
+{
+	struct nscss_sibling_position *entry = NULL;
+	dom_node *parent, *node, *prev;
+	dom_exception exc;
+	unsigned int idx;
+	bool found = false;
+	int32_t cnt = 0;
+
+	exc = dom_node_get_parent_node(n, &parent);
+	if (exc != DOM_NO_ERR || parent == NULL) {
+		return node_count_siblings_walk(n, same_name, node_name, after);
+	}
+
+	for (idx = 0; idx < SIBLING_CACHE_SIZE; idx++) {
+		struct nscss_sibling_position *e = &cache->entry[idx];
+
+		if (e->parent == parent && e->after == after &&
+				(same_name ? (e->name != NULL &&
+				dom_string_caseless_isequal(e->name,
+						node_name)) :
+				(e->name == NULL))) {
+			entry = e;
+			break;
+		}
+	}
+
+	if (entry != NULL && entry->node == n) {
+		dom_node_unref(parent);
+		return entry->count;
+	}
+
+	/* Walk back to the element last counted */
+	node = dom_node_ref(n);
+	while (node != NULL) {
+		exc = dom_node_get_previous_sibling(node, &prev);
+		dom_node_unref(node);
+		if (exc != DOM_NO_ERR) {
+			break;
+		}
+		node = prev;
+
+		if (entry != NULL && node == entry->node) {
+			dom_node_unref(node);
+			found = true;
+			break;
+		}
+
+		cnt += node_count_siblings_check(node, same_name, node_name);
+	}
+
+	if (found) {
+		if (after) {
+			/* less the siblings up to and including this one */
+			cnt = entry->count - cnt - 1;
+		} else {
+			cnt += entry->count + node_count_siblings_check(
+					entry->node, same_name, node_name);
+		}
+	} else if (exc != DOM_NO_ERR) {
+		cnt = node_count_siblings_walk(n, same_name, node_name, after);
+	} else if (after) {
+		/* walk found the preceding siblings, not following */
+		cnt = node_count_siblings_walk(n, same_name, node_name, after);
+	}
+
+	if (entry == NULL) {
+		entry = &cache->entry[cache->victim];
+		cache->victim = (cache->victim + 1) % SIBLING_CACHE_SIZE;
+
+		nscss_sibling_position_fini(entry);
+
+		entry->parent = dom_node_ref(parent);
+		entry->name = same_name ? dom_string_ref(node_name) : NULL;
+		entry->after = after;
+	} else {
+		dom_node_unref(entry->node);
+	}
+
+	entry->node = dom_node_ref(n);
+	entry->count = cnt;
+
+	dom_node_unref(parent);
+
+	return cnt;
+}
+
+/* exported interface documented in css/siblings.h */
+nserror nscss_count_siblings(struct nscss_sibling_cache *cache, dom_node *n,
+		bool same_name, bool after, int32_t *count)
+{
+	dom_exception exc;
+	dom_string *node_name = NULL;
+
+	if (same_name) {
+		exc = dom_node_get_node_name(n, &node_name);
+		if ((exc != DOM_NO_ERR) || (node_name == NULL)) {
+			return NSERROR_NOMEM;
+		}
+	}
+
+	if (cache != NULL) {
+		*count = nscss_sibling_cache_count(cache, n,
+				same_name, node_name, after);
+	} else {
+		*count = node_count_siblings_walk(n, same_name,
+				node_name, after);
+	}
+
+	if (node_name != NULL) {
+		dom_string_unref(node_name);
+	}
+
+	return NSERROR_OK;
+}
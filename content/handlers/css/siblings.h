@@ -0,0 +1,73 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Interface to counting of element siblings for CSS selection.
+ *
+ * Selectors such as :nth-child require the position of an element among
+ * its siblings. A sibling position cache allows a pass selecting styles
+ * for the elements of a document in order to find each position from
+ * that of the element last counted for the same parent rather than by
+ * walking every preceding sibling.
+ */
+
+#ifndef NETSURF_CSS_SIBLINGS_H_
+#define NETSURF_CSS_SIBLINGS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <dom/dom.h>
+
+#include "utils/errors.h"
+
+struct nscss_sibling_cache;
+
+/**
+ * Create a sibling position cache
+ *
+ * The cache must only be used for a single pass over a document which
+ * is not modified during the pass.
+ *
+ * \param cache_out  Updated to the new cache on success
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+nserror nscss_sibling_cache_create(struct nscss_sibling_cache **cache_out);
+
+/**
+ * Destroy a sibling position cache
+ *
+ * \param cache  The cache to destroy, or NULL
+ */
+void nscss_sibling_cache_destroy(struct nscss_sibling_cache *cache);
+
+/**
+ * Count an element's element siblings
+ *
+ * \param cache      Sibling position cache, or NULL to walk the siblings
+ * \param n          Element to count the siblings of
+ * \param same_name  Only count siblings with the same name, or all
+ * \param after      Count following instead of preceding siblings
+ * \param count      Updated to the number of siblings on success
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+nserror nscss_count_siblings(struct nscss_sibling_cache *cache, dom_node *n,
+		bool same_name, bool after, int32_t *count);
+
+#endif
@@ -27,12 +27,13 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <dom/dom.h>
 
 #include "utils/nsoption.h"
 #include "utils/log.h"
-#include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/nsurl.h"
 #include "netsurf/misc.h"
 #include "netsurf/content.h"
@@ -54,11 +55,15 @@
 /**
  * Destructor for box nodes which own styles
  *
- * \param b The box being destroyed.
- * \return 0 to allow talloc to continue destroying the tree.
+ * Releases everything the box holds a reference to. It is called when
+ * the box is freed and again when the box tree arena is destroyed so
+ * released references are cleared.
+ *
+ * \param ptr The box being destroyed.
  */
-static int box_talloc_destructor(struct box *b)
+static void box_destructor(void *ptr)
 {
+	struct box *b = ptr;
 	struct html_scrollbar_data *data;
 
 	if ((b->flags & STYLE_OWNED) && b->style != NULL) {
@@ -71,30 +76,34 @@ static int box_talloc_destructor(struct box *b)
 		b->styles = NULL;
 	}
 
-	if (b->href != NULL)
+	if (b->href != NULL) {
 		nsurl_unref(b->href);
+		b->href = NULL;
+	}
 
 	if (b->id != NULL) {
 		lwc_string_unref(b->id);
+		b->id = NULL;
 	}
 
 	if (b->node != NULL) {
 		dom_node_unref(b->node);
+		b->node = NULL;
 	}
 
 	if (b->scroll_x != NULL) {
 		data = scrollbar_get_data(b->scroll_x);
 		scrollbar_destroy(b->scroll_x);
 		free(data);
+		b->scroll_x = NULL;
 	}
 
 	if (b->scroll_y != NULL) {
 		data = scrollbar_get_data(b->scroll_y);
 		scrollbar_destroy(b->scroll_y);
 		free(data);
+		b->scroll_y = NULL;
 	}
-
-	return 0;
 }
 
 /**
@@ -107,7 +116,7 @@ static int box_talloc_destructor(struct box *b)
  * \param  target       target for the box (not copied), or 0
  * \param  title        title for the box (not copied), or 0
  * \param  id           id for the box (not copied), or 0
- * \param  context      context for allocations
+ * \param  arena        box tree arena to allocate from
  * \return  allocated and initialised box, or 0 on memory exhaustion
  *
  * styles is always owned by the box, if it is set.
@@ -116,18 +125,17 @@ static int box_talloc_destructor(struct box *b)
 
 struct box * box_create(css_select_results *styles, css_computed_style *style,
 		bool style_owned, nsurl *href, const char *target,
-		const char *title, lwc_string *id, void *context)
+		const char *title, lwc_string *id, struct arena *arena)
 {
 	unsigned int i;
 	struct box *box;
 
-	box = talloc(context, struct box);
+	box = arena_alloc_destructor(arena, sizeof(struct box),
+			box_destructor);
 	if (!box) {
 		return 0;
 	}
 
-	talloc_set_destructor(box, box_talloc_destructor);
-
 	box->type = BOX_INLINE;
 	box->flags = 0;
 	box->flags = style_owned ? (box->flags | STYLE_OWNED) : box->flags;
@@ -143,6 +151,7 @@ struct box * box_create(css_select_results *styles, css_computed_style *style,
 	box->scroll_x = box->scroll_y = NULL;
 	box->min_width = 0;
 	box->max_width = UNKNOWN_MAX_WIDTH;
+	box->layout_width = 0;
 	box->byte_offset = 0;
 	box->text = NULL;
 	box->length = 0;
@@ -284,15 +293,10 @@ void box_free_box(struct box *box)
 	if (!(box->flags & CLONE)) {
 		if (box->gadget)
 			form_free_control(box->gadget);
-		if (box->scroll_x != NULL)
-			scrollbar_destroy(box->scroll_x);
-		if (box->scroll_y != NULL)
-			scrollbar_destroy(box->scroll_y);
-		if (box->styles != NULL)
-			css_select_results_destroy(box->styles);
+		box_destructor(box);
 	}
 
-	talloc_free(box);
+	/* the memory is released with the box tree arena */
 }
 
 
@@ -342,6 +346,50 @@ void box_bounds(struct box *box, struct rect *r)
 }
 
 
+/**
+ * Invalidate the layout of a box whose content or intrinsic size changed.
+ *
+ * The min/max widths and any reusable layout of the box and all its
+ * ancestors are discarded, so the next layout recomputes them. The
+ * layout of unaffected parts of the tree is kept.
+ *
+ * \param  box  the box which has changed
+ */
+
+void box_invalidate_layout(struct box *box)
+{
+	struct box *b;
+
+	for (b = box; b != NULL; b = b->parent) {
+		b->max_width = UNKNOWN_MAX_WIDTH;
+		b->flags &= ~LAYOUT_VALID;
+	}
+}
+
+
+/**
+ * Invalidate the layout of a box and all its descendants.
+ *
+ * Used when something every box may depend on changes, such as the
+ * font faces or the viewport dimensions used for viewport relative
+ * lengths.
+ *
+ * \param  box  the root of the tree to invalidate
+ */
+
+void box_invalidate_layout_tree(struct box *box)
+{
+	struct box *child;
+
+	box->max_width = UNKNOWN_MAX_WIDTH;
+	box->flags &= ~LAYOUT_VALID;
+
+	for (child = box->children; child != NULL; child = child->next) {
+		box_invalidate_layout_tree(child);
+	}
+}
+
+
 /**
  * Determine if a point lies within a box.
  *
@@ -105,6 +105,7 @@ struct nsurl;
 struct dom_node;
 struct dom_string;
 struct rect;
+struct arena;
 
 #define UNKNOWN_WIDTH INT_MAX
 #define UNKNOWN_MAX_WIDTH INT_MAX
@@ -136,7 +137,8 @@ typedef enum {
 	REPLACE_DIM = 1 << 9,	/* replaced element has given dimensions */
 	IFRAME      = 1 << 10,	/* box contains an iframe */
 	CONVERT_CHILDREN = 1 << 11,  /* wanted children converting */
-	IS_REPLACED = 1 << 12	/* box is a replaced element */
+	IS_REPLACED = 1 << 12,	/* box is a replaced element */
+	LAYOUT_VALID = 1 << 13	/* layout at layout_width can be reused */
 } box_flags;
 
 /* Sides of a box */
@@ -210,6 +212,10 @@ struct box {
 	 * non-negative. */
 	int max_width;
 
+	/** Width available when the box was last laid out. Only
+	 * meaningful while the LAYOUT_VALID flag is set. */
+	int layout_width;
+
 	/**< Byte offset within a textual representation of this content. */
 	size_t byte_offset;
 
@@ -323,13 +329,15 @@ extern const char *TARGET_BLANK;
 
 struct box * box_create(css_select_results *styles, css_computed_style *style,
 		bool style_owned, struct nsurl *href, const char *target,
-		const char *title, lwc_string *id, void *context);
+		const char *title, lwc_string *id, struct arena *arena);
 void box_add_child(struct box *parent, struct box *child);
 void box_insert_sibling(struct box *box, struct box *new_box);
 void box_unlink_and_free(struct box *box);
 void box_free(struct box *box);
 void box_free_box(struct box *box);
 void box_bounds(struct box *box, struct rect *r);
+void box_invalidate_layout(struct box *box);
+void box_invalidate_layout_tree(struct box *box);
 void box_coords(struct box *box, int *x, int *y);
 struct box *box_at_point(
 		const nscss_len_ctx *len_ctx,
@@ -37,7 +37,7 @@
 #include "utils/corestrings.h"
 #include "utils/log.h"
 #include "utils/messages.h"
-#include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/string.h"
 #include "utils/ascii.h"
 #include "netsurf/css.h"
@@ -46,6 +46,8 @@
 #include "content/content_protected.h"
 #include "css/hints.h"
 #include "css/select.h"
+#include "css/siblings.h"
+#include "css/ancestors.h"
 #include "css/utils.h"
 #include "desktop/gui_internal.h"
 
@@ -67,7 +69,11 @@ struct box_construct_ctx {
 
 	box_construct_complete_cb cb;	/**< Callback to invoke on completion */
 
-	int *bctx;			/**< talloc context */
+	struct arena *bctx;		/**< box tree arena */
+
+	struct nscss_sibling_cache *siblings;	/**< sibling position cache */
+
+	struct nscss_ancestor_filter *ancestors;	/**< ancestor filter */
 };
 
 /**
@@ -104,7 +110,7 @@ static bool box_construct_element(struct box_construct_ctx *ctx,
 		bool *convert_children);
 static void box_construct_element_after(dom_node *n, html_content *content);
 static bool box_construct_text(struct box_construct_ctx *ctx);
-static css_select_results * box_get_style(html_content *c,
+static css_select_results * box_get_style(struct box_construct_ctx *construct,
 		const css_computed_style *parent_style,
 		const css_computed_style *root_style, dom_node *n);
 static void box_text_transform(char *s, unsigned int len,
@@ -129,7 +135,7 @@ static bool box_embed(BOX_SPECIAL_PARAMS);
 static bool box_pre(BOX_SPECIAL_PARAMS);
 static bool box_iframe(BOX_SPECIAL_PARAMS);
 static bool box_get_attribute(dom_node *n, const char *attribute,
-		void *context, char **value);
+		struct arena *arena, char **value);
 
 /* element_table must be sorted by name */
 struct element_entry {
@@ -154,6 +160,18 @@ static const struct element_entry element_table[] = {
 };
 #define ELEMENT_TABLE_COUNT (sizeof(element_table) / sizeof(element_table[0]))
 
+/**
+ * Destroy a box tree construction context
+ *
+ * \param ctx  The context to destroy
+ */
+static void box_construct_ctx_destroy(struct box_construct_ctx *ctx)
+{
+	nscss_sibling_cache_destroy(ctx->siblings);
+	nscss_ancestor_filter_destroy(ctx->ancestors);
+	free(ctx);
+}
+
 /**
  * Construct a box tree from an xml tree and stylesheets.
  *
@@ -170,8 +188,8 @@ nserror dom_to_box(dom_node *n, html_content *c, box_construct_complete_cb cb, v
 	assert(box_conversion_context != NULL);
 
 	if (c->bctx == NULL) {
-		/* create a context allocation for this box tree */
-		c->bctx = talloc_zero(0, int);
+		/* create an arena for this box tree */
+		c->bctx = arena_create(0);
 		if (c->bctx == NULL) {
 			return NSERROR_NOMEM;
 		}
@@ -182,6 +200,17 @@ nserror dom_to_box(dom_node *n, html_content *c, box_construct_complete_cb cb, v
 		return NSERROR_NOMEM;
 	}
 
+	if (nscss_sibling_cache_create(&ctx->siblings) != NSERROR_OK) {
+		free(ctx);
+		return NSERROR_NOMEM;
+	}
+
+	if (nscss_ancestor_filter_create(&ctx->ancestors) != NSERROR_OK) {
+		nscss_sibling_cache_destroy(ctx->siblings);
+		free(ctx);
+		return NSERROR_NOMEM;
+	}
+
 	ctx->content = c;
 	ctx->n = dom_node_ref(n);
 	ctx->root_box = NULL;
@@ -204,7 +233,7 @@ nserror cancel_dom_to_box(void *box_conversion_context)
 	}
 
 	dom_node_unref(ctx->n);
-	free(ctx);
+	box_construct_ctx_destroy(ctx);
 
 	return NSERROR_OK;
 }
@@ -405,7 +434,7 @@ void convert_xml_to_box(struct box_construct_ctx *ctx)
 		if (box_construct_element(ctx, &convert_children) == false) {
 			ctx->cb(ctx->content, false);
 			dom_node_unref(ctx->n);
-			free(ctx);
+			box_construct_ctx_destroy(ctx);
 			return;
 		}
 
@@ -419,7 +448,7 @@ void convert_xml_to_box(struct box_construct_ctx *ctx)
 			if (err != DOM_NO_ERR) {
 				ctx->cb(ctx->content, false);
 				dom_node_unref(next);
-				free(ctx);
+				box_construct_ctx_destroy(ctx);
 				return;
 			}
 
@@ -431,7 +460,7 @@ void convert_xml_to_box(struct box_construct_ctx *ctx)
 				if (box_construct_text(ctx) == false) {
 					ctx->cb(ctx->content, false);
 					dom_node_unref(ctx->n);
-					free(ctx);
+					box_construct_ctx_destroy(ctx);
 					return;
 				}
 			}
@@ -464,7 +493,7 @@ void convert_xml_to_box(struct box_construct_ctx *ctx)
 
 			assert(ctx->n == NULL);
 
-			free(ctx);
+			box_construct_ctx_destroy(ctx);
 			return;
 		}
 	} while (++num_processed < max_processed_before_yield);
@@ -561,7 +590,7 @@ static bool box_construct_marker(struct box *box, const char *title,
 			}
 		}
 
-		marker->text = talloc_array(ctx->bctx, char, 20);
+		marker->text = arena_alloc(ctx->bctx, 20);
 		if (marker->text == NULL)
 			return false;
 
@@ -782,8 +811,7 @@ bool box_construct_element(struct box_construct_ctx *ctx,
 		root_style = ctx->root_box->style;
 	}
 
-	styles = box_get_style(ctx->content, props.parent_style, root_style,
-			ctx->n);
+	styles = box_get_style(ctx, props.parent_style, root_style, ctx->n);
 	if (styles == NULL)
 		return false;
 
@@ -800,7 +828,7 @@ bool box_construct_element(struct box_construct_ctx *ctx,
 		if (t == NULL)
 			return false;
 
-		props.title = talloc_strdup(ctx->bctx, t);
+		props.title = arena_strdup(ctx->bctx, t);
 
 		free(t);
 
@@ -921,8 +949,8 @@ bool box_construct_element(struct box_construct_ctx *ctx,
 		}
 
 		/* Can't do this, because the lifetimes of boxes and gadgets
-		 * are inextricably linked. Fortunately, talloc will save us
-		 * (for now) */
+		 * are inextricably linked. Fortunately, the box tree arena
+		 * will save us (for now) */
 		/* box_free_box(box); */
 
 		*convert_children = false;
@@ -1186,7 +1214,7 @@ bool box_construct_text(struct box_construct_ctx *ctx)
 
 		box->type = BOX_TEXT;
 
-		box->text = talloc_strdup(ctx->bctx, text);
+		box->text = arena_strdup(ctx->bctx, text);
 		free(text);
 		if (box->text == NULL)
 			return false;
@@ -1305,7 +1333,7 @@ bool box_construct_text(struct box_construct_ctx *ctx)
 
 			box->type = BOX_TEXT;
 
-			box->text = talloc_strdup(ctx->bctx, current);
+			box->text = arena_strdup(ctx->bctx, current);
 			if (box->text == NULL) {
 				free(text);
 				return false;
@@ -1351,21 +1379,22 @@ bool box_construct_text(struct box_construct_ctx *ctx)
 /**
  * Get the style for an element.
  *
- * \param  c               content of type CONTENT_HTML that is being processed
+ * \param  construct       tree construction context
  * \param  parent_style    style at this point in xml tree, or NULL for root
  * \param  root_style      root node's style, or NULL for root
  * \param  n               node in xml tree
  * \return  the new style, or NULL on memory exhaustion
  */
-css_select_results *box_get_style(html_content *c,
+css_select_results *box_get_style(struct box_construct_ctx *construct,
 		const css_computed_style *parent_style,
 		const css_computed_style *root_style, dom_node *n)
 {
+	html_content *c = construct->content;
 	dom_string *s;
 	dom_exception err;
 	css_stylesheet *inline_style = NULL;
 	css_select_results *styles;
-	nscss_select_ctx ctx;
+	nscss_select_ctx ctx = { 0 };
 
 	/* Firstly, construct inline stylesheet, if any */
 	err = dom_element_get_attribute(n, corestring_dom_style, &s);
@@ -1393,6 +1422,11 @@ css_select_results *box_get_style(html_content *c,
 	ctx.universal = c->universal;
 	ctx.root_style = root_style;
 	ctx.parent_style = parent_style;
+	ctx.siblings = construct->siblings;
+	ctx.ancestors = construct->ancestors;
+
+	/* Track the element's ancestors */
+	nscss_ancestor_filter_enter(construct->ancestors, n);
 
 	/* Select style for element */
 	styles = nscss_get_style(&ctx, n, &c->media, inline_style);
@@ -1563,7 +1597,7 @@ bool box_a(BOX_SPECIAL_PARAMS)
 		else {
 			/* 6.16 says that frame names must begin with [a-zA-Z]
 			 * This doesn't match reality, so just take anything */
-			box->target = talloc_strdup(content->bctx,
+			box->target = arena_strdup(content->bctx,
 					dom_string_data(s));
 			if (!box->target) {
 				dom_string_unref(s);
@@ -1604,7 +1638,7 @@ bool box_image(BOX_SPECIAL_PARAMS)
 		dom_string_unref(s);
 		if (alt == NULL)
 			return false;
-		box->text = talloc_strdup(content->bctx, alt);
+		box->text = arena_strdup(content->bctx, alt);
 		free(alt);
 		if (box->text == NULL)
 			return false;
@@ -1673,19 +1707,18 @@ bool box_noscript(BOX_SPECIAL_PARAMS)
 /**
  * Destructor for object_params, for &lt;object&gt; elements
  *
- * \param o  The object params being destroyed.
- * \return 0 to allow talloc to continue destroying the tree.
+ * \param ptr  The object params being destroyed.
  */
-static int box_object_talloc_destructor(struct object_params *o)
+static void box_object_destructor(void *ptr)
 {
+	struct object_params *o = ptr;
+
 	if (o->codebase != NULL)
 		nsurl_unref(o->codebase);
 	if (o->classid != NULL)
 		nsurl_unref(o->classid);
 	if (o->data != NULL)
 		nsurl_unref(o->data);
-
-	return 0;
 }
 
 /**
@@ -1710,12 +1743,11 @@ bool box_object(BOX_SPECIAL_PARAMS)
 	if (box->usemap && box->usemap[0] == '#')
 		box->usemap++;
 
-	params = talloc(content->bctx, struct object_params);
+	params = arena_alloc_destructor(content->bctx,
+			sizeof(struct object_params), box_object_destructor);
 	if (params == NULL)
 		return false;
 
-	talloc_set_destructor(params, box_object_talloc_destructor);
-
 	params->data = NULL;
 	params->type = NULL;
 	params->codetype = NULL;
@@ -1855,7 +1887,8 @@ bool box_object(BOX_SPECIAL_PARAMS)
 			}
 			dom_string_unref(name);
 
-			param = talloc(params, struct object_param);
+			param = arena_alloc(content->bctx,
+					sizeof(struct object_param));
 			if (param == NULL) {
 				dom_node_unref(c);
 				return false;
@@ -1866,32 +1899,32 @@ bool box_object(BOX_SPECIAL_PARAMS)
 			param->valuetype = NULL;
 			param->next = NULL;
 
-			if (box_get_attribute(c, "name", param,
+			if (box_get_attribute(c, "name", content->bctx,
 					&param->name) == false) {
 				dom_node_unref(c);
 				return false;
 			}
 
-			if (box_get_attribute(c, "value", param,
+			if (box_get_attribute(c, "value", content->bctx,
 					&param->value) == false) {
 				dom_node_unref(c);
 				return false;
 			}
 
-			if (box_get_attribute(c, "type", param,
+			if (box_get_attribute(c, "type", content->bctx,
 					&param->type) == false) {
 				dom_node_unref(c);
 				return false;
 			}
 
-			if (box_get_attribute(c, "valuetype", param,
+			if (box_get_attribute(c, "valuetype", content->bctx,
 					&param->valuetype) == false) {
 				dom_node_unref(c);
 				return false;
 			}
 
 			if (param->valuetype == NULL) {
-				param->valuetype = talloc_strdup(param, "data");
+				param->valuetype = arena_strdup(content->bctx, "data");
 				if (param->valuetype == NULL) {
 					dom_node_unref(c);
 					return false;
@@ -1945,7 +1978,8 @@ bool box_frameset(BOX_SPECIAL_PARAMS)
 		return true;
 	}
 
-	content->frameset = talloc_zero(content->bctx, struct content_html_frames);
+	content->frameset = arena_zalloc(content->bctx,
+			sizeof(struct content_html_frames));
 	if (!content->frameset)
 		return false;
 
@@ -1959,23 +1993,6 @@ bool box_frameset(BOX_SPECIAL_PARAMS)
 }
 
 
-/**
- * Destructor for content_html_frames, for frame elements
- *
- * \param f  The frame params being destroyed.
- * \return 0 to allow talloc to continue destroying the tree.
- */
-static int box_frames_talloc_destructor(struct content_html_frames *f)
-{
-	if (f->url != NULL) {
-		nsurl_unref(f->url);
-		f->url = NULL;
-	}
-
-	return 0;
-}
-
-
 /**
  * Parse a multi-length-list, as defined by HTML 4.01.
  *
@@ -2114,10 +2131,8 @@ bool box_create_frameset(struct content_html_frames *f, dom_node *n,
 	f->cols = cols;
 	f->rows = rows;
 	f->scrolling = BW_SCROLLING_NO;
-	f->children = talloc_array(content->bctx, struct content_html_frames,
-								(rows * cols));
-
-	talloc_set_destructor(f->children, box_frames_talloc_destructor);
+	f->children = arena_alloc(content->bctx,
+			sizeof(struct content_html_frames) * (rows * cols));
 
 	for (row = 0; row < rows; row++) {
 		for (col = 0; col < cols; col++) {
@@ -2248,7 +2263,7 @@ bool box_create_frameset(struct content_html_frames *f, dom_node *n,
 			/* fill in specified values */
 			err = dom_element_get_attribute(c, corestring_dom_name, &s);
 			if (err == DOM_NO_ERR && s != NULL) {
-				frame->name = talloc_strdup(content->bctx,
+				frame->name = arena_strdup(content->bctx,
 						dom_string_data(s));
 				dom_string_unref(s);
 			}
@@ -2328,23 +2343,6 @@ bool box_create_frameset(struct content_html_frames *f, dom_node *n,
 }
 
 
-/**
- * Destructor for content_html_iframe, for &lt;iframe&gt; elements
- *
- * \param f The iframe params being destroyed.
- * \return 0 to allow talloc to continue destroying the tree.
- */
-static int box_iframes_talloc_destructor(struct content_html_iframe *f)
-{
-	if (f->url != NULL) {
-		nsurl_unref(f->url);
-		f->url = NULL;
-	}
-
-	return 0;
-}
-
-
 /**
  * Inline subwindow [16.5].
  */
@@ -2387,14 +2385,12 @@ bool box_iframe(BOX_SPECIAL_PARAMS)
 	}
 
 	/* create a new iframe */
-	iframe = talloc(content->bctx, struct content_html_iframe);
+	iframe = arena_alloc(content->bctx, sizeof(struct content_html_iframe));
 	if (iframe == NULL) {
 		nsurl_unref(url);
 		return false;
 	}
 
-	talloc_set_destructor(iframe, box_iframes_talloc_destructor);
-
 	iframe->box = box;
 	iframe->margin_width = 0;
 	iframe->margin_height = 0;
@@ -2410,7 +2406,7 @@ bool box_iframe(BOX_SPECIAL_PARAMS)
 	/* fill in specified values */
 	err = dom_element_get_attribute(n, corestring_dom_name, &s);
 	if (err == DOM_NO_ERR && s != NULL) {
-		iframe->name = talloc_strdup(content->bctx, dom_string_data(s));
+		iframe->name = arena_strdup(content->bctx, dom_string_data(s));
 		dom_string_unref(s);
 	}
 
@@ -2489,7 +2485,7 @@ static bool box_input_text(html_content *html, struct box *box,
 	if (!inline_box)
 		return false;
 	inline_box->type = BOX_TEXT;
-	inline_box->text = talloc_strdup(html->bctx, "");
+	inline_box->text = arena_strdup(html->bctx, "");
 
 	box_add_child(inline_container, inline_box);
 	box_add_child(box, inline_container);
@@ -2575,16 +2571,16 @@ bool box_input(BOX_SPECIAL_PARAMS)
 		inline_box->type = BOX_TEXT;
 
 		if (box->gadget->value != NULL)
-			inline_box->text = talloc_strdup(content->bctx,
+			inline_box->text = arena_strdup(content->bctx,
 					box->gadget->value);
 		else if (box->gadget->type == GADGET_SUBMIT)
-			inline_box->text = talloc_strdup(content->bctx,
+			inline_box->text = arena_strdup(content->bctx,
 					messages_get("Form_Submit"));
 		else if (box->gadget->type == GADGET_RESET)
-			inline_box->text = talloc_strdup(content->bctx,
+			inline_box->text = arena_strdup(content->bctx,
 					messages_get("Form_Reset"));
 		else
-			inline_box->text = talloc_strdup(content->bctx,
+			inline_box->text = arena_strdup(content->bctx,
 							 "Button");
 
 		if (inline_box->text == NULL)
@@ -2815,13 +2811,13 @@ bool box_select(BOX_SPECIAL_PARAMS)
 	}
 
 	if (gadget->data.select.num_selected == 0)
-		inline_box->text = talloc_strdup(content->bctx,
+		inline_box->text = arena_strdup(content->bctx,
 				messages_get("Form_None"));
 	else if (gadget->data.select.num_selected == 1)
-		inline_box->text = talloc_strdup(content->bctx,
+		inline_box->text = arena_strdup(content->bctx,
 				gadget->data.select.current->text);
 	else
-		inline_box->text = talloc_strdup(content->bctx,
+		inline_box->text = arena_strdup(content->bctx,
 				messages_get("Form_Many"));
 	if (inline_box->text == NULL)
 		goto no_memory;
@@ -2945,12 +2941,11 @@ bool box_embed(BOX_SPECIAL_PARAMS)
 			box_is_root(n)) == CSS_DISPLAY_NONE)
 		return true;
 
-	params = talloc(content->bctx, struct object_params);
+	params = arena_alloc_destructor(content->bctx,
+			sizeof(struct object_params), box_object_destructor);
 	if (params == NULL)
 		return false;
 
-	talloc_set_destructor(params, box_object_talloc_destructor);
-
 	params->data = NULL;
 	params->type = NULL;
 	params->codetype = NULL;
@@ -3019,7 +3014,7 @@ bool box_embed(BOX_SPECIAL_PARAMS)
 			return false;
 		}
 
-		param = talloc(content->bctx, struct object_param);
+		param = arena_alloc(content->bctx, sizeof(struct object_param));
 		if (param == NULL) {
 			dom_node_unref(attr);
 			dom_string_unref(value);
@@ -3028,10 +3023,10 @@ bool box_embed(BOX_SPECIAL_PARAMS)
 			return false;
 		}
 
-		param->name = talloc_strdup(content->bctx, dom_string_data(name));
-		param->value = talloc_strdup(content->bctx, dom_string_data(value));
+		param->name = arena_strdup(content->bctx, dom_string_data(name));
+		param->value = arena_strdup(content->bctx, dom_string_data(value));
 		param->type = NULL;
-		param->valuetype = talloc_strdup(content->bctx, "data");
+		param->valuetype = arena_strdup(content->bctx, "data");
 		param->next = NULL;
 
 		dom_string_unref(value);
@@ -3068,7 +3063,7 @@ bool box_embed(BOX_SPECIAL_PARAMS)
  *
  * \param  n	      xmlNode, of type XML_ELEMENT_NODE
  * \param  attribute  name of attribute
- * \param  context    talloc context for result buffer
+ * \param  arena      arena to allocate result buffer from
  * \param  value      updated to value, if the attribute is present
  * \return  true on success, false if attribute present but memory exhausted
  *
@@ -3077,7 +3072,7 @@ bool box_embed(BOX_SPECIAL_PARAMS)
  */
 
 bool box_get_attribute(dom_node *n, const char *attribute,
-		void *context, char **value)
+		struct arena *arena, char **value)
 {
 	char *result;
 	dom_string *attr, *attr_name;
@@ -3097,7 +3092,7 @@ bool box_get_attribute(dom_node *n, const char *attribute,
 	dom_string_unref(attr_name);
 
 	if (attr != NULL) {
-		result = talloc_strdup(context, dom_string_data(attr));
+		result = arena_strdup(arena, dom_string_data(attr));
 
 		dom_string_unref(attr);
 
@@ -124,7 +124,7 @@ bool box_normalise_block(
 	struct box *next_child;
 	struct box *table;
 	css_computed_style *style;
-	nscss_select_ctx ctx;
+	nscss_select_ctx ctx = { 0 };
 
 	assert(block != NULL);
 	assert(root != NULL);
@@ -242,7 +242,7 @@ bool box_normalise_table(
 	struct box *row_group;
 	css_computed_style *style;
 	struct columns col_info;
-	nscss_select_ctx ctx;
+	nscss_select_ctx ctx = { 0 };
 
 	assert(table != NULL);
 	assert(table->type == BOX_TABLE);
@@ -454,7 +454,7 @@ bool box_normalise_table_spans(
 	unsigned int rows_left = table->rows;
 	unsigned int group_rows_left;
 	unsigned int col;
-	nscss_select_ctx ctx;
+	nscss_select_ctx ctx = { 0 };
 
 	ctx.root_style = root->style;
 
@@ -611,7 +611,7 @@ bool box_normalise_table_row_group(
 	struct box *next_child;
 	struct box *row;
 	css_computed_style *style;
-	nscss_select_ctx ctx;
+	nscss_select_ctx ctx = { 0 };
 	unsigned int group_row_count = 0;
 
 	assert(row_group != 0);
@@ -766,7 +766,7 @@ bool box_normalise_table_row(
 	struct box *cell = NULL;
 	css_computed_style *style;
 	unsigned int i;
-	nscss_select_ctx ctx;
+	nscss_select_ctx ctx = { 0 };
 
 	assert(row != NULL);
 	assert(row->type == BOX_TABLE_ROW);
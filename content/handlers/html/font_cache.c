@@ -0,0 +1,641 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Text measurement cache implementation.
+ *
+ * Entries are keyed on the metric affecting members of the plot font
+ * style together with the text bytes. Each entry holds the measured
+ * width and the most recent split request of its text. The entries
+ * are kept in a hash table and a least recently used list, the least
+ * recently used entries are discarded when the memory limit would be
+ * exceeded.
+ *
+ * The frontend maps the generic families to the faces configured in
+ * the font options. The faces are not part of the key so the whole
+ * cache is discarded when they change.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libwapcaplet/libwapcaplet.h>
+
+#include "utils/errors.h"
+#include "utils/log.h"
+#include "utils/nsoption.h"
+#include "utils/utils.h"
+#include "netsurf/inttypes.h"
+#include "netsurf/plot_style.h"
+#include "netsurf/layout.h"
+
+#include "html/font_cache.h"
+
+/** Number of hash buckets, must be a power of two */
+#define FONT_CACHE_BUCKETS 4096
+
+/** Default memory limit for cache entries */
+#define FONT_CACHE_DEFAULT_LIMIT (1024 * 1024)
+
+/** Longest text, in bytes, held in the cache */
+#define FONT_CACHE_TEXT_MAX 1024
+
+/** Number of generic families with a configurable face */
+#define FONT_CACHE_FACES 5
+
+/**
+ * Text measurement cache entry
+ */
+struct font_cache_entry {
+	struct font_cache_entry *next; /**< next entry in hash chain */
+	struct font_cache_entry *lru_prev; /**< more recently used entry */
+	struct font_cache_entry *lru_next; /**< less recently used entry */
+
+	uint32_t hash; /**< hash of the key */
+	size_t alloc; /**< memory used by this entry */
+
+	plot_font_generic_family_t family; /**< generic family of key */
+	plot_style_fixed size; /**< font size of key */
+	int weight; /**< font weight of key */
+	plot_font_flags_t flags; /**< font flags of key */
+	lwc_string **families; /**< NULL terminated families or NULL */
+
+	const char *text; /**< text of key */
+	size_t length; /**< length of text in bytes */
+
+	bool width_valid; /**< whether width has been measured */
+	int width; /**< measured width of text */
+
+	bool split_valid; /**< whether a split has been made */
+	int split_x; /**< x coordinate of the split request */
+	size_t split_offset; /**< character offset of the split */
+	int split_actual_x; /**< x coordinate of the split */
+
+	/** storage for families and text */
+	lwc_string *storage[FLEX_ARRAY_LEN_DECL];
+};
+
+/**
+ * Text measurement cache state
+ */
+static struct font_cache {
+	/** frontend layout table */
+	const struct gui_layout_table *layout;
+	/** memory limit for entries */
+	size_t limit;
+	/** hash table of entries */
+	struct font_cache_entry *buckets[FONT_CACHE_BUCKETS];
+	/** most recently used entry */
+	struct font_cache_entry *lru_head;
+	/** least recently used entry */
+	struct font_cache_entry *lru_tail;
+	/** font faces the entries were measured with */
+	char *faces[FONT_CACHE_FACES];
+	/** incremented each time the font faces change */
+	unsigned int faces_generation;
+	/** statistics */
+	struct font_cache_stats stats;
+} font_cache;
+
+
+/**
+ * Compute the hash of a cache key
+ *
+ * \param fstyle The font style of the key.
+ * \param string The text of the key.
+ * \param length The length of the text in bytes.
+ * \return The hash value.
+ */
+static uint32_t
+font_cache_hash(const plot_font_style_t *fstyle,
+		const char *string,
+		size_t length)
+{
+	uint32_t hash = 0x811c9dc5;
+	lwc_string * const *family;
+	size_t idx;
+
+	for (idx = 0; idx < length; idx++) {
+		hash ^= (uint8_t)string[idx];
+		hash *= 0x01000193;
+	}
+
+	hash ^= fstyle->family;
+	hash *= 0x01000193;
+	hash ^= (uint32_t)fstyle->size;
+	hash *= 0x01000193;
+	hash ^= (uint32_t)fstyle->weight;
+	hash *= 0x01000193;
+	hash ^= fstyle->flags;
+	hash *= 0x01000193;
+
+	/* family names are interned so the pointers identify them */
+	if (fstyle->families != NULL) {
+		for (family = fstyle->families; *family != NULL; family++) {
+			hash ^= (uint32_t)(uintptr_t)*family;
+			hash *= 0x01000193;
+		}
+	}
+
+	return hash;
+}
+
+
+/**
+ * Check whether a cache entry matches a key
+ */
+static bool
+font_cache_match(const struct font_cache_entry *entry,
+		 uint32_t hash,
+		 const plot_font_style_t *fstyle,
+		 const char *string,
+		 size_t length)
+{
+	lwc_string * const *family;
+	lwc_string **efamily;
+
+	if ((entry->hash != hash) ||
+	    (entry->length != length) ||
+	    (entry->family != fstyle->family) ||
+	    (entry->size != fstyle->size) ||
+	    (entry->weight != fstyle->weight) ||
+	    (entry->flags != fstyle->flags)) {
+		return false;
+	}
+
+	if ((entry->families == NULL) || (fstyle->families == NULL)) {
+		if (entry->families != fstyle->families) {
+			return false;
+		}
+	} else {
+		family = fstyle->families;
+		efamily = entry->families;
+		while ((*family != NULL) && (*family == *efamily)) {
+			family++;
+			efamily++;
+		}
+		if (*family != *efamily) {
+			return false;
+		}
+	}
+
+	return memcmp(entry->text, string, length) == 0;
+}
+
+
+/**
+ * Remove an entry from the least recently used list
+ */
+static void font_cache_lru_unlink(struct font_cache_entry *entry)
+{
+	if (entry->lru_prev != NULL) {
+		entry->lru_prev->lru_next = entry->lru_next;
+	} else {
+		font_cache.lru_head = entry->lru_next;
+	}
+
+	if (entry->lru_next != NULL) {
+		entry->lru_next->lru_prev = entry->lru_prev;
+	} else {
+		font_cache.lru_tail = entry->lru_prev;
+	}
+}
+
+
+/**
+ * Place an entry at the head of the least recently used list
+ */
+static void font_cache_lru_link(struct font_cache_entry *entry)
+{
+	entry->lru_prev = NULL;
+	entry->lru_next = font_cache.lru_head;
+	if (font_cache.lru_head != NULL) {
+		font_cache.lru_head->lru_prev = entry;
+	} else {
+		font_cache.lru_tail = entry;
+	}
+	font_cache.lru_head = entry;
+}
+
+
+/**
+ * Remove an entry from the cache and free it
+ */
+static void font_cache_entry_destroy(struct font_cache_entry *entry)
+{
+	struct font_cache_entry **link;
+	lwc_string **family;
+
+	link = &font_cache.buckets[entry->hash & (FONT_CACHE_BUCKETS - 1)];
+	while (*link != entry) {
+		link = &(*link)->next;
+	}
+	*link = entry->next;
+
+	font_cache_lru_unlink(entry);
+
+	if (entry->families != NULL) {
+		for (family = entry->families; *family != NULL; family++) {
+			lwc_string_unref(*family);
+		}
+	}
+
+	font_cache.stats.entries--;
+	font_cache.stats.size -= entry->alloc;
+
+	free(entry);
+}
+
+
+/**
+ * Find the cache entry for a key
+ *
+ * A found entry becomes the most recently used.
+ *
+ * \param fstyle The font style of the key.
+ * \param string The text of the key.
+ * \param length The length of the text in bytes.
+ * \param[out] hash_out The hash of the key.
+ * \return The cache entry or NULL if there is none.
+ */
+static struct font_cache_entry *
+font_cache_find(const plot_font_style_t *fstyle,
+		const char *string,
+		size_t length,
+		uint32_t *hash_out)
+{
+	struct font_cache_entry *entry;
+	uint32_t hash;
+
+	if (length > FONT_CACHE_TEXT_MAX) {
+		return NULL;
+	}
+
+	hash = font_cache_hash(fstyle, string, length);
+	*hash_out = hash;
+
+	entry = font_cache.buckets[hash & (FONT_CACHE_BUCKETS - 1)];
+	while (entry != NULL) {
+		if (font_cache_match(entry, hash, fstyle, string, length)) {
+			if (entry != font_cache.lru_head) {
+				font_cache_lru_unlink(entry);
+				font_cache_lru_link(entry);
+			}
+			return entry;
+		}
+		entry = entry->next;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Create a cache entry for a key
+ *
+ * Least recently used entries are discarded to keep within the
+ * memory limit.
+ *
+ * \param fstyle The font style of the key.
+ * \param string The text of the key.
+ * \param length The length of the text in bytes.
+ * \param hash The hash of the key.
+ * \return The new cache entry or NULL if it could not be created.
+ */
+static struct font_cache_entry *
+font_cache_insert(const plot_font_style_t *fstyle,
+		  const char *string,
+		  size_t length,
+		  uint32_t hash)
+{
+	struct font_cache_entry *entry;
+	struct font_cache_entry **bucket;
+	size_t family_count = 0;
+	size_t alloc;
+	size_t idx;
+
+	if (length > FONT_CACHE_TEXT_MAX) {
+		return NULL;
+	}
+
+	if (fstyle->families != NULL) {
+		while (fstyle->families[family_count] != NULL) {
+			family_count++;
+		}
+		/* allow for terminator */
+		family_count++;
+	}
+
+	alloc = sizeof(struct font_cache_entry) +
+		(family_count * sizeof(lwc_string *)) +
+		length;
+
+	if (alloc > font_cache.limit) {
+		return NULL;
+	}
+
+	while ((font_cache.lru_tail != NULL) &&
+	       ((font_cache.stats.size + alloc) > font_cache.limit)) {
+		font_cache_entry_destroy(font_cache.lru_tail);
+	}
+
+	entry = malloc(alloc);
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	entry->hash = hash;
+	entry->alloc = alloc;
+	entry->family = fstyle->family;
+	entry->size = fstyle->size;
+	entry->weight = fstyle->weight;
+	entry->flags = fstyle->flags;
+	entry->width_valid = false;
+	entry->split_valid = false;
+
+	if (family_count == 0) {
+		entry->families = NULL;
+	} else {
+		entry->families = entry->storage;
+		for (idx = 0; idx < family_count - 1; idx++) {
+			entry->families[idx] =
+				lwc_string_ref(fstyle->families[idx]);
+		}
+		entry->families[idx] = NULL;
+	}
+
+	entry->length = length;
+	entry->text = (const char *)(entry->storage + family_count);
+	memcpy(entry->storage + family_count, string, length);
+
+	bucket = &font_cache.buckets[hash & (FONT_CACHE_BUCKETS - 1)];
+	entry->next = *bucket;
+	*bucket = entry;
+
+	font_cache_lru_link(entry);
+
+	font_cache.stats.entries++;
+	font_cache.stats.size += alloc;
+
+	return entry;
+}
+
+
+/**
+ * Measure the width of a string using the cache.
+ *
+ * \param[in] fstyle plot style for this text
+ * \param[in] string UTF-8 string to measure
+ * \param[in] length length of string, in bytes
+ * \param[out] width updated to width of string[0..length)
+ * \return NSERROR_OK and width updated or appropriate error
+ *          code on faliure
+ */
+static nserror
+font_cache_width(const plot_font_style_t *fstyle,
+		 const char *string,
+		 size_t length,
+		 int *width)
+{
+	struct font_cache_entry *entry;
+	uint32_t hash = 0;
+	nserror res;
+
+	entry = font_cache_find(fstyle, string, length, &hash);
+	if ((entry != NULL) && entry->width_valid) {
+		font_cache.stats.width_hit++;
+		*width = entry->width;
+		return NSERROR_OK;
+	}
+
+	font_cache.stats.width_miss++;
+
+	res = font_cache.layout->width(fstyle, string, length, width);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	if (entry == NULL) {
+		entry = font_cache_insert(fstyle, string, length, hash);
+	}
+	if (entry != NULL) {
+		entry->width_valid = true;
+		entry->width = *width;
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Find the position in a string where an x coordinate falls.
+ *
+ * Positions are only requested in response to user interaction so
+ * are passed straight to the frontend.
+ *
+ * \param[in] fstyle style for this text
+ * \param[in] string UTF-8 string to measure
+ * \param[in] length length of string, in bytes
+ * \param[in] x coordinate to search for
+ * \param[out] char_offset updated to offset in string of actual_x, [0..length]
+ * \param[out] actual_x updated to x coordinate of character closest to x
+ * \return NSERROR_OK and char_offset and actual_x updated or
+ *          appropriate error code on faliure
+ */
+static nserror
+font_cache_position(const plot_font_style_t *fstyle,
+		    const char *string,
+		    size_t length,
+		    int x,
+		    size_t *char_offset,
+		    int *actual_x)
+{
+	return font_cache.layout->position(fstyle, string, length, x,
+					   char_offset, actual_x);
+}
+
+
+/**
+ * Find where to split a string to make it fit a width using the cache.
+ *
+ * \param[in] fstyle style for this text
+ * \param[in] string UTF-8 string to measure
+ * \param[in] length length of string, in bytes
+ * \param[in] x width available
+ * \param[out] char_offset updated to offset in string of actual_x, [1..length]
+ * \param[out] actual_x updated to x coordinate of character closest to x
+ * \return NSERROR_OK or appropriate error code on faliure
+ */
+static nserror
+font_cache_split(const plot_font_style_t *fstyle,
+		 const char *string,
+		 size_t length,
+		 int x,
+		 size_t *char_offset,
+		 int *actual_x)
+{
+	struct font_cache_entry *entry;
+	uint32_t hash = 0;
+	nserror res;
+
+	entry = font_cache_find(fstyle, string, length, &hash);
+	if ((entry != NULL) && entry->split_valid && (entry->split_x == x)) {
+		font_cache.stats.split_hit++;
+		*char_offset = entry->split_offset;
+		*actual_x = entry->split_actual_x;
+		return NSERROR_OK;
+	}
+
+	font_cache.stats.split_miss++;
+
+	res = font_cache.layout->split(fstyle, string, length, x,
+				       char_offset, actual_x);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	if (entry == NULL) {
+		entry = font_cache_insert(fstyle, string, length, hash);
+	}
+	if (entry != NULL) {
+		entry->split_valid = true;
+		entry->split_x = x;
+		entry->split_offset = *char_offset;
+		entry->split_actual_x = *actual_x;
+	}
+
+	return NSERROR_OK;
+}
+
+
+static const struct gui_layout_table font_cache_layout = {
+	.width = font_cache_width,
+	.position = font_cache_position,
+	.split = font_cache_split,
+};
+
+const struct gui_layout_table *font_cache_layout_table = &font_cache_layout;
+
+
+/* exported interface documented in html/font_cache.h */
+nserror font_cache_init(const struct gui_layout_table *layout, size_t limit)
+{
+	if (layout == NULL) {
+		return NSERROR_BAD_PARAMETER;
+	}
+
+	font_cache_flush();
+	memset(&font_cache.stats, 0, sizeof(font_cache.stats));
+
+	font_cache.layout = layout;
+	font_cache.limit = (limit != 0) ? limit : FONT_CACHE_DEFAULT_LIMIT;
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in html/font_cache.h */
+void font_cache_fini(void)
+{
+	unsigned int idx;
+
+	NSLOG(layout, INFO,
+	      "Text measurement cache width %"PRIu64" hit %"PRIu64" miss, split %"PRIu64" hit %"PRIu64" miss, %u entries using %"PRIsizet" bytes",
+	      font_cache.stats.width_hit,
+	      font_cache.stats.width_miss,
+	      font_cache.stats.split_hit,
+	      font_cache.stats.split_miss,
+	      font_cache.stats.entries,
+	      font_cache.stats.size);
+
+	font_cache_flush();
+	font_cache.layout = NULL;
+
+	for (idx = 0; idx < FONT_CACHE_FACES; idx++) {
+		free(font_cache.faces[idx]);
+		font_cache.faces[idx] = NULL;
+	}
+}
+
+
+/* exported interface documented in html/font_cache.h */
+void font_cache_flush(void)
+{
+	while (font_cache.lru_tail != NULL) {
+		font_cache_entry_destroy(font_cache.lru_tail);
+	}
+}
+
+
+/**
+ * Update the record of a configured font face
+ *
+ * \param face The recorded face to update.
+ * \param option The currently configured face or NULL.
+ * \return true if the face has changed, else false.
+ */
+static bool font_cache_face_changed(char **face, const char *option)
+{
+	if ((*face == NULL) && (option == NULL)) {
+		return false;
+	}
+	if ((*face != NULL) && (option != NULL) &&
+	    (strcmp(*face, option) == 0)) {
+		return false;
+	}
+
+	free(*face);
+	*face = (option != NULL) ? strdup(option) : NULL;
+
+	return true;
+}
+
+
+/* exported interface documented in html/font_cache.h */
+unsigned int font_cache_update_faces(void)
+{
+	bool changed = false;
+
+	changed |= font_cache_face_changed(&font_cache.faces[0],
+					   nsoption_charp(font_sans));
+	changed |= font_cache_face_changed(&font_cache.faces[1],
+					   nsoption_charp(font_serif));
+	changed |= font_cache_face_changed(&font_cache.faces[2],
+					   nsoption_charp(font_mono));
+	changed |= font_cache_face_changed(&font_cache.faces[3],
+					   nsoption_charp(font_cursive));
+	changed |= font_cache_face_changed(&font_cache.faces[4],
+					   nsoption_charp(font_fantasy));
+
+	if (changed) {
+		NSLOG(layout, DEBUG, "Font faces changed, flushing %u entries",
+		      font_cache.stats.entries);
+		font_cache_flush();
+		font_cache.faces_generation++;
+	}
+
+	return font_cache.faces_generation;
+}
+
+
+/* exported interface documented in html/font_cache.h */
+void font_cache_get_stats(struct font_cache_stats *stats)
+{
+	*stats = font_cache.stats;
+}
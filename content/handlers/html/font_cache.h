@@ -0,0 +1,104 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Text measurement cache interface.
+ *
+ * Layout measures the same words in the same font style many times.
+ * The cache sits between layout and the frontend layout table and
+ * remembers the results of width and split operations keyed on the
+ * font style and the text bytes.
+ */
+
+#ifndef NETSURF_HTML_FONT_CACHE_H
+#define NETSURF_HTML_FONT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/errors.h"
+
+struct gui_layout_table;
+
+/**
+ * Text measurement cache statistics
+ */
+struct font_cache_stats {
+	uint64_t width_hit; /**< width requests answered from the cache */
+	uint64_t width_miss; /**< width requests passed to the frontend */
+	uint64_t split_hit; /**< split requests answered from the cache */
+	uint64_t split_miss; /**< split requests passed to the frontend */
+	unsigned int entries; /**< number of entries in the cache */
+	size_t size; /**< memory used by the cache entries in bytes */
+};
+
+/**
+ * Layout table which answers from the measurement cache.
+ *
+ * Requests the cache cannot answer are passed to the frontend layout
+ * table given to font_cache_init().
+ */
+extern const struct gui_layout_table *font_cache_layout_table;
+
+/**
+ * Initialise the text measurement cache
+ *
+ * \param layout The frontend layout table to measure text with.
+ * \param limit The maximum memory used by cache entries in bytes or
+ *              zero for the default.
+ * \return NSERROR_OK on success or error code on failure.
+ */
+nserror font_cache_init(const struct gui_layout_table *layout, size_t limit);
+
+/**
+ * Finalise the text measurement cache
+ *
+ * Releases all cache entries and reports the hit statistics.
+ */
+void font_cache_fini(void);
+
+/**
+ * Discard every measurement held in the cache.
+ *
+ * Must be called if the frontend changes how a font style maps to
+ * glyphs, as previously cached measurements become stale.
+ */
+void font_cache_flush(void);
+
+/**
+ * Discard the cache if the configured font faces have changed.
+ *
+ * The frontend maps the generic font families to the faces set in the
+ * font options, which are not part of the cache key. This must be
+ * called before text is measured for a layout so measurements made
+ * with previously configured faces are not used.
+ *
+ * \return The font face generation, which changes whenever the faces
+ *         change so callers can discard layouts made with other faces.
+ */
+unsigned int font_cache_update_faces(void);
+
+/**
+ * Obtain the text measurement cache statistics
+ *
+ * \param[out] stats The statistics to populate.
+ */
+void font_cache_get_stats(struct font_cache_stats *stats);
+
+#endif
@@ -36,7 +36,7 @@
 #include "utils/corestrings.h"
 #include "utils/log.h"
 #include "utils/messages.h"
-#include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/url.h"
 #include "utils/utf8.h"
 #include "utils/ascii.h"
@@ -1809,17 +1809,17 @@ static nserror form__select_process_selection(html_content *html,
 		}
 	}
 
-	talloc_free(inline_box->text);
+	/* previous text is released with the box tree arena */
 	inline_box->text = 0;
 
 	if (control->data.select.num_selected == 0) {
-		inline_box->text = talloc_strdup(html->bctx,
+		inline_box->text = arena_strdup(html->bctx,
 				messages_get("Form_None"));
 	} else if (control->data.select.num_selected == 1) {
-		inline_box->text = talloc_strdup(html->bctx,
+		inline_box->text = arena_strdup(html->bctx,
 				control->data.select.current->text);
 	} else {
-		inline_box->text = talloc_strdup(html->bctx,
+		inline_box->text = arena_strdup(html->bctx,
 				messages_get("Form_Many"));
 	}
 
@@ -1830,6 +1830,7 @@ static nserror form__select_process_selection(html_content *html,
 		inline_box->length = strlen(inline_box->text);
 	}
 	inline_box->width = control->box->width;
+	box_invalidate_layout(inline_box);
 
 	html__redraw_a_box(html, control->box);
 
@@ -173,7 +173,7 @@ struct form *form_new(void *node, const char *action, const char *target,
  * \note There may exist controls attached to box tree nodes which are not
  * associated with any form. These will leak at present. Ideally, they will
  * be cleaned up when the box tree is destroyed. As that currently happens
- * via talloc, this won't happen. These controls are distinguishable, as their
+ * via the box tree arena, this won't happen. These controls are distinguishable, as their
  * form field will be NULL.
  *
  * \param form The form to free
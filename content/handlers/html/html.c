@@ -36,11 +36,12 @@
 #include "utils/libdom.h"
 #include "utils/log.h"
 #include "utils/messages.h"
-#include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/utf8.h"
 #include "utils/nsoption.h"
 #include "utils/string.h"
 #include "utils/ascii.h"
+#include "netsurf/inttypes.h"
 #include "netsurf/content.h"
 #include "netsurf/browser_window.h"
 #include "netsurf/utf8.h"
@@ -63,6 +64,7 @@
 #include "html/form_internal.h"
 #include "html/imagemap.h"
 #include "html/layout.h"
+#include "html/font_cache.h"
 #include "html/search.h"
 
 #define CHUNK 4096
@@ -212,7 +214,8 @@ static void html_box_convert_done(html_content *c, bool success)
 	dom_exception exc; /* returned by libdom functions */
 	dom_node *html;
 
-	NSLOG(netsurf, INFO, "Done XML to box (%p)", c);
+	NSLOG(netsurf, INFO, "Done XML to box (%p) using %"PRIsizet" bytes",
+	      c, (c->bctx != NULL) ? arena_size(c->bctx) : 0);
 
 	c->box_conversion_context = NULL;
 
@@ -1105,7 +1108,7 @@ html_create_html_data(html_content *c, const http_parameter *params)
 	c->frameset = NULL;
 	c->iframe = NULL;
 	c->page = NULL;
-	c->font_func = guit->layout;
+	c->font_func = font_cache_layout_table;
 	c->drag_type = HTML_DRAG_NONE;
 	c->drag_owner.no_owner = true;
 	c->selection_type = HTML_SELECTION_NONE;
@@ -1661,6 +1664,9 @@ static void html_reformat(struct content *c, int width, int height)
 {
 	html_content *htmlc = (html_content *) c;
 	struct box *layout;
+	unsigned int faces;
+	css_fixed vw;
+	css_fixed vh;
 	uint64_t ms_before;
 	uint64_t ms_after;
 	uint64_t ms_interval;
@@ -1669,8 +1675,25 @@ static void html_reformat(struct content *c, int width, int height)
 
 	htmlc->reflowing = true;
 
-	htmlc->len_ctx.vw = nscss_pixels_physical_to_css(INTTOFIX(width));
-	htmlc->len_ctx.vh = nscss_pixels_physical_to_css(INTTOFIX(height));
+	/* measurements made with other font faces are stale */
+	faces = font_cache_update_faces();
+
+	vw = nscss_pixels_physical_to_css(INTTOFIX(width));
+	vh = nscss_pixels_physical_to_css(INTTOFIX(height));
+
+	/* Reused line layouts and cached min/max widths depend on the font
+	 * faces and on viewport relative lengths, which an unchanged
+	 * available width does not capture. */
+	if (htmlc->had_initial_layout &&
+	    ((faces != htmlc->layout_faces) ||
+	     (vw != htmlc->len_ctx.vw) ||
+	     (vh != htmlc->len_ctx.vh))) {
+		box_invalidate_layout_tree(htmlc->layout);
+	}
+	htmlc->layout_faces = faces;
+
+	htmlc->len_ctx.vw = vw;
+	htmlc->len_ctx.vh = vh;
 	htmlc->len_ctx.root_style = htmlc->layout->style;
 
 	layout_document(htmlc, width, height);
@@ -1698,6 +1721,14 @@ static void html_reformat(struct content *c, int width, int height)
 	/* calculate next reflow time at three times what it took to reflow */
 	nsu_getmonotonic_ms(&ms_after);
 
+	NSLOG(layout, INFO,
+	      "Reformat of %s to %ix%i took %"PRIu64"ms, reused %u of %u inline containers",
+	      nsurl_access(content_get_url(c)),
+	      width, height,
+	      ms_after - ms_before,
+	      htmlc->layout_inline_reused,
+	      htmlc->layout_inline_count);
+
 	ms_interval = (ms_after - ms_before) * 3;
 	if (ms_interval < (nsoption_uint(min_reflow_period) * 10)) {
 		ms_interval = nsoption_uint(min_reflow_period) * 10;
@@ -1747,20 +1778,15 @@ static void html_destroy_frameset(struct content_html_frames *frameset)
 {
 	int i;
 
-	if (frameset->name) {
-		talloc_free(frameset->name);
-		frameset->name = NULL;
-	}
+	/* names and children are released with the box tree arena */
+	frameset->name = NULL;
 	if (frameset->url) {
-		talloc_free(frameset->url);
+		nsurl_unref(frameset->url);
 		frameset->url = NULL;
 	}
 	if (frameset->children) {
 		for (i = 0; i < (frameset->rows * frameset->cols); i++) {
-			if (frameset->children[i].name) {
-				talloc_free(frameset->children[i].name);
-				frameset->children[i].name = NULL;
-			}
+			frameset->children[i].name = NULL;
 			if (frameset->children[i].url) {
 				nsurl_unref(frameset->children[i].url);
 				frameset->children[i].url = NULL;
@@ -1768,7 +1794,6 @@ static void html_destroy_frameset(struct content_html_frames *frameset)
 			if (frameset->children[i].children)
 				html_destroy_frameset(&frameset->children[i]);
 		}
-		talloc_free(frameset->children);
 		frameset->children = NULL;
 	}
 }
@@ -1779,24 +1804,31 @@ static void html_destroy_iframe(struct content_html_iframe *iframe)
 	next = iframe;
 	while ((iframe = next) != NULL) {
 		next = iframe->next;
-		if (iframe->name)
-			talloc_free(iframe->name);
+		/* iframe is released with the box tree arena */
 		if (iframe->url) {
 			nsurl_unref(iframe->url);
 			iframe->url = NULL;
 		}
-		talloc_free(iframe);
 	}
 }
 
 
 static void html_free_layout(html_content *htmlc)
 {
+	uint64_t start, end;
+	size_t size;
+
 	if (htmlc->bctx != NULL) {
-		/* freeing talloc context should let the entire box
-		 * set be destroyed
-		 */
-		talloc_free(htmlc->bctx);
+		/* destroying the arena releases the entire box set */
+		size = arena_size(htmlc->bctx);
+		nsu_getmonotonic_ms(&start);
+		arena_destroy(htmlc->bctx);
+		nsu_getmonotonic_ms(&end);
+
+		NSLOG(netsurf, INFO,
+		      "Freed box tree of %"PRIsizet" bytes in %"PRIu64"ms",
+		      size, end - start);
+		htmlc->bctx = NULL;
 	}
 }
 
@@ -1863,7 +1895,6 @@ static void html_destroy(struct content *c)
 	/* Free frameset */
 	if (html->frameset != NULL) {
 		html_destroy_frameset(html->frameset);
-		talloc_free(html->frameset);
 		html->frameset = NULL;
 	}
 
@@ -2807,6 +2838,7 @@ static content_type html_content_type(void)
 
 static void html_fini(void)
 {
+	font_cache_fini();
 	html_css_fini();
 }
 
@@ -2850,6 +2882,10 @@ nserror html_init(void)
 	if (error != NSERROR_OK)
 		goto error;
 
+	error = font_cache_init(guit->layout, 0);
+	if (error != NSERROR_OK)
+		goto error;
+
 	for (i = 0; i < NOF_ELEMENTS(html_types); i++) {
 		error = content_factory_register_handler(html_types[i],
 				&html_content_handler);
@@ -35,6 +35,7 @@
 struct gui_layout_table;
 struct scrollbar_msg_data;
 struct content_redraw_data;
+struct arena;
 
 typedef enum {
 	HTML_DRAG_NONE,			/** No drag */
@@ -127,14 +128,23 @@ typedef struct html_content {
 	/** Whether an initial layout has been done */
 	bool had_initial_layout;
 
+	/** Number of inline containers visited by the last layout */
+	unsigned int layout_inline_count;
+
+	/** Number of those whose previous layout was reused */
+	unsigned int layout_inline_reused;
+
+	/** Font face generation the current layout was made with */
+	unsigned int layout_faces;
+
 	/** Whether scripts are enabled for this content */
 	bool enable_scripting;
 
 	/* Title element node */
 	dom_node *title;
 
-	/** A talloc context purely for the render box tree */
-	int *bctx;
+	/** An arena purely for the render box tree */
+	struct arena *bctx;
 	/** A context pointer for the box conversion, NULL if no conversion
 	 * is in progress.
 	 */
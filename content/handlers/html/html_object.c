@@ -90,8 +90,6 @@ html_object_done(struct box *box,
 		 hlcache_handle *object,
 		 bool background)
 {
-	struct box *b;
-
 	if (background) {
 		box->background = object;
 		return;
@@ -110,9 +108,8 @@ html_object_done(struct box *box,
 	}
 
 	if (!(box->flags & REPLACE_DIM)) {
-		/* invalidate parent min, max widths */
-		for (b = box; b; b = b->parent)
-			b->max_width = UNKNOWN_MAX_WIDTH;
+		/* invalidate parent min, max widths and layout */
+		box_invalidate_layout(box);
 
 		/* delete any clones of this box */
 		while (box->next && (box->next->flags & CLONE)) {
@@ -1334,16 +1334,15 @@ html_search(struct content *c,
 		if (html->search_string == NULL)
 			return;
 
-		if (html->search != NULL) {
-			search_destroy_context(html->search);
-			html->search = NULL;
+		/* an existing context refines its matches when the
+		 * string has been extended */
+		if (html->search == NULL) {
+			html->search = search_create_context(c, CONTENT_HTML,
+					context);
+			if (html->search == NULL)
+				return;
 		}
 
-		html->search = search_create_context(c, CONTENT_HTML, context);
-
-		if (html->search == NULL)
-			return;
-
 		search_step(html->search, flags, string);
 
 	} else {
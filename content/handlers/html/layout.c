@@ -42,9 +42,10 @@
 #include <string.h>
 #include <math.h>
 #include <dom/dom.h>
+#include <nsutils/time.h>
 
 #include "utils/log.h"
-#include "utils/talloc.h"
+#include "utils/arena.h"
 #include "utils/utils.h"
 #include "utils/nsoption.h"
 #include "netsurf/inttypes.h"
@@ -352,7 +353,8 @@ static void layout_minmax_table(struct box *table,
 	if (table->max_width != UNKNOWN_MAX_WIDTH)
 		return;
 
-	if (table_calculate_column_types(&content->len_ctx, table) == false) {
+	if (table_calculate_column_types(&content->len_ctx, content->bctx,
+			table) == false) {
 		NSLOG(netsurf, WARNING,
 				"Could not establish table column types.");
 		return;
@@ -911,8 +913,10 @@ layout_minmax_inline_container(struct box *inline_container,
 	assert(inline_container->type == BOX_INLINE_CONTAINER);
 
 	/* check if the widths have already been calculated */
-	if (inline_container->max_width != UNKNOWN_MAX_WIDTH)
+	if (inline_container->max_width != UNKNOWN_MAX_WIDTH) {
+		*has_height = (inline_container->flags & HAS_HEIGHT);
 		return;
+	}
 
 	*has_height = false;
 
@@ -931,6 +935,14 @@ layout_minmax_inline_container(struct box *inline_container,
 	inline_container->min_width = min;
 	inline_container->max_width = max;
 
+	/* remember whether the lines have height for when the cached
+	 * widths are used */
+	if (*has_height) {
+		inline_container->flags |= HAS_HEIGHT;
+	} else {
+		inline_container->flags &= ~HAS_HEIGHT;
+	}
+
 	assert(0 <= inline_container->min_width &&
 			inline_container->min_width <=
 			inline_container->max_width);
@@ -972,6 +984,9 @@ static void layout_minmax_block(
 	if (block->max_width != UNKNOWN_MAX_WIDTH)
 		return;
 
+	/* height flags are derived afresh with the widths */
+	block->flags &= ~(HAS_HEIGHT | MAKE_HEIGHT);
+
 	if (block->style != NULL) {
 		wtype = css_computed_width(block->style, &width, &wunit);
 		htype = css_computed_height(block->style, &height, &hunit);
@@ -2781,7 +2796,7 @@ layout_text_box_split(html_content *content,
 		space_width = 0;
 
 	/* Create clone of split_box, c2 */
-	c2 = talloc_memdup(content->bctx, split_box, sizeof *c2);
+	c2 = arena_memdup(content->bctx, split_box, sizeof *c2);
 	if (!c2)
 		return false;
 	c2->flags |= CLONE;
@@ -3850,6 +3865,7 @@ static bool layout_inline_container(struct box *inline_container, int width,
 {
 	bool first_line = true;
 	bool has_text_children;
+	bool reusable;
 	struct box *c, *next;
 	int y = 0;
 	int curwidth,maxwidth = width;
@@ -3864,11 +3880,38 @@ static bool layout_inline_container(struct box *inline_container, int width,
 	      cx,
 	      cy);
 
+	content->layout_inline_count++;
+
+	/* Without floats the lines only depend on the available width, so
+	 * an unchanged container keeps its previous layout. */
+	if ((inline_container->flags & LAYOUT_VALID) &&
+	    (inline_container->layout_width == width) &&
+	    (cont->float_children == NULL)) {
+		content->layout_inline_reused++;
+		return true;
+	}
+
+	inline_container->flags &= ~LAYOUT_VALID;
+	inline_container->width = width;
+
+	reusable = (cont->float_children == NULL);
 
 	has_text_children = false;
 	for (c = inline_container->children; c; c = c->next) {
 		bool is_pre = false;
 
+		/* Floats, inline blocks and positioned boxes are placed
+		 * relative to boxes outside the container. */
+		if ((c->type != BOX_INLINE &&
+		     c->type != BOX_TEXT &&
+		     c->type != BOX_BR &&
+		     c->type != BOX_INLINE_END) ||
+		    (c->flags & IFRAME) ||
+		    (c->style != NULL &&
+		     css_computed_position(c->style) != CSS_POSITION_STATIC)) {
+			reusable = false;
+		}
+
 		if (c->style) {
 			enum css_white_space_e whitespace;
 
@@ -3906,6 +3949,11 @@ static bool layout_inline_container(struct box *inline_container, int width,
 	inline_container->width = maxwidth;
 	inline_container->height = y;
 
+	if (reusable && cont->float_children == NULL) {
+		inline_container->flags |= LAYOUT_VALID;
+		inline_container->layout_width = width;
+	}
+
 	return true;
 }
 
@@ -4202,9 +4250,8 @@ layout_block_context(struct box *block,
 				return false;
 
 		} else if (box->type == BOX_INLINE_CONTAINER) {
-			box->width = box->parent->width;
-			if (!layout_inline_container(box, box->width, block,
-					cx, cy, content))
+			if (!layout_inline_container(box, box->parent->width,
+					block, cx, cy, content))
 				return false;
 
 		} else if (box->type == BOX_TABLE) {
@@ -5394,12 +5441,28 @@ bool layout_document(html_content *content, int width, int height)
 	bool ret;
 	struct box *doc = content->layout;
 	const struct gui_layout_table *font_func = content->font_func;
+	uint64_t ms_before;
+	uint64_t ms_after;
 
 	NSLOG(layout, DEBUG, "Doing layout to %ix%i of %s",
 			width, height, nsurl_access(content_get_url(
 					&content->base)));
 
-	layout_minmax_block(doc, font_func, content);
+	content->layout_inline_count = 0;
+	content->layout_inline_reused = 0;
+
+	/* min/max widths do not depend on the available width so are
+	 * only recalculated for boxes which have been invalidated */
+	if (doc->max_width != UNKNOWN_MAX_WIDTH) {
+		NSLOG(layout, DEBUG, "Using cached min/max widths");
+	} else {
+		nsu_getmonotonic_ms(&ms_before);
+		layout_minmax_block(doc, font_func, content);
+		nsu_getmonotonic_ms(&ms_after);
+
+		NSLOG(layout, INFO, "Min/max widths took %"PRIu64"ms",
+		      ms_after - ms_before);
+	}
 
 	layout_block_find_dimensions(&content->len_ctx,
 			width, height, 0, 0, doc);
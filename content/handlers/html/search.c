@@ -23,7 +23,6 @@
  * Free text search (core)
  */
 
-#include <ctype.h>
 #include <string.h>
 #include <dom/dom.h>
 
@@ -31,6 +30,7 @@
 #include "utils/log.h"
 #include "utils/messages.h"
 #include "utils/utils.h"
+#include "utils/strmatch.h"
 #include "content/content.h"
 #include "content/hlcache.h"
 #include "desktop/selection.h"
@@ -44,10 +44,6 @@
 #include "html/html_internal.h"
 #include "html/search.h"
 
-#ifndef NOF_ELEMENTS
-#define NOF_ELEMENTS(array) (sizeof(array)/sizeof(*(array)))
-#endif
-
 
 struct list_entry {
 	unsigned start_idx;	/* start position of match */
@@ -68,6 +64,7 @@ struct search_context {
 	struct list_entry *found;
 	struct list_entry *current; /* first for select all */
 	char *string;
+	struct strmatch *matcher; /* compiled string */
 	bool prev_case_sens;
 	bool newsearch;
 	bool is_html;
@@ -107,6 +104,7 @@ search_create_context(struct content *c, content_type type, void *gui_data)
 	context->found = search_head;
 	context->current = NULL;
 	context->string = NULL;
+	context->matcher = NULL;
 	context->prev_case_sens = false;
 	context->newsearch = true;
 	context->c = c;
@@ -147,124 +145,6 @@ static void free_matches(struct search_context *context)
 }
 
 
-/**
- * Find the first occurrence of 'match' in 'string' and return its index
- *
- * \param  string     the string to be searched (unterminated)
- * \param  s_len      length of the string to be searched
- * \param  pattern    the pattern for which we are searching (unterminated)
- * \param  p_len      length of pattern
- * \param  case_sens  true iff case sensitive match required
- * \param  m_len      accepts length of match in bytes
- * \return pointer to first match, NULL if none
- */
-
-static const char *find_pattern(const char *string, int s_len,
-		const char *pattern, int p_len, bool case_sens,
-		unsigned int *m_len)
-{
-	struct { const char *ss, *s, *p; bool first; } context[16];
-	const char *ep = pattern + p_len;
-	const char *es = string  + s_len;
-	const char *p = pattern - 1;  /* a virtual '*' before the pattern */
-	const char *ss = string;
-	const char *s = string;
-	bool first = true;
-	int top = 0;
-
-	while (p < ep) {
-		bool matches;
-		if (p < pattern || *p == '*') {
-			char ch;
-
-			/* skip any further asterisks; one is the same as many
-			*/
-			do p++; while (p < ep && *p == '*');
-
-			/* if we're at the end of the pattern, yes, it matches
-			*/
-			if (p >= ep) break;
-
-			/* anything matches a # so continue matching from
-			   here, and stack a context that will try to match
-			   the wildcard against the next character */
-
-			ch = *p;
-			if (ch != '#') {
-				/* scan forwards until we find a match for
-				   this char */
-				if (!case_sens) ch = toupper(ch);
-				while (s < es) {
-					if (case_sens) {
-						if (*s == ch) break;
-					} else if (toupper(*s) == ch)
-						break;
-					s++;
-				}
-			}
-
-			if (s < es) {
-				/* remember where we are in case the match
-				   fails; we may then resume */
-				if (top < (int)NOF_ELEMENTS(context)) {
-					context[top].ss = ss;
-					context[top].s  = s + 1;
-					context[top].p  = p - 1;
-					/* ptr to last asterisk */
-					context[top].first = first;
-					top++;
-				}
-
-				if (first) {
-					ss = s;
-					/* remember first non-'*' char */
-					first = false;
-				}
-
-				matches = true;
-			} else {
-				matches = false;
-			}
-
-		} else if (s < es) {
-			char ch = *p;
-			if (ch == '#')
-				matches = true;
-			else {
-				if (case_sens)
-					matches = (*s == ch);
-				else
-					matches = (toupper(*s) == toupper(ch));
-			}
-			if (matches && first) {
-				ss = s;  /* remember first non-'*' char */
-				first = false;
-			}
-		} else {
-			matches = false;
-		}
-
-		if (matches) {
-			p++; s++;
-		} else {
-			/* doesn't match,
-			 * resume with stacked context if we have one */
-			if (--top < 0)
-				return NULL;  /* no match, give up */
-
-			ss = context[top].ss;
-			s  = context[top].s;
-			p  = context[top].p;
-			first = context[top].first;
-		}
-	}
-
-	/* end of pattern reached */
-	*m_len = max(s - ss, 1);
-	return ss;
-}
-
-
 /**
  * Add a new entry to the list of matches
  *
@@ -306,16 +186,13 @@ add_entry(unsigned start_idx, unsigned end_idx,	struct search_context *context)
 /**
  * Finds all occurrences of a given string in the html box tree
  *
- * \param pattern   the string pattern to search for
- * \param p_len     pattern length
+ * \param matcher   the compiled string pattern to search for
  * \param cur       pointer to the current box
- * \param case_sens whether to perform a case sensitive search
  * \param context   The search context to add the entry to.
  * \return true on success, false on memory allocation failure
  */
-static bool find_occurrences_html(const char *pattern, int p_len,
-		struct box *cur, bool case_sens,
-		struct search_context *context)
+static bool find_occurrences_html(const struct strmatch *matcher,
+		struct box *cur, struct search_context *context)
 {
 	struct box *a;
 
@@ -326,11 +203,10 @@ static bool find_occurrences_html(const char *pattern, int p_len,
 
 		while (length > 0) {
 			struct list_entry *entry;
-			unsigned match_length;
+			size_t match_length;
 			unsigned match_offset;
 			const char *new_text;
-			const char *pos = find_pattern(text, length,
-					pattern, p_len, case_sens,
+			const char *pos = strmatch_find(matcher, text, length,
 					&match_length);
 			if (!pos)
 				break;
@@ -356,8 +232,7 @@ static bool find_occurrences_html(const char *pattern, int p_len,
 
 	/* and recurse */
 	for (a = cur->children; a; a = a->next) {
-		if (!find_occurrences_html(pattern, p_len, a, case_sens,
-				context))
+		if (!find_occurrences_html(matcher, a, context))
 			return false;
 	}
 
@@ -368,34 +243,30 @@ static bool find_occurrences_html(const char *pattern, int p_len,
 /**
  * Finds all occurrences of a given string in a textplain content
  *
- * \param pattern   the string pattern to search for
- * \param p_len     pattern length
+ * \param matcher   the compiled string pattern to search for
  * \param c         the content to be searched
- * \param case_sens whether to perform a case sensitive search
  * \param context   The search context to add the entry to.
  * \return true on success, false on memory allocation failure
  */
 
-static bool find_occurrences_text(const char *pattern, int p_len,
-		struct content *c, bool case_sens,
-		struct search_context *context)
+static bool find_occurrences_text(const struct strmatch *matcher,
+		struct content *c, struct search_context *context)
 {
-	int nlines = textplain_line_count(c);
-	int line;
+	unsigned line;
 
-	for(line = 0; line < nlines; line++) {
+	/* the line count may grow as lines are wrapped */
+	for(line = 0; line < textplain_line_count(c); line++) {
 		size_t offset, length;
 		const char *text = textplain_get_line(c, line,
 				&offset, &length);
 		if (text) {
 			while (length > 0) {
 				struct list_entry *entry;
-				unsigned match_length;
+				size_t match_length;
 				size_t start_idx;
 				const char *new_text;
-				const char *pos = find_pattern(text, length,
-						pattern, p_len, case_sens,
-						&match_length);
+				const char *pos = strmatch_find(matcher, text,
+						length, &match_length);
 				if (!pos)
 					break;
 
@@ -418,6 +289,87 @@ static bool find_occurrences_text(const char *pattern, int p_len,
 }
 
 
+/**
+ * Refines the list of matches for a string extending the previous one
+ *
+ * Every occurrence of the refined string begins where a match of the
+ * previous string was found, so only those positions are examined.
+ *
+ * \param matcher   the compiled refined string pattern
+ * \param context   The search context holding the previous matches.
+ */
+static void refine_matches(const struct strmatch *matcher,
+		struct search_context *context)
+{
+	struct list_entry *a;
+	struct list_entry *b;
+	struct box *box = NULL;
+	unsigned end_idx = 0;
+
+	/* selections are recreated for the refined matches; detach
+	 * each before clearing as the clearing updates the screen */
+	for (a = context->found->next; a; a = a->next) {
+		struct selection *sel = a->sel;
+		if (sel) {
+			a->sel = NULL;
+			selection_clear(sel, true);
+			selection_destroy(sel);
+		}
+	}
+
+	for (a = context->found->next; a; a = b) {
+		const char *text = NULL;
+		size_t length = 0;
+		size_t match_length;
+
+		b = a->next;
+
+		if (context->is_html == true) {
+			if (a->start_box != box) {
+				box = a->start_box;
+				end_idx = 0;
+			}
+			text = box->text + (a->start_idx - box->byte_offset);
+			length = box->length - (a->start_idx - box->byte_offset);
+		} else {
+			size_t offset;
+			int line = textplain_find_line(context->c,
+					a->start_idx);
+			if (line >= 0) {
+				text = textplain_get_line(context->c, line,
+						&offset, &length);
+			}
+			if (text) {
+				text += a->start_idx - offset;
+				length -= a->start_idx - offset;
+			}
+		}
+
+		/* matches may not overlap */
+		if (text && a->start_idx >= end_idx &&
+				strmatch_prefix(matcher, text, length,
+						&match_length)) {
+			a->end_idx = a->start_idx + match_length;
+			end_idx = a->end_idx;
+			continue;
+		}
+
+		/* no longer matches => remove from list */
+		if (a->prev == NULL) {
+			context->found->next = a->next;
+		} else {
+			a->prev->next = a->next;
+		}
+		if (a->next == NULL) {
+			context->found->prev = a->prev;
+		} else {
+			a->next->prev = a->prev;
+		}
+		free(a);
+	}
+}
+
+
 /**
  * Specifies whether all matches or just the current match should
  * be highlighted in the search text.
@@ -500,14 +452,21 @@ search_text(const char *string,
 
 	/* check if we need to start a new search or continue an old one */
 	if ((context->newsearch) ||
-	    (context->prev_case_sens != case_sensitive)) {
-		bool res;
+	    (context->prev_case_sens != case_sensitive) ||
+	    (context->string == NULL) ||
+	    (strcmp(context->string, string) != 0)) {
+		struct strmatch *matcher;
+		bool res = true;
+
+		if (strmatch_create(string, string_len, case_sensitive,
+				&matcher) != NSERROR_OK) {
+			return;
+		}
 
 		if (context->string != NULL)
 			free(context->string);
 
 		context->current = NULL;
-		free_matches(context);
 
 		context->string = malloc(string_len + 1);
 		if (context->string != NULL) {
@@ -517,16 +476,29 @@ search_text(const char *string,
 
 		guit->search->hourglass(true, context->gui_p);
 
-		if (context->is_html == true) {
-			res = find_occurrences_html(string, string_len,
-					box, case_sensitive, context);
+		if ((context->newsearch == false) &&
+		    (context->matcher != NULL) &&
+		    strmatch_refines(context->matcher, matcher)) {
+			/* string extended, so narrow the existing matches */
+			refine_matches(matcher, context);
 		} else {
-			res = find_occurrences_text(string, string_len,
-					context->c, case_sensitive, context);
+			free_matches(context);
+
+			if (context->is_html == true) {
+				res = find_occurrences_html(matcher, box,
+						context);
+			} else {
+				res = find_occurrences_text(matcher,
+						context->c, context);
+			}
 		}
 
+		strmatch_destroy(context->matcher);
+		context->matcher = matcher;
+
 		if (!res) {
 			free_matches(context);
+			context->newsearch = true;
 			guit->search->hourglass(false, context->gui_p);
 			return;
 		}
@@ -606,6 +578,7 @@ search_step(struct search_context *context,
 	if (i >= string_len) {
 		union content_msg_data msg_data;
 		free_matches(context);
+		context->newsearch = true;
 
 		guit->search->status(true, context->gui_p);
 		guit->search->back_state(false, context->gui_p);
@@ -657,5 +630,6 @@ void search_destroy_context(struct search_context *context)
 	guit->search->back_state(true, context->gui_p);
 
 	free_matches(context);
+	strmatch_destroy(context->matcher);
 	free(context);
 }
@@ -26,7 +26,7 @@
 #include <dom/dom.h>
 
 #include "utils/log.h"
-#include "utils/talloc.h"
+#include "utils/arena.h"
 #include "css/utils.h"
 
 #include "html/box.h"
@@ -87,6 +87,7 @@ static bool table_cell_top_process_row(
  * Determine the column width types for a table.
  *
  * \param  len_ctx  Length conversion context
+ * \param  arena    box tree arena to allocate the column array from
  * \param  table    box of type BOX_TABLE
  * \return  true on success, false on memory exhaustion
  *
@@ -96,6 +97,7 @@ static bool table_cell_top_process_row(
 
 bool table_calculate_column_types(
 		const nscss_len_ctx *len_ctx,
+		struct arena *arena,
 		struct box *table)
 {
 	unsigned int i, j;
@@ -106,7 +108,8 @@ bool table_calculate_column_types(
 		/* table->col already constructed, for example frameset table */
 		return true;
 
-	table->col = col = talloc_array(table, struct column, table->columns);
+	table->col = col = arena_alloc(arena,
+			sizeof(struct column) * table->columns);
 	if (!col)
 		return false;
 
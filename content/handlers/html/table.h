@@ -28,9 +28,11 @@
 #include <stdbool.h>
 
 struct box;
+struct arena;
 
 bool table_calculate_column_types(
 		const nscss_len_ctx *len_ctx,
+		struct arena *arena,
 		struct box *table);
 void table_used_border_for_cell(
 		const nscss_len_ctx *len_ctx,
@@ -26,6 +26,9 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef WITH_IMAGE_DECODE_THREAD
+#include <pthread.h>
+#endif
 
 #include "netsurf/inttypes.h"
 #include "utils/utils.h"
@@ -47,6 +50,33 @@
  */
 typedef unsigned int cache_age;
 
+/**
+ * Initial number of chains in the content index.
+ */
+#define IMAGE_CACHE_INDEX_INITIAL_SIZE 64
+
+#ifdef WITH_IMAGE_DECODE_THREAD
+/**
+ * Number of background decode threads.
+ */
+#define IMAGE_CACHE_DECODE_THREADS 2
+
+/**
+ * Interval at which completed background decodes are collected (ms)
+ */
+#define IMAGE_CACHE_DECODE_POLL_TIME 20
+
+/**
+ * State of a background decode of a cache entry.
+ */
+enum image_cache_decode_state {
+	IMAGE_CACHE_DECODE_NONE = 0, /**< no decode outstanding */
+	IMAGE_CACHE_DECODE_QUEUED, /**< waiting for a decode thread */
+	IMAGE_CACHE_DECODE_BUSY, /**< being decoded */
+	IMAGE_CACHE_DECODE_DONE, /**< decoded and waiting to be collected */
+};
+#endif
+
 /**
  * Image cache entry
  */
@@ -54,12 +84,20 @@ struct image_cache_entry_s {
 	struct image_cache_entry_s *next; /**< next cache entry in list */
 	struct image_cache_entry_s *prev; /**< previous cache entry in list */
 
+	struct image_cache_entry_s *hash_next; /**< next entry in index chain */
+	struct image_cache_entry_s *hash_prev; /**< previous entry in index chain */
+
+	struct image_cache_entry_s *lru_next; /**< next less recently plotted entry */
+	struct image_cache_entry_s *lru_prev; /**< next more recently plotted entry */
+
 	/** content is used as a key */
 	struct content *content;
 	/** associated bitmap entry */
 	struct bitmap *bitmap;
 	/** routine to convert content into bitmap */
 	image_cache_convert_fn *convert;
+	/** routine to decode source data into bitmap off the main thread */
+	image_cache_decode_fn *decode;
 
 	/* Statistics for replacement algorithm */
 
@@ -69,7 +107,48 @@ struct image_cache_entry_s {
 	cache_age bitmap_age; /**< Age of last conversion to a bitmap by cache*/
 
 	int conversion_count; /**< Number of times image has been converted */
+
+#ifdef WITH_IMAGE_DECODE_THREAD
+	/* Background decode, the state, list link and result are
+	 * protected by the decoder lock while a decode is outstanding.
+	 */
+	enum image_cache_decode_state decode_state; /**< decode state */
+	struct image_cache_entry_s *decode_next; /**< next entry in decode list */
+	struct bitmap *decode_bitmap; /**< result of the decode */
+
+	/* Source data is resolved on the main thread before queueing */
+	const uint8_t *decode_data; /**< source data to decode */
+	size_t decode_size; /**< length of source data */
+
+	bool decode_pending; /**< decode outstanding, main thread only */
+	bool decode_placeholder; /**< plotted while decoding, main thread only */
+#endif
+};
+
+#ifdef WITH_IMAGE_DECODE_THREAD
+/**
+ * Background decoder state.
+ *
+ * The queue and done lists are shared with the decode threads and
+ * must only be accessed with the lock held.
+ */
+struct image_cache_decoder {
+	pthread_t threads[IMAGE_CACHE_DECODE_THREADS]; /**< decode threads */
+	unsigned int thread_count; /**< number of threads running */
+
+	pthread_mutex_t lock; /**< lock protecting the entry lists */
+	pthread_cond_t cond; /**< signalled when an entry is queued */
+	pthread_cond_t done_cond; /**< signalled when a decode completes */
+	bool quit; /**< decode threads should exit */
+
+	struct image_cache_entry_s *queue; /**< entries waiting to be decoded */
+	struct image_cache_entry_s **queue_tail; /**< end of queue list */
+	struct image_cache_entry_s *done; /**< entries which have been decoded */
+
+	/** number of decodes not yet collected, main thread only */
+	unsigned int outstanding;
 };
+#endif
 
 /**
  * Current state of the cache.
@@ -89,6 +168,24 @@ struct image_cache_s {
 	/* The objects the cache holds */
 	struct image_cache_entry_s *entries;
 
+	/** Entries indexed by content */
+	struct image_cache_entry_s **buckets;
+	/** Number of index chains (power of 2) */
+	unsigned int bucket_count;
+	/** Number of entries the cache holds */
+	unsigned int entry_count;
+
+	/**
+	 * Entries ordered by when they were last plotted. Entries
+	 * which have never been plotted are at the tail.
+	 */
+	struct image_cache_entry_s *lru_head;
+	struct image_cache_entry_s *lru_tail;
+
+	/** Entry last found by index, speeds up in order enumeration */
+	struct image_cache_entry_s *findn_entry;
+	/** Index of the entry last found by index */
+	int findn_index;
 
 	/* Statistics for management algorithm */
 
@@ -134,6 +231,22 @@ struct image_cache_s {
 	int peak_conversions;
 	/** Size of bitmap with most conversions */
 	unsigned int peak_conversions_size;
+
+	/** Number of entry lookups by content */
+	int lookup_count;
+
+	/** Number of bitmaps freed by the cleaner */
+	int evict_count;
+	/** Total size of bitmaps freed by the cleaner */
+	uint64_t evict_size;
+
+#ifdef WITH_IMAGE_DECODE_THREAD
+	/** Background decoder or NULL if conversions are synchronous */
+	struct image_cache_decoder *decoder;
+
+	/** Number of bitmaps successfully decoded in the background */
+	int decode_count;
+#endif
 };
 
 /** image cache state */
@@ -149,16 +262,50 @@ static struct image_cache_s *image_cache = NULL;
 static struct image_cache_entry_s *image_cache__findn(int entryn)
 {
 	struct image_cache_entry_s *found;
+	int index;
+
+	if ((image_cache->findn_entry != NULL) &&
+	    (entryn >= image_cache->findn_index)) {
+		/* continue from the previous entry found */
+		found = image_cache->findn_entry;
+		index = image_cache->findn_index;
+	} else {
+		found = image_cache->entries;
+		index = 0;
+	}
 
-	found = image_cache->entries;
-	while ((found != NULL) && (entryn > 0)) {
-		entryn--;
+	while ((found != NULL) && (index < entryn)) {
+		index++;
 		found = found->next;
 	}
+
+	if (found != NULL) {
+		image_cache->findn_entry = found;
+		image_cache->findn_index = index;
+	}
+
 	return found;
 }
 
 
+/**
+ * Obtain the index chain for a content
+ *
+ * \param c The content to get the chain for
+ * \return Pointer to the head of the index chain
+ */
+static inline struct image_cache_entry_s **
+image_cache__chain(const struct content *c)
+{
+	uint32_t hash;
+
+	/* contents are heap allocated so the low bits carry nothing */
+	hash = (uint32_t)((uintptr_t)c >> 4) * 2654435761u;
+
+	return &image_cache->buckets[hash & (image_cache->bucket_count - 1)];
+}
+
+
 /**
  * Find the cache entry for a content
  *
@@ -169,9 +316,11 @@ static struct image_cache_entry_s *image_cache__find(const struct content *c)
 {
 	struct image_cache_entry_s *found;
 
-	found = image_cache->entries;
+	image_cache->lookup_count++;
+
+	found = *image_cache__chain(c);
 	while ((found != NULL) && (found->content != c)) {
-		found = found->next;
+		found = found->hash_next;
 	}
 	return found;
 }
@@ -216,14 +365,130 @@ static void image_cache_stats_bitmap_add(struct image_cache_entry_s *centry)
 	}
 }
 
+/**
+ * Grow the content index
+ *
+ * The index is doubled in size and every entry rehashed. Should the
+ * allocation fail the existing index is retained; it remains correct
+ * but with longer chains.
+ */
+static void image_cache__grow(void)
+{
+	struct image_cache_entry_s **buckets;
+	struct image_cache_entry_s **chain;
+	struct image_cache_entry_s *centry;
+	unsigned int old_count = image_cache->bucket_count;
+
+	buckets = calloc(old_count * 2, sizeof(struct image_cache_entry_s *));
+	if (buckets == NULL) {
+		return;
+	}
+
+	free(image_cache->buckets);
+	image_cache->buckets = buckets;
+	image_cache->bucket_count = old_count * 2;
+
+	for (centry = image_cache->entries;
+	     centry != NULL;
+	     centry = centry->next) {
+		chain = image_cache__chain(centry->content);
+
+		centry->hash_prev = NULL;
+		centry->hash_next = *chain;
+		if (*chain != NULL) {
+			(*chain)->hash_prev = centry;
+		}
+		*chain = centry;
+	}
+}
+
+/**
+ * Remove an entry from the plot order list
+ *
+ * \param centry The image cache entry to remove.
+ */
+static void image_cache__lru_unlink(struct image_cache_entry_s *centry)
+{
+	if (centry->lru_prev == NULL) {
+		image_cache->lru_head = centry->lru_next;
+	} else {
+		centry->lru_prev->lru_next = centry->lru_next;
+	}
+
+	if (centry->lru_next == NULL) {
+		image_cache->lru_tail = centry->lru_prev;
+	} else {
+		centry->lru_next->lru_prev = centry->lru_prev;
+	}
+}
+
+/**
+ * Mark an entry as the most recently plotted
+ *
+ * \param centry The image cache entry which was plotted.
+ */
+static void image_cache__lru_touch(struct image_cache_entry_s *centry)
+{
+	if (image_cache->lru_head == centry) {
+		return;
+	}
+
+	image_cache__lru_unlink(centry);
+
+	centry->lru_prev = NULL;
+	centry->lru_next = image_cache->lru_head;
+	if (centry->lru_next != NULL) {
+		centry->lru_next->lru_prev = centry;
+	} else {
+		image_cache->lru_tail = centry;
+	}
+	image_cache->lru_head = centry;
+}
+
+/**
+ * Add an entry to the cache
+ *
+ * The entry must have its content set. It is placed at the tail of
+ * the plot order as it has never been plotted.
+ *
+ * \param centry The image cache entry to add.
+ */
 static void image_cache__link(struct image_cache_entry_s *centry)
 {
+	struct image_cache_entry_s **chain;
+
+	if (image_cache->entry_count >= image_cache->bucket_count) {
+		image_cache__grow();
+	}
+
 	centry->next = image_cache->entries;
 	centry->prev = NULL;
 	if (centry->next != NULL) {
 		centry->next->prev = centry;
 	}
 	image_cache->entries = centry;
+
+	chain = image_cache__chain(centry->content);
+	centry->hash_prev = NULL;
+	centry->hash_next = *chain;
+	if (centry->hash_next != NULL) {
+		centry->hash_next->hash_prev = centry;
+	}
+	*chain = centry;
+
+	centry->lru_next = NULL;
+	centry->lru_prev = image_cache->lru_tail;
+	if (centry->lru_prev != NULL) {
+		centry->lru_prev->lru_next = centry;
+	} else {
+		image_cache->lru_head = centry;
+	}
+	image_cache->lru_tail = centry;
+
+	image_cache->entry_count++;
+
+	/* indexes have all moved */
+	image_cache->findn_entry = NULL;
 }
 
 static void image_cache__unlink(struct image_cache_entry_s *centry)
@@ -245,8 +510,432 @@ static void image_cache__unlink(struct image_cache_entry_s *centry)
 			centry->next->prev = centry->prev;
 		}
 	}
+
+	/* remove from index */
+	if (centry->hash_prev == NULL) {
+		*image_cache__chain(centry->content) = centry->hash_next;
+	} else {
+		centry->hash_prev->hash_next = centry->hash_next;
+	}
+	if (centry->hash_next != NULL) {
+		centry->hash_next->hash_prev = centry->hash_prev;
+	}
+
+	image_cache__lru_unlink(centry);
+
+	image_cache->entry_count--;
+
+	image_cache->findn_entry = NULL;
+}
+
+#ifdef WITH_IMAGE_DECODE_THREAD
+
+/**
+ * Background decode thread.
+ *
+ * Decodes queued entries and moves them to the done list. Only the
+ * source data and decode routine of an entry are used without the
+ * lock held. The content, which must only be used on the main thread,
+ * cannot be destroyed and so release its source data while the entry
+ * is being decoded.
+ *
+ * \param p The decoder state.
+ * \return NULL
+ */
+static void *image_cache__decode_thread(void *p)
+{
+	struct image_cache_decoder *decoder = p;
+	struct image_cache_entry_s *centry;
+	struct bitmap *bitmap;
+
+	pthread_mutex_lock(&decoder->lock);
+	while (true) {
+		while ((decoder->queue == NULL) && (decoder->quit == false)) {
+			pthread_cond_wait(&decoder->cond, &decoder->lock);
+		}
+
+		if (decoder->quit) {
+			break;
+		}
+
+		centry = decoder->queue;
+		decoder->queue = centry->decode_next;
+		if (decoder->queue == NULL) {
+			decoder->queue_tail = &decoder->queue;
+		}
+		centry->decode_state = IMAGE_CACHE_DECODE_BUSY;
+		pthread_mutex_unlock(&decoder->lock);
+
+		bitmap = centry->decode(centry->decode_data,
+					centry->decode_size);
+
+		pthread_mutex_lock(&decoder->lock);
+		centry->decode_bitmap = bitmap;
+		centry->decode_state = IMAGE_CACHE_DECODE_DONE;
+		centry->decode_next = decoder->done;
+		decoder->done = centry;
+		pthread_cond_broadcast(&decoder->done_cond);
+	}
+	pthread_mutex_unlock(&decoder->lock);
+
+	return NULL;
+}
+
+/**
+ * Remove an entry from a decoder list.
+ *
+ * The decoder lock must be held and the entry must be on the list.
+ *
+ * \param list The list to remove the entry from.
+ * \param tail The lists tail pointer or NULL if it has none.
+ * \param centry The entry to remove.
+ */
+static void
+image_cache__decode_unlist(struct image_cache_entry_s **list,
+			   struct image_cache_entry_s ***tail,
+			   struct image_cache_entry_s *centry)
+{
+	while (*list != centry) {
+		list = &(*list)->decode_next;
+	}
+	*list = centry->decode_next;
+
+	if ((tail != NULL) && (*tail == &centry->decode_next)) {
+		*tail = list;
+	}
+	centry->decode_next = NULL;
+}
+
+/**
+ * Complete a background decode on the main thread.
+ *
+ * The entry must have been removed from the decoder lists. The
+ * decoded bitmap is installed in the entry.
+ *
+ * \param centry The entry which has been decoded.
+ * \param redraw Request a redraw of the content if a placeholder was
+ *                plotted for it.
+ */
+static void
+image_cache__decode_complete(struct image_cache_entry_s *centry, bool redraw)
+{
+	struct bitmap *bitmap = centry->decode_bitmap;
+	bool placeholder = centry->decode_placeholder;
+
+	centry->decode_state = IMAGE_CACHE_DECODE_NONE;
+	centry->decode_bitmap = NULL;
+	centry->decode_pending = false;
+	centry->decode_placeholder = false;
+	image_cache->decoder->outstanding--;
+
+	if (bitmap == NULL) {
+		image_cache->fail_count++;
+		image_cache->fail_size += centry->bitmap_size;
+		return;
+	}
+
+	centry->bitmap = bitmap;
+	image_cache_stats_bitmap_add(centry);
+	image_cache->decode_count++;
+
+	if (placeholder) {
+		/* the bitmap was wanted before it was available */
+		image_cache->miss_count++;
+		image_cache->miss_size += centry->bitmap_size;
+
+		if (redraw) {
+			content__request_redraw(centry->content, 0, 0,
+						centry->content->width,
+						centry->content->height);
+		}
+	}
+}
+
+/**
+ * Scheduled poll for completed background decodes.
+ *
+ * Reschedules itself while there are decodes outstanding.
+ *
+ * \param p unused.
+ */
+static void image_cache__decode_poll(void *p)
+{
+	struct image_cache_decoder *decoder = image_cache->decoder;
+	struct image_cache_entry_s *done;
+	struct image_cache_entry_s *next;
+
+	pthread_mutex_lock(&decoder->lock);
+	done = decoder->done;
+	decoder->done = NULL;
+	pthread_mutex_unlock(&decoder->lock);
+
+	while (done != NULL) {
+		next = done->decode_next;
+		done->decode_next = NULL;
+		image_cache__decode_complete(done, true);
+		done = next;
+	}
+
+	if (decoder->outstanding > 0) {
+		guit->misc->schedule(IMAGE_CACHE_DECODE_POLL_TIME,
+				     image_cache__decode_poll,
+				     NULL);
+	}
+}
+
+/**
+ * Queue an entry for background decoding.
+ *
+ * The source data is obtained here on the main thread, the decode
+ * threads never access the content.
+ *
+ * \param centry The entry to decode.
+ * \return true if the entry will be decoded in the background or
+ *         false if it must be converted synchronously.
+ */
+static bool image_cache__decode_queue(struct image_cache_entry_s *centry)
+{
+	struct image_cache_decoder *decoder = image_cache->decoder;
+
+	if ((decoder == NULL) || (centry->decode == NULL)) {
+		return false;
+	}
+
+	if (centry->decode_pending) {
+		return true;
+	}
+
+	centry->decode_data = content__get_source_data(centry->content,
+						       &centry->decode_size);
+	if (centry->decode_data == NULL) {
+		return false;
+	}
+
+	pthread_mutex_lock(&decoder->lock);
+	centry->decode_state = IMAGE_CACHE_DECODE_QUEUED;
+	centry->decode_next = NULL;
+	*decoder->queue_tail = centry;
+	decoder->queue_tail = &centry->decode_next;
+	pthread_cond_signal(&decoder->cond);
+	pthread_mutex_unlock(&decoder->lock);
+
+	centry->decode_pending = true;
+
+	if (decoder->outstanding == 0) {
+		guit->misc->schedule(IMAGE_CACHE_DECODE_POLL_TIME,
+				     image_cache__decode_poll,
+				     NULL);
+	}
+	decoder->outstanding++;
+
+	return true;
+}
+
+/**
+ * Resolve any outstanding background decode of an entry.
+ *
+ * A decode which has not yet started is cancelled, one in progress is
+ * waited for and a completed one is collected. On return the entry
+ * may be freely altered.
+ *
+ * \param centry The entry to resolve.
+ */
+static void image_cache__decode_wait(struct image_cache_entry_s *centry)
+{
+	struct image_cache_decoder *decoder = image_cache->decoder;
+	bool cancelled = false;
+
+	if (centry->decode_pending == false) {
+		return;
+	}
+
+	pthread_mutex_lock(&decoder->lock);
+	while (centry->decode_state == IMAGE_CACHE_DECODE_BUSY) {
+		pthread_cond_wait(&decoder->done_cond, &decoder->lock);
+	}
+
+	if (centry->decode_state == IMAGE_CACHE_DECODE_QUEUED) {
+		image_cache__decode_unlist(&decoder->queue,
+					   &decoder->queue_tail,
+					   centry);
+		cancelled = true;
+	} else {
+		image_cache__decode_unlist(&decoder->done, NULL, centry);
+	}
+	pthread_mutex_unlock(&decoder->lock);
+
+	if (cancelled) {
+		centry->decode_state = IMAGE_CACHE_DECODE_NONE;
+		centry->decode_pending = false;
+		centry->decode_placeholder = false;
+		decoder->outstanding--;
+	} else {
+		image_cache__decode_complete(centry, false);
+	}
 }
 
+/**
+ * Determine if a placeholder must be plotted for an entry.
+ *
+ * A placeholder is required while a background decode is
+ * outstanding, the content is redrawn once the decode completes. A
+ * completed decode is collected immediately.
+ *
+ * \param centry The entry being plotted.
+ * \return true if the entry has a decode outstanding.
+ */
+static bool image_cache__decode_placeholder(struct image_cache_entry_s *centry)
+{
+	struct image_cache_decoder *decoder = image_cache->decoder;
+	bool done = false;
+
+	if (centry->decode_pending == false) {
+		return false;
+	}
+
+	pthread_mutex_lock(&decoder->lock);
+	if (centry->decode_state == IMAGE_CACHE_DECODE_DONE) {
+		image_cache__decode_unlist(&decoder->done, NULL, centry);
+		done = true;
+	}
+	pthread_mutex_unlock(&decoder->lock);
+
+	if (done) {
+		image_cache__decode_complete(centry, false);
+	} else {
+		centry->decode_placeholder = true;
+	}
+
+	return !done;
+}
+
+/**
+ * Start the background decode threads.
+ *
+ * \return NSERROR_OK on success or error code on failure.
+ */
+static nserror image_cache__decode_init(void)
+{
+	struct image_cache_decoder *decoder;
+	unsigned int thread_idx;
+
+	decoder = calloc(1, sizeof(struct image_cache_decoder));
+	if (decoder == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	decoder->queue_tail = &decoder->queue;
+
+	if (pthread_mutex_init(&decoder->lock, NULL) != 0) {
+		free(decoder);
+		return NSERROR_INIT_FAILED;
+	}
+
+	if (pthread_cond_init(&decoder->cond, NULL) != 0) {
+		pthread_mutex_destroy(&decoder->lock);
+		free(decoder);
+		return NSERROR_INIT_FAILED;
+	}
+
+	if (pthread_cond_init(&decoder->done_cond, NULL) != 0) {
+		pthread_cond_destroy(&decoder->cond);
+		pthread_mutex_destroy(&decoder->lock);
+		free(decoder);
+		return NSERROR_INIT_FAILED;
+	}
+
+	for (thread_idx = 0;
+	     thread_idx < IMAGE_CACHE_DECODE_THREADS;
+	     thread_idx++) {
+		if (pthread_create(&decoder->threads[thread_idx], NULL,
+				   image_cache__decode_thread, decoder) != 0) {
+			break;
+		}
+	}
+	decoder->thread_count = thread_idx;
+
+	if (decoder->thread_count == 0) {
+		pthread_cond_destroy(&decoder->done_cond);
+		pthread_cond_destroy(&decoder->cond);
+		pthread_mutex_destroy(&decoder->lock);
+		free(decoder);
+		return NSERROR_INIT_FAILED;
+	}
+
+	image_cache->decoder = decoder;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Stop the background decode threads.
+ *
+ * Queued decodes are discarded and completed ones collected.
+ */
+static void image_cache__decode_fini(void)
+{
+	struct image_cache_decoder *decoder = image_cache->decoder;
+	struct image_cache_entry_s *centry;
+	unsigned int thread_idx;
+
+	if (decoder == NULL) {
+		return;
+	}
+
+	guit->misc->schedule(-1, image_cache__decode_poll, NULL);
+
+	pthread_mutex_lock(&decoder->lock);
+	decoder->quit = true;
+	pthread_cond_broadcast(&decoder->cond);
+	pthread_mutex_unlock(&decoder->lock);
+
+	for (thread_idx = 0; thread_idx < decoder->thread_count; thread_idx++) {
+		pthread_join(decoder->threads[thread_idx], NULL);
+	}
+
+	/* threads have exited, the lists may be used without the lock */
+	while (decoder->queue != NULL) {
+		centry = decoder->queue;
+		decoder->queue = centry->decode_next;
+		centry->decode_next = NULL;
+		centry->decode_state = IMAGE_CACHE_DECODE_NONE;
+		centry->decode_pending = false;
+		decoder->outstanding--;
+	}
+
+	while (decoder->done != NULL) {
+		centry = decoder->done;
+		decoder->done = centry->decode_next;
+		centry->decode_next = NULL;
+		image_cache__decode_complete(centry, false);
+	}
+
+	pthread_cond_destroy(&decoder->done_cond);
+	pthread_cond_destroy(&decoder->cond);
+	pthread_mutex_destroy(&decoder->lock);
+	free(decoder);
+	image_cache->decoder = NULL;
+}
+
+#else
+
+static inline bool image_cache__decode_queue(struct image_cache_entry_s *centry)
+{
+	return false;
+}
+
+static inline void image_cache__decode_wait(struct image_cache_entry_s *centry)
+{
+}
+
+static inline bool
+image_cache__decode_placeholder(struct image_cache_entry_s *centry)
+{
+	return false;
+}
+
+#endif
+
 /**
  * free bitmap from an image cache entry
  *
@@ -289,6 +978,8 @@ static void image_cache__free_entry(struct image_cache_entry_s *centry)
 		image_cache->total_unrendered++;
 	}
 
+	image_cache__decode_wait(centry);
+
 	image_cache__free_bitmap(centry);
 
 	image_cache__unlink(centry);
@@ -299,23 +990,33 @@ static void image_cache__free_entry(struct image_cache_entry_s *centry)
 /**
  * Image cache cleaner
  *
+ * Bitmaps are freed starting with the least recently plotted entry
+ * until the cache is back within its target size. Recently plotted
+ * entries are never considered and as the list is in plot order the
+ * walk stops at the first one.
+ *
  * \param icache The image cache context.
  */
 static void image_cache__clean(struct image_cache_s *icache)
 {
-	struct image_cache_entry_s *centry = icache->entries;
+	struct image_cache_entry_s *centry = icache->lru_tail;
 
-	while (centry != NULL) {
-		if ((icache->current_age - centry->redraw_age) >
+	while ((centry != NULL) &&
+	       (icache->total_bitmap_size >
+		(icache->params.limit - icache->params.hysteresis))) {
+		if ((icache->current_age - centry->redraw_age) <=
 		    icache->params.bg_clean_time) {
-			/* only consider older entries, avoids active entries */
-			if ((icache->total_bitmap_size >
-			     (icache->params.limit - icache->params.hysteresis)) &&
-			    (rand() > (RAND_MAX / 2))) {
-				image_cache__free_bitmap(centry);
-			}
+			/* this and all remaining entries are active */
+			break;
+		}
+
+		if (centry->bitmap != NULL) {
+			icache->evict_count++;
+			icache->evict_size += centry->bitmap_size;
+			image_cache__free_bitmap(centry);
 		}
-		centry=centry->next;
+
+		centry = centry->lru_prev;
 	}
 }
 
@@ -352,6 +1053,9 @@ struct bitmap *image_cache_get_bitmap(const struct content *c)
 		return NULL;
 	}
 
+	/* the caller requires the bitmap now */
+	image_cache__decode_wait(centry);
+
 	if (centry->bitmap == NULL) {
 		if (centry->convert != NULL) {
 			centry->bitmap = centry->convert(centry->content);
@@ -420,12 +1124,28 @@ image_cache_init(const struct image_cache_parameters *image_cache_parameters)
 		return NSERROR_NOMEM;
 	}
 
+	image_cache->bucket_count = IMAGE_CACHE_INDEX_INITIAL_SIZE;
+	image_cache->buckets = calloc(image_cache->bucket_count,
+				      sizeof(struct image_cache_entry_s *));
+	if (image_cache->buckets == NULL) {
+		free(image_cache);
+		image_cache = NULL;
+		return NSERROR_NOMEM;
+	}
+
 	image_cache->params = *image_cache_parameters;
 
 	guit->misc->schedule(image_cache->params.bg_clean_time,
 				image_cache__background_update,
 				image_cache);
 
+#ifdef WITH_IMAGE_DECODE_THREAD
+	if (image_cache__decode_init() != NSERROR_OK) {
+		/* not fatal, conversions are simply performed synchronously */
+		NSLOG(netsurf, INFO, "Unable to start image decode threads");
+	}
+#endif
+
 	NSLOG(netsurf, INFO,
 	      "Image cache initialised with a limit of %"PRIsizet" hysteresis of %"PRIsizet,
 	      image_cache->params.limit,
@@ -441,6 +1161,10 @@ nserror image_cache_fini(void)
 
 	guit->misc->schedule(-1, image_cache__background_update, image_cache);
 
+#ifdef WITH_IMAGE_DECODE_THREAD
+	image_cache__decode_fini();
+#endif
+
 	NSLOG(netsurf, INFO, "Size at finish %"PRIsizet" (in %d)",
 	      image_cache->total_bitmap_size, image_cache->bitmap_count);
 
@@ -501,6 +1225,18 @@ nserror image_cache_fini(void)
 	      image_cache->peak_conversions_size,
 	      image_cache->peak_conversions);
 
+	NSLOG(netsurf, INFO,
+	      "Lookups %d, bitmaps evicted %d (size %"PRIu64")",
+	      image_cache->lookup_count,
+	      image_cache->evict_count,
+	      image_cache->evict_size);
+
+#ifdef WITH_IMAGE_DECODE_THREAD
+	NSLOG(netsurf, INFO, "Bitmaps decoded in background %d",
+	      image_cache->decode_count);
+#endif
+
+	free(image_cache->buckets);
 	free(image_cache);
 
 	return NSERROR_OK;
@@ -509,7 +1245,8 @@ nserror image_cache_fini(void)
 /* exported interface documented in image_cache.h */
 nserror image_cache_add(struct content *content,
 			struct bitmap *bitmap,
-			image_cache_convert_fn *convert)
+			image_cache_convert_fn *convert,
+			image_cache_decode_fn *decode)
 {
 	struct image_cache_entry_s *centry;
 
@@ -525,16 +1262,20 @@ nserror image_cache_add(struct content *content,
 		if (centry == NULL) {
 			return NSERROR_NOMEM;
 		}
-		image_cache__link(centry);
 		centry->content = content;
+		image_cache__link(centry);
 
 		centry->bitmap_size = content->width * content->height * 4;
+	} else {
+		/* entry is about to be altered */
+		image_cache__decode_wait(centry);
 	}
 
 	NSLOG(netsurf, INFO, "centry %p, content %p, bitmap %p", centry,
 	      content, bitmap);
 
 	centry->convert = convert;
+	centry->decode = decode;
 
 	/* set bitmap entry if one is passed, free extant one if present */
 	if (bitmap != NULL) {
@@ -547,7 +1288,8 @@ nserror image_cache_add(struct content *content,
 	} else {
 		/* no bitmap, check to see if we should speculatively convert */
 		if ((centry->convert != NULL) &&
-		    (image_cache_speculate(content) == true)) {
+		    (image_cache_speculate(content) == true) &&
+		    (image_cache__decode_queue(centry) == false)) {
 			centry->bitmap = centry->convert(centry->content);
 
 			if (centry->bitmap != NULL) {
@@ -667,6 +1409,9 @@ case chr :					\
 			FMTCHR('v', "d", total_extra_conversions_count);
 			FMTCHR('w', "u", peak_conversions_size);
 			FMTCHR('x', "d", peak_conversions);
+			FMTCHR('y', "d", lookup_count);
+			FMTCHR('z', "d", evict_count);
+			FMTCHR('A', PRId64, evict_size);
 
 
 			}
@@ -810,6 +1555,11 @@ bool image_cache_redraw(struct content *c,
 		return false;
 	}
 
+	if (image_cache__decode_placeholder(centry)) {
+		/* nothing is plotted until the background decode completes */
+		return true;
+	}
+
 	if (centry->bitmap == NULL) {
 		if (centry->convert != NULL) {
 			centry->bitmap = centry->convert(centry->content);
@@ -833,6 +1583,7 @@ bool image_cache_redraw(struct content *c,
 	/* update statistics */
 	centry->redraw_count++;
 	centry->redraw_age = image_cache->current_age;
+	image_cache__lru_touch(centry);
 
 	return image_bitmap_plot(centry->bitmap, data, clip, ctx);
 }
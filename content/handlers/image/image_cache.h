@@ -37,6 +37,9 @@
 #ifndef NETSURF_IMAGE_IMAGE_CACHE_H_
 #define NETSURF_IMAGE_IMAGE_CACHE_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "utils/errors.h"
 #include "netsurf/content_type.h"
 
@@ -45,6 +48,19 @@ struct redraw_context;
 
 typedef struct bitmap * (image_cache_convert_fn) (struct content *content);
 
+/**
+ * Decode image source data into a bitmap.
+ *
+ * Decoding may take place on a background thread so the routine must
+ * only use the source data passed and the frontend bitmap operations.
+ * It must not access the content or log.
+ *
+ * \param data The image source data.
+ * \param size The length of the source data.
+ * \return The decoded bitmap or NULL on failure.
+ */
+typedef struct bitmap * (image_cache_decode_fn) (const uint8_t *data, size_t size);
+
 struct image_cache_parameters {
 	/** How frequently the background cache clean process is run (ms) */
 	unsigned int bg_clean_time;
@@ -71,11 +87,15 @@ nserror image_cache_fini(void);
  * @param content The content handle used as a key
  * @param bitmap A bitmap representing the already converted content or NULL.
  * @param convert A function pointer to convert the content into a bitmap or NULL.
+ * @param decode A function pointer to decode the content source data
+ *               into a bitmap, which may be called off the main thread,
+ *               or NULL if the content may only be converted.
  * @return A netsurf error code.
  */
 nserror image_cache_add(struct content *content, 
 			struct bitmap *bitmap, 
-			image_cache_convert_fn *convert);
+			image_cache_convert_fn *convert,
+			image_cache_decode_fn *decode);
 
 nserror image_cache_remove(struct content *content);
 
@@ -155,6 +175,9 @@ int image_cache_snentryf(char *string, size_t size, unsigned int entryn,
  *     of times.
  * x The number of times the image that was converted (read missed cache) 
  *     highest number of times.
+ * y The number of cache entry lookups.
+ * z The number of bitmaps freed by the cache cleaner.
+ * A The total size of bitmaps freed by the cache cleaner.
  *
  * format modifiers:
  * A p before the value modifies the replacement to be a percentage.
@@ -56,7 +56,14 @@
 /* but we don't care if we're not on RISC OS */
 #endif
 
-static char nsjpeg_error_buffer[JMSG_LENGTH_MAX];
+/**
+ * JPEG library error handling state for a single decode
+ */
+struct nsjpeg_error_mgr {
+	struct jpeg_error_mgr pub; /**< library error manager */
+	jmp_buf setjmp_buffer; /**< return point for fatal errors */
+	char buffer[JMSG_LENGTH_MAX]; /**< message of the last error */
+};
 
 static unsigned char nsjpeg_eoi[] = { 0xff, JPEG_EOI };
 
@@ -142,37 +149,49 @@ static void nsjpeg_term_source(j_decompress_ptr cinfo)
  */
 static void nsjpeg_error_log(j_common_ptr cinfo)
 {
-	cinfo->err->format_message(cinfo, nsjpeg_error_buffer);
-	NSLOG(netsurf, INFO, "%s", nsjpeg_error_buffer);
+	struct nsjpeg_error_mgr *err = (struct nsjpeg_error_mgr *) cinfo->err;
+
+	cinfo->err->format_message(cinfo, err->buffer);
+	NSLOG(netsurf, INFO, "%s", err->buffer);
+}
+
+
+/**
+ * Error output handler for JPEG library which discards warnings.
+ *
+ * Used when decoding may be off the main thread where logging is not
+ * permitted.
+ */
+static void nsjpeg_error_discard(j_common_ptr cinfo)
+{
 }
 
 
 /**
  * Fatal error handler for JPEG library.
  *
- * This prevents jpeglib calling exit() on a fatal error.
+ * This prevents jpeglib calling exit() on a fatal error. The message
+ * is left in the error manager buffer for the caller to report.
  */
 static void nsjpeg_error_exit(j_common_ptr cinfo)
 {
-	jmp_buf *setjmp_buffer = (jmp_buf *) cinfo->client_data;
+	struct nsjpeg_error_mgr *err = (struct nsjpeg_error_mgr *) cinfo->err;
 
-	cinfo->err->format_message(cinfo, nsjpeg_error_buffer);
-	NSLOG(netsurf, INFO, "%s", nsjpeg_error_buffer);
+	cinfo->err->format_message(cinfo, err->buffer);
 
-	longjmp(*setjmp_buffer, 1);
+	longjmp(err->setjmp_buffer, 1);
 }
 
 /**
- * create a bitmap from jpeg content.
+ * create a bitmap from jpeg source data.
+ *
+ * This may be called off the main thread.
  */
 static struct bitmap *
-jpeg_cache_convert(struct content *c)
+jpeg_cache_decode(const uint8_t *source_data, size_t source_size)
 {
-	const uint8_t *source_data; /* Jpeg source data */
-	size_t source_size; /* length of Jpeg source data */
 	struct jpeg_decompress_struct cinfo;
-	struct jpeg_error_mgr jerr;
-	jmp_buf setjmp_buffer;
+	struct nsjpeg_error_mgr jerr;
 	unsigned int height;
 	unsigned int width;
 	struct bitmap * volatile bitmap = NULL;
@@ -187,26 +206,23 @@ jpeg_cache_convert(struct content *c)
 		jpeg_resync_to_restart,
 		nsjpeg_term_source };
 
-	/* obtain jpeg source data and perfom minimal sanity checks */
-	source_data = content__get_source_data(c, &source_size);
-
+	/* perfom minimal sanity checks on source data */
 	if ((source_data == NULL) ||
 	    (source_size < MIN_JPEG_SIZE)) {
 		return NULL;
 	}
 
 	/* setup a JPEG library error handler */
-	cinfo.err = jpeg_std_error(&jerr);
-	jerr.error_exit = nsjpeg_error_exit;
-	jerr.output_message = nsjpeg_error_log;
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = nsjpeg_error_exit;
+	jerr.pub.output_message = nsjpeg_error_discard;
 
 	/* handler for fatal errors during decompression */
-	if (setjmp(setjmp_buffer)) {
+	if (setjmp(jerr.setjmp_buffer)) {
 		jpeg_destroy_decompress(&cinfo);
 		return bitmap;
 	}
 
-	cinfo.client_data = &setjmp_buffer;
 	jpeg_create_decompress(&cinfo);
 
 	/* setup data source */
@@ -302,14 +318,27 @@ jpeg_cache_convert(struct content *c)
 	return bitmap;
 }
 
+/**
+ * create a bitmap from jpeg content.
+ */
+static struct bitmap *
+jpeg_cache_convert(struct content *c)
+{
+	const uint8_t *source_data; /* Jpeg source data */
+	size_t source_size; /* length of Jpeg source data */
+
+	source_data = content__get_source_data(c, &source_size);
+
+	return jpeg_cache_decode(source_data, source_size);
+}
+
 /**
  * Convert a CONTENT_JPEG for display.
  */
 static bool nsjpeg_convert(struct content *c)
 {
 	struct jpeg_decompress_struct cinfo;
-	struct jpeg_error_mgr jerr;
-	jmp_buf setjmp_buffer;
+	struct nsjpeg_error_mgr jerr;
 	struct jpeg_source_mgr source_mgr = { 0, 0,
 		nsjpeg_init_source, nsjpeg_fill_input_buffer,
 		nsjpeg_skip_input_data, jpeg_resync_to_restart,
@@ -322,20 +351,21 @@ static bool nsjpeg_convert(struct content *c)
 	/* check image header is valid and get width/height */
 	data = content__get_source_data(c, &size);
 
-	cinfo.err = jpeg_std_error(&jerr);
-	jerr.error_exit = nsjpeg_error_exit;
-	jerr.output_message = nsjpeg_error_log;
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = nsjpeg_error_exit;
+	jerr.pub.output_message = nsjpeg_error_log;
 
-	if (setjmp(setjmp_buffer)) {
+	if (setjmp(jerr.setjmp_buffer)) {
 		jpeg_destroy_decompress(&cinfo);
 
+		NSLOG(netsurf, INFO, "%s", jerr.buffer);
+
 		msg_data.errordata.errorcode = NSERROR_UNKNOWN;
-		msg_data.errordata.errormsg = nsjpeg_error_buffer;
+		msg_data.errordata.errormsg = jerr.buffer;
 		content_broadcast(c, CONTENT_MSG_ERROR, &msg_data);
 		return false;
 	}
 
-	cinfo.client_data = &setjmp_buffer;
 	jpeg_create_decompress(&cinfo);
 	source_mgr.next_input_byte = (unsigned char *) data;
 	source_mgr.bytes_in_buffer = size;
@@ -352,7 +382,7 @@ static bool nsjpeg_convert(struct content *c)
 
 	jpeg_destroy_decompress(&cinfo);
 
-	image_cache_add(c, NULL, jpeg_cache_convert);
+	image_cache_add(c, NULL, jpeg_cache_convert, jpeg_cache_decode);
 
 	/* set title text */
 	title = messages_get_buff("JPEGTitle",
@@ -86,6 +86,27 @@ static void nspng_error(png_structp png_ptr, png_const_charp error_message)
 	longjmp(png_jmpbuf(png_ptr), CBERR_LIBPNG);
 }
 
+/**
+ * png_cache_warning -- callback for libpng warnings while decoding
+ *
+ * Decoding may be off the main thread so warnings are discarded.
+ */
+static void
+png_cache_warning(png_structp png_ptr, png_const_charp warning_message)
+{
+}
+
+/**
+ * png_cache_error -- callback for libpng errors while decoding
+ *
+ * Decoding may be off the main thread so the error is not logged.
+ */
+static void
+png_cache_error(png_structp png_ptr, png_const_charp error_message)
+{
+	longjmp(png_jmpbuf(png_ptr), CBERR_LIBPNG);
+}
+
 static void nspng_setup_transforms(png_structp png_ptr, png_infop info_ptr)
 {
 	int bit_depth, color_type, intent;
@@ -421,12 +442,13 @@ static png_bytep *calc_row_pointers(struct bitmap *bitmap)
 	return row_ptrs;
 }
 
-/** PNG content to bitmap conversion.
+/** PNG source data to bitmap conversion.
  *
- * This routine generates a bitmap object from a PNG image content
+ * This routine generates a bitmap object from PNG image source data
+ * and may be called off the main thread.
  */
 static struct bitmap *
-png_cache_convert(struct content *c)
+png_cache_decode(const uint8_t *data, size_t size)
 {
 	png_structp png_ptr;
 	png_infop info_ptr;
@@ -436,8 +458,8 @@ png_cache_convert(struct content *c)
 	png_uint_32 width, height;
 	volatile png_bytep * volatile row_pointers = NULL;
 
-	png_cache_read_data.data = 
-		content__get_source_data(c, &png_cache_read_data.size);
+	png_cache_read_data.data = data;
+	png_cache_read_data.size = size;
 
 	if ((png_cache_read_data.data == NULL) || 
 	    (png_cache_read_data.size <= 8)) {
@@ -445,7 +467,7 @@ png_cache_convert(struct content *c)
 	}
 
 	png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL,
-			nspng_error, nspng_warning);
+			png_cache_error, png_cache_warning);
 	if (png_ptr == NULL) {
 		return NULL;
 	}
@@ -512,6 +534,21 @@ png_cache_convert_error:
 	return (struct bitmap *)bitmap;
 }
 
+/** PNG content to bitmap conversion.
+ *
+ * This routine generates a bitmap object from a PNG image content
+ */
+static struct bitmap *
+png_cache_convert(struct content *c)
+{
+	const uint8_t *data;
+	size_t size;
+
+	data = content__get_source_data(c, &size);
+
+	return png_cache_decode(data, size);
+}
+
 static bool nspng_convert(struct content *c)
 {
 	nspng_content *png_c = (nspng_content *) c;
@@ -537,7 +574,7 @@ static bool nspng_convert(struct content *c)
 		guit->bitmap->modified(png_c->bitmap);
 	}
 
-	image_cache_add(c, png_c->bitmap, png_cache_convert);
+	image_cache_add(c, png_c->bitmap, png_cache_convert, png_cache_decode);
 
 	content_set_ready(c);
 	content_set_done(c);
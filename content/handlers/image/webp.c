@@ -82,13 +82,13 @@ webp_create(const content_handler *handler,
 }
 
 /**
- * create a bitmap from webp content.
+ * create a bitmap from webp source data.
+ *
+ * This may be called off the main thread.
  */
 static struct bitmap *
-webp_cache_convert(struct content *c)
+webp_cache_decode(const uint8_t *source_data, size_t source_size)
 {
-	const uint8_t *source_data; /* webp source data */
-	size_t source_size; /* length of webp source data */
 	VP8StatusCode webpres;
 	WebPBitstreamFeatures webpfeatures;
 	unsigned int bmap_flags;
@@ -97,8 +97,6 @@ webp_cache_convert(struct content *c)
 	size_t rowstride;
 	struct bitmap *bitmap = NULL;
 
-	source_data = content__get_source_data(c, &source_size);
-
 	webpres = WebPGetFeatures(source_data, source_size, &webpfeatures);
 
 	if (webpres != VP8_STATUS_OK) {
@@ -145,6 +143,20 @@ webp_cache_convert(struct content *c)
 	return bitmap;
 }
 
+/**
+ * create a bitmap from webp content.
+ */
+static struct bitmap *
+webp_cache_convert(struct content *c)
+{
+	const uint8_t *source_data; /* webp source data */
+	size_t source_size; /* length of webp source data */
+
+	source_data = content__get_source_data(c, &source_size);
+
+	return webp_cache_decode(source_data, source_size);
+}
+
 /**
  * Convert the webp source data content.
  *
@@ -175,7 +187,7 @@ static bool webp_convert(struct content *c)
 	c->height = height;
 	c->size = c->width * c->height * 4;
 
-	image_cache_add(c, NULL, webp_cache_convert);
+	image_cache_add(c, NULL, webp_cache_convert, webp_cache_decode);
 
 	content_set_ready(c);
 	content_set_done(c);
@@ -0,0 +1,505 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Compiled javascript bytecode cache implementation.
+ *
+ * Bytecode is held in memory in a small number of entries, one for each
+ * script URL, with the least recently used entries evicted to keep the
+ * total size bounded.
+ *
+ * In the backing store the bytecode for a script is kept under the
+ * script URL with a fragment added, which the low level cache never
+ * uses as it removes fragments. The bytecode is preceded by a header
+ * identifying the duktape version and script source it was compiled
+ * for. Loading invalid bytecode is unsafe so the header also holds a
+ * hash of the bytecode, checked before it is used.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libwapcaplet/libwapcaplet.h>
+
+#include "utils/errors.h"
+#include "utils/log.h"
+#include "utils/nsurl.h"
+#include "netsurf/inttypes.h"
+#include "content/backing_store.h"
+#include "desktop/gui_internal.h"
+
+#include "javascript/duktape/duktape.h"
+#include "javascript/duktape/bytecode.h"
+
+/** Smallest script source worth caching the bytecode of */
+#define BYTECODE_MIN_SOURCE 1024
+
+/** Number of scripts whose bytecode is held in memory */
+#define BYTECODE_CACHE_ENTRIES 32
+
+/** Greatest total size of the bytecode held in memory */
+#define BYTECODE_CACHE_SIZE (4 * 1024 * 1024)
+
+/** Fragment added to a script URL to make its backing store key */
+#define BYTECODE_FRAGMENT "netsurf-bytecode"
+
+/** Magic number identifying stored bytecode ("NSBC") */
+#define BYTECODE_MAGIC 0x4e534243
+
+/**
+ * Header preceding bytecode in the backing store
+ */
+struct bytecode_header {
+	uint32_t magic; /**< BYTECODE_MAGIC */
+	uint32_t version; /**< duktape version bytecode was dumped by */
+	uint64_t hash; /**< hash of the script source */
+	uint64_t length; /**< length of the script source */
+	uint64_t len; /**< length of the bytecode */
+	uint64_t check; /**< hash of the bytecode */
+};
+
+/**
+ * Bytecode held in memory
+ */
+struct bytecode_entry {
+	struct nsurl *url; /**< URL of the script or NULL if entry unused */
+	uint64_t hash; /**< hash of the script source */
+	size_t length; /**< length of the script source */
+	uint8_t *data; /**< bytecode */
+	size_t len; /**< length of bytecode */
+	unsigned int used; /**< cache clock when entry was last used */
+};
+
+/**
+ * Bytecode cache
+ */
+static struct {
+	struct bytecode_entry entry[BYTECODE_CACHE_ENTRIES];
+	size_t size; /**< total length of bytecode held */
+	unsigned int clock; /**< cache clock */
+
+	unsigned int memory_hits; /**< bytecode found in memory */
+	unsigned int store_hits; /**< bytecode found in the backing store */
+	unsigned int misses; /**< bytecode not found */
+	unsigned int rejected; /**< stored bytecode which was invalid */
+	unsigned int stored; /**< bytecode written to the backing store */
+} bytecode_cache;
+
+
+/**
+ * Compute the FNV-1a hash of some data
+ *
+ * \param data  The data to hash
+ * \param len   Length of data
+ * \return hash of data
+ */
+static uint64_t bytecode_hash(const uint8_t *data, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t idx;
+
+	for (idx = 0; idx < len; idx++) {
+		hash ^= data[idx];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+
+/**
+ * Get the backing store key for the bytecode of a script
+ *
+ * \param url        URL of the script
+ * \param store_url  Updated to the key on success
+ * \return NSERROR_OK on success, otherwise error code
+ */
+static nserror bytecode_store_url(struct nsurl *url, struct nsurl **store_url)
+{
+	lwc_string *frag;
+	nserror res;
+
+	if (lwc_intern_string(BYTECODE_FRAGMENT,
+			sizeof(BYTECODE_FRAGMENT) - 1, &frag) != lwc_error_ok) {
+		return NSERROR_NOMEM;
+	}
+
+	res = nsurl_refragment(url, frag, store_url);
+	lwc_string_unref(frag);
+
+	return res;
+}
+
+
+/**
+ * Find the memory cache entry for a script
+ *
+ * \param url  URL of the script
+ * \return entry or NULL if there is none
+ */
+static struct bytecode_entry *bytecode_entry_find(struct nsurl *url)
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < BYTECODE_CACHE_ENTRIES; idx++) {
+		struct bytecode_entry *entry = &bytecode_cache.entry[idx];
+
+		if ((entry->url != NULL) &&
+		    nsurl_compare(entry->url, url, NSURL_COMPLETE)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Release a memory cache entry's bytecode
+ *
+ * \param entry  The entry to release
+ */
+static void bytecode_entry_release(struct bytecode_entry *entry)
+{
+	if (entry->url == NULL) {
+		return;
+	}
+
+	bytecode_cache.size -= entry->len;
+	nsurl_unref(entry->url);
+	free(entry->data);
+	entry->url = NULL;
+	entry->data = NULL;
+	entry->len = 0;
+}
+
+
+/**
+ * Place bytecode in the memory cache
+ *
+ * \param key   Key of the script
+ * \param data  Bytecode, ownership of which passes to the cache
+ * \param len   Length of bytecode
+ * \return The entry holding the bytecode or NULL if it is too large
+ */
+static struct bytecode_entry *
+bytecode_entry_insert(const struct dukky_bytecode_key *key,
+		uint8_t *data, size_t len)
+{
+	struct bytecode_entry *entry;
+	unsigned int idx;
+
+	entry = bytecode_entry_find(key->url);
+	if (entry != NULL) {
+		bytecode_entry_release(entry);
+	}
+
+	if (len > BYTECODE_CACHE_SIZE) {
+		free(data);
+		return NULL;
+	}
+
+	/* evict least recently used entries until there is space */
+	while ((entry == NULL) ||
+	       (bytecode_cache.size + len > BYTECODE_CACHE_SIZE)) {
+		struct bytecode_entry *lru = NULL;
+
+		for (idx = 0; idx < BYTECODE_CACHE_ENTRIES; idx++) {
+			struct bytecode_entry *e = &bytecode_cache.entry[idx];
+
+			if (e == entry) {
+				continue;
+			}
+			if (e->url == NULL) {
+				if (entry == NULL) {
+					lru = e;
+					break;
+				}
+				continue;
+			}
+			if ((lru == NULL) || (e->used < lru->used)) {
+				lru = e;
+			}
+		}
+
+		if (lru == NULL) {
+			break;
+		}
+		bytecode_entry_release(lru);
+		if (entry == NULL) {
+			entry = lru;
+		}
+	}
+
+	entry->url = nsurl_ref(key->url);
+	entry->hash = key->hash;
+	entry->length = key->length;
+	entry->data = data;
+	entry->len = len;
+	entry->used = ++bytecode_cache.clock;
+	bytecode_cache.size += len;
+
+	return entry;
+}
+
+
+/**
+ * Retrieve bytecode from the backing store into the memory cache
+ *
+ * \param key  Key of the script
+ * \return The entry holding the bytecode or NULL if it was not found
+ */
+static struct bytecode_entry *
+bytecode_fetch(const struct dukky_bytecode_key *key)
+{
+	struct bytecode_header header;
+	struct bytecode_entry *entry = NULL;
+	struct nsurl *store_url;
+	uint8_t *stored;
+	size_t stored_len;
+	uint8_t *data;
+
+	if (bytecode_store_url(key->url, &store_url) != NSERROR_OK) {
+		return NULL;
+	}
+
+	if (guit->llcache->fetch(store_url, BACKING_STORE_NONE,
+			&stored, &stored_len) != NSERROR_OK) {
+		nsurl_unref(store_url);
+		return NULL;
+	}
+
+	if (stored_len < sizeof(header)) {
+		goto invalid;
+	}
+	memcpy(&header, stored, sizeof(header));
+
+	if ((header.magic != BYTECODE_MAGIC) ||
+	    (header.version != DUK_VERSION) ||
+	    (header.len != stored_len - sizeof(header)) ||
+	    (header.check != bytecode_hash(stored + sizeof(header),
+					   stored_len - sizeof(header)))) {
+		goto invalid;
+	}
+
+	if ((header.hash != key->hash) || (header.length != key->length)) {
+		/* bytecode of a previous version of the script */
+		guit->llcache->release(store_url, BACKING_STORE_NONE);
+		nsurl_unref(store_url);
+		return NULL;
+	}
+
+	data = malloc(header.len);
+	if (data != NULL) {
+		memcpy(data, stored + sizeof(header), header.len);
+		entry = bytecode_entry_insert(key, data, header.len);
+	}
+
+	guit->llcache->release(store_url, BACKING_STORE_NONE);
+	nsurl_unref(store_url);
+
+	return entry;
+
+invalid:
+	NSLOG(dukky, INFO, "Invalid stored bytecode for %s",
+	      nsurl_access(key->url));
+	bytecode_cache.rejected++;
+	guit->llcache->release(store_url, BACKING_STORE_NONE);
+	guit->llcache->invalidate(store_url);
+	nsurl_unref(store_url);
+
+	return NULL;
+}
+
+
+/**
+ * Write bytecode to the backing store
+ *
+ * \param key       Key of the script
+ * \param bytecode  Dumped bytecode of the compiled script
+ * \param len       Length of the bytecode
+ * \return NSERROR_OK on success, otherwise error code
+ */
+static nserror
+bytecode_write(const struct dukky_bytecode_key *key,
+	       const uint8_t *bytecode, size_t len)
+{
+	struct bytecode_header header;
+	struct nsurl *store_url;
+	uint8_t *data;
+	nserror res;
+
+	if (guit->llcache == null_llcache_table) {
+		/* backing store is disabled */
+		return NSERROR_OK;
+	}
+
+	res = bytecode_store_url(key->url, &store_url);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	data = malloc(sizeof(header) + len);
+	if (data == NULL) {
+		nsurl_unref(store_url);
+		return NSERROR_NOMEM;
+	}
+
+	header.magic = BYTECODE_MAGIC;
+	header.version = DUK_VERSION;
+	header.hash = key->hash;
+	header.length = key->length;
+	header.len = len;
+	header.check = bytecode_hash(bytecode, len);
+	memcpy(data, &header, sizeof(header));
+	memcpy(data + sizeof(header), bytecode, len);
+
+	if (guit->llcache->store_async != NULL) {
+		res = guit->llcache->store_async(store_url, BACKING_STORE_NONE,
+				data, sizeof(header) + len, NULL, NULL);
+	} else {
+		res = guit->llcache->store(store_url, BACKING_STORE_NONE,
+				data, sizeof(header) + len);
+	}
+
+	/* the store has only taken the data if it was written or the
+	 * write itself failed.
+	 */
+	if ((res == NSERROR_OK) || (res == NSERROR_SAVE_FAILED)) {
+		guit->llcache->release(store_url, BACKING_STORE_NONE);
+	} else {
+		free(data);
+	}
+	nsurl_unref(store_url);
+
+	if (res == NSERROR_OK) {
+		bytecode_cache.stored++;
+	}
+
+	return res;
+}
+
+
+/* exported interface documented in javascript/duktape/bytecode.h */
+nserror dukky_bytecode_key_init(const char *name, const uint8_t *src,
+		size_t srclen, struct dukky_bytecode_key *key)
+{
+	if ((name == NULL) || (srclen < BYTECODE_MIN_SOURCE)) {
+		return NSERROR_NOT_FOUND;
+	}
+
+	/* scripts without a URL, such as inline scripts, are not cached */
+	if (nsurl_create(name, &key->url) != NSERROR_OK) {
+		return NSERROR_NOT_FOUND;
+	}
+
+	key->hash = bytecode_hash(src, srclen);
+	key->length = srclen;
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in javascript/duktape/bytecode.h */
+void dukky_bytecode_key_fini(struct dukky_bytecode_key *key)
+{
+	nsurl_unref(key->url);
+	key->url = NULL;
+}
+
+
+/* exported interface documented in javascript/duktape/bytecode.h */
+nserror dukky_bytecode_find(const struct dukky_bytecode_key *key,
+		const uint8_t **bytecode_out, size_t *len_out)
+{
+	struct bytecode_entry *entry;
+
+	entry = bytecode_entry_find(key->url);
+	if ((entry != NULL) &&
+	    (entry->hash == key->hash) &&
+	    (entry->length == key->length)) {
+		bytecode_cache.memory_hits++;
+	} else {
+		entry = bytecode_fetch(key);
+		if (entry == NULL) {
+			bytecode_cache.misses++;
+			return NSERROR_NOT_FOUND;
+		}
+		bytecode_cache.store_hits++;
+	}
+
+	entry->used = ++bytecode_cache.clock;
+	*bytecode_out = entry->data;
+	*len_out = entry->len;
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in javascript/duktape/bytecode.h */
+nserror dukky_bytecode_store(const struct dukky_bytecode_key *key,
+		const uint8_t *bytecode, size_t len)
+{
+	uint8_t *data;
+
+	data = malloc(len);
+	if (data == NULL) {
+		return NSERROR_NOMEM;
+	}
+	memcpy(data, bytecode, len);
+	bytecode_entry_insert(key, data, len);
+
+	return bytecode_write(key, bytecode, len);
+}
+
+
+/* exported interface documented in javascript/duktape/bytecode.h */
+void dukky_bytecode_invalidate(const struct dukky_bytecode_key *key)
+{
+	struct bytecode_entry *entry;
+	struct nsurl *store_url;
+
+	entry = bytecode_entry_find(key->url);
+	if (entry != NULL) {
+		bytecode_entry_release(entry);
+	}
+
+	if (bytecode_store_url(key->url, &store_url) == NSERROR_OK) {
+		guit->llcache->invalidate(store_url);
+		nsurl_unref(store_url);
+	}
+}
+
+
+/* exported interface documented in javascript/duktape/bytecode.h */
+void dukky_bytecode_finalise(void)
+{
+	unsigned int idx;
+
+	NSLOG(dukky, INFO,
+	      "Bytecode cache: %u memory hits, %u store hits, %u misses, "
+	      "%u rejected, %u stored, %"PRIsizet" bytes held",
+	      bytecode_cache.memory_hits, bytecode_cache.store_hits,
+	      bytecode_cache.misses, bytecode_cache.rejected,
+	      bytecode_cache.stored, bytecode_cache.size);
+
+	for (idx = 0; idx < BYTECODE_CACHE_ENTRIES; idx++) {
+		bytecode_entry_release(&bytecode_cache.entry[idx]);
+	}
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Interface to compiled javascript bytecode cache.
+ *
+ * Scripts fetched from a URL are compiled to duktape bytecode once and
+ * the dumped bytecode kept, keyed on the script URL and a hash of its
+ * source. Bytecode is held in memory and written to the low level cache
+ * backing store so it persists between runs.
+ */
+
+#ifndef NETSURF_JAVASCRIPT_DUKTAPE_BYTECODE_H_
+#define NETSURF_JAVASCRIPT_DUKTAPE_BYTECODE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "utils/errors.h"
+
+struct nsurl;
+
+/**
+ * Bytecode cache key
+ */
+struct dukky_bytecode_key {
+	struct nsurl *url; /**< URL the script was fetched from */
+	uint64_t hash; /**< hash of the script source */
+	size_t length; /**< length of the script source */
+};
+
+/**
+ * Create the bytecode cache key for a script
+ *
+ * Only scripts with a URL of sufficient size are cached, scripts which
+ * are not return NSERROR_NOT_FOUND.
+ *
+ * \param name    Name of the script, which is its URL if it has one
+ * \param src     Script source
+ * \param srclen  Length of the script source
+ * \param key     Key to initialise
+ * \return NSERROR_OK and key initialised on success, otherwise error code
+ */
+nserror dukky_bytecode_key_init(const char *name, const uint8_t *src,
+		size_t srclen, struct dukky_bytecode_key *key);
+
+/**
+ * Finalise a bytecode cache key
+ *
+ * \param key  Key initialised by dukky_bytecode_key_init
+ */
+void dukky_bytecode_key_fini(struct dukky_bytecode_key *key);
+
+/**
+ * Find cached bytecode for a script
+ *
+ * The bytecode is only valid until the next call to the bytecode cache.
+ *
+ * \param key           Key of the script
+ * \param bytecode_out  Updated to the bytecode on success
+ * \param len_out       Updated to the length of the bytecode on success
+ * \return NSERROR_OK on success, NSERROR_NOT_FOUND if not cached
+ */
+nserror dukky_bytecode_find(const struct dukky_bytecode_key *key,
+		const uint8_t **bytecode_out, size_t *len_out);
+
+/**
+ * Store the bytecode compiled from a script
+ *
+ * \param key       Key of the script
+ * \param bytecode  Dumped bytecode of the compiled script
+ * \param len       Length of the bytecode
+ * \return NSERROR_OK on success, otherwise error code
+ */
+nserror dukky_bytecode_store(const struct dukky_bytecode_key *key,
+		const uint8_t *bytecode, size_t len);
+
+/**
+ * Forget bytecode which failed to load
+ *
+ * \param key  Key of the script
+ */
+void dukky_bytecode_invalidate(const struct dukky_bytecode_key *key);
+
+/**
+ * Release all bytecode held in memory
+ */
+void dukky_bytecode_finalise(void);
+
+#endif
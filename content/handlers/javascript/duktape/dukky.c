@@ -25,6 +25,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include <nsutils/time.h>
 
 #include "netsurf/inttypes.h"
@@ -32,6 +33,7 @@
 #include "utils/nsoption.h"
 #include "utils/log.h"
 #include "utils/corestrings.h"
+#include "utils/nsurl.h"
 #include "content/content.h"
 
 #include "javascript/js.h"
@@ -43,6 +45,7 @@
 
 #include "duktape.h"
 #include "dukky.h"
+#include "bytecode.h"
 
 #include <dom/dom.h>
 
@@ -52,13 +55,34 @@
 #define EVENT_LISTENER_JS_MAGIC MAGIC(EVENT_LISTENER_JS_MAP)
 #define GENERICS_MAGIC MAGIC(GENERICS_TABLE)
 
+/**
+ * dukky javascript heap
+ *
+ * A heap holds the prototypes of every binding, which are costly to
+ * create, so it is only created when a script first needs to run.
+ */
+struct dukky_heap {
+	duk_context *ctx; /**< duktape base context */
+	uint64_t exec_start_time; /**< start of current execution or 0 */
+};
+
 /**
  * dukky javascript context
  */
 struct jscontext {
-	duk_context *ctx; /**< duktape base context */
+	struct dukky_heap *heap; /**< heap, created with first compartment */
 	duk_context *thread; /**< duktape compartment */
-	uint64_t exec_start_time;
+	bool pending; /**< compartment requested but not yet created */
+	void *win_priv; /**< window of the pending compartment */
+	void *doc_priv; /**< document of the pending compartment */
+};
+
+/**
+ * compiled bytecode of a script built in to NetSurf
+ */
+struct dukky_builtin {
+	void *bytecode; /**< dumped bytecode or NULL if not yet compiled */
+	duk_size_t len; /**< length of bytecode */
 };
 
 static duk_ret_t dukky_populate_object(duk_context *ctx, void *udata)
@@ -559,6 +583,177 @@ static void dukky_free_function(void *udata, void *ptr)
 
 #define CTX (ctx->thread)
 
+/** bytecode of polyfill.js */
+static struct dukky_builtin dukky_polyfill_bytecode;
+
+/** bytecode of generics.js */
+static struct dukky_builtin dukky_generics_bytecode;
+
+/**
+ * context creation and script compilation statistics
+ */
+static struct {
+	unsigned int heaps; /**< heaps created */
+	uint64_t heap_ms; /**< time spent creating heaps */
+	unsigned int compartments; /**< compartments created */
+	uint64_t compartment_ms; /**< time spent creating compartments */
+	unsigned int compiled; /**< scripts compiled from source */
+	uint64_t compile_ms; /**< time spent compiling scripts */
+	unsigned int loaded; /**< scripts loaded from cached bytecode */
+	uint64_t load_ms; /**< time spent loading bytecode */
+} dukky_stats;
+
+/**
+ * Load a function from bytecode, for use with duk_safe_call
+ *
+ * \param ctx    duktape context with the bytecode buffer on the stack
+ * \param udata  unused
+ * \return number of return values
+ */
+static duk_ret_t dukky_load_function(duk_context *ctx, void *udata)
+{
+	/* ..., bytecode */
+	duk_load_function(ctx);
+	/* ..., func */
+	return 1;
+}
+
+/**
+ * Dump a function to bytecode, for use with duk_safe_call
+ *
+ * \param ctx    duktape context with the function on the stack
+ * \param udata  unused
+ * \return number of return values
+ */
+static duk_ret_t dukky_dump_function(duk_context *ctx, void *udata)
+{
+	/* ..., func */
+	duk_dump_function(ctx);
+	/* ..., bytecode */
+	return 1;
+}
+
+/**
+ * Create a javascript heap with the prototypes of every binding
+ *
+ * \return new heap or NULL on memory exhaustion
+ */
+static struct dukky_heap *dukky_heap_create(void)
+{
+	struct dukky_heap *heap;
+	duk_context *ctx;
+	uint64_t start_ms, end_ms;
+
+	heap = calloc(1, sizeof(*heap));
+	if (heap == NULL) {
+		return NULL;
+	}
+
+	(void) nsu_getmonotonic_ms(&start_ms);
+	ctx = heap->ctx = duk_create_heap(
+		dukky_alloc_function,
+		dukky_realloc_function,
+		dukky_free_function,
+		heap,
+		NULL);
+	if (heap->ctx == NULL) {
+		free(heap);
+		return NULL;
+	}
+	/* Create the prototype stuffs */
+	duk_push_global_object(ctx);
+	duk_push_boolean(ctx, true);
+	duk_put_prop_string(ctx, -2, "protos");
+	duk_put_global_string(ctx, PROTO_MAGIC);
+	/* Create prototypes here */
+	dukky_create_prototypes(ctx);
+	(void) nsu_getmonotonic_ms(&end_ms);
+
+	dukky_stats.heaps++;
+	dukky_stats.heap_ms += end_ms - start_ms;
+	NSLOG(dukky, DEBUG, "Created heap %p in %"PRIu64"ms",
+	      heap, end_ms - start_ms);
+
+	return heap;
+}
+
+/**
+ * Destroy a javascript heap
+ *
+ * \param heap  The heap to destroy
+ */
+static void dukky_heap_destroy(struct dukky_heap *heap)
+{
+	duk_destroy_heap(heap->ctx);
+	free(heap);
+}
+
+/**
+ * Push the function for a builtin script
+ *
+ * The script is compiled in the first compartment it is run in and the
+ * bytecode kept to be loaded in later compartments.
+ *
+ * \param ctx      duktape compartment
+ * \param builtin  bytecode of the script
+ * \param name     name of the script
+ * \param src      source of the script
+ * \param len      length of the source
+ * \return true if the function was pushed, false with the error pushed
+ */
+static bool
+dukky_push_builtin(duk_context *ctx,
+		   struct dukky_builtin *builtin,
+		   const char *name,
+		   const uint8_t *src,
+		   size_t len)
+{
+	const void *bytecode;
+	void *buf;
+
+	if (builtin->bytecode != NULL) {
+		/* ... */
+		buf = duk_push_fixed_buffer(ctx, builtin->len);
+		memcpy(buf, builtin->bytecode, builtin->len);
+		/* ..., bytecode */
+		if (duk_safe_call(ctx, dukky_load_function, NULL, 1, 1) == 0) {
+			/* ..., func */
+			return true;
+		}
+		/* ..., err */
+		NSLOG(dukky, WARNING, "Unable to load %s bytecode: %s",
+		      name, duk_safe_to_string(ctx, -1));
+		duk_pop(ctx);
+		/* ... */
+		free(builtin->bytecode);
+		builtin->bytecode = NULL;
+	}
+
+	/* ... */
+	duk_push_string(ctx, name);
+	/* ..., name */
+	if (duk_pcompile_lstring_filename(ctx, DUK_COMPILE_EVAL,
+					  (const char *)src, len) != 0) {
+		/* ..., err */
+		return false;
+	}
+	/* ..., func */
+	duk_dup_top(ctx);
+	/* ..., func, func */
+	if (duk_safe_call(ctx, dukky_dump_function, NULL, 1, 1) == 0) {
+		/* ..., func, bytecode */
+		bytecode = duk_get_buffer(ctx, -1, &builtin->len);
+		builtin->bytecode = malloc(builtin->len);
+		if (builtin->bytecode != NULL) {
+			memcpy(builtin->bytecode, bytecode, builtin->len);
+		}
+	}
+	duk_pop(ctx);
+	/* ..., func */
+
+	return true;
+}
+
 /**
  * close current compartment
  *
@@ -577,9 +772,9 @@ static nserror dukky_closecompartment(jscontext *ctx)
 	duk_get_global_string(ctx->thread, MAGIC(closedownCompartment));
 	dukky_pcall(CTX, 0, true);
 	NSLOG(dukky, DEEPDEBUG, "Popping the thread off the stack");
-	duk_set_top(ctx->ctx, 0);
-	duk_gc(ctx->ctx, 0);
-	duk_gc(ctx->ctx, DUK_GC_COMPACT);
+	duk_set_top(ctx->heap->ctx, 0);
+	duk_gc(ctx->heap->ctx, 0);
+	duk_gc(ctx->heap->ctx, DUK_GC_COMPACT);
 
 	ctx->thread = NULL;
 
@@ -602,7 +797,21 @@ void js_initialise(void)
 /* exported interface documented in js.h */
 void js_finalise(void)
 {
-	/* NADA for now */
+	NSLOG(dukky, INFO,
+	      "Created %u heaps in %"PRIu64"ms, %u compartments in %"PRIu64"ms",
+	      dukky_stats.heaps, dukky_stats.heap_ms,
+	      dukky_stats.compartments, dukky_stats.compartment_ms);
+	NSLOG(dukky, INFO,
+	      "Compiled %u scripts in %"PRIu64"ms, loaded %u from bytecode in %"PRIu64"ms",
+	      dukky_stats.compiled, dukky_stats.compile_ms,
+	      dukky_stats.loaded, dukky_stats.load_ms);
+
+	free(dukky_polyfill_bytecode.bytecode);
+	dukky_polyfill_bytecode.bytecode = NULL;
+	free(dukky_generics_bytecode.bytecode);
+	dukky_generics_bytecode.bytecode = NULL;
+
+	dukky_bytecode_finalise();
 }
 
 
@@ -610,25 +819,14 @@ void js_finalise(void)
 nserror
 js_newcontext(int timeout, jscallback *cb, void *cbctx, jscontext **jsctx)
 {
-	duk_context *ctx;
 	jscontext *ret = calloc(1, sizeof(*ret));
 	*jsctx = NULL;
 	NSLOG(dukky, DEBUG, "Creating new duktape javascript context");
 	if (ret == NULL) return NSERROR_NOMEM;
-	ctx = ret->ctx = duk_create_heap(
-		dukky_alloc_function,
-		dukky_realloc_function,
-		dukky_free_function,
-		ret,
-		NULL);
-	if (ret->ctx == NULL) { free(ret); return NSERROR_NOMEM; }
-	/* Create the prototype stuffs */
-	duk_push_global_object(ctx);
-	duk_push_boolean(ctx, true);
-	duk_put_prop_string(ctx, -2, "protos");
-	duk_put_global_string(ctx, PROTO_MAGIC);
-	/* Create prototypes here */
-	dukky_create_prototypes(ctx);
+
+	/* The heap is only created when a script first needs to run,
+	 * as most contexts for frames and windows never run one.
+	 */
 
 	*jsctx = ret;
 	return NSERROR_OK;
@@ -639,33 +837,57 @@ js_newcontext(int timeout, jscallback *cb, void *cbctx, jscontext **jsctx)
 void js_destroycontext(jscontext *ctx)
 {
 	NSLOG(dukky, DEBUG, "Destroying duktape javascript context");
-	dukky_closecompartment(ctx);
-	duk_destroy_heap(ctx->ctx);
+	if (ctx->heap != NULL) {
+		dukky_closecompartment(ctx);
+		dukky_heap_destroy(ctx->heap);
+	}
 	free(ctx);
 }
 
 
-/* exported interface documented in js.h */
-jsobject *js_newcompartment(jscontext *ctx, void *win_priv, void *doc_priv)
+/**
+ * Create the pending compartment of a context
+ *
+ * The heap and compartment are created when first needed rather than
+ * when the compartment is requested, so documents which never run a
+ * script do not pay for building the binding prototypes.
+ *
+ * \param ctx javascript context
+ * \return true if the context has a compartment else false
+ */
+static bool dukky_create_compartment(jscontext *ctx)
 {
-	assert(ctx != NULL);
+	uint64_t start_ms, end_ms;
+
+	if (!ctx->pending) {
+		return ctx->thread != NULL;
+	}
+	ctx->pending = false;
+
 	NSLOG(dukky, DEBUG,
-	      "New javascript/duktape compartment, win_priv=%p, doc_priv=%p",
-	      win_priv, doc_priv);
+	      "Creating compartment, win_priv=%p, doc_priv=%p",
+	      ctx->win_priv, ctx->doc_priv);
 
-	/* Pop any active thread off */
-	dukky_closecompartment(ctx);
+	if (ctx->heap == NULL) {
+		ctx->heap = dukky_heap_create();
+		if (ctx->heap == NULL) {
+			NSLOG(dukky, CRITICAL, "Unable to create heap, compartment aborted");
+			return false;
+		}
+	}
+
+	(void) nsu_getmonotonic_ms(&start_ms);
 
 	/* create new compartment thread */
-	duk_push_thread(ctx->ctx);
-	ctx->thread = duk_require_context(ctx->ctx, -1);
+	duk_push_thread(ctx->heap->ctx);
+	ctx->thread = duk_require_context(ctx->heap->ctx, -1);
 	duk_push_int(CTX, 0);
 	duk_push_int(CTX, 1);
 	duk_push_int(CTX, 2);
 	/* Manufacture a Window object */
 	/* win_priv is a browser_window, doc_priv is an html content struct */
-	duk_push_pointer(CTX, win_priv);
-	duk_push_pointer(CTX, doc_priv);
+	duk_push_pointer(CTX, ctx->win_priv);
+	duk_push_pointer(CTX, ctx->doc_priv);
 	dukky_create_object(CTX, PROTO_NAME(WINDOW), 2);
 	duk_push_global_object(CTX);
 	duk_put_prop_string(CTX, -2, PROTO_MAGIC);
@@ -684,18 +906,18 @@ jsobject *js_newcompartment(jscontext *ctx, void *win_priv, void *doc_priv)
 
 	/* Now load the polyfills */
 	/* ... */
-	duk_push_string(CTX, "polyfill.js");
-	/* ..., polyfill.js */
-	if (duk_pcompile_lstring_filename(CTX, DUK_COMPILE_EVAL,
-					  (const char *)polyfill_js, polyfill_js_len) != 0) {
+	if (!dukky_push_builtin(CTX, &dukky_polyfill_bytecode, "polyfill.js",
+				polyfill_js, polyfill_js_len)) {
 		NSLOG(dukky, CRITICAL, "%s", duk_safe_to_string(CTX, -1));
 		NSLOG(dukky, CRITICAL, "Unable to compile polyfill.js, compartment aborted");
-		return NULL;
+		dukky_closecompartment(ctx);
+		return false;
 	}
 	/* ..., (generics.js) */
 	if (dukky_pcall(CTX, 0, true) != 0) {
 		NSLOG(dukky, CRITICAL, "Unable to run polyfill.js, compartment aborted");
-		return NULL;
+		dukky_closecompartment(ctx);
+		return false;
 	}
 	/* ..., result */
 	duk_pop(CTX);
@@ -703,18 +925,18 @@ jsobject *js_newcompartment(jscontext *ctx, void *win_priv, void *doc_priv)
 
 	/* Now load the NetSurf table in */
 	/* ... */
-	duk_push_string(CTX, "generics.js");
-	/* ..., generics.js */
-	if (duk_pcompile_lstring_filename(CTX, DUK_COMPILE_EVAL,
-					  (const char *)generics_js, generics_js_len) != 0) {
+	if (!dukky_push_builtin(CTX, &dukky_generics_bytecode, "generics.js",
+				generics_js, generics_js_len)) {
 		NSLOG(dukky, CRITICAL, "%s", duk_safe_to_string(CTX, -1));
 		NSLOG(dukky, CRITICAL, "Unable to compile generics.js, compartment aborted");
-		return NULL;
+		dukky_closecompartment(ctx);
+		return false;
 	}
 	/* ..., (generics.js) */
 	if (dukky_pcall(CTX, 0, true) != 0) {
 		NSLOG(dukky, CRITICAL, "Unable to run generics.js, compartment aborted");
-		return NULL;
+		dukky_closecompartment(ctx);
+		return false;
 	}
 	/* ..., result */
 	duk_pop(CTX);
@@ -729,15 +951,42 @@ jsobject *js_newcompartment(jscontext *ctx, void *win_priv, void *doc_priv)
 	duk_pop(CTX);
 	/* ... */
 
+	(void) nsu_getmonotonic_ms(&end_ms);
+	dukky_stats.compartments++;
+	dukky_stats.compartment_ms += end_ms - start_ms;
+	NSLOG(dukky, DEBUG, "Created compartment in %"PRIu64"ms",
+	      end_ms - start_ms);
+
 	dukky_log_stack_frame(CTX, "New compartment created");
 
+	return true;
+}
+
+
+/* exported interface documented in js.h */
+jsobject *js_newcompartment(jscontext *ctx, void *win_priv, void *doc_priv)
+{
+	assert(ctx != NULL);
+	NSLOG(dukky, DEBUG,
+	      "New javascript/duktape compartment, win_priv=%p, doc_priv=%p",
+	      win_priv, doc_priv);
+
+	/* Pop any active thread off */
+	if (ctx->heap != NULL) {
+		dukky_closecompartment(ctx);
+	}
+
+	ctx->pending = true;
+	ctx->win_priv = win_priv;
+	ctx->doc_priv = doc_priv;
+
 	return (jsobject *)ctx;
 }
 
 duk_bool_t dukky_check_timeout(void *udata)
 {
 #define JS_EXEC_TIMEOUT_MS 10000 /* 10 seconds */
-	jscontext *ctx = (jscontext *) udata;
+	struct dukky_heap *heap = (struct dukky_heap *) udata;
 	uint64_t now;
 
 	(void) nsu_getmonotonic_ms(&now);
@@ -746,8 +995,8 @@ duk_bool_t dukky_check_timeout(void *udata)
 	 * so only test for execution timeout if we've recorded a
 	 * start time.
 	 */
-	return ctx->exec_start_time != 0 &&
-			now > (ctx->exec_start_time + JS_EXEC_TIMEOUT_MS);
+	return heap->exec_start_time != 0 &&
+			now > (heap->exec_start_time + JS_EXEC_TIMEOUT_MS);
 }
 
 static void dukky_dump_error(duk_context *ctx)
@@ -765,10 +1014,10 @@ duk_int_t dukky_pcall(duk_context *ctx, duk_size_t argc, bool reset_timeout)
 {
 	if (reset_timeout) {
 		duk_memory_functions funcs;
-		jscontext *jsctx;
+		struct dukky_heap *heap;
 		duk_get_memory_functions(ctx, &funcs);
-		jsctx = funcs.udata;
-		(void) nsu_getmonotonic_ms(&jsctx->exec_start_time);
+		heap = funcs.udata;
+		(void) nsu_getmonotonic_ms(&heap->exec_start_time);
 	}
 
 	duk_int_t ret = duk_pcall(ctx, argc);
@@ -809,32 +1058,139 @@ void dukky_log_stack_frame(duk_context *ctx, const char * reason)
 }
 
 
+/**
+ * Push the function for a script from cached bytecode
+ *
+ * \param ctx  javascript context
+ * \param key  bytecode cache key of the script
+ * \return true if the function was pushed, false if it was not cached
+ */
+static bool
+dukky_push_cached_script(jscontext *ctx, struct dukky_bytecode_key *key)
+{
+	const uint8_t *bytecode;
+	size_t len;
+	void *buf;
+	uint64_t start_ms, end_ms;
+
+	if (dukky_bytecode_find(key, &bytecode, &len) != NSERROR_OK) {
+		return false;
+	}
+
+	(void) nsu_getmonotonic_ms(&start_ms);
+	/* ... */
+	buf = duk_push_fixed_buffer(CTX, len);
+	memcpy(buf, bytecode, len);
+	/* ..., bytecode */
+	if (duk_safe_call(CTX, dukky_load_function, NULL, 1, 1) != 0) {
+		/* ..., err */
+		NSLOG(dukky, INFO, "Unable to load bytecode for %s: %s",
+		      nsurl_access(key->url), duk_safe_to_string(CTX, -1));
+		duk_pop(CTX);
+		/* ... */
+		dukky_bytecode_invalidate(key);
+		return false;
+	}
+	/* ..., func */
+	(void) nsu_getmonotonic_ms(&end_ms);
+
+	dukky_stats.loaded++;
+	dukky_stats.load_ms += end_ms - start_ms;
+	NSLOG(dukky, DEBUG, "Loaded %"PRIsizet" bytes of bytecode for %s in %"PRIu64"ms",
+	      len, nsurl_access(key->url), end_ms - start_ms);
+
+	return true;
+}
+
+/**
+ * Cache the bytecode of a compiled script
+ *
+ * \param ctx  javascript context with the compiled function on the stack
+ * \param key  bytecode cache key of the script
+ */
+static void
+dukky_cache_script(jscontext *ctx, struct dukky_bytecode_key *key)
+{
+	const uint8_t *bytecode;
+	duk_size_t len;
+
+	/* ..., func */
+	duk_dup_top(CTX);
+	/* ..., func, func */
+	if (duk_safe_call(CTX, dukky_dump_function, NULL, 1, 1) != 0) {
+		/* ..., func, err */
+		NSLOG(dukky, INFO, "Unable to dump bytecode for %s: %s",
+		      nsurl_access(key->url), duk_safe_to_string(CTX, -1));
+		duk_pop(CTX);
+		/* ..., func */
+		return;
+	}
+	/* ..., func, bytecode */
+	bytecode = duk_get_buffer(CTX, -1, &len);
+	if (bytecode != NULL) {
+		dukky_bytecode_store(key, bytecode, len);
+	}
+	duk_pop(CTX);
+	/* ..., func */
+}
+
 /* exported interface documented in js.h */
 bool
 js_exec(jscontext *ctx, const uint8_t *txt, size_t txtlen, const char *name)
 {
+	struct dukky_bytecode_key key;
+	bool cacheable;
+	uint64_t start_ms, end_ms;
+
 	assert(ctx);
 
 	if (txt == NULL || txtlen == 0) {
 		return false;
 	}
 
+	if (!dukky_create_compartment(ctx)) {
+		return false;
+	}
+
 	duk_set_top(CTX, 0);
 	NSLOG(dukky, DEEPDEBUG, "Running %"PRIsizet" bytes from %s", txtlen, name);
 	/* NSLOG(dukky, DEEPDEBUG, "\n%s\n", txt); */
 
-	(void) nsu_getmonotonic_ms(&ctx->exec_start_time);
-	if (name != NULL) {
-		duk_push_string(CTX, name);
-	} else {
-		duk_push_string(CTX, "?unknown source?");
+	cacheable = (dukky_bytecode_key_init(name, txt, txtlen,
+					     &key) == NSERROR_OK);
+
+	(void) nsu_getmonotonic_ms(&ctx->heap->exec_start_time);
+	if (cacheable == false || dukky_push_cached_script(ctx, &key) == false) {
+		if (name != NULL) {
+			duk_push_string(CTX, name);
+		} else {
+			duk_push_string(CTX, "?unknown source?");
+		}
+		(void) nsu_getmonotonic_ms(&start_ms);
+		if (duk_pcompile_lstring_filename(CTX,
+						  DUK_COMPILE_EVAL,
+						  (const char *)txt,
+						  txtlen) != 0) {
+			NSLOG(dukky, DEBUG, "Failed to compile JavaScript input");
+			if (cacheable) {
+				dukky_bytecode_key_fini(&key);
+			}
+			goto handle_error;
+		}
+		(void) nsu_getmonotonic_ms(&end_ms);
+
+		dukky_stats.compiled++;
+		dukky_stats.compile_ms += end_ms - start_ms;
+		NSLOG(dukky, DEBUG, "Compiled %"PRIsizet" bytes from %s in %"PRIu64"ms",
+		      txtlen, name, end_ms - start_ms);
+
+		if (cacheable) {
+			dukky_cache_script(ctx, &key);
+		}
 	}
-	if (duk_pcompile_lstring_filename(CTX,
-					  DUK_COMPILE_EVAL,
-					  (const char *)txt,
-					  txtlen) != 0) {
-		NSLOG(dukky, DEBUG, "Failed to compile JavaScript input");
-		goto handle_error;
+
+	if (cacheable) {
+		dukky_bytecode_key_fini(&key);
 	}
 
 	if (duk_pcall(CTX, 0/*nargs*/) == DUK_EXEC_ERROR) {
@@ -1025,7 +1381,7 @@ static void dukky_generic_event_handler(dom_event *evt, void *pw)
 {
 	duk_memory_functions funcs;
 	duk_context *ctx = (duk_context *)pw;
-	jscontext *jsctx;
+	struct dukky_heap *heap;
 	dom_string *name;
 	dom_exception exc;
 	dom_event_target *targ;
@@ -1035,7 +1391,7 @@ static void dukky_generic_event_handler(dom_event *evt, void *pw)
 
 	/* Retrieve the JS context from the Duktape context */
 	duk_get_memory_functions(ctx, &funcs);
-	jsctx = funcs.udata;
+	heap = funcs.udata;
 
 	NSLOG(dukky, DEBUG, "Handling an event in duktape interface...");
 	exc = dom_event_get_type(evt, &name);
@@ -1084,7 +1440,7 @@ static void dukky_generic_event_handler(dom_event *evt, void *pw)
 	/* ... handler node */
 	dukky_push_event(ctx, evt);
 	/* ... handler node event */
-	(void) nsu_getmonotonic_ms(&jsctx->exec_start_time);
+	(void) nsu_getmonotonic_ms(&heap->exec_start_time);
 	if (duk_pcall_method(ctx, 1) != 0) {
 		/* Failed to run the method */
 		/* ... err */
@@ -1183,7 +1539,7 @@ handle_extras:
 		/* ... copy handler callback node */
 		dukky_push_event(ctx, evt);
 		/* ... copy handler callback node event */
-		(void) nsu_getmonotonic_ms(&jsctx->exec_start_time);
+		(void) nsu_getmonotonic_ms(&heap->exec_start_time);
 		if (duk_pcall_method(ctx, 1) != 0) {
 			/* Failed to run the method */
 			/* ... copy handler err */
@@ -1410,8 +1766,10 @@ void js_handle_new_element(jscontext *ctx, struct dom_element *node)
 					key, 2, dom_string_length(key),
 					&sub);
 				if (exc == DOM_NO_ERR) {
-					dukky_register_event_listener_for(
-						CTX, node, sub, false);
+					if (dukky_create_compartment(ctx)) {
+						dukky_register_event_listener_for(
+							CTX, node, sub, false);
+					}
 					dom_string_unref(sub);
 				}
 			}
@@ -1434,6 +1792,10 @@ out:
 void js_event_cleanup(jscontext *ctx, struct dom_event *evt)
 {
 	assert(ctx);
+	if (ctx->thread == NULL) {
+		/* no compartment so no event was mapped */
+		return;
+	}
 	/* ... */
 	duk_get_global_string(CTX, EVENT_MAGIC);
 	/* ... EVENT_MAP */
@@ -1474,6 +1836,27 @@ bool js_fire_event(jscontext *ctx, const char *type, struct dom_document *doc, s
 	 * we swallow the event silently
 	 */
 
+	if (ctx->thread == NULL) {
+		/* No script has run to add a handler on Window, so only
+		 * an onload attribute on the body can handle the event.
+		 */
+		bool has_onload = false;
+
+		exc = dom_html_document_get_body(doc, &body);
+		if (exc != DOM_NO_ERR || body == NULL) {
+			return true;
+		}
+		exc = dom_element_has_attribute(body, corestring_dom_onload,
+						&has_onload);
+		dom_node_unref(body);
+		if (exc != DOM_NO_ERR || has_onload == false) {
+			return true;
+		}
+		if (!dukky_create_compartment(ctx)) {
+			return true;
+		}
+	}
+
 	exc = dom_event_create(&evt);
 	if (exc != DOM_NO_ERR) return true;
 	exc = dom_event_init(evt, corestring_dom_load, false, false);
@@ -1523,7 +1906,7 @@ bool js_fire_event(jscontext *ctx, const char *type, struct dom_document *doc, s
 	/* ... handler Window */
 	dukky_push_event(CTX, evt);
 	/* ... handler Window event */
-	(void) nsu_getmonotonic_ms(&ctx->exec_start_time);
+	(void) nsu_getmonotonic_ms(&ctx->heap->exec_start_time);
 	if (duk_pcall_method(CTX, 1) != 0) {
 		/* Failed to run the handler */
 		/* ... err */
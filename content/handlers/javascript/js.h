@@ -68,7 +68,8 @@ void js_destroycontext(jscontext *ctx);
  * Create a new javascript compartment
  *
  * This is called once for a page with javascript script tags on
- * it. It constructs a fresh global window object.
+ * it. It constructs a fresh global window object. An implementation
+ * may defer the construction until a script first needs to run.
  */
 jsobject *js_newcompartment(jscontext *ctx, void *win_priv, void *doc_priv);
 
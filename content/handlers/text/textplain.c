@@ -44,6 +44,7 @@
 #include "netsurf/browser_window.h"
 #include "netsurf/plotters.h"
 #include "netsurf/layout.h"
+#include "netsurf/misc.h"
 #include "content/content_protected.h"
 #include "content/hlcache.h"
 #include "css/utils.h"
@@ -60,6 +61,16 @@ struct textplain_line {
 	size_t	length;
 };
 
+/**
+ * A line of the source text, delimited by line terminators.
+ */
+struct textplain_logical_line {
+	size_t start; /**< offset of line in utf8_data */
+	size_t length; /**< length of line in bytes, excluding terminator */
+	size_t chars; /**< number of characters in line */
+	size_t columns; /**< columns needed to display line unwrapped */
+};
+
 typedef struct textplain_content {
 	struct content base;
 
@@ -68,8 +79,40 @@ typedef struct textplain_content {
 	char *utf8_data;
 	size_t utf8_data_size;
 	size_t utf8_data_allocated;
+
+	/** Logical lines indexed so far, the last may be incomplete */
+	struct textplain_logical_line *logical_line;
+	unsigned long logical_line_count;
+	unsigned long logical_line_allocated;
+	/** Bytes of utf8_data added to the logical line index */
+	size_t indexed_size;
+	/** Terminator ending the last indexed line, if it may be paired */
+	char index_terminator;
+
+	/** Total number of physical (wrapped) lines */
 	unsigned long physical_line_count;
+	/** Physical lines of each logical line, possibly estimated */
+	unsigned long *line_rows;
+	/** Fenwick tree over line_rows giving physical line numbers */
+	unsigned long *row_tree;
+	/** Number of logical lines line_rows was computed for */
+	unsigned long rows_line_count;
+	/** Columns line_rows was computed for, 0 if not formatted */
+	size_t columns;
+
+	/** Wrapped physical lines of logical lines window_line to
+	 * window_end - 1, the first being physical line window_row.
+	 */
 	struct textplain_line *physical_line;
+	unsigned long physical_line_allocated;
+	unsigned long window_rows;
+	unsigned long window_line;
+	unsigned long window_end;
+	unsigned long window_row;
+
+	/** Whether a reformat is scheduled as the height has changed */
+	bool reformat_pending;
+
 	int formatted_width;
 	struct browser_window *bw;
 
@@ -86,6 +129,10 @@ typedef struct textplain_content {
 #define MARGIN 4
 
 #define TAB_WIDTH 8  /* must be power of 2 currently */
+
+/** Physical lines held in the wrapped window before it is restarted */
+#define WINDOW_ROWS 1024
+
 #define TEXT_SIZE 10 * PLOT_STYLE_SCALE  /* Unscaled text size in pt */
 
 static plot_font_style_t textplain_style = {
@@ -172,8 +219,23 @@ textplain_create_internal(textplain_content *c, lwc_string *encoding)
 	c->utf8_data = utf8_data;
 	c->utf8_data_size = 0;
 	c->utf8_data_allocated = CHUNK;
-	c->physical_line = 0;
+	c->logical_line = NULL;
+	c->logical_line_count = 0;
+	c->logical_line_allocated = 0;
+	c->indexed_size = 0;
+	c->index_terminator = 0;
 	c->physical_line_count = 0;
+	c->line_rows = NULL;
+	c->row_tree = NULL;
+	c->rows_line_count = 0;
+	c->columns = 0;
+	c->physical_line = NULL;
+	c->physical_line_allocated = 0;
+	c->window_rows = 0;
+	c->window_line = 0;
+	c->window_end = 0;
+	c->window_row = 0;
+	c->reformat_pending = false;
 	c->formatted_width = 0;
 	c->bw = NULL;
 
@@ -335,6 +397,111 @@ textplain_drain_input(textplain_content *c,
 }
 
 
+/**
+ * Start a new logical line
+ *
+ * \param c textplain content
+ * \param start offset of the line in utf8_data
+ * \return true on success or false on memory exhaustion
+ */
+static bool textplain_add_line(textplain_content *c, size_t start)
+{
+	struct textplain_logical_line *line;
+
+	if (c->logical_line_count == c->logical_line_allocated) {
+		unsigned long allocated = c->logical_line_allocated + 1024;
+
+		line = realloc(c->logical_line, sizeof(*line) * allocated);
+		if (line == NULL)
+			return false;
+
+		c->logical_line = line;
+		c->logical_line_allocated = allocated;
+	}
+
+	line = &c->logical_line[c->logical_line_count++];
+	line->start = start;
+	line->length = 0;
+	line->chars = 0;
+	line->columns = 0;
+
+	return true;
+}
+
+
+/**
+ * Add newly converted data to the logical line index
+ *
+ * Lines are delimited by CR, LF, CR/LF or LF/CR. The number of
+ * characters in each line and the columns it needs are recorded so
+ * reformatting need not examine the data of lines which fit.
+ *
+ * \param c textplain content
+ * \return true on success or false on memory exhaustion
+ */
+static bool textplain_index_lines(textplain_content *c)
+{
+	const char *utf8_data = c->utf8_data;
+	size_t utf8_data_size = c->utf8_data_size;
+	struct textplain_logical_line *line;
+	size_t i;
+
+	if (c->logical_line_count == 0) {
+		if (textplain_add_line(c, 0) == false)
+			return false;
+	}
+	line = &c->logical_line[c->logical_line_count - 1];
+
+	for (i = c->indexed_size; i < utf8_data_size; i++) {
+		char chr = utf8_data[i];
+		size_t next_col;
+
+		if (c->index_terminator != 0) {
+			char terminator = c->index_terminator;
+
+			c->index_terminator = 0;
+
+			/* skip second char of CR/LF or LF/CR pair */
+			if (chr != terminator && (chr == '\n' || chr == '\r')) {
+				line->start = i + 1;
+				continue;
+			}
+		}
+
+		if (chr == '\n' || chr == '\r') {
+			line->length = i - line->start;
+
+			if (textplain_add_line(c, i + 1) == false)
+				return false;
+			line = &c->logical_line[c->logical_line_count - 1];
+
+			c->index_terminator = chr;
+			continue;
+		}
+
+		if ((chr & 0xc0) == 0x80) {
+			/* continuation byte of a character */
+			continue;
+		}
+
+		/* as the column is tracked when wrapping */
+		next_col = line->chars + 1;
+		if (chr == '\t') {
+			next_col = (next_col + TAB_WIDTH - 1) & ~(TAB_WIDTH - 1);
+		}
+		if (next_col >= line->columns) {
+			line->columns = next_col + 1;
+		}
+		line->chars++;
+	}
+
+	line->length = utf8_data_size - line->start;
+	c->indexed_size = utf8_data_size;
+
+	return true;
+}
+
+
 /**
  * Process data for CONTENT_TEXTPLAIN.
  */
@@ -354,6 +521,9 @@ textplain_process_data(struct content *c, const char *data, unsigned int size)
 	if (textplain_drain_input(text, stream, PARSERUTILS_NEEDDATA) == false)
 		goto no_memory;
 
+	if (textplain_index_lines(text) == false)
+		goto no_memory;
+
 	return true;
 
 no_memory:
@@ -379,6 +549,9 @@ static bool textplain_convert(struct content *c)
 	if (textplain_drain_input(text, stream, PARSERUTILS_EOF) == false)
 		return false;
 
+	if (textplain_index_lines(text) == false)
+		return false;
+
 	parserutils_inputstream_destroy(stream);
 	text->inputstream = NULL;
 
@@ -405,123 +578,370 @@ static float textplain_line_height(void)
 
 
 /**
- * Reformat a CONTENT_TEXTPLAIN to a new width.
+ * Add to the physical line count of a logical line in the row tree
+ *
+ * \param text textplain content
+ * \param lineno logical line number
+ * \param delta physical lines to add, modulo ULONG_MAX + 1
  */
-static void textplain_reformat(struct content *c, int width, int height)
+static void
+textplain_row_tree_add(textplain_content *text,
+		       unsigned long lineno,
+		       unsigned long delta)
 {
-	textplain_content *text = (textplain_content *) c;
-	char *utf8_data = text->utf8_data;
-	size_t utf8_data_size = text->utf8_data_size;
-	unsigned long line_count = 0;
-	struct textplain_line *line = text->physical_line;
-	struct textplain_line *line1;
-	size_t i, space, col;
-	size_t columns = 80;
-	int character_width;
-	size_t line_start;
-	nserror res;
+	unsigned long idx;
 
-	NSLOG(netsurf, INFO, "content %p w:%d h:%d", c, width, height);
+	for (idx = lineno + 1; idx <= text->rows_line_count; idx += idx & -idx) {
+		text->row_tree[idx] += delta;
+	}
+}
 
-	/* compute available columns (assuming monospaced font) - use 8
-	 * characters for better accuracy
-	 */
-	res = guit->layout->width(&textplain_style,
-				  "ABCDEFGH", 8,
-				  &character_width);
-	if (res != NSERROR_OK) {
-		return;
+
+/**
+ * Get the first physical line of a logical line
+ *
+ * \param text textplain content
+ * \param lineno logical line number
+ * \return number of physical lines in the logical lines before lineno
+ */
+static unsigned long
+textplain_row_tree_prefix(textplain_content *text, unsigned long lineno)
+{
+	unsigned long rows = 0;
+
+	for (; lineno > 0; lineno -= lineno & -lineno) {
+		rows += text->row_tree[lineno];
 	}
 
-	columns = (width - MARGIN - MARGIN) * 8 / character_width;
-	textplain_tab_width = (TAB_WIDTH * character_width) / 8;
+	return rows;
+}
 
-	text->formatted_width = width;
 
-	text->physical_line_count = 0;
+/**
+ * Find the logical line containing a physical line
+ *
+ * \param text textplain content
+ * \param row physical line number, less than physical_line_count
+ * \return logical line number
+ */
+static unsigned long
+textplain_row_tree_find(textplain_content *text, unsigned long row)
+{
+	unsigned long lineno = 0;
+	unsigned long bit = 1;
 
-	if (!line) {
-		text->physical_line = line =
-			malloc(sizeof(struct textplain_line) * (1024 + 3));
-		if (!line)
-			goto no_memory;
+	while (bit * 2 <= text->rows_line_count) {
+		bit *= 2;
 	}
 
-	line[line_count++].start = line_start = 0;
-	space = 0;
-	i = 0;
-	col = 0;
-	while (i < utf8_data_size) {
-		size_t csize; /* number of bytes in character */
-		uint32_t chr;
-		bool term;
-		size_t next_col;
-		parserutils_error perror;
+	for (; bit != 0; bit /= 2) {
+		if (lineno + bit <= text->rows_line_count &&
+		    text->row_tree[lineno + bit] <= row) {
+			lineno += bit;
+			row -= text->row_tree[lineno];
+		}
+	}
+
+	return lineno;
+}
 
-		perror = parserutils_charset_utf8_to_ucs4((const uint8_t *)utf8_data + i, utf8_data_size - i, &chr, &csize);
-		if (perror != PARSERUTILS_OK) {
-			chr = 0xfffd;
+
+/**
+ * Compute the physical lines of every logical line for a width
+ *
+ * Logical lines which fit in the available columns occupy a single
+ * physical line. The physical lines of longer lines are estimated as
+ * a lower bound from their length, and are only determined when the
+ * line is wrapped by textplain_get_row.
+ *
+ * \param text textplain content
+ * \param columns available columns
+ * \return true on success or false on memory exhaustion
+ */
+static bool textplain_layout_lines(textplain_content *text, size_t columns)
+{
+	unsigned long count = text->logical_line_count;
+	unsigned long *line_rows;
+	unsigned long *row_tree;
+	unsigned long total = 0;
+	unsigned long lineno;
+
+	line_rows = realloc(text->line_rows, sizeof(*line_rows) * (count + 1));
+	if (line_rows == NULL)
+		return false;
+	text->line_rows = line_rows;
+
+	row_tree = realloc(text->row_tree, sizeof(*row_tree) * (count + 1));
+	if (row_tree == NULL)
+		return false;
+	text->row_tree = row_tree;
+
+	row_tree[0] = 0;
+	for (lineno = 0; lineno < count; lineno++) {
+		const struct textplain_logical_line *line;
+		unsigned long rows = 1;
+
+		line = &text->logical_line[lineno];
+		if (line->columns > columns) {
+			/* a physical line holds at most columns - 1 chars */
+			rows = (line->chars + columns - 2) / (columns - 1);
 		}
 
-		term = (chr == '\n' || chr == '\r');
+		line_rows[lineno] = rows;
+		row_tree[lineno + 1] = rows;
+		total += rows;
+	}
 
-		next_col = col + 1;
+	/* build the tree in place from the counts */
+	for (lineno = 1; lineno <= count; lineno++) {
+		unsigned long parent = lineno + (lineno & -lineno);
 
-		if (chr == '\t') {
-			next_col = (next_col + TAB_WIDTH - 1) & ~(TAB_WIDTH - 1);
+		if (parent <= count) {
+			row_tree[parent] += row_tree[lineno];
 		}
+	}
+
+	text->rows_line_count = count;
+	text->columns = columns;
+	text->physical_line_count = total;
+
+	/* discard the wrapped window */
+	text->window_rows = 0;
+	text->window_line = 0;
+	text->window_end = 0;
+	text->window_row = 0;
+
+	return true;
+}
+
+
+/**
+ * Reformat a CONTENT_TEXTPLAIN to the width it is already formatted for
+ *
+ * Scheduled when wrapping lines has changed the number of physical
+ * lines, so the content height and its users are updated.
+ *
+ * \param p textplain content
+ */
+static void textplain_reformat_callback(void *p)
+{
+	textplain_content *text = p;
 
-		if (term || next_col >= columns) {
-			if (line_count % 1024 == 0) {
-				line1 = realloc(line,
-						sizeof(struct textplain_line) *
-						(line_count + 1024 + 3));
-				if (!line1)
-					goto no_memory;
-				text->physical_line = line = line1;
+	text->reformat_pending = false;
+
+	content__reformat(&text->base, false,
+			  text->base.available_width,
+			  text->base.available_height);
+}
+
+
+/**
+ * Append a physical line to the wrapped window
+ *
+ * \param text textplain content
+ * \param start offset of line in utf8_data
+ * \param length length of line in bytes
+ * \return true on success or false on memory exhaustion
+ */
+static bool
+textplain_append_row(textplain_content *text, size_t start, size_t length)
+{
+	struct textplain_line *line;
+
+	if (text->window_rows == text->physical_line_allocated) {
+		unsigned long allocated = text->physical_line_allocated + 1024;
+
+		line = realloc(text->physical_line, sizeof(*line) * allocated);
+		if (line == NULL)
+			return false;
+
+		text->physical_line = line;
+		text->physical_line_allocated = allocated;
+	}
+
+	line = &text->physical_line[text->window_rows++];
+	line->start = start;
+	line->length = length;
+
+	return true;
+}
+
+
+/**
+ * Wrap a logical line, appending its physical lines to the window
+ *
+ * Lines are broken after the last space which fits or, failing that,
+ * before the first character which does not.
+ *
+ * \param text textplain content
+ * \param lineno logical line to wrap, which must be window_end
+ * \return true on success or false on memory exhaustion
+ */
+static bool textplain_wrap_line(textplain_content *text, unsigned long lineno)
+{
+	const struct textplain_logical_line *line = &text->logical_line[lineno];
+	const char *utf8_data = text->utf8_data;
+	size_t columns = text->columns;
+	size_t end = line->start + line->length;
+	size_t line_start = line->start;
+	size_t space = line_start;
+	size_t i = line_start;
+	size_t col = 0;
+	unsigned long old_rows;
+	unsigned long rows = 0;
+
+	assert(lineno == text->window_end);
+
+	if (line->columns > columns) {
+		while (i < end) {
+			size_t next_col = col + 1;
+
+			if (utf8_data[i] == '\t') {
+				next_col = (next_col + TAB_WIDTH - 1) &
+						~(TAB_WIDTH - 1);
 			}
 
-			if (term) {
-				line[line_count-1].length = i - line_start;
+			if (next_col >= columns && col > 0) {
+				size_t line_end = i;
 
-				/* skip second char of CR/LF or LF/CR pair */
-				if (i + 1 < utf8_data_size &&
-				    utf8_data[i+1] != utf8_data[i] &&
-				    (utf8_data[i+1] == '\n' ||
-				     utf8_data[i+1] == '\r')) {
-					i++;
+				if (space != line_start) {
+					/* break after last space in line */
+					line_end = space + 1;
 				}
-			} else {
-				if (space) {
-					/* break at last space in line */
-					i = space;
-					line[line_count-1].length = (i + 1) - line_start;
-				} else
-					line[line_count-1].length = i - line_start;
+
+				if (textplain_append_row(text, line_start,
+						line_end - line_start) == false)
+					return false;
+				rows++;
+
+				i = space = line_start = line_end;
+				col = 0;
+				continue;
 			}
 
-			line[line_count++].start = line_start = i + 1;
-			col = 0;
-			space = 0;
-		} else {
-			col++;
-			if (chr == ' ')
+			if (utf8_data[i] == ' ')
 				space = i;
+			col++;
+			i = utf8_next(utf8_data, end, i);
 		}
-		i += csize;
 	}
-	line[line_count-1].length = i - line[line_count-1].start;
-	line[line_count].start = utf8_data_size;
 
-	text->physical_line_count = line_count;
-	c->width = width;
-	c->height = line_count * textplain_line_height() + MARGIN + MARGIN;
+	if (textplain_append_row(text, line_start, end - line_start) == false)
+		return false;
+	rows++;
 
-	return;
+	text->window_end = lineno + 1;
 
-no_memory:
-	NSLOG(netsurf, INFO, "out of memory (line_count %lu)", line_count);
-	return;
+	old_rows = text->line_rows[lineno];
+	text->line_rows[lineno] = rows;
+
+	if (rows != old_rows) {
+		/* the estimate was wrong so the content height changes */
+		textplain_row_tree_add(text, lineno, rows - old_rows);
+		text->physical_line_count += rows - old_rows;
+
+		if (text->reformat_pending == false) {
+			guit->misc->schedule(0, textplain_reformat_callback,
+					     text);
+			text->reformat_pending = true;
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * Get a physical line, wrapping the logical line containing it if needed
+ *
+ * The returned line is only valid until the next call.
+ *
+ * \param text textplain content
+ * \param row physical line number
+ * \return the physical line or NULL if there is no such line
+ */
+static struct textplain_line *
+textplain_get_row(textplain_content *text, unsigned long row)
+{
+	unsigned long lineno;
+
+	while ((row < text->window_row) ||
+	       (row >= text->window_row + text->window_rows)) {
+		if (row >= text->physical_line_count) {
+			return NULL;
+		}
+
+		lineno = textplain_row_tree_find(text, row);
+
+		if ((lineno != text->window_end) ||
+		    (text->window_rows >= WINDOW_ROWS)) {
+			/* restart the window at the logical line */
+			text->window_rows = 0;
+			text->window_line = lineno;
+			text->window_end = lineno;
+			text->window_row = textplain_row_tree_prefix(text,
+								     lineno);
+		}
+
+		if (textplain_wrap_line(text, lineno) == false) {
+			NSLOG(netsurf, INFO, "out of memory (line %lu)",
+			      lineno);
+			return NULL;
+		}
+	}
+
+	return &text->physical_line[row - text->window_row];
+}
+
+
+/**
+ * Reformat a CONTENT_TEXTPLAIN to a new width.
+ *
+ * Only the physical line counts of the logical lines are computed,
+ * lines are wrapped as they are displayed.
+ */
+static void textplain_reformat(struct content *c, int width, int height)
+{
+	textplain_content *text = (textplain_content *) c;
+	size_t columns = 80;
+	int character_width;
+	nserror res;
+
+	NSLOG(netsurf, INFO, "content %p w:%d h:%d", c, width, height);
+
+	/* compute available columns (assuming monospaced font) - use 8
+	 * characters for better accuracy
+	 */
+	res = guit->layout->width(&textplain_style,
+				  "ABCDEFGH", 8,
+				  &character_width);
+	if (res != NSERROR_OK) {
+		return;
+	}
+
+	columns = (width - MARGIN - MARGIN) * 8 / character_width;
+	if (columns < 2)
+		columns = 2;
+	textplain_tab_width = (TAB_WIDTH * character_width) / 8;
+
+	text->formatted_width = width;
+
+	if ((columns != text->columns) ||
+	    (text->logical_line_count != text->rows_line_count)) {
+		if (textplain_layout_lines(text, columns) == false) {
+			NSLOG(netsurf, INFO, "out of memory (line_count %lu)",
+			      text->logical_line_count);
+			text->columns = 0;
+			text->rows_line_count = 0;
+			text->physical_line_count = 0;
+			text->window_rows = 0;
+			return;
+		}
+	}
+
+	c->width = width;
+	c->height = text->physical_line_count * textplain_line_height() +
+		MARGIN + MARGIN;
 }
 
 
@@ -539,10 +959,15 @@ static void textplain_destroy(struct content *c)
 		parserutils_inputstream_destroy(text->inputstream);
 	}
 
-	if (text->physical_line != NULL) {
-		free(text->physical_line);
+	if (text->reformat_pending) {
+		guit->misc->schedule(-1, textplain_reformat_callback, text);
 	}
 
+	free(text->logical_line);
+	free(text->line_rows);
+	free(text->row_tree);
+	free(text->physical_line);
+
 	if (text->utf8_data != NULL) {
 		free(text->utf8_data);
 	}
@@ -792,17 +1217,15 @@ static void textplain_search(struct content *c, void *gui_data,
 		if (text->search_string == NULL)
 			return;
 
-		if (text->search != NULL) {
-			search_destroy_context(text->search);
-			text->search = NULL;
+		/* an existing context refines its matches when the
+		 * string has been extended */
+		if (text->search == NULL) {
+			text->search = search_create_context(c,
+					CONTENT_TEXTPLAIN, gui_data);
+			if (text->search == NULL)
+				return;
 		}
 
-		text->search = search_create_context(c, CONTENT_TEXTPLAIN,
-						     gui_data);
-
-		if (text->search == NULL)
-			return;
-
 		search_step(text->search, flags, string);
 
 	} else {
@@ -1060,7 +1483,7 @@ textplain_redraw(struct content *c,
 	float scaled_line_height = line_height * data->scale;
 	long line0 = (clip->y0 - y * data->scale) / scaled_line_height - 1;
 	long line1 = (clip->y1 - y * data->scale) / scaled_line_height + 1;
-	struct textplain_line *line = text->physical_line;
+	struct textplain_line *line;
 	size_t length;
 	plot_style_t *plot_style_highlight;
 	nserror res;
@@ -1081,7 +1504,7 @@ textplain_redraw(struct content *c,
 		return false;
 	}
 
-	if (!line)
+	if (text->columns == 0)
 		return true;
 
 	/* choose a suitable background colour for any highlighted text */
@@ -1096,14 +1519,19 @@ textplain_redraw(struct content *c,
 	x = (x + MARGIN) * data->scale;
 	y = (y + MARGIN) * data->scale;
 	for (lineno = line0; lineno != line1; lineno++) {
-		const char *text_d = utf8_data + line[lineno].start;
+		const char *text_d;
 		int tab_width = textplain_tab_width * data->scale;
 		size_t offset = 0;
 		int tx = x;
 
 		if (!tab_width) tab_width = 1;
 
-		length = line[lineno].length;
+		line = textplain_get_row(text, lineno);
+		if (line == NULL)
+			break;
+
+		text_d = utf8_data + line->start;
+		length = line->length;
 		if (!length)
 			continue;
 
@@ -1122,7 +1550,7 @@ textplain_redraw(struct content *c,
 
 			if (!text_draw(text_d + offset,
 				       next_offset - offset,
-				       line[lineno].start + offset,
+				       line->start + offset,
 				       tx,
 				       y + (lineno * scaled_line_height),
 				       clip,
@@ -1156,7 +1584,7 @@ textplain_redraw(struct content *c,
 			 */
 
 			if (bw) {
-				unsigned tab_ofst = line[lineno].start + next_offset;
+				unsigned tab_ofst = line->start + next_offset;
 				struct selection *sel = &text->sel;
 				bool highlighted = false;
 
@@ -1397,7 +1825,10 @@ size_t textplain_offset_from_coords(struct content *c, int x, int y, int dir)
 	else if ((unsigned)y >= nlines)
 		y = nlines - 1;
 
-	line = &textc->physical_line[y];
+	line = textplain_get_row(textc, y);
+	if (line == NULL)
+		return 0;
+
 	text = textc->utf8_data + line->start;
 	length = line->length;
 	idx = 0;
@@ -1468,14 +1899,15 @@ textplain_coords_from_range(struct content *c,
 
 	utf8_data = text->utf8_data;
 	nlines = text->physical_line_count;
-	line = text->physical_line;
 
 	/* find start */
 	lineno = textplain_find_line(c, start);
 
 	r->y0 = (int)(MARGIN + lineno * line_height);
 
-	if (lineno + 1 <= nlines || line[lineno + 1].start >= end) {
+	line = textplain_get_row(text, lineno);
+
+	if (lineno + 1 <= nlines || line == NULL) {
 		/* \todo - it may actually be more efficient just to
 		 *   run forwards most of the time
 		 */
@@ -1487,15 +1919,15 @@ textplain_coords_from_range(struct content *c,
 		r->x1 = text->formatted_width;
 	} else {
 		/* single line */
-		const char *text = utf8_data + line[lineno].start;
+		const char *text = utf8_data + line->start;
 
 		r->x0 = textplain_coord_from_offset(text,
-						    start - line[lineno].start,
-						    line[lineno].length);
+						    start - line->start,
+						    line->length);
 
 		r->x1 = textplain_coord_from_offset(text,
-						    end - line[lineno].start,
-						    line[lineno].length);
+						    end - line->start,
+						    line->length);
 	}
 
 	r->y1 = (int)(MARGIN + (lineno + 1) * line_height);
@@ -1514,9 +1946,9 @@ textplain_get_line(struct content *c,
 
 	assert(c != NULL);
 
-	if (lineno >= text->physical_line_count)
+	line = textplain_get_row(text, lineno);
+	if (line == NULL)
 		return NULL;
-	line = &text->physical_line[lineno];
 
 	*poffset = line->start;
 	*plen = line->length;
@@ -1529,27 +1961,49 @@ int textplain_find_line(struct content *c, unsigned offset)
 {
 	textplain_content *text = (textplain_content *) c;
 	struct textplain_line *line;
-	int nlines;
-	int lineno = 0;
+	unsigned long first = 0;
+	unsigned long last;
+	unsigned long row;
+	unsigned long end_row;
 
 	assert(c != NULL);
 
-	line = text->physical_line;
-	nlines = text->physical_line_count;
-
 	if (offset > text->utf8_data_size) {
 		return -1;
 	}
 
-/* \todo - implement binary search here */
-	while (lineno < nlines && line[lineno].start < offset) {
-		lineno++;
+	if (text->rows_line_count == 0) {
+		return 0;
 	}
-	if (line[lineno].start > offset) {
-		lineno--;
+
+	/* find the last logical line starting at or before offset */
+	last = text->rows_line_count - 1;
+	while (first < last) {
+		unsigned long mid = first + (last - first + 1) / 2;
+
+		if (text->logical_line[mid].start <= offset) {
+			first = mid;
+		} else {
+			last = mid - 1;
+		}
 	}
 
-	return lineno;
+	/* then the physical line within it, wrapping it if necessary */
+	row = textplain_row_tree_prefix(text, first);
+	line = textplain_get_row(text, row);
+	if (line == NULL) {
+		return row;
+	}
+
+	/* the wrapped window now holds the physical lines of the line */
+	end_row = text->window_row + text->window_rows;
+	line = &text->physical_line[row - text->window_row];
+	while ((row + 1 < end_row) && (line[1].start <= offset)) {
+		row++;
+		line++;
+	}
+
+	return row;
 }
 
 
@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "netsurf/inttypes.h"
 #include "utils/http.h"
 #include "utils/log.h"
 #include "utils/messages.h"
@@ -34,11 +35,17 @@
 #include "netsurf/content.h"
 #include "desktop/gui_internal.h"
 
+#include "content/fetch.h"
 #include "content/mimesniff.h"
 #include "content/hlcache.h"
 // Note, this is *ONLY* so that we can abort cleanly during shutdown of the cache
 #include "content/content_protected.h"
 
+/**
+ * Initial number of chains in the content index.
+ */
+#define HLCACHE_INDEX_INITIAL_SIZE 64
+
 typedef struct hlcache_entry hlcache_entry;
 typedef struct hlcache_retrieval_ctx hlcache_retrieval_ctx;
 
@@ -74,6 +81,10 @@ struct hlcache_entry {
 
 	hlcache_entry *next;		/**< Next sibling */
 	hlcache_entry *prev;		/**< Previous sibling */
+
+	uint32_t hash;			/**< Hash of content source URL */
+	hlcache_entry *hash_next;	/**< Next in index chain */
+	hlcache_entry *hash_prev;	/**< Previous in index chain */
 };
 
 /** Current state of the cache.
@@ -86,12 +97,23 @@ struct hlcache_s {
 	/** List of cached content objects */
 	hlcache_entry *content_list;
 
+	/**
+	 * Index of cached content objects by the hash of their
+	 * source URL. All contents sharing a low-level object have
+	 * the same source URL so will be found on the same chain.
+	 */
+	hlcache_entry **buckets;
+	size_t bucket_count; /**< Number of index chains (power of 2) */
+	size_t entry_count; /**< Number of entries in the index */
+
 	/** Ring of retrieval contexts */
 	hlcache_retrieval_ctx *retrieval_ctx_ring;
 
 	/* statistics */
 	unsigned int hit_count;
 	unsigned int miss_count;
+	unsigned int lookup_count; /**< Number of content lookups */
+	unsigned int probe_count; /**< Entries examined by content lookups */
 };
 
 /** high level cache state */
@@ -103,6 +125,120 @@ static struct hlcache_s *hlcache = NULL;
  ******************************************************************************/
 
 
+/**
+ * Obtain the index chain for a source URL hash
+ *
+ * \param hash  Hash of source URL
+ * \return Pointer to the head of the index chain
+ */
+static inline hlcache_entry **hlcache_entry_chain(uint32_t hash)
+{
+	return &hlcache->buckets[hash & (hlcache->bucket_count - 1)];
+}
+
+/**
+ * Grow the content index
+ *
+ * The index is doubled in size and every entry rehashed. The content
+ * list is walked from its tail so chains retain newest first order.
+ * Should the allocation fail the existing index is retained; it
+ * remains correct but with longer chains.
+ */
+static void hlcache_index_grow(void)
+{
+	hlcache_entry **buckets;
+	hlcache_entry **chain;
+	hlcache_entry *entry;
+	size_t old_count = hlcache->bucket_count;
+
+	buckets = calloc(old_count * 2, sizeof(hlcache_entry *));
+	if (buckets == NULL) {
+		return;
+	}
+
+	free(hlcache->buckets);
+	hlcache->buckets = buckets;
+	hlcache->bucket_count = old_count * 2;
+
+	entry = hlcache->content_list;
+	while (entry != NULL && entry->next != NULL) {
+		entry = entry->next;
+	}
+
+	for (; entry != NULL; entry = entry->prev) {
+		chain = hlcache_entry_chain(entry->hash);
+
+		entry->hash_prev = NULL;
+		entry->hash_next = *chain;
+		if (*chain != NULL)
+			(*chain)->hash_prev = entry;
+		*chain = entry;
+	}
+
+	NSLOG(netsurf, DEBUG, "Grew content index to %"PRIsizet" chains",
+	      hlcache->bucket_count);
+}
+
+/**
+ * Insert an entry into the cache
+ *
+ * The entry is placed at the head of the content list and indexed
+ * by the source URL of its content.
+ *
+ * \param entry  Entry to insert, its content must be set
+ */
+static void hlcache_entry_insert(hlcache_entry *entry)
+{
+	hlcache_entry **chain;
+
+	if (hlcache->entry_count >= hlcache->bucket_count) {
+		hlcache_index_grow();
+	}
+
+	entry->prev = NULL;
+	entry->next = hlcache->content_list;
+	if (hlcache->content_list != NULL)
+		hlcache->content_list->prev = entry;
+	hlcache->content_list = entry;
+
+	entry->hash = nsurl_hash(content_get_url(entry->content));
+	chain = hlcache_entry_chain(entry->hash);
+
+	entry->hash_prev = NULL;
+	entry->hash_next = *chain;
+	if (*chain != NULL)
+		(*chain)->hash_prev = entry;
+	*chain = entry;
+
+	hlcache->entry_count++;
+}
+
+/**
+ * Remove an entry from the cache
+ *
+ * \param entry  Entry to remove
+ */
+static void hlcache_entry_remove(hlcache_entry *entry)
+{
+	if (entry->prev == NULL)
+		hlcache->content_list = entry->next;
+	else
+		entry->prev->next = entry->next;
+
+	if (entry->next != NULL)
+		entry->next->prev = entry->prev;
+
+	if (entry->hash_prev == NULL)
+		*hlcache_entry_chain(entry->hash) = entry->hash_next;
+	else
+		entry->hash_prev->hash_next = entry->hash_next;
+
+	if (entry->hash_next != NULL)
+		entry->hash_next->hash_prev = entry->hash_prev;
+
+	hlcache->entry_count--;
+}
+
 /**
  * Attempt to clean the cache
  */
@@ -136,13 +272,7 @@ static void hlcache_clean(void *force_clean_flag)
 		 */
 
 		/* Remove entry from cache */
-		if (entry->prev == NULL)
-			hlcache->content_list = entry->next;
-		else
-			entry->prev->next = entry->next;
-
-		if (entry->next != NULL)
-			entry->next->prev = entry->prev;
+		hlcache_entry_remove(entry);
 
 		/* Destroy content */
 		content_destroy(entry->content);
@@ -158,6 +288,26 @@ static void hlcache_clean(void *force_clean_flag)
 	guit->misc->schedule(hlcache->params.bg_clean_time, hlcache_clean, NULL);
 }
 
+/**
+ * Determine the fetch priority of a retrieval
+ *
+ * \param accepted_types  The content types acceptable to the caller
+ * \return The fetch priority
+ */
+static enum fetch_priority hlcache_fetch_priority(content_type accepted_types)
+{
+	if ((accepted_types & (CONTENT_HTML | CONTENT_TEXTPLAIN)) != 0) {
+		return FETCH_PRIORITY_DOCUMENT;
+	}
+	if ((accepted_types & CONTENT_CSS) != 0) {
+		return FETCH_PRIORITY_STYLESHEET;
+	}
+	if ((accepted_types & CONTENT_SCRIPT) != 0) {
+		return FETCH_PRIORITY_SCRIPT;
+	}
+	return FETCH_PRIORITY_IMAGE;
+}
+
 /**
  * Determine if the specified MIME type is acceptable
  *
@@ -226,12 +376,24 @@ static nserror hlcache_find_content(hlcache_retrieval_ctx *ctx,
 	hlcache_entry *entry;
 	hlcache_event event;
 	nserror error = NSERROR_OK;
+	uint32_t hash;
 
-	/* Search list of cached contents for a suitable one */
-	for (entry = hlcache->content_list; entry != NULL; entry = entry->next) {
+	hlcache->lookup_count++;
+
+	/* Search cached contents with the same source URL for a
+	 * suitable one */
+	hash = nsurl_hash(llcache_handle_get_url(ctx->llcache));
+	for (entry = *hlcache_entry_chain(hash);
+	     entry != NULL;
+	     entry = entry->hash_next) {
 		hlcache_handle entry_handle = { entry, NULL, NULL };
 		const llcache_handle *entry_llcache;
 
+		hlcache->probe_count++;
+
+		if (entry->hash != hash)
+			continue;
+
 		if (entry->content == NULL)
 			continue;
 
@@ -273,11 +435,7 @@ static nserror hlcache_find_content(hlcache_retrieval_ctx *ctx,
 		}
 
 		/* Insert into cache */
-		entry->prev = NULL;
-		entry->next = hlcache->content_list;
-		if (hlcache->content_list != NULL)
-			hlcache->content_list->prev = entry;
-		hlcache->content_list = entry;
+		hlcache_entry_insert(entry);
 
 		/* Signal to caller that we created a content */
 		error = NSERROR_NEED_DATA;
@@ -555,8 +713,18 @@ hlcache_initialise(const struct hlcache_parameters *hlcache_parameters)
 		return NSERROR_NOMEM;
 	}
 
+	hlcache->bucket_count = HLCACHE_INDEX_INITIAL_SIZE;
+	hlcache->buckets = calloc(hlcache->bucket_count,
+				  sizeof(hlcache_entry *));
+	if (hlcache->buckets == NULL) {
+		free(hlcache);
+		hlcache = NULL;
+		return NSERROR_NOMEM;
+	}
+
 	ret = llcache_initialise(&hlcache_parameters->llcache);
 	if (ret != NSERROR_OK) {
+		free(hlcache->buckets);
 		free(hlcache);
 		hlcache = NULL;
 		return ret;
@@ -660,9 +828,13 @@ void hlcache_finalise(void)
 	NSLOG(netsurf, INFO, "hit/miss %d/%d", hlcache->hit_count,
 	      hlcache->miss_count);
 
+	NSLOG(netsurf, INFO, "%d lookups examined %d entries",
+	      hlcache->lookup_count, hlcache->probe_count);
+
 	/* De-schedule ourselves */
 	guit->misc->schedule(-1, hlcache_clean, NULL);
 
+	free(hlcache->buckets);
 	free(hlcache);
 	hlcache = NULL;
 
@@ -711,6 +883,11 @@ nserror hlcache_handle_retrieve(nsurl *url, uint32_t flags,
 	ctx->handle->cb = cb;
 	ctx->handle->pw = pw;
 
+	/* the fetch priority is derived from what the caller accepts */
+	flags &= ~LLCACHE_RETRIEVE_PRIORITY_MASK;
+	flags |= hlcache_fetch_priority(accepted_types) <<
+		LLCACHE_RETRIEVE_PRIORITY_SHIFT;
+
 	error = llcache_handle_retrieve(url, flags, referer, post,
 			hlcache_llcache_callback, ctx,
 			&ctx->llcache);
@@ -836,11 +1013,7 @@ nserror hlcache_handle_abort(hlcache_handle *handle)
 
 		entry->content = clone;
 		handle->entry = entry;
-		entry->prev = NULL;
-		entry->next = hlcache->content_list;
-		if (hlcache->content_list != NULL)
-			hlcache->content_list->prev = entry;
-		hlcache->content_list = entry;
+		hlcache_entry_insert(entry);
 
 		c = clone;
 	}
@@ -35,6 +35,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <strings.h>
+#include <errno.h>
 #include <nsutils/time.h>
 
 #include "netsurf/inttypes.h"
@@ -133,6 +134,57 @@ typedef enum {
  */
 #define INVALID_AGE -1
 
+/**
+ * Initial number of chains in an object list URL index.
+ */
+#define LLCACHE_INDEX_INITIAL_SIZE 256
+
+/**
+ * Remaining lifetime in seconds beyond which persistence candidates
+ * are considered equally long lived.
+ */
+#define LLCACHE_PERSIST_LIFETIME_CAP (7 * 24 * 60 * 60)
+
+/**
+ * Estimated fixed cost in ms of writing an object to the backing store.
+ */
+#define LLCACHE_PERSIST_WRITE_OVERHEAD 1
+
+/**
+ * Size of the first source data segment of an object of unknown length.
+ */
+#define LLCACHE_SEGMENT_MIN (64 * 1024)
+
+/**
+ * Largest source data segment. Each segment is twice the size of the
+ * previous one up to this size.
+ */
+#define LLCACHE_SEGMENT_MAX (4 * 1024 * 1024)
+
+/**
+ * Largest source buffer allocated from a Content-Length header.
+ *
+ * The header is supplied by the server so it is not trusted with
+ * larger allocations. Data beyond this is accumulated in segments as
+ * it actually arrives.
+ */
+#define LLCACHE_PRESIZE_MAX LLCACHE_SEGMENT_MAX
+
+/**
+ * Segment of object source data.
+ *
+ * Source data whose length is not known in advance is accumulated in
+ * a list of segments so it is never copied while it is fetched. The
+ * segments are coalesced into a single buffer when a consumer needs
+ * the whole source.
+ */
+struct llcache_source_segment {
+	struct llcache_source_segment *next; /**< Next segment */
+	uint8_t *data;		/**< Segment data */
+	size_t len;		/**< Byte length of data in segment */
+	size_t alloc;		/**< Allocated size of segment data */
+};
+
 /** Cache control data */
 typedef struct {
 	time_t req_time;	/**< Time of request */
@@ -157,23 +209,45 @@ typedef struct {
 typedef enum {
 	LLCACHE_STATE_RAM = 0, /**< source data is stored in RAM only */
 	LLCACHE_STATE_DISC, /**< source data is stored on disc */
+	LLCACHE_STATE_WRITE, /**< source data is being written to disc */
 } llcache_store_state;
 
 /**
- * Low-level cache object
+ * Low-level cache object list
  *
- * \todo Consider whether a list is a sane container.
+ * Objects are kept on a doubly linked list for iteration and are
+ * additionally indexed by the hash of their URL so that lookups do
+ * not need to visit every object in the list.
+ */
+struct llcache_object_list {
+	llcache_object *head;	  /**< Head of the object list */
+	llcache_object **buckets; /**< URL hash index chains */
+	size_t bucket_count;	  /**< Number of index chains (power of 2) */
+	size_t count;		  /**< Number of objects in the list */
+};
+
+/**
+ * Low-level cache object
  */
 struct llcache_object {
 	llcache_object *prev;	     /**< Previous in list */
 	llcache_object *next;	     /**< Next in list */
 
+	struct llcache_object_list *list; /**< List object resides in */
+	llcache_object *hash_prev;   /**< Previous in index chain */
+	llcache_object *hash_next;   /**< Next in index chain */
+
 	nsurl *url;		     /**< Post-redirect URL for object */
 
 	/** \todo We need a generic dynamic buffer object */
 	uint8_t *source_data;	     /**< Source data for object */
 	size_t source_len;	     /**< Byte length of source data */
 	size_t source_alloc;	     /**< Allocated size of source buffer */
+	/** Source data segments, when not NULL they hold all the
+	 * source data and source_data is NULL
+	 */
+	struct llcache_source_segment *source_segs;
+	struct llcache_source_segment *source_segs_tail; /**< Last segment */
 
 	size_t ssl_cert_count;       /**< The number of SSL certificates stored */
 	struct ssl_cert_info *ssl_certs;    /**< SSL certificate information if count is non-zero */
@@ -195,23 +269,29 @@ struct llcache_object {
 	llcache_header *headers;     /**< Fetch headers */
 	size_t num_headers;	     /**< Number of fetch headers */
 
+	size_t persist_idx;	     /**< Index in persistence candidate
+				      * heap or 0 if not a candidate
+				      */
+	uint64_t persist_score;	     /**< Persistence candidate priority */
+
 	/* Instrumentation. These elements are strictly for information
 	 * to improve the cache performance and to provide performance
 	 * metrics. The values are non-authoritative and must not be used to
 	 * determine object lifetime etc.
 	 */
 	time_t last_used; /**< time the last user was removed from the object */
+	uint32_t use_count; /**< number of times retrieved from the cache */
 };
 
 /**
  * Core llcache control context.
  */
 struct llcache_s {
-	/** Head of the low-level cached object list */
-	llcache_object *cached_objects;
+	/** The low-level cached object list */
+	struct llcache_object_list cached_objects;
 
-	/** Head of the low-level uncached object list */
-	llcache_object *uncached_objects;
+	/** The low-level uncached object list */
+	struct llcache_object_list uncached_objects;
 
 	/** The target upper bound for the RAM cache size */
 	uint32_t limit;
@@ -260,6 +340,15 @@ struct llcache_s {
 	 */
 	uint64_t total_elapsed;
 
+	/**
+	 * Persistence candidates.
+	 *
+	 * A binary max heap of objects ordered by their persistence
+	 * score with the root at index 1.
+	 */
+	llcache_object **persist_heap;
+	size_t persist_heap_count; /**< Number of objects in the heap */
+	size_t persist_heap_alloc; /**< Allocated size of the heap */
 };
 
 /** low level cache state */
@@ -896,6 +985,8 @@ static nserror llcache_object_refetch(llcache_object *object)
 			  object->fetch.flags & LLCACHE_RETRIEVE_VERIFIABLE,
 			  object->fetch.tried_with_tls_downgrade,
 			  (const char **)headers,
+			  (object->fetch.flags & LLCACHE_RETRIEVE_PRIORITY_MASK) >>
+			  LLCACHE_RETRIEVE_PRIORITY_SHIFT,
 			  &object->fetch.fetch);
 
 	/* Clean up cache-control headers */
@@ -952,6 +1043,143 @@ static nserror llcache_object_fetch(llcache_object *object, uint32_t flags,
 	return llcache_object_refetch(object);
 }
 
+/**
+ * Free the source data segments of an object.
+ *
+ * \param object The object to free the segments of.
+ */
+static void llcache_object_source_segments_destroy(llcache_object *object)
+{
+	struct llcache_source_segment *seg;
+
+	while (object->source_segs != NULL) {
+		seg = object->source_segs;
+		object->source_segs = seg->next;
+		free(seg->data);
+		free(seg);
+	}
+	object->source_segs_tail = NULL;
+}
+
+/**
+ * Coalesce the source data segments of an object into a single buffer.
+ *
+ * \param object The object to coalesce the source data of.
+ * \return NSERROR_OK on success or NSERROR_NOMEM if the buffer could
+ *         not be allocated, in which case the segments are retained.
+ */
+static nserror llcache_object_source_coalesce(llcache_object *object)
+{
+	struct llcache_source_segment *seg;
+	uint8_t *data;
+	size_t offset = 0;
+
+	seg = object->source_segs;
+	if (seg == NULL) {
+		return NSERROR_OK;
+	}
+
+	if (seg->next == NULL) {
+		/* a single segment is used as the buffer directly */
+		data = seg->data;
+		object->source_alloc = seg->alloc;
+		seg->data = NULL;
+	} else {
+		data = malloc(object->source_len);
+		if (data == NULL) {
+			return NSERROR_NOMEM;
+		}
+
+		/* free each segment once it is copied to limit the
+		 * peak memory use
+		 */
+		while (object->source_segs != NULL) {
+			seg = object->source_segs;
+			object->source_segs = seg->next;
+			memcpy(data + offset, seg->data, seg->len);
+			offset += seg->len;
+			free(seg->data);
+			free(seg);
+		}
+		object->source_alloc = object->source_len;
+	}
+
+	llcache_object_source_segments_destroy(object);
+	object->source_data = data;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Find the source data of an object at an offset.
+ *
+ * \param object The object to find the source data of.
+ * \param offset The offset of the data within the source.
+ * \param len Updated with the length of contiguous data at the offset.
+ * \return Pointer to the data at the offset.
+ */
+static const uint8_t *
+llcache_object_source_at(llcache_object *object, size_t offset, size_t *len)
+{
+	struct llcache_source_segment *seg;
+
+	if (object->source_segs == NULL) {
+		*len = object->source_len - offset;
+		return object->source_data + offset;
+	}
+
+	for (seg = object->source_segs; seg != NULL; seg = seg->next) {
+		if (offset < seg->len) {
+			*len = seg->len - offset;
+			return seg->data + offset;
+		}
+		offset -= seg->len;
+	}
+
+	*len = 0;
+	return NULL;
+}
+
+/**
+ * Discard source data of a streamed object once it has been emitted.
+ *
+ * Streamed source is not retained so the emitted data, which is at
+ * the start of the source, is released. Buffers larger than the
+ * minimum segment size are freed so a burst of data does not leave a
+ * large allocation behind for the remainder of the fetch.
+ *
+ * \param object The streamed object.
+ * \param len The length of the emitted data, which always ends at the
+ *            end of a segment or of the source.
+ */
+static void llcache_object_source_discard(llcache_object *object, size_t len)
+{
+	struct llcache_source_segment *seg;
+
+	object->source_len -= len;
+
+	while (len > 0 && object->source_segs != NULL) {
+		seg = object->source_segs;
+		assert(seg->len <= len);
+
+		object->source_segs = seg->next;
+		len -= seg->len;
+		free(seg->data);
+		free(seg);
+	}
+
+	if (object->source_segs == NULL) {
+		object->source_segs_tail = NULL;
+
+		assert(object->source_len == 0);
+		if (object->source_alloc > LLCACHE_SEGMENT_MIN) {
+			free(object->source_data);
+			object->source_data = NULL;
+			object->source_alloc = 0;
+		}
+	}
+}
+
 /**
  * Destroy a low-level cache object
  *
@@ -976,12 +1204,13 @@ static nserror llcache_object_destroy(llcache_object *object)
 	}
 
 	if (object->source_data != NULL) {
-		if (object->store_state == LLCACHE_STATE_DISC) {
+		if (object->store_state != LLCACHE_STATE_RAM) {
 			guit->llcache->release(object->url, BACKING_STORE_NONE);
 		} else {
 			free(object->source_data);
 		}
 	}
+	llcache_object_source_segments_destroy(object);
 
 	nsurl_unref(object->url);
 
@@ -1017,6 +1246,193 @@ static nserror llcache_object_destroy(llcache_object *object)
 	return NSERROR_OK;
 }
 
+/**
+ * Initialise a low-level cache object list
+ *
+ * \param list	List to initialise
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+static nserror llcache_object_list_init(struct llcache_object_list *list)
+{
+	list->head = NULL;
+	list->count = 0;
+	list->bucket_count = LLCACHE_INDEX_INITIAL_SIZE;
+	list->buckets = calloc(list->bucket_count, sizeof(llcache_object *));
+	if (list->buckets == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	return NSERROR_OK;
+}
+
+/**
+ * Obtain the URL index chain an object with a given URL belongs on
+ *
+ * \param list	List to index
+ * \param url	URL to find chain for
+ * \return Pointer to the head of the index chain
+ */
+static inline llcache_object **
+llcache_object_list_chain(const struct llcache_object_list *list,
+		const nsurl *url)
+{
+	return &list->buckets[nsurl_hash(url) & (list->bucket_count - 1)];
+}
+
+/**
+ * Grow the URL index of a low-level cache object list
+ *
+ * The index is doubled in size and every object rehashed. Should the
+ * allocation fail the existing index is retained; it remains correct
+ * but with longer chains.
+ *
+ * \param list	List to grow index of
+ */
+static void llcache_object_list_grow(struct llcache_object_list *list)
+{
+	llcache_object **buckets;
+	llcache_object **chain;
+	llcache_object *object;
+	size_t old_count = list->bucket_count;
+
+	buckets = calloc(old_count * 2, sizeof(llcache_object *));
+	if (buckets == NULL) {
+		return;
+	}
+
+	free(list->buckets);
+	list->buckets = buckets;
+	list->bucket_count = old_count * 2;
+
+	for (object = list->head; object != NULL; object = object->next) {
+		chain = llcache_object_list_chain(list, object->url);
+
+		object->hash_prev = NULL;
+		object->hash_next = *chain;
+		if (*chain != NULL)
+			(*chain)->hash_prev = object;
+		*chain = object;
+	}
+
+	NSLOG(llcache, DEBUG, "Grew index of list %p to %"PRIsizet" chains",
+	      list, list->bucket_count);
+}
+
+/**
+ * Place an object at a position in the persistence candidate heap
+ *
+ * \param idx	  Heap index
+ * \param object  Object to place
+ */
+static inline void
+llcache_persist_heap_set(size_t idx, llcache_object *object)
+{
+	llcache->persist_heap[idx] = object;
+	object->persist_idx = idx;
+}
+
+/**
+ * Move a persistence candidate towards the heap root
+ *
+ * \param idx  Heap index of the candidate
+ */
+static void llcache_persist_heap_up(size_t idx)
+{
+	llcache_object *object = llcache->persist_heap[idx];
+
+	while ((idx > 1) &&
+	       (llcache->persist_heap[idx / 2]->persist_score <
+		object->persist_score)) {
+		llcache_persist_heap_set(idx, llcache->persist_heap[idx / 2]);
+		idx /= 2;
+	}
+	llcache_persist_heap_set(idx, object);
+}
+
+/**
+ * Move a persistence candidate away from the heap root
+ *
+ * \param idx  Heap index of the candidate
+ */
+static void llcache_persist_heap_down(size_t idx)
+{
+	llcache_object *object = llcache->persist_heap[idx];
+	size_t child;
+
+	while ((child = idx * 2) <= llcache->persist_heap_count) {
+		if ((child < llcache->persist_heap_count) &&
+		    (llcache->persist_heap[child + 1]->persist_score >
+		     llcache->persist_heap[child]->persist_score)) {
+			child++;
+		}
+		if (llcache->persist_heap[child]->persist_score <=
+		    object->persist_score) {
+			break;
+		}
+		llcache_persist_heap_set(idx, llcache->persist_heap[child]);
+		idx = child;
+	}
+	llcache_persist_heap_set(idx, object);
+}
+
+/**
+ * Add an object to the persistence candidate heap
+ *
+ * \param object  Object to add, its persist_score must be set
+ * \return NSERROR_OK on success, NSERROR_NOMEM on memory exhaustion
+ */
+static nserror llcache_persist_heap_insert(llcache_object *object)
+{
+	assert(object->persist_idx == 0);
+
+	if (llcache->persist_heap_count + 1 >= llcache->persist_heap_alloc) {
+		size_t alloc = llcache->persist_heap_alloc * 2;
+		llcache_object **heap;
+
+		if (alloc == 0) {
+			alloc = LLCACHE_INDEX_INITIAL_SIZE;
+		}
+
+		heap = realloc(llcache->persist_heap,
+			       alloc * sizeof(llcache_object *));
+		if (heap == NULL) {
+			return NSERROR_NOMEM;
+		}
+		llcache->persist_heap = heap;
+		llcache->persist_heap_alloc = alloc;
+	}
+
+	llcache->persist_heap_count++;
+	llcache_persist_heap_set(llcache->persist_heap_count, object);
+	llcache_persist_heap_up(llcache->persist_heap_count);
+
+	return NSERROR_OK;
+}
+
+/**
+ * Remove an object from the persistence candidate heap
+ *
+ * \param object  Object to remove
+ */
+static void llcache_persist_heap_remove(llcache_object *object)
+{
+	size_t idx = object->persist_idx;
+	llcache_object *last;
+
+	assert(idx != 0);
+
+	last = llcache->persist_heap[llcache->persist_heap_count];
+	llcache->persist_heap_count--;
+	object->persist_idx = 0;
+
+	if (idx <= llcache->persist_heap_count) {
+		/* fill the hole with the last object and restore order */
+		llcache_persist_heap_set(idx, last);
+		llcache_persist_heap_up(idx);
+		llcache_persist_heap_down(last->persist_idx);
+	}
+}
+
 /**
  * Add a low-level cache object to a cache list
  *
@@ -1025,14 +1441,32 @@ static nserror llcache_object_destroy(llcache_object *object)
  * \return NSERROR_OK
  */
 static nserror llcache_object_add_to_list(llcache_object *object,
-		llcache_object **list)
+		struct llcache_object_list *list)
 {
+	llcache_object **chain;
+
+	assert(object->list == NULL);
+
+	if (list->count >= list->bucket_count) {
+		llcache_object_list_grow(list);
+	}
+
 	object->prev = NULL;
-	object->next = *list;
+	object->next = list->head;
+
+	if (list->head != NULL)
+		list->head->prev = object;
+	list->head = object;
+	list->count++;
+
+	chain = llcache_object_list_chain(list, object->url);
+	object->hash_prev = NULL;
+	object->hash_next = *chain;
+	if (*chain != NULL)
+		(*chain)->hash_prev = object;
+	*chain = object;
 
-	if (*list != NULL)
-		(*list)->prev = object;
-	*list = object;
+	object->list = list;
 
 	return NSERROR_OK;
 }
@@ -1175,16 +1609,38 @@ static nserror llcache_object_clone_cache_data(llcache_object *source,
  * \return NSERROR_OK
  */
 static nserror
-llcache_object_remove_from_list(llcache_object *object, llcache_object **list)
+llcache_object_remove_from_list(llcache_object *object,
+		struct llcache_object_list *list)
 {
-	if (object == *list)
-		*list = object->next;
+	assert(object->list == list);
+
+	/* only listed objects may be persistence candidates */
+	if (object->persist_idx != 0) {
+		llcache_persist_heap_remove(object);
+	}
+
+	if (object == list->head)
+		list->head = object->next;
 	else
 		object->prev->next = object->next;
 
 	if (object->next != NULL)
 		object->next->prev = object->prev;
 
+	if (object->hash_prev == NULL)
+		*llcache_object_list_chain(list, object->url) =
+				object->hash_next;
+	else
+		object->hash_prev->hash_next = object->hash_next;
+
+	if (object->hash_next != NULL)
+		object->hash_next->hash_prev = object->hash_prev;
+
+	object->prev = object->next = NULL;
+	object->hash_prev = object->hash_next = NULL;
+	object->list = NULL;
+	list->count--;
+
 	return NSERROR_OK;
 }
 
@@ -1803,6 +2259,89 @@ static inline bool llcache__scheme_is_persistable(const nsurl *url)
 	return persistable;
 }
 
+/**
+ * Compute the persistence priority of an object
+ *
+ * Objects are ranked by the network fetches persisting them is likely
+ * to save for the time it will take to write them. The benefit is
+ * the number of times the object has been reused and how long it
+ * will remain fresh. The cost is estimated from the object size and
+ * the measured backing store write bandwidth.
+ *
+ * \param object  Object to rank
+ * \param remaining_lifetime  Remaining freshness lifetime of object
+ * \return The priority, higher values are more valuable to persist.
+ */
+static uint64_t
+llcache_persist_score(const llcache_object *object, int remaining_lifetime)
+{
+	uint64_t bandwidth; /* estimated write bandwidth in bytes/second */
+	uint64_t cost; /* estimated write time in ms */
+	uint64_t benefit;
+
+	if ((llcache->total_written > 0) && (llcache->total_elapsed > 0)) {
+		bandwidth = (llcache->total_written * 1000) /
+			llcache->total_elapsed;
+	} else {
+		/* nothing written yet, assume the maximum is achieved */
+		bandwidth = llcache->maximum_bandwidth;
+	}
+	if (bandwidth == 0) {
+		bandwidth = 1;
+	}
+
+	cost = LLCACHE_PERSIST_WRITE_OVERHEAD +
+		(((uint64_t)object->source_len * 1000) / bandwidth);
+
+	benefit = (uint64_t)(object->use_count + 1) *
+		min(remaining_lifetime, LLCACHE_PERSIST_LIFETIME_CAP);
+
+	return (benefit * 1000) / cost;
+}
+
+/**
+ * Update an object's persistence candidacy
+ *
+ * Complete, fresh, cached objects held only in RAM are kept ranked in
+ * the persistence candidate heap, any other object is removed from it.
+ *
+ * \param object  Object to update
+ */
+static void llcache_persist_candidate_update(llcache_object *object)
+{
+	int remaining_lifetime;
+
+	if ((object->list == &llcache->cached_objects) &&
+	    (object->store_state == LLCACHE_STATE_RAM) &&
+	    (object->fetch.state == LLCACHE_FETCH_COMPLETE) &&
+	    llcache__scheme_is_persistable(object->url)) {
+		remaining_lifetime = llcache_object_rfc2616_remaining_lifetime(
+				&object->cache);
+
+		if (remaining_lifetime > llcache->minimum_lifetime) {
+			object->persist_score = llcache_persist_score(object,
+					remaining_lifetime);
+
+			if (object->persist_idx == 0) {
+				if (llcache_persist_heap_insert(object) !=
+				    NSERROR_OK) {
+					NSLOG(llcache, DEBUG,
+					      "Unable to add persistence candidate %p",
+					      object);
+				}
+			} else {
+				llcache_persist_heap_up(object->persist_idx);
+				llcache_persist_heap_down(object->persist_idx);
+			}
+			return;
+		}
+	}
+
+	if (object->persist_idx != 0) {
+		llcache_persist_heap_remove(object);
+	}
+}
+
 /**
  * Check whether a scheme is cachable.
  *
@@ -1930,8 +2469,12 @@ llcache_object_retrieve_from_cache(nsurl *url,
 	      referer==NULL?"":nsurl_access(referer),
 	      post);
 
-	/* Search for the most recently fetched matching object */
-	for (obj = llcache->cached_objects; obj != NULL; obj = obj->next) {
+	/* Search the URL index for the most recently fetched
+	 * matching object
+	 */
+	for (obj = *llcache_object_list_chain(&llcache->cached_objects, url);
+	     obj != NULL;
+	     obj = obj->hash_next) {
 
 		if ((newest == NULL ||
 		     obj->cache.req_time > newest->cache.req_time) &&
@@ -1941,6 +2484,12 @@ llcache_object_retrieve_from_cache(nsurl *url,
 		}
 	}
 
+	if (newest != NULL) {
+		/* account for the reuse in the persistence ranking */
+		newest->use_count++;
+		llcache_persist_candidate_update(newest);
+	}
+
 	/* No viable object found in cache create one and attempt to
 	 * pull from persistent store.
 	 */
@@ -2424,6 +2973,9 @@ static nserror llcache_object_cache_update(llcache_object *object)
 	if (object->cache.date == 0)
 		object->cache.date = time(NULL);
 
+	/* freshness may have changed */
+	llcache_persist_candidate_update(object);
+
 	return NSERROR_OK;
 }
 
@@ -2493,6 +3045,203 @@ static nserror llcache_fetch_notmodified(llcache_object *object,
 	return NSERROR_OK;
 }
 
+/**
+ * Size the source buffer of an object from its Content-Length.
+ *
+ * The buffer is only allocated when the length of the decoded source
+ * is known. Otherwise the source is accumulated in segments. The
+ * allocation is capped at LLCACHE_PRESIZE_MAX whatever length the
+ * server claims.
+ *
+ * \param object The object whose headers have been received.
+ */
+static void llcache_object_source_presize(llcache_object *object)
+{
+	const char *content_length = NULL;
+	unsigned long long length;
+	uint8_t *data;
+	char *end;
+	size_t i;
+
+	if ((object->source_data != NULL) ||
+	    (object->source_segs != NULL) ||
+	    (object->fetch.flags & LLCACHE_RETRIEVE_STREAM_DATA)) {
+		return;
+	}
+
+	for (i = 0; i < object->num_headers; i++) {
+		if (strcasecmp(object->headers[i].name,
+			       "Content-Encoding") == 0) {
+			/* the fetcher decodes the content so its
+			 * length is not that of the source
+			 */
+			if (strcasecmp(object->headers[i].value,
+				       "identity") != 0) {
+				return;
+			}
+		} else if (strcasecmp(object->headers[i].name,
+				      "Content-Length") == 0) {
+			content_length = object->headers[i].value;
+		}
+	}
+
+	if (content_length == NULL) {
+		return;
+	}
+
+	errno = 0;
+	length = strtoull(content_length, &end, 10);
+	if ((errno != 0) || (end == content_length) ||
+	    (length == 0) || (length > SIZE_MAX)) {
+		return;
+	}
+
+	if (length > llcache->limit) {
+		/* objects too large to cache are often downloads
+		 * which are streamed once their type is known
+		 */
+		return;
+	}
+
+	if (length > LLCACHE_PRESIZE_MAX) {
+		length = LLCACHE_PRESIZE_MAX;
+	}
+
+	data = malloc(length);
+	if (data == NULL) {
+		/* fall back to segments */
+		return;
+	}
+
+	object->source_data = data;
+	object->source_alloc = length;
+}
+
+/**
+ * Append fetched data to the source segments of an object.
+ *
+ * Any data already in the source buffer becomes the first segment.
+ *
+ * \param object  Object being fetched
+ * \param data	  Data to append
+ * \param len	  Byte length of data
+ * \return NSERROR_OK on success, appropriate error otherwise.
+ */
+static nserror
+llcache_object_source_append_segment(llcache_object *object,
+				     const uint8_t *data,
+				     size_t len)
+{
+	struct llcache_source_segment *seg;
+	size_t seg_len;
+	size_t used;
+
+	if (object->source_data != NULL) {
+		/* source buffer becomes the first segment */
+		seg = malloc(sizeof(*seg));
+		if (seg == NULL) {
+			return NSERROR_NOMEM;
+		}
+		seg->next = NULL;
+		seg->data = object->source_data;
+		seg->len = object->source_len;
+		seg->alloc = object->source_alloc;
+
+		object->source_segs = object->source_segs_tail = seg;
+		object->source_data = NULL;
+		object->source_alloc = 0;
+	}
+
+	seg = object->source_segs_tail;
+
+	/* fill the remainder of the last segment */
+	if (seg != NULL) {
+		used = min(len, seg->alloc - seg->len);
+		memcpy(seg->data + seg->len, data, used);
+		seg->len += used;
+		object->source_len += used;
+		data += used;
+		len -= used;
+	}
+
+	if (len == 0) {
+		return NSERROR_OK;
+	}
+
+	/* each segment is double the size of the last one */
+	if (seg == NULL) {
+		seg_len = LLCACHE_SEGMENT_MIN;
+	} else {
+		seg_len = min(seg->alloc * 2, LLCACHE_SEGMENT_MAX);
+	}
+	if (seg_len < len) {
+		seg_len = len;
+	}
+
+	seg = malloc(sizeof(*seg));
+	if (seg == NULL) {
+		return NSERROR_NOMEM;
+	}
+	seg->data = malloc(seg_len);
+	if (seg->data == NULL) {
+		free(seg);
+		return NSERROR_NOMEM;
+	}
+	seg->next = NULL;
+	seg->len = len;
+	seg->alloc = seg_len;
+	memcpy(seg->data, data, len);
+
+	if (object->source_segs_tail != NULL) {
+		object->source_segs_tail->next = seg;
+	} else {
+		object->source_segs = seg;
+	}
+	object->source_segs_tail = seg;
+	object->source_len += len;
+
+	return NSERROR_OK;
+}
+
+/**
+ * Hand fetched data straight to the user of a streamed object.
+ *
+ * When the sole user of a streamed object has been sent all the
+ * source so far the data is emitted directly from the fetcher's
+ * buffer and never copied into the object.
+ *
+ * \param object  Object being fetched
+ * \param data	  Data to emit
+ * \param len	  Byte length of data
+ * \return NSERROR_OK if the data was emitted, NSERROR_NEED_DATA if it
+ *         must be buffered, appropriate error otherwise.
+ */
+static nserror
+llcache_object_stream_data(llcache_object *object,
+			   const uint8_t *data,
+			   size_t len)
+{
+	llcache_object_user *user = object->users;
+	llcache_event event;
+
+	/* The user must be expecting data and not be in the middle of
+	 * handling an event from this object.
+	 */
+	if ((user == NULL) ||
+	    (user->next != NULL) ||
+	    (user->iterator_target) ||
+	    (user->queued_for_delete) ||
+	    (user->handle->state != LLCACHE_FETCH_DATA)) {
+		return NSERROR_NEED_DATA;
+	}
+
+	event.type = LLCACHE_EVENT_HAD_DATA;
+	event.data.data.buf = data;
+	event.data.data.len = len;
+
+	return llcache_send_event_to_users(object, &event);
+}
+
 /**
  * Process a chunk of fetched data
  *
@@ -2538,10 +3287,35 @@ llcache_fetch_process_data(llcache_object *object,
 		}
 
 		object->fetch.state = LLCACHE_FETCH_DATA;
+
+		llcache_object_source_presize(object);
+	}
+
+	if ((object->fetch.flags & LLCACHE_RETRIEVE_STREAM_DATA) &&
+	    (object->source_len == 0)) {
+		nserror error;
+
+		error = llcache_object_stream_data(object, data, len);
+		if (error != NSERROR_NEED_DATA) {
+			return error;
+		}
+		/* not taken by the user so buffer it for replay */
 	}
 
-	/* Resize source buffer if it's too small */
-	if (object->source_len + len >= object->source_alloc) {
+	if ((object->source_segs == NULL) &&
+	    (object->source_len + len <= object->source_alloc)) {
+		/* Append this data chunk to source buffer */
+		memcpy(object->source_data + object->source_len, data, len);
+		object->source_len += len;
+
+		return NSERROR_OK;
+	}
+
+	if ((object->source_segs == NULL) &&
+	    (object->fetch.flags & LLCACHE_RETRIEVE_STREAM_DATA)) {
+		/* Streamed source is discarded as it is emitted so
+		 * the buffer only grows to the largest pending data.
+		 */
 		const size_t new_len = object->source_len + len + 64 * 1024;
 		uint8_t *temp = realloc(object->source_data, new_len);
 		if (temp == NULL)
@@ -2549,13 +3323,14 @@ llcache_fetch_process_data(llcache_object *object,
 
 		object->source_data = temp;
 		object->source_alloc = new_len;
-	}
 
-	/* Append this data chunk to source buffer */
-	memcpy(object->source_data + object->source_len, data, len);
-	object->source_len += len;
+		memcpy(object->source_data + object->source_len, data, len);
+		object->source_len += len;
 
-	return NSERROR_OK;
+		return NSERROR_OK;
+	}
+
+	return llcache_object_source_append_segment(object, data, len);
 }
 
 
@@ -2769,9 +3544,11 @@ static nserror llcache_fetch_timeout(llcache_object *object)
 static nserror
 build_candidate_list(struct llcache_object ***lst_out, int *lst_len_out)
 {
-	llcache_object *object, *next;
+	llcache_object *object;
 	struct llcache_object **lst;
+	struct llcache_object **busy; /* candidates unavailable this run */
 	int lst_len = 0;
+	int busy_len = 0;
 	int remaining_lifetime;
 
 #define MAX_PERSIST_PER_RUN 128
@@ -2781,39 +3558,51 @@ build_candidate_list(struct llcache_object ***lst_out, int *lst_len_out)
 		return NSERROR_NOMEM;
 	}
 
-	for (object = llcache->cached_objects; object != NULL; object = next) {
-		next = object->next;
+	busy = calloc(MAX_PERSIST_PER_RUN, sizeof(struct llcache_object *));
+	if (busy == NULL) {
+		free(lst);
+		return NSERROR_NOMEM;
+	}
 
-		/* Only consider http(s) for the disc cache. */
-		if (!llcache__scheme_is_persistable(object->url)) {
-			continue;
-		}
+	/* take the most valuable candidates from the heap in order */
+	while ((llcache->persist_heap_count > 0) &&
+	       (lst_len < MAX_PERSIST_PER_RUN) &&
+	       (busy_len < MAX_PERSIST_PER_RUN)) {
+		object = llcache->persist_heap[1];
+		llcache_persist_heap_remove(object);
 
 		remaining_lifetime = llcache_object_rfc2616_remaining_lifetime(
 				&object->cache);
 
-		/* cacehable objects with no pending fetches, not
-		 * already on disc and with sufficient lifetime to
-		 * make disc cache worthwhile
-		 */
-		if ((object->candidate_count == 0) &&
-		    (object->fetch.fetch == NULL) &&
-		    (object->store_state == LLCACHE_STATE_RAM) &&
-		    (remaining_lifetime > llcache->minimum_lifetime)) {
-			lst[lst_len] = object;
-			lst_len++;
-			if (lst_len == MAX_PERSIST_PER_RUN)
-				break;
+		if (remaining_lifetime <= llcache->minimum_lifetime) {
+			/* no longer sufficient lifetime to make disc
+			 * cache worthwhile, only a revalidation will
+			 * make the object a candidate again.
+			 */
+			continue;
 		}
+
+		if ((object->candidate_count != 0) ||
+		    (object->fetch.fetch != NULL)) {
+			/* object is in use by a fetch */
+			busy[busy_len++] = object;
+			continue;
+		}
+
+		lst[lst_len++] = object;
 	}
 
+	/* return busy candidates to the heap for a later run */
+	while (busy_len > 0) {
+		llcache_persist_heap_insert(busy[--busy_len]);
+	}
+	free(busy);
+
 	if (lst_len == 0) {
 		free(lst);
 		return NSERROR_NOT_FOUND;
 	}
 
-	/** \todo sort list here */
-
 	*lst_len_out = lst_len;
 	*lst_out = lst;
 
@@ -2843,6 +3632,12 @@ write_backing_store(struct llcache_object *object,
 
 	nsu_getmonotonic_ms(&startms);
 
+	/* the backing store requires the source in a single buffer */
+	ret = llcache_object_source_coalesce(object);
+	if (ret != NSERROR_OK) {
+		return ret;
+	}
+
 	/* put object data in backing store */
 	ret = guit->llcache->store(object->url,
 				   BACKING_STORE_NONE,
@@ -2925,6 +3720,167 @@ static void llcache_persist_slowcheck(void *p)
 	}
 }
 
+/**
+ * Mark objects whose source data write has completed.
+ *
+ * \param list The object list to search.
+ * \param url The url of the object which was written.
+ */
+static void
+llcache_store_complete_list(struct llcache_object_list *list, nsurl *url)
+{
+	llcache_object *object;
+
+	for (object = *llcache_object_list_chain(list, url);
+	     object != NULL;
+	     object = object->hash_next) {
+		if ((object->store_state == LLCACHE_STATE_WRITE) &&
+		    (nsurl_compare(object->url, url, NSURL_COMPLETE) == true)) {
+			object->store_state = LLCACHE_STATE_DISC;
+		}
+	}
+}
+
+/**
+ * Backing store asynchronous write completion callback.
+ *
+ * Accounts for the write bandwidth and once the source data has been
+ * written transitions the object to the on disc state. The object
+ * remains on disc even if the write failed as the backing store owns
+ * the source data, a subsequent retrieval failure causes a refetch.
+ */
+static void
+llcache_store_complete(nsurl *url,
+		       enum backing_store_flags flags,
+		       nserror res,
+		       size_t written,
+		       unsigned long elapsed,
+		       void *pw)
+{
+	if (llcache == NULL) {
+		return;
+	}
+
+	if (res == NSERROR_OK) {
+		/* ensure the write is accounted as taking at least the
+		 * minimal amount of time
+		 */
+		if (elapsed == 0) {
+			elapsed = 1;
+		}
+
+		llcache->total_written += written;
+		llcache->total_elapsed += elapsed;
+
+		NSLOG(llcache, DEBUG,
+		      "Wrote %"PRIssizet" bytes in %lums bw:%lu %s",
+		      written, elapsed, (written * 1000) / elapsed,
+		      nsurl_access(url));
+
+		if ((elapsed > llcache->time_quantum) &&
+		    (((written * 1000) / elapsed) < llcache->minimum_bandwidth)) {
+			/* slow write, check overall performance later */
+			guit->misc->schedule(llcache->time_quantum * 100,
+					     llcache_persist_slowcheck,
+					     NULL);
+		}
+	}
+
+	/* the source data is written after the metadata */
+	if ((flags & BACKING_STORE_META) != 0) {
+		return;
+	}
+
+	llcache_store_complete_list(&llcache->cached_objects, url);
+	llcache_store_complete_list(&llcache->uncached_objects, url);
+}
+
+/**
+ * Queue an object to be written to the backing store.
+ *
+ * The metadata is queued before the source data so that if the
+ * backing store is unable to accept the source data the object can
+ * remain in RAM. Once the source data has been accepted the backing
+ * store owns it and the object is in the writing state until
+ * llcache_store_complete() is called.
+ *
+ * \param object The object to put in the backing store.
+ * \param written_out The amount of data queued.
+ * \param elapsed The time in ms it took to queue the data.
+ * \return NSERROR_OK on success, NSERROR_NOSPACE if the backing store
+ *         cannot accept more writes at present or appropriate error code.
+ */
+static nserror
+write_backing_store_async(struct llcache_object *object,
+			  size_t *written_out,
+			  unsigned long *elapsed)
+{
+	nserror ret;
+	uint8_t *metadata;
+	size_t metadatasize;
+	uint64_t startms = 0;
+	uint64_t endms = 1000;
+
+	nsu_getmonotonic_ms(&startms);
+
+	/* the backing store requires the source in a single buffer */
+	ret = llcache_object_source_coalesce(object);
+	if (ret != NSERROR_OK) {
+		return ret;
+	}
+
+	ret = llcache_serialise_metadata(object, &metadata, &metadatasize);
+	if (ret != NSERROR_OK) {
+		return ret;
+	}
+
+	ret = guit->llcache->store_async(object->url,
+					 BACKING_STORE_META,
+					 metadata,
+					 metadatasize,
+					 llcache_store_complete,
+					 NULL);
+	if (ret == NSERROR_NOSPACE) {
+		/* store took no reference to the metadata */
+		free(metadata);
+		return ret;
+	}
+	guit->llcache->release(object->url, BACKING_STORE_META);
+	if (ret != NSERROR_OK) {
+		return ret;
+	}
+
+	/* set before queueing as the completion may happen
+	 * immediately if the backing store has to write synchronously.
+	 */
+	object->store_state = LLCACHE_STATE_WRITE;
+
+	ret = guit->llcache->store_async(object->url,
+					 BACKING_STORE_NONE,
+					 object->source_data,
+					 object->source_len,
+					 llcache_store_complete,
+					 NULL);
+	if (ret != NSERROR_OK) {
+		/* unable to put source data in backing store. Ensure
+		 * the already queued metadata is invalidated.
+		 */
+		object->store_state = LLCACHE_STATE_RAM;
+		guit->llcache->invalidate(object->url);
+		return ret;
+	}
+	nsu_getmonotonic_ms(&endms);
+
+	*written_out = object->source_len + metadatasize;
+
+	*elapsed = endms - startms;
+	if (*elapsed == 0) {
+		*elapsed = 1;
+	}
+
+	return NSERROR_OK;
+}
+
 /**
  * Possibly write objects data to backing store.
  *
@@ -2940,8 +3896,8 @@ static void llcache_persist(void *p)
 
 	unsigned long write_limit; /* max number of bytes to write in this run*/
 
-	size_t written; /* all bytes written for a single object */
-	unsigned long elapsed; /* how long writing an object took */
+	size_t written = 0; /* all bytes written for a single object */
+	unsigned long elapsed = 1; /* how long writing an object took */
 
 	size_t total_written = 0; /* total bytes written in this run */
 	unsigned long total_elapsed = 1; /* total ms used to write bytes */
@@ -2957,7 +3913,19 @@ static void llcache_persist(void *p)
 
 	/* obtained a candidate list, make each object persistent in turn */
 	for (idx = 0; idx < lst_count; idx++) {
-		ret = write_backing_store(lst[idx], &written, &elapsed);
+		if (guit->llcache->store_async != NULL) {
+			ret = write_backing_store_async(lst[idx],
+							&written, &elapsed);
+		} else {
+			ret = write_backing_store(lst[idx], &written, &elapsed);
+		}
+		if (ret == NSERROR_NOSPACE) {
+			/* backing store cannot accept any more writes
+			 * until outstanding ones complete.
+			 */
+			next = llcache->time_quantum;
+			break;
+		}
 		if (ret != NSERROR_OK) {
 			continue;
 		}
@@ -3020,7 +3988,6 @@ static void llcache_persist(void *p)
 		}
 
 	}
-	free(lst);
 
 	/* Completed list without running out of allowed bytes or time */
 	if (idx == lst_count) {
@@ -3032,8 +3999,17 @@ static void llcache_persist(void *p)
 		}
 	}
 
-	llcache->total_written += total_written;
-	llcache->total_elapsed += total_elapsed;
+	/* candidates which were not written remain candidates */
+	for (idx = 0; idx < lst_count; idx++) {
+		llcache_persist_candidate_update(lst[idx]);
+	}
+	free(lst);
+
+	/* asynchronous writes are accounted for on completion */
+	if (guit->llcache->store_async == NULL) {
+		llcache->total_written += total_written;
+		llcache->total_elapsed += total_elapsed;
+	}
 
 	NSLOG(llcache, DEBUG,
 	      "writeout size:%"PRIssizet" time:%lu bandwidth:%lubytes/s",
@@ -3110,13 +4086,20 @@ static void llcache_fetch_callback(const fetch_msg *msg, void *p)
 		object->fetch.state = LLCACHE_FETCH_COMPLETE;
 		object->fetch.fetch = NULL;
 
-		/* Shrink source buffer to required size */
-		temp = realloc(object->source_data,
-				object->source_len);
-		/* If source_len is 0, then temp may be NULL */
-		if (temp != NULL || object->source_len == 0) {
-			object->source_data = temp;
-			object->source_alloc = object->source_len;
+		/* Gather segmented source into a single buffer so
+		 * users only ever read it, otherwise shrink the
+		 * source buffer to the required size.
+		 */
+		if (object->source_segs != NULL) {
+			error = llcache_object_source_coalesce(object);
+		} else if (object->source_alloc != object->source_len) {
+			temp = realloc(object->source_data,
+				       object->source_len);
+			/* If source_len is 0, then temp may be NULL */
+			if (temp != NULL || object->source_len == 0) {
+				object->source_data = temp;
+				object->source_alloc = object->source_len;
+			}
 		}
 
 		llcache_object_cache_update(object);
@@ -3283,16 +4266,9 @@ static llcache_object_user *llcache_object_find_user(
  * \return True if object resides in list, false otherwise
  */
 static bool llcache_object_in_list(const llcache_object *object,
-		const llcache_object *list)
+		const struct llcache_object_list *list)
 {
-	while (list != NULL) {
-		if (list == object)
-			break;
-
-		list = list->next;
-	}
-
-	return list != NULL;
+	return object->list == list;
 }
 
 /**
@@ -3462,30 +4438,46 @@ static nserror llcache_object_notify_users(llcache_object *object)
 				objstate >= LLCACHE_FETCH_DATA &&
 				object->source_len > handle->bytes) {
 			size_t orig_handle_read;
+			bool streaming;
 
 			/* Construct HAD_DATA event */
 			event.type = LLCACHE_EVENT_HAD_DATA;
 			event.data.data.buf =
-					object->source_data + handle->bytes;
-			event.data.data.len =
-					object->source_len - handle->bytes;
+				llcache_object_source_at(object,
+							 handle->bytes,
+							 &event.data.data.len);
 
 			/* Update record of last byte emitted */
-			if (object->fetch.flags &
-					LLCACHE_RETRIEVE_STREAM_DATA) {
-				/* Streaming, so reset to zero to
+			streaming = object->fetch.flags &
+					LLCACHE_RETRIEVE_STREAM_DATA;
+			orig_handle_read = handle->bytes;
+			if (streaming) {
+				/* Streaming, so the emitted data is
+				 * discarded once the user has had it to
 				 * minimise amount of cached source data.
-				 * Additionally, we don't support replay
-				 * when streaming. */
-				orig_handle_read = 0;
-				handle->bytes = object->source_len = 0;
+				 */
+				handle->bytes = 0;
 			} else {
-				orig_handle_read = handle->bytes;
-				handle->bytes = object->source_len;
+				handle->bytes += event.data.data.len;
+
+				if (handle->bytes < object->source_len) {
+					/* remaining segments are emitted
+					 * on the next pass
+					 */
+					llcache_users_not_caught_up();
+				}
 			}
 
 			/* Emit event */
 			error = handle->cb(handle, &event, handle->pw);
+			if (streaming && error != NSERROR_NEED_DATA) {
+				llcache_object_source_discard(object,
+						orig_handle_read +
+						event.data.data.len);
+				if (object->source_len > 0) {
+					llcache_users_not_caught_up();
+				}
+			}
 			if (user->queued_for_delete) {
 				next_user = user->next;
 				llcache_object_remove_user(object, user);
@@ -3511,9 +4503,10 @@ static nserror llcache_object_notify_users(llcache_object *object)
 			}
 		}
 
-		/* User: DATA, Obj: COMPLETE => User->COMPLETE */
+		/* User: DATA, Obj: COMPLETE, all source emitted => User->COMPLETE */
 		if (handle->state == LLCACHE_FETCH_DATA &&
-				objstate > LLCACHE_FETCH_DATA) {
+				objstate > LLCACHE_FETCH_DATA &&
+				handle->bytes >= object->source_len) {
 			handle->state = LLCACHE_FETCH_COMPLETE;
 
 			/* Emit DONE event */
@@ -3579,6 +4572,12 @@ llcache_object_snapshot(llcache_object *object,	llcache_object **snapshot)
 	if (error != NSERROR_OK)
 		return error;
 
+	error = llcache_object_source_coalesce(object);
+	if (error != NSERROR_OK) {
+		llcache_object_destroy(newobj);
+		return error;
+	}
+
 	newobj->source_alloc = newobj->source_len = object->source_len;
 
 	if (object->source_len > 0) {
@@ -3647,7 +4646,7 @@ total_object_size(llcache_object *object)
 	tot = sizeof(*object);
 	tot += nsurl_length(object->url);
 
-	if (object->source_data != NULL) {
+	if ((object->source_data != NULL) || (object->source_segs != NULL)) {
 		tot += object->source_len;
 	}
 
@@ -3695,7 +4694,7 @@ void llcache_clean(bool purge)
 	}
 
 	/* Uncacheable objects with no users or fetches */
-	for (object = llcache->uncached_objects;
+	for (object = llcache->uncached_objects.head;
 	     object != NULL;
 	     object = next) {
 		next = object->next;
@@ -3717,7 +4716,7 @@ void llcache_clean(bool purge)
 
 
 	/* Stale cacheable objects with no users or pending fetches */
-	for (object = llcache->cached_objects;
+	for (object = llcache->cached_objects.head;
 	     object != NULL;
 	     object = next) {
 		next = object->next;
@@ -3737,7 +4736,7 @@ void llcache_clean(bool purge)
 				llcache_object_remove_from_list(object,
 						&llcache->cached_objects);
 
-				if (object->store_state == LLCACHE_STATE_DISC) {
+				if (object->store_state != LLCACHE_STATE_RAM) {
 					guit->llcache->invalidate(object->url);
 				}
 
@@ -3761,7 +4760,7 @@ void llcache_clean(bool purge)
 	 * pending fetches and pushed to persistent store while the
 	 * cache exceeds the configured size.
 	 */
-	for (object = llcache->cached_objects;
+	for (object = llcache->cached_objects.head;
 	     ((limit < llcache_size) && (object != NULL));
 	     object = next) {
 		next = object->next;
@@ -3785,7 +4784,7 @@ void llcache_clean(bool purge)
 	 * and pushed to persistent store while the cache exceeds
 	 * the configured size. Effectively just the llcache object metadata.
 	 */
-	for (object = llcache->cached_objects;
+	for (object = llcache->cached_objects.head;
 	     ((limit < llcache_size) && (object != NULL));
 	     object = next) {
 		next = object->next;
@@ -3815,7 +4814,7 @@ void llcache_clean(bool purge)
 	 * most valuable objects as replacing them is a full network
 	 * fetch
 	 */
-	for (object = llcache->cached_objects;
+	for (object = llcache->cached_objects.head;
 	     ((limit < llcache_size) && (object != NULL));
 	     object = next) {
 		next = object->next;
@@ -3846,11 +4845,24 @@ void llcache_clean(bool purge)
 nserror
 llcache_initialise(const struct llcache_parameters *prm)
 {
+	nserror res;
+
 	llcache = calloc(1, sizeof(struct llcache_s));
 	if (llcache == NULL) {
 		return NSERROR_NOMEM;
 	}
 
+	res = llcache_object_list_init(&llcache->cached_objects);
+	if (res == NSERROR_OK) {
+		res = llcache_object_list_init(&llcache->uncached_objects);
+	}
+	if (res != NSERROR_OK) {
+		free(llcache->cached_objects.buckets);
+		free(llcache);
+		llcache = NULL;
+		return res;
+	}
+
 	llcache->limit = prm->limit;
 	llcache->minimum_lifetime = prm->minimum_lifetime;
 	llcache->minimum_bandwidth = prm->minimum_bandwidth;
@@ -3875,7 +4887,7 @@ void llcache_finalise(void)
 	uint64_t total_bandwidth = 0; /* total bandwidth */
 
 	/* Clean uncached objects */
-	for (object = llcache->uncached_objects; object != NULL; object = next) {
+	for (object = llcache->uncached_objects.head; object != NULL; object = next) {
 		llcache_object_user *user, *next_user;
 
 		next = object->next;
@@ -3892,11 +4904,13 @@ void llcache_finalise(void)
 		/* Fetch system has already been destroyed */
 		object->fetch.fetch = NULL;
 
+		llcache_object_remove_from_list(object,
+				&llcache->uncached_objects);
 		llcache_object_destroy(object);
 	}
 
 	/* Clean cached objects */
-	for (object = llcache->cached_objects; object != NULL; object = next) {
+	for (object = llcache->cached_objects.head; object != NULL; object = next) {
 		llcache_object_user *user, *next_user;
 
 		next = object->next;
@@ -3913,10 +4927,15 @@ void llcache_finalise(void)
 		/* Fetch system has already been destroyed */
 		object->fetch.fetch = NULL;
 
+		llcache_object_remove_from_list(object,
+				&llcache->cached_objects);
 		llcache_object_destroy(object);
 	}
 
-	/* backing store finalisation */
+	/* backing store finalisation, any outstanding writes are
+	 * completed so the object lists must no longer reference
+	 * destroyed objects.
+	 */
 	guit->llcache->finalise();
 
 	if (llcache->total_elapsed > 0) {
@@ -3930,6 +4949,9 @@ void llcache_finalise(void)
 	      llcache->total_elapsed,
 	      total_bandwidth);
 
+	free(llcache->persist_heap);
+	free(llcache->uncached_objects.buckets);
+	free(llcache->cached_objects.buckets);
 	free(llcache);
 	llcache = NULL;
 }
@@ -3950,12 +4972,12 @@ static void llcache_catch_up_all_users(void *ignored)
 	llcache->all_caught_up = true;
 
 	/* Catch new users up with state of objects */
-	for (object = llcache->cached_objects; object != NULL;
+	for (object = llcache->cached_objects.head; object != NULL;
 			object = object->next) {
 		llcache_object_notify_users(object);
 	}
 
-	for (object = llcache->uncached_objects; object != NULL;
+	for (object = llcache->uncached_objects.head; object != NULL;
 			object = object->next) {
 		llcache_object_notify_users(object);
 	}
@@ -4153,7 +5175,7 @@ nserror llcache_handle_force_stream(llcache_handle *handle)
 		return NSERROR_OK;
 
 	/* Forcibly uncache this object */
-	if (llcache_object_in_list(object, llcache->cached_objects)) {
+	if (llcache_object_in_list(object, &llcache->cached_objects)) {
 		llcache_object_remove_from_list(object,
 				&llcache->cached_objects);
 		llcache_object_add_to_list(object, &llcache->uncached_objects);
@@ -4183,13 +5205,36 @@ nsurl *llcache_handle_get_url(const llcache_handle *handle)
 	return handle->object != NULL ? handle->object->url : NULL;
 }
 
+/* See llcache.h for documentation */
+nserror llcache_handle_coalesce_source(llcache_handle *handle)
+{
+	if (handle->object == NULL) {
+		return NSERROR_OK;
+	}
+
+	return llcache_object_source_coalesce(handle->object);
+}
+
 /* See llcache.h for documentation */
 const uint8_t *llcache_handle_get_source_data(const llcache_handle *handle,
 		size_t *size)
 {
-	*size = handle->object != NULL ? handle->object->source_len : 0;
+	const llcache_object *object = handle->object;
+
+	if (object == NULL) {
+		*size = 0;
+		return NULL;
+	}
+
+	if (object->source_segs != NULL) {
+		/* only the leading segment is contiguous */
+		*size = object->source_segs->len;
+		return object->source_segs->data;
+	}
+
+	*size = object->source_len;
 
-	return handle->object != NULL ? handle->object->source_data : NULL;
+	return object->source_data;
 }
 
 /* See llcache.h for documentation */
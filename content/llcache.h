@@ -60,9 +60,14 @@ enum llcache_retrieve_flag {
 	/**< No error pages */
 	LLCACHE_RETRIEVE_NO_ERROR_PAGES = (1 << 2),
 	/**< Stream data (implies that object is not cacheable) */
-	LLCACHE_RETRIEVE_STREAM_DATA    = (1 << 3)
+	LLCACHE_RETRIEVE_STREAM_DATA    = (1 << 3),
+	/**< Fetch priority (enum fetch_priority) */
+	LLCACHE_RETRIEVE_PRIORITY_MASK  = (7 << 4)
 };
 
+/** Shift of the fetch priority within the retrieval flags */
+#define LLCACHE_RETRIEVE_PRIORITY_SHIFT 4
+
 /** Low-level cache event types */
 typedef enum {
 	LLCACHE_EVENT_GOT_CERTS,        /**< SSL certificates arrived */
@@ -274,6 +279,12 @@ nserror llcache_handle_abort(llcache_handle *handle);
 /**
  * Force a low-level cache handle into streaming mode
  *
+ * Source data of a streamed object is discarded once it has been
+ * emitted. Data fetched while the user is caught up is emitted
+ * directly from the fetcher's buffer without being copied, so the
+ * memory used is independent of the size of the object. The handle
+ * must be the sole user of the object.
+ *
  * \param handle  Handle to stream
  * \return NSERROR_OK on success, appropriate error otherwise
  */
@@ -295,9 +306,26 @@ nserror llcache_handle_invalidate_cache_data(llcache_handle *handle);
  */
 nsurl *llcache_handle_get_url(const llcache_handle *handle);
 
+/**
+ * Gather the source data of a low-level cache object into one buffer
+ *
+ * Source of unknown length is held in segments while it is fetched
+ * and is gathered when the fetch completes. Users which need all the
+ * source received so far while the fetch is still in progress call
+ * this first. It must only be called from the main thread.
+ *
+ * \param handle  Handle to gather the source data of
+ * \return NSERROR_OK on success, appropriate error otherwise
+ */
+nserror llcache_handle_coalesce_source(llcache_handle *handle);
+
 /**
  * Retrieve source data of a low-level cache object
  *
+ * The source data is not modified. While the object is being fetched
+ * only the leading contiguous part of the source received so far may
+ * be returned unless llcache_handle_coalesce_source() has been called.
+ *
  * \param handle  Handle to retrieve source data from
  * \param size    Pointer to location to receive byte length of data
  * \return Pointer to source data
@@ -87,6 +87,8 @@
  * potential crashes.
  */
 
+#include "utils/config.h"
+
 #include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -94,6 +96,11 @@
 #include <string.h>
 #include <strings.h>
 #include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #ifdef WITH_NSPSL
 #include <nspsl.h>
 #endif
@@ -233,12 +240,65 @@ struct hsts_data {
 	bool include_sub_domains; /**< Whether to include subdomains */
 };
 
+/**
+ * URL database snapshot file header
+ *
+ * A snapshot is a binary image of the database which may be mapped
+ * directly into memory. The header is followed by the host records,
+ * the path records and finally the string table. All values are in
+ * host byte order and all string references are offsets into the
+ * string table; offset zero is the empty string.
+ */
+struct urldb_snapshot_header {
+	char magic[8];		/**< Snapshot file identifier */
+	uint32_t version;	/**< Snapshot format version */
+	uint32_t endian;	/**< Byte order marker */
+	uint32_t host_count;	/**< Number of host records */
+	uint32_t path_count;	/**< Number of path records */
+	uint32_t string_size;	/**< Size of string table in bytes */
+	uint32_t reserved;	/**< Reserved, must be zero */
+};
+
+/**
+ * URL database snapshot host record
+ */
+struct urldb_snapshot_host {
+	uint32_t name;		/**< Host name */
+	uint32_t first_path;	/**< Index of first path record */
+	uint32_t path_count;	/**< Number of path records */
+	uint32_t hsts_include_sub_domains; /**< HSTS covers subdomains */
+	int64_t hsts_expires;	/**< HSTS expiry time */
+};
+
+/**
+ * URL database snapshot path record
+ */
+struct urldb_snapshot_path {
+	uint32_t scheme;	/**< URL scheme */
+	uint32_t path;		/**< URL path and query */
+	uint32_t title;		/**< Resource title */
+	uint32_t port;		/**< Port number, 0 for scheme default */
+	uint32_t visits;	/**< Visit count */
+	uint32_t type;		/**< Type of resource */
+	uint32_t hash;		/**< URL hash for the bloom filter */
+	uint32_t reserved;	/**< Reserved, must be zero */
+	int64_t last_visit;	/**< Last visit time */
+};
+
 struct host_part {
 	/**
 	 * Known paths on this host. This _must_ be first so that
 	 * struct host_part *h = (struct host_part *)mypath; works
+	 *
+	 * \note Use urldb_host_paths() to access the paths so any
+	 *       entries still held in a loaded snapshot are added.
 	 */
 	struct path_data paths;
+	/**
+	 * Snapshot record of paths on this host which have not been
+	 * added to the paths tree yet, or NULL.
+	 */
+	const struct urldb_snapshot_host *snapshot;
 	/**
 	 * Allow access to SSL protected resources on this host
 	 * without verifying certificate authenticity
@@ -322,6 +382,61 @@ static struct bloom_filter *url_bloom;
  */
 #define BLOOM_SIZE (1024 * 32)
 
+/** URL database snapshot file identifier */
+#define URL_SNAPSHOT_MAGIC "NSURLDB\x1a"
+/** Length of URL database snapshot file identifier */
+#define URL_SNAPSHOT_MAGIC_LEN 8
+/** Current URL database snapshot format version */
+#define URL_SNAPSHOT_VERSION 1
+/** URL database snapshot byte order marker */
+#define URL_SNAPSHOT_ENDIAN 0x01020304
+
+/**
+ * Loaded URL database snapshot
+ *
+ * Hosts are added to the database when the snapshot is loaded but
+ * their paths are only added when they are first accessed. The
+ * snapshot is released once every host has had its paths added.
+ */
+struct urldb_snapshot {
+	uint8_t *data;		/**< Snapshot file contents */
+	size_t size;		/**< Size of snapshot file contents */
+	bool mapped;		/**< The contents are memory mapped */
+
+	const struct urldb_snapshot_host *hosts; /**< Host records */
+	const struct urldb_snapshot_path *paths; /**< Path records */
+	const char *strings;	/**< String table */
+	uint32_t host_count;	/**< Number of host records */
+
+	/** Host entry for each host record with paths, or NULL */
+	struct host_part **host_entries;
+	/** Number of host entries whose paths are yet to be added */
+	unsigned int pending;
+};
+
+/** Currently loaded URL database snapshot */
+static struct urldb_snapshot *url_snapshot;
+
+static void urldb_snapshot_load_host(struct host_part *h);
+
+
+/**
+ * Get the root of the paths tree of a host
+ *
+ * Any paths on the host held in the loaded snapshot are added to the
+ * tree first.
+ *
+ * \param h Host entry
+ * \return The path tree root
+ */
+static inline struct path_data *urldb_host_paths(const struct host_part *h)
+{
+	if (h->snapshot != NULL) {
+		urldb_snapshot_load_host((struct host_part *)h);
+	}
+	return (struct path_data *)&h->paths;
+}
+
 
 /**
  * write a time_t to a file portably
@@ -511,6 +626,34 @@ urldb_count_urls(const struct path_data *root,
 }
 
 
+/**
+ * Generate the full name of a host
+ *
+ * \param h Host entry
+ * \param host Buffer to place the host name in
+ * \param size Size of buffer
+ * \return true on success, false on error
+ */
+static bool urldb_host_name(const struct host_part *h, char *host, size_t size)
+{
+	char *p, *end;
+
+	host[0] = '\0';
+
+	for (p = host, end = host + size;
+	     h && h != &db_root && p < end; h = h->parent) {
+		int written = snprintf(p, end - p, "%s%s", h->part,
+				       (h->parent && h->parent->parent) ? "." : "");
+		if (written < 0) {
+			return false;
+		}
+		p += written;
+	}
+
+	return true;
+}
+
+
 /**
  * Save a search (sub)tree
  *
@@ -522,7 +665,7 @@ static void urldb_save_search_tree(struct search_node *parent, FILE *fp)
 	char host[256];
 	const struct host_part *h;
 	unsigned int path_count = 0;
-	char *path, *p, *end;
+	char *path;
 	int path_alloc = 64, path_used = 1;
 	time_t expiry, hsts_expiry = 0;
 	int hsts_include_subdomains = 0;
@@ -540,15 +683,9 @@ static void urldb_save_search_tree(struct search_node *parent, FILE *fp)
 
 	path[0] = '\0';
 
-	for (h = parent->data, p = host, end = host + sizeof host;
-	     h && h != &db_root && p < end; h = h->parent) {
-		int written = snprintf(p, end - p, "%s%s", h->part,
-				       (h->parent && h->parent->parent) ? "." : "");
-		if (written < 0) {
-			free(path);
-			return;
-		}
-		p += written;
+	if (!urldb_host_name(parent->data, host, sizeof host)) {
+		free(path);
+		return;
 	}
 
 	h = parent->data;
@@ -557,14 +694,14 @@ static void urldb_save_search_tree(struct search_node *parent, FILE *fp)
 		hsts_include_subdomains = h->hsts.include_sub_domains;
 	}
 
-	urldb_count_urls(&parent->data->paths, expiry, &path_count);
+	urldb_count_urls(urldb_host_paths(h), expiry, &path_count);
 
 	if (path_count > 0) {
 		fprintf(fp, "%s %i ", host, hsts_include_subdomains);
 		urldb_write_timet(fp, hsts_expiry);
 		fprintf(fp, "%i\n", path_count);
 
-		urldb_write_paths(&parent->data->paths, host, fp,
+		urldb_write_paths(&h->paths, host, fp,
 				  &path, &path_alloc, &path_used, expiry);
 	} else if (hsts_expiry) {
 		fprintf(fp, "%s %i ", host, hsts_include_subdomains);
@@ -850,7 +987,7 @@ urldb_iterate_partial_host(struct search_node *root,
 			return false;
 		}
 
-		if (root->data->paths.children) {
+		if (urldb_host_paths(root->data)->children) {
 			/* and extract all paths attached to this host */
 			if (!urldb_iterate_entries_path(&root->data->paths,
 							callback,
@@ -980,6 +1117,11 @@ urldb_iterate_entries_host(struct search_node *parent,
 		return false;
 	}
 
+	if (url_callback != NULL) {
+		/* ensure paths held in a snapshot are present */
+		urldb_host_paths(parent->data);
+	}
+
 	if ((parent->data->paths.children) ||
 	    ((cookie_callback) &&
 	     (parent->data->paths.cookies))) {
@@ -1427,7 +1569,7 @@ static struct path_data *urldb_find_url(nsurl *url)
 		port_int = 0;
 	}
 
-	p = urldb_match_path(&h->paths, plq, scheme, port_int);
+	p = urldb_match_path(urldb_host_paths(h), plq, scheme, port_int);
 
 	free(plq);
 	lwc_string_unref(scheme);
@@ -1492,7 +1634,7 @@ static void urldb_dump_hosts(struct host_part *parent)
 	}
 
 	/* Dump path data */
-	urldb_dump_paths(&parent->paths);
+	urldb_dump_paths(urldb_host_paths(parent));
 
 	/* and recurse */
 	for (h = parent->children; h; h = h->next) {
@@ -2100,7 +2242,7 @@ urldb_add_path(lwc_string *scheme,
 
 	assert(scheme && host && url);
 
-	d = (struct path_data *) &host->paths;
+	d = urldb_host_paths(host);
 
 	/* skip leading '/' */
 	segment = buf;
@@ -2843,6 +2985,723 @@ static void urldb_destroy_search_tree(struct search_node *root)
 }
 
 
+/**
+ * Add a URL read from a database file
+ *
+ * \param h Host entry to add the URL to
+ * \param host Host name
+ * \param scheme URL scheme
+ * \param port Port number, 0 for the scheme default
+ * \param path_query URL path and query
+ * \return Pointer to the path entry, or NULL on error
+ */
+static struct path_data *
+urldb_load_url(struct host_part *h,
+	       const char *host,
+	       const char *scheme,
+	       unsigned int port,
+	       const char *path_query)
+{
+	char url[64 + 3 + 256 + 6 + 4096 + 1 + 1];
+	char ports[10];
+	bool is_file = false;
+	nsurl *nsurl;
+	lwc_string *scheme_lwc, *fragment_lwc;
+	char *plq;
+	size_t len;
+	struct path_data *p;
+
+	if (!strcasecmp(host, "localhost") &&
+	    !strcasecmp(scheme, "file"))
+		is_file = true;
+
+	snprintf(ports, sizeof ports, "%u", port);
+
+	snprintf(url, sizeof url, "%s://%s%s%s%s",
+		 scheme,
+		 /* file URLs have no host */
+		 (is_file ? "" : host),
+		 (port ? ":" : ""),
+		 (port ? ports : ""),
+		 path_query);
+
+	if (nsurl_create(url, &nsurl) != NSERROR_OK) {
+		NSLOG(netsurf, INFO, "Failed inserting '%s'", url);
+		return NULL;
+	}
+
+	if (url_bloom != NULL) {
+		uint32_t hash = nsurl_hash(nsurl);
+		bloom_insert_hash(url_bloom, hash);
+	}
+
+	/* Copy and merge path/query strings */
+	if (nsurl_get(nsurl, NSURL_PATH | NSURL_QUERY,
+		      &plq, &len) != NSERROR_OK) {
+		NSLOG(netsurf, INFO, "Failed inserting '%s'", url);
+		nsurl_unref(nsurl);
+		return NULL;
+	}
+
+	scheme_lwc = nsurl_get_component(nsurl, NSURL_SCHEME);
+	fragment_lwc = nsurl_get_component(nsurl, NSURL_FRAGMENT);
+	p = urldb_add_path(scheme_lwc, port, h, plq, fragment_lwc, nsurl);
+	if (!p) {
+		NSLOG(netsurf, INFO, "Failed inserting '%s'", url);
+	}
+	nsurl_unref(nsurl);
+	lwc_string_unref(scheme_lwc);
+	if (fragment_lwc != NULL)
+		lwc_string_unref(fragment_lwc);
+
+	return p;
+}
+
+
+/**
+ * Destroy a URL database snapshot
+ *
+ * Any host entries with paths still held in the snapshot must have
+ * been destroyed or had their paths added.
+ *
+ * \param snap The snapshot to destroy
+ */
+static void urldb_snapshot_destroy(struct urldb_snapshot *snap)
+{
+	if (snap == NULL) {
+		return;
+	}
+
+#ifdef HAVE_MMAP
+	if (snap->mapped) {
+		munmap(snap->data, snap->size);
+	} else
+#endif
+	{
+		free(snap->data);
+	}
+
+	free(snap->host_entries);
+	free(snap);
+}
+
+
+/**
+ * Add the paths of a host held in the loaded snapshot
+ *
+ * \param h Host entry with paths held in the snapshot
+ */
+static void urldb_snapshot_load_host(struct host_part *h)
+{
+	const struct urldb_snapshot_host *sh = h->snapshot;
+	const struct urldb_snapshot_path *sp;
+	const char *strings = url_snapshot->strings;
+	struct path_data *p;
+	uint32_t idx;
+
+	/* paths are added through the accessor so clear this first */
+	h->snapshot = NULL;
+
+	for (idx = 0; idx < sh->path_count; idx++) {
+		sp = &url_snapshot->paths[sh->first_path + idx];
+
+		p = urldb_load_url(h,
+				   strings + sh->name,
+				   strings + sp->scheme,
+				   sp->port,
+				   strings + sp->path);
+		if (p == NULL) {
+			continue;
+		}
+
+		p->urld.visits = sp->visits;
+		p->urld.last_visit = (time_t)sp->last_visit;
+		p->urld.type = (content_type)sp->type;
+
+		if (strings[sp->title] != '\0') {
+			free(p->urld.title);
+			p->urld.title = strdup(strings + sp->title);
+		}
+	}
+
+	url_snapshot->pending--;
+	if (url_snapshot->pending == 0) {
+		urldb_snapshot_destroy(url_snapshot);
+		url_snapshot = NULL;
+	}
+}
+
+
+/**
+ * Add the paths of every host held in the loaded snapshot
+ */
+static void urldb_snapshot_flush(void)
+{
+	struct host_part *h;
+	uint32_t idx;
+
+	/* the snapshot is released once the last host is added */
+	for (idx = 0;
+	     (url_snapshot != NULL) && (idx < url_snapshot->host_count);
+	     idx++) {
+		h = url_snapshot->host_entries[idx];
+		if ((h != NULL) && (h->snapshot != NULL)) {
+			urldb_snapshot_load_host(h);
+		}
+	}
+}
+
+
+/**
+ * Check the contents of a URL database snapshot are consistent
+ *
+ * \param snap The snapshot to check
+ * \return NSERROR_OK if the snapshot is usable else error code.
+ */
+static nserror urldb_snapshot_validate(struct urldb_snapshot *snap)
+{
+	const struct urldb_snapshot_header *hdr;
+	uint64_t size;
+	uint32_t path_count;
+	uint32_t string_size;
+	uint32_t idx;
+
+	if (snap->size < sizeof(*hdr)) {
+		return NSERROR_INVALID;
+	}
+	hdr = (const struct urldb_snapshot_header *)snap->data;
+
+	if ((hdr->version != URL_SNAPSHOT_VERSION) ||
+	    (hdr->endian != URL_SNAPSHOT_ENDIAN)) {
+		NSLOG(netsurf, INFO, "Unsupported URL snapshot version %u",
+		      hdr->version);
+		return NSERROR_INVALID;
+	}
+
+	path_count = hdr->path_count;
+	string_size = hdr->string_size;
+
+	size = sizeof(*hdr) +
+		(uint64_t)hdr->host_count * sizeof(struct urldb_snapshot_host) +
+		(uint64_t)path_count * sizeof(struct urldb_snapshot_path) +
+		string_size;
+	if ((size != snap->size) || (string_size == 0)) {
+		return NSERROR_INVALID;
+	}
+
+	snap->host_count = hdr->host_count;
+	snap->hosts = (const struct urldb_snapshot_host *)(hdr + 1);
+	snap->paths = (const struct urldb_snapshot_path *)
+		(snap->hosts + snap->host_count);
+	snap->strings = (const char *)(snap->paths + path_count);
+
+	/* every string must be terminated within the table */
+	if (snap->strings[string_size - 1] != '\0') {
+		return NSERROR_INVALID;
+	}
+
+	for (idx = 0; idx < snap->host_count; idx++) {
+		const struct urldb_snapshot_host *sh = &snap->hosts[idx];
+
+		if ((sh->name >= string_size) ||
+		    (sh->first_path > path_count) ||
+		    (sh->path_count > (path_count - sh->first_path))) {
+			return NSERROR_INVALID;
+		}
+	}
+
+	for (idx = 0; idx < path_count; idx++) {
+		const struct urldb_snapshot_path *sp = &snap->paths[idx];
+
+		if ((sp->scheme >= string_size) ||
+		    (sp->path >= string_size) ||
+		    (sp->title >= string_size)) {
+			return NSERROR_INVALID;
+		}
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Load a URL database snapshot
+ *
+ * The snapshot is mapped into memory where possible. Hosts are added
+ * to the database immediately while their paths are added on first
+ * access.
+ *
+ * \param fp Open snapshot file, closed before return.
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror urldb_snapshot_load(FILE *fp)
+{
+	struct urldb_snapshot *snap;
+	struct host_part *h;
+	uint32_t idx;
+	nserror res;
+
+	snap = calloc(1, sizeof(*snap));
+	if (snap == NULL) {
+		fclose(fp);
+		return NSERROR_NOMEM;
+	}
+
+#ifdef HAVE_MMAP
+	{
+		struct stat sb;
+
+		if ((fstat(fileno(fp), &sb) == 0) && (sb.st_size > 0)) {
+			void *map;
+			map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE,
+				   fileno(fp), 0);
+			if (map != MAP_FAILED) {
+				snap->data = map;
+				snap->size = sb.st_size;
+				snap->mapped = true;
+			}
+		}
+	}
+#endif
+
+	if (snap->data == NULL) {
+		long size;
+
+		if ((fseek(fp, 0, SEEK_END) != 0) ||
+		    ((size = ftell(fp)) <= 0) ||
+		    (fseek(fp, 0, SEEK_SET) != 0)) {
+			free(snap);
+			fclose(fp);
+			return NSERROR_INVALID;
+		}
+
+		snap->size = size;
+		snap->data = malloc(snap->size);
+		if (snap->data == NULL) {
+			free(snap);
+			fclose(fp);
+			return NSERROR_NOMEM;
+		}
+
+		if (fread(snap->data, 1, snap->size, fp) != snap->size) {
+			free(snap->data);
+			free(snap);
+			fclose(fp);
+			return NSERROR_INVALID;
+		}
+	}
+	fclose(fp);
+
+	res = urldb_snapshot_validate(snap);
+	if (res == NSERROR_OK) {
+		snap->host_entries = calloc(snap->host_count,
+					    sizeof(struct host_part *));
+		if ((snap->host_entries == NULL) && (snap->host_count > 0)) {
+			res = NSERROR_NOMEM;
+		}
+	}
+
+	if (res != NSERROR_OK) {
+		NSLOG(netsurf, INFO, "Invalid URL snapshot");
+		urldb_snapshot_destroy(snap);
+		return res;
+	}
+
+	/* paths held in a previous snapshot must be added before
+	 * it is replaced
+	 */
+	urldb_snapshot_flush();
+	url_snapshot = snap;
+
+	for (idx = 0; idx < snap->host_count; idx++) {
+		const struct urldb_snapshot_host *sh = &snap->hosts[idx];
+		uint32_t path_idx;
+
+		/* skip data that has ended up with a host of '' */
+		if (snap->strings[sh->name] == '\0') {
+			continue;
+		}
+
+		h = urldb_add_host(snap->strings + sh->name);
+		if (h == NULL) {
+			NSLOG(netsurf, INFO, "Failed adding host: '%s'",
+			      snap->strings + sh->name);
+			res = NSERROR_NOMEM;
+			break;
+		}
+		h->hsts.expires = (time_t)sh->hsts_expires;
+		h->hsts.include_sub_domains = sh->hsts_include_sub_domains;
+
+		if (sh->path_count == 0) {
+			continue;
+		}
+
+		if (url_bloom != NULL) {
+			for (path_idx = 0;
+			     path_idx < sh->path_count;
+			     path_idx++) {
+				bloom_insert_hash(url_bloom,
+				    snap->paths[sh->first_path + path_idx].hash);
+			}
+		}
+
+		/* count this record before any previous paths are added
+		 * so the snapshot cannot be released while in use
+		 */
+		snap->pending++;
+
+		if (h->snapshot != NULL) {
+			/* repeated host, add the previous paths now */
+			urldb_snapshot_load_host(h);
+		}
+		h->snapshot = sh;
+		snap->host_entries[idx] = h;
+	}
+
+	if (snap->pending == 0) {
+		urldb_snapshot_destroy(snap);
+		url_snapshot = NULL;
+	}
+
+	if (res == NSERROR_OK) {
+		NSLOG(netsurf, INFO, "Successfully loaded URL snapshot");
+	}
+
+	return res;
+}
+
+
+/**
+ * URL database snapshot output buffer
+ */
+struct urldb_snapshot_buffer {
+	uint8_t *data;	/**< Buffer contents */
+	size_t used;	/**< Number of bytes used */
+	size_t alloc;	/**< Number of bytes allocated */
+};
+
+
+/**
+ * URL database snapshot writer context
+ */
+struct urldb_snapshot_writer {
+	struct urldb_snapshot_buffer hosts; /**< Host records */
+	struct urldb_snapshot_buffer paths; /**< Path records */
+	struct urldb_snapshot_buffer strings; /**< String table */
+
+	uint32_t schemes[8];	/**< Scheme strings already written */
+	unsigned int scheme_count; /**< Number of schemes written */
+
+	time_t expiry;		/**< Expiry time of URLs */
+};
+
+
+/**
+ * Append data to a snapshot output buffer
+ *
+ * \param buf The buffer to append to
+ * \param data The data to append
+ * \param len The length of the data
+ * \param offset Updated with the offset of the data in the buffer
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+urldb_snapshot_append(struct urldb_snapshot_buffer *buf,
+		      const void *data,
+		      size_t len,
+		      uint32_t *offset)
+{
+	if ((buf->used + len) > UINT32_MAX) {
+		return NSERROR_NOSPACE;
+	}
+
+	if ((buf->used + len) > buf->alloc) {
+		size_t alloc = (buf->alloc > 0) ? buf->alloc : 4096;
+		uint8_t *temp;
+
+		while ((buf->used + len) > alloc) {
+			alloc *= 2;
+		}
+
+		temp = realloc(buf->data, alloc);
+		if (temp == NULL) {
+			return NSERROR_NOMEM;
+		}
+		buf->data = temp;
+		buf->alloc = alloc;
+	}
+
+	memcpy(buf->data + buf->used, data, len);
+	if (offset != NULL) {
+		*offset = buf->used;
+	}
+	buf->used += len;
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Add a string to the snapshot string table
+ *
+ * \param w The snapshot writer
+ * \param str The string to add, NULL or empty strings are not stored
+ * \param offset Updated with the offset of the string in the table
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+urldb_snapshot_string(struct urldb_snapshot_writer *w,
+		      const char *str,
+		      uint32_t *offset)
+{
+	if ((str == NULL) || (*str == '\0')) {
+		*offset = 0;
+		return NSERROR_OK;
+	}
+
+	return urldb_snapshot_append(&w->strings, str, strlen(str) + 1, offset);
+}
+
+
+/**
+ * Add a scheme to the snapshot string table
+ *
+ * There are few distinct schemes so each is only stored once.
+ *
+ * \param w The snapshot writer
+ * \param scheme The scheme to add
+ * \param offset Updated with the offset of the string in the table
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+urldb_snapshot_scheme(struct urldb_snapshot_writer *w,
+		      const char *scheme,
+		      uint32_t *offset)
+{
+	unsigned int idx;
+	nserror res;
+
+	for (idx = 0; idx < w->scheme_count; idx++) {
+		if (strcmp((const char *)w->strings.data + w->schemes[idx],
+			   scheme) == 0) {
+			*offset = w->schemes[idx];
+			return NSERROR_OK;
+		}
+	}
+
+	res = urldb_snapshot_string(w, scheme, offset);
+	if ((res == NSERROR_OK) &&
+	    (w->scheme_count < (sizeof(w->schemes) / sizeof(w->schemes[0])))) {
+		w->schemes[w->scheme_count++] = *offset;
+	}
+
+	return res;
+}
+
+
+/**
+ * Write path records for a host whose paths are still in the snapshot
+ *
+ * \param w The snapshot writer
+ * \param sh The snapshot host record
+ * \param count Incremented by the number of path records written
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+urldb_snapshot_write_pending(struct urldb_snapshot_writer *w,
+			     const struct urldb_snapshot_host *sh,
+			     uint32_t *count)
+{
+	const char *strings = url_snapshot->strings;
+	const struct urldb_snapshot_path *sp;
+	struct urldb_snapshot_path rec;
+	uint32_t idx;
+	nserror res;
+
+	for (idx = 0; idx < sh->path_count; idx++) {
+		sp = &url_snapshot->paths[sh->first_path + idx];
+
+		/* loaded entries are never persistent */
+		if ((sp->last_visit <= w->expiry) || (sp->visits == 0)) {
+			continue;
+		}
+
+		rec = *sp;
+		res = urldb_snapshot_scheme(w, strings + sp->scheme,
+					    &rec.scheme);
+		if (res == NSERROR_OK) {
+			res = urldb_snapshot_string(w, strings + sp->path,
+						    &rec.path);
+		}
+		if (res == NSERROR_OK) {
+			res = urldb_snapshot_string(w, strings + sp->title,
+						    &rec.title);
+		}
+		if (res == NSERROR_OK) {
+			res = urldb_snapshot_append(&w->paths, &rec,
+						    sizeof(rec), NULL);
+		}
+		if (res != NSERROR_OK) {
+			return res;
+		}
+		(*count)++;
+	}
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Write path records for a host
+ *
+ * \param w The snapshot writer
+ * \param root Root of the host path tree
+ * \param count Incremented by the number of path records written
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+urldb_snapshot_write_paths(struct urldb_snapshot_writer *w,
+			   const struct path_data *root,
+			   uint32_t *count)
+{
+	const struct path_data *p = root;
+	struct urldb_snapshot_path rec;
+	char *path_query;
+	size_t len;
+	nserror res;
+
+	do {
+		if (p->children != NULL) {
+			/* Drill down into children */
+			p = p->children;
+			continue;
+		}
+
+		/* leaf node */
+		if ((p->url != NULL) &&
+		    (p->persistent ||
+		     ((p->urld.last_visit > w->expiry) &&
+		      (p->urld.visits > 0)))) {
+			memset(&rec, 0, sizeof(rec));
+			rec.port = p->port;
+			rec.visits = p->urld.visits;
+			rec.type = p->urld.type;
+			rec.hash = nsurl_hash(p->url);
+			rec.last_visit = p->urld.last_visit;
+
+			res = nsurl_get(p->url, NSURL_PATH | NSURL_QUERY,
+					&path_query, &len);
+			if (res != NSERROR_OK) {
+				return res;
+			}
+			res = urldb_snapshot_string(w, path_query, &rec.path);
+			free(path_query);
+
+			if (res == NSERROR_OK) {
+				res = urldb_snapshot_scheme(w,
+						lwc_string_data(p->scheme),
+						&rec.scheme);
+			}
+			if (res == NSERROR_OK) {
+				res = urldb_snapshot_string(w, p->urld.title,
+							    &rec.title);
+			}
+			if (res == NSERROR_OK) {
+				res = urldb_snapshot_append(&w->paths, &rec,
+							    sizeof(rec), NULL);
+			}
+			if (res != NSERROR_OK) {
+				return res;
+			}
+			(*count)++;
+		}
+
+		/* Now, find next node to process. */
+		while (p != root) {
+			if (p->next != NULL) {
+				/* Have a sibling, process that */
+				p = p->next;
+				break;
+			}
+
+			/* Ascend tree */
+			p = p->parent;
+		}
+	} while (p != root);
+
+	return NSERROR_OK;
+}
+
+
+/**
+ * Write snapshot records for a search (sub)tree
+ *
+ * \param w The snapshot writer
+ * \param parent root node of search tree to write
+ * \return NSERROR_OK on success else error code.
+ */
+static nserror
+urldb_snapshot_write_tree(struct urldb_snapshot_writer *w,
+			  struct search_node *parent)
+{
+	const struct host_part *h = parent->data;
+	struct urldb_snapshot_host rec;
+	char host[256];
+	size_t strings_used;
+	nserror res;
+
+	if (parent == &empty) {
+		return NSERROR_OK;
+	}
+
+	res = urldb_snapshot_write_tree(w, parent->left);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	if (!urldb_host_name(h, host, sizeof host)) {
+		return NSERROR_INVALID;
+	}
+
+	memset(&rec, 0, sizeof(rec));
+	if (h->hsts.expires > w->expiry) {
+		rec.hsts_expires = h->hsts.expires;
+		rec.hsts_include_sub_domains = h->hsts.include_sub_domains;
+	}
+
+	strings_used = w->strings.used;
+	res = urldb_snapshot_string(w, host, &rec.name);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	rec.first_path = w->paths.used / sizeof(struct urldb_snapshot_path);
+	if (h->snapshot != NULL) {
+		/* copy paths directly from the loaded snapshot */
+		res = urldb_snapshot_write_pending(w, h->snapshot,
+						   &rec.path_count);
+	} else {
+		res = urldb_snapshot_write_paths(w, &h->paths,
+						 &rec.path_count);
+	}
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	if ((rec.path_count > 0) || (rec.hsts_expires != 0)) {
+		res = urldb_snapshot_append(&w->hosts, &rec, sizeof(rec), NULL);
+		if (res != NSERROR_OK) {
+			return res;
+		}
+	} else {
+		/* host not written so drop its name */
+		w->strings.used = strings_used;
+	}
+
+	return urldb_snapshot_write_tree(w, parent->right);
+}
+
+
 /*************** External interface ***************/
 
 
@@ -2867,6 +3726,10 @@ void urldb_destroy(void)
 	}
 	memset(&db_root, 0, sizeof(db_root));
 
+	/* And any snapshot the remaining paths were held in */
+	urldb_snapshot_destroy(url_snapshot);
+	url_snapshot = NULL;
+
 	/* And the bloom filter */
 	if (url_bloom != NULL) {
 		bloom_destroy(url_bloom);
@@ -2902,6 +3765,13 @@ nserror urldb_load(const char *filename)
 		return NSERROR_NOT_FOUND;
 	}
 
+	if ((fread(s, 1, URL_SNAPSHOT_MAGIC_LEN, fp) ==
+	     URL_SNAPSHOT_MAGIC_LEN) &&
+	    (memcmp(s, URL_SNAPSHOT_MAGIC, URL_SNAPSHOT_MAGIC_LEN) == 0)) {
+		return urldb_snapshot_load(fp);
+	}
+	rewind(fp);
+
 	if (!fgets(s, MAXIMUM_URL_LENGTH, fp)) {
 		fclose(fp);
 		return NSERROR_NEED_DATA;
@@ -2974,13 +3844,7 @@ nserror urldb_load(const char *filename)
 		for (i = 0; i < urls; i++) {
 			struct path_data *p = NULL;
 			char scheme[64], ports[10];
-			char url[64 + 3 + 256 + 6 + 4096 + 1 + 1];
 			unsigned int port;
-			bool is_file = false;
-			nsurl *nsurl;
-			lwc_string *scheme_lwc, *fragment_lwc;
-			char *path_query;
-			size_t len;
 
 			if (!fgets(scheme, sizeof scheme, fp))
 				break;
@@ -2998,59 +3862,16 @@ nserror urldb_load(const char *filename)
 			length = strlen(s) - 1;
 			s[length] = '\0';
 
-			if (!strcasecmp(host, "localhost") &&
-			    !strcasecmp(scheme, "file"))
-				is_file = true;
-
-			snprintf(url, sizeof url, "%s://%s%s%s%s",
-				 scheme,
-				 /* file URLs have no host */
-				 (is_file ? "" : host),
-				 (port ? ":" : ""),
-				 (port ? ports : ""),
-				 s);
-
 			/* TODO: store URLs in pre-parsed state, and make
 			 *       a nsurl_load to generate the nsurl more
 			 *       swiftly.
 			 *       Need a nsurl_save too.
 			 */
-			if (nsurl_create(url, &nsurl) != NSERROR_OK) {
-				NSLOG(netsurf, INFO, "Failed inserting '%s'",
-				      url);
-				fclose(fp);
-				return NSERROR_NOMEM;
-			}
-
-			if (url_bloom != NULL) {
-				uint32_t hash = nsurl_hash(nsurl);
-				bloom_insert_hash(url_bloom, hash);
-			}
-
-			/* Copy and merge path/query strings */
-			if (nsurl_get(nsurl, NSURL_PATH | NSURL_QUERY,
-				      &path_query, &len) != NSERROR_OK) {
-				NSLOG(netsurf, INFO, "Failed inserting '%s'",
-				      url);
-				fclose(fp);
-				return NSERROR_NOMEM;
-			}
-
-			scheme_lwc = nsurl_get_component(nsurl, NSURL_SCHEME);
-			fragment_lwc = nsurl_get_component(nsurl,
-							   NSURL_FRAGMENT);
-			p = urldb_add_path(scheme_lwc, port, h, path_query,
-					   fragment_lwc, nsurl);
+			p = urldb_load_url(h, host, scheme, port, s);
 			if (!p) {
-				NSLOG(netsurf, INFO, "Failed inserting '%s'",
-				      url);
 				fclose(fp);
 				return NSERROR_NOMEM;
 			}
-			nsurl_unref(nsurl);
-			lwc_string_unref(scheme_lwc);
-			if (fragment_lwc != NULL)
-				lwc_string_unref(fragment_lwc);
 
 			if (!fgets(s, MAXIMUM_URL_LENGTH, fp))
 				break;
@@ -3121,6 +3942,115 @@ nserror urldb_save(const char *filename)
 }
 
 
+/* exported interface documented in netsurf/url_db.h */
+nserror urldb_load_with_snapshot(const char *filename, const char *snapshot)
+{
+	struct stat text_sb;
+	struct stat snap_sb;
+	nserror res;
+
+	assert(filename);
+	assert(snapshot);
+
+	if ((stat(snapshot, &snap_sb) == 0) &&
+	    ((stat(filename, &text_sb) != 0) ||
+	     (snap_sb.st_mtime >= text_sb.st_mtime))) {
+		res = urldb_load(snapshot);
+		if (res == NSERROR_OK) {
+			return res;
+		}
+		NSLOG(netsurf, INFO, "Unable to load URL snapshot %s", snapshot);
+	}
+
+	return urldb_load(filename);
+}
+
+
+/* exported interface documented in netsurf/url_db.h */
+nserror urldb_save_snapshot(const char *filename)
+{
+	struct urldb_snapshot_writer w;
+	struct urldb_snapshot_header hdr;
+	char *tmpname;
+	FILE *fp;
+	nserror res;
+	int i;
+
+	assert(filename);
+
+	memset(&w, 0, sizeof(w));
+	w.expiry = time(NULL) - ((60 * 60 * 24) * nsoption_int(expire_url));
+
+	/* offset zero is the empty string */
+	res = urldb_snapshot_append(&w.strings, "", 1, NULL);
+
+	for (i = 0; (res == NSERROR_OK) && (i != NUM_SEARCH_TREES); i++) {
+		res = urldb_snapshot_write_tree(&w, search_trees[i]);
+	}
+
+	if (res != NSERROR_OK) {
+		NSLOG(netsurf, INFO, "Failed to generate URL snapshot");
+		goto out;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, URL_SNAPSHOT_MAGIC, URL_SNAPSHOT_MAGIC_LEN);
+	hdr.version = URL_SNAPSHOT_VERSION;
+	hdr.endian = URL_SNAPSHOT_ENDIAN;
+	hdr.host_count = w.hosts.used / sizeof(struct urldb_snapshot_host);
+	hdr.path_count = w.paths.used / sizeof(struct urldb_snapshot_path);
+	hdr.string_size = w.strings.used;
+
+	/* the file being replaced may still be mapped so the snapshot
+	 * is written to a new file which is then renamed over it.
+	 */
+	tmpname = malloc(strlen(filename) + 5);
+	if (tmpname == NULL) {
+		res = NSERROR_NOMEM;
+		goto out;
+	}
+	sprintf(tmpname, "%s.tmp", filename);
+
+	fp = fopen(tmpname, "wb");
+	if (!fp) {
+		NSLOG(netsurf, INFO, "Failed to open file '%s' for writing",
+		      tmpname);
+		free(tmpname);
+		res = NSERROR_SAVE_FAILED;
+		goto out;
+	}
+
+	if ((fwrite(&hdr, sizeof(hdr), 1, fp) != 1) ||
+	    (fwrite(w.hosts.data, 1, w.hosts.used, fp) != w.hosts.used) ||
+	    (fwrite(w.paths.data, 1, w.paths.used, fp) != w.paths.used) ||
+	    (fwrite(w.strings.data, 1, w.strings.used, fp) != w.strings.used)) {
+		res = NSERROR_SAVE_FAILED;
+	}
+
+	if ((fclose(fp) != 0) && (res == NSERROR_OK)) {
+		res = NSERROR_SAVE_FAILED;
+	}
+
+	if ((res == NSERROR_OK) && (rename(tmpname, filename) != 0)) {
+		NSLOG(netsurf, INFO, "Failed to rename '%s' to '%s'",
+		      tmpname, filename);
+		res = NSERROR_SAVE_FAILED;
+	}
+
+	if (res != NSERROR_OK) {
+		remove(tmpname);
+	}
+	free(tmpname);
+
+out:
+	free(w.hosts.data);
+	free(w.paths.data);
+	free(w.strings.data);
+
+	return res;
+}
+
+
 /* exported interface documented in content/urldb.h */
 nserror urldb_set_url_persistence(nsurl *url, bool persist)
 {
@@ -3675,7 +4605,7 @@ urldb_iterate_partial(const char *prefix,
 				return;
 		}
 
-		if (h->paths.children) {
+		if (urldb_host_paths(h)->children) {
 			/* Have paths, iterate them */
 			urldb_iterate_partial_path(&h->paths, slash + 1,
 						   callback);
@@ -217,6 +217,16 @@ NSOPTION_UINT(curl_fetch_timeout, 30)
 /** Suppress debug output from cURL. */
 NSOPTION_BOOL(suppress_curl_debug, true)
 
+/** Negotiate HTTP/2 with servers that support it, allowing fetches
+ * from the same host to share a connection.
+ */
+NSOPTION_BOOL(enable_http2, false)
+
+/** Maximum simultaneous active fetchers per host once they are
+ * multiplexed on a shared HTTP/2 connection.
+ */
+NSOPTION_INTEGER(max_streams_per_host, 32)
+
 /** Whether to allow target="_blank" */
 NSOPTION_BOOL(target_blank, true)
 
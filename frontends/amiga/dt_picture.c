@@ -244,7 +244,7 @@ bool amiga_dt_picture_convert(struct content *c)
 		free(filetype);
 	}
 	
-	image_cache_add(c, NULL, amiga_dt_picture_cache_convert);
+	image_cache_add(c, NULL, amiga_dt_picture_cache_convert, NULL);
 
 	content_set_ready(c);
 	content_set_done(c);
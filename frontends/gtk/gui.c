@@ -189,6 +189,13 @@ static nserror set_defaults(struct nsoption_s *defaults)
 		nsoption_setnull_charp(url_file, fname);
 	}
 
+	/* url database snapshot default */
+	fname = NULL;
+	netsurf_mkpath(&fname, NULL, 2, nsgtk_config_home, "URLs.snapshot");
+	if (fname != NULL) {
+		nsoption_setnull_charp(url_snapshot_file, fname);
+	}
+
 	/* bookmark database default */
 	fname = NULL;
 	netsurf_mkpath(&fname, NULL, 2, nsgtk_config_home, "Hotlist");
@@ -205,6 +212,7 @@ static nserror set_defaults(struct nsoption_s *defaults)
 	if ((nsoption_charp(cookie_file) == NULL) ||
 	    (nsoption_charp(cookie_jar) == NULL) ||
 	    (nsoption_charp(url_file) == NULL) ||
+	    (nsoption_charp(url_snapshot_file) == NULL) ||
 	    (nsoption_charp(hotlist_path) == NULL) ||
 	    (nsoption_charp(downloads_directory) == NULL)) {
 		NSLOG(netsurf, INFO,
@@ -412,7 +420,8 @@ static nserror nsgtk_init(int argc, char** argv, char **respath)
 
 	save_complete_init();
 
-	urldb_load(nsoption_charp(url_file));
+	urldb_load_with_snapshot(nsoption_charp(url_file),
+				 nsoption_charp(url_snapshot_file));
 	urldb_load_cookies(nsoption_charp(cookie_file));
 	hotlist_init(nsoption_charp(hotlist_path),
 		     nsoption_charp(hotlist_path));
@@ -547,6 +556,7 @@ static void gui_quit(void)
 	nsgtk_download_destroy();
 	urldb_save_cookies(nsoption_charp(cookie_jar));
 	urldb_save(nsoption_charp(url_file));
+	urldb_save_snapshot(nsoption_charp(url_snapshot_file));
 
 	res = nsgtk_cookies_destroy();
 	if (res != NSERROR_OK) {
@@ -1176,6 +1186,7 @@ static nserror nsgtk_option_init(int *pargc, char** argv)
 
 static struct gui_misc_table nsgtk_misc_table = {
 	.schedule = nsgtk_schedule,
+	.fd_watch = nsgtk_fd_watch,
 
 	.quit = gui_quit,
 	.launch_url = gui_launch_url,
@@ -35,6 +35,9 @@ NSOPTION_STRING(downloads_directory, NULL)
 /* where to store URL database */
 NSOPTION_STRING(url_file, NULL)
 
+/* where to store URL database snapshot for fast loading */
+NSOPTION_STRING(url_snapshot_file, NULL)
+
 /* Always show tabs even if there is only one */
 NSOPTION_BOOL(show_single_tab, false)
 
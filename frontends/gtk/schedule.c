@@ -22,6 +22,7 @@
 
 #include "utils/errors.h"
 #include "utils/log.h"
+#include "netsurf/misc.h"
 
 #include "gtk/schedule.h"
 
@@ -150,3 +151,98 @@ schedule_run(void)
         }
 	return true;
 }
+
+
+/** File descriptor watch record. */
+typedef struct {
+        guint source;                   /**< The glib event source. */
+        void (*callback)(int fd, unsigned int events, void *p);
+        void *context;                  /**< The context for the callback. */
+} _nsgtk_fd_watch_t;
+
+/** Watches keyed by file descriptor. */
+static GHashTable *fd_watches = NULL;
+
+static void
+nsgtk_fd_watch_destroy(gpointer data)
+{
+        _nsgtk_fd_watch_t *watch = (_nsgtk_fd_watch_t *)data;
+
+        g_source_remove(watch->source);
+        free(watch);
+}
+
+static gboolean
+nsgtk_fd_watch_callback(GIOChannel *source, GIOCondition condition,
+                        gpointer data)
+{
+        _nsgtk_fd_watch_t *watch = (_nsgtk_fd_watch_t *)data;
+        int fd = g_io_channel_unix_get_fd(source);
+        unsigned int events = 0;
+
+        if ((condition & (G_IO_IN | G_IO_HUP)) != 0) {
+                events |= GUI_FD_READ;
+        }
+        if ((condition & G_IO_OUT) != 0) {
+                events |= GUI_FD_WRITE;
+        }
+        if ((condition & G_IO_ERR) != 0) {
+                events |= GUI_FD_ERROR;
+        }
+
+        /* the callback may replace or remove this watch */
+        watch->callback(fd, events, watch->context);
+
+        return TRUE;
+}
+
+/* exported interface documented in gtk/schedule.h */
+nserror
+nsgtk_fd_watch(int fd,
+               unsigned int events,
+               void (*callback)(int fd, unsigned int events, void *p),
+               void *p)
+{
+        _nsgtk_fd_watch_t *watch;
+        GIOChannel *channel;
+        GIOCondition condition = G_IO_ERR | G_IO_HUP;
+
+        if (fd_watches == NULL) {
+                fd_watches = g_hash_table_new_full(g_direct_hash,
+                                                   g_direct_equal,
+                                                   NULL,
+                                                   nsgtk_fd_watch_destroy);
+        }
+
+        /* Remove any existing watch on this descriptor. */
+        g_hash_table_remove(fd_watches, GINT_TO_POINTER(fd));
+
+        /* only removal */
+        if (events == 0) {
+                return NSERROR_OK;
+        }
+
+        if ((events & GUI_FD_READ) != 0) {
+                condition |= G_IO_IN;
+        }
+        if ((events & GUI_FD_WRITE) != 0) {
+                condition |= G_IO_OUT;
+        }
+
+        watch = malloc(sizeof(_nsgtk_fd_watch_t));
+        if (watch == NULL) {
+                return NSERROR_NOMEM;
+        }
+        watch->callback = callback;
+        watch->context = p;
+
+        channel = g_io_channel_unix_new(fd);
+        watch->source = g_io_add_watch(channel, condition,
+                                       nsgtk_fd_watch_callback, watch);
+        /* the watch holds a reference to the channel */
+        g_io_channel_unref(channel);
+
+        g_hash_table_insert(fd_watches, GINT_TO_POINTER(fd), watch);
+
+        return NSERROR_OK;
+}
@@ -23,4 +23,17 @@ nserror nsgtk_schedule(int t, void (*callback)(void *p), void *p);
 
 bool schedule_run(void);
 
+/**
+ * Watch a file descriptor for readiness from the glib main loop.
+ *
+ * \param fd The file descriptor to watch.
+ * \param events Bitmask of gui_fd_event to wait for or 0 to stop watching.
+ * \param callback Function called when the descriptor is ready.
+ * \param p user parameter, passed to callback function
+ * \return NSERROR_OK on success or appropriate error code.
+ */
+nserror nsgtk_fd_watch(int fd, unsigned int events,
+		void (*callback)(int fd, unsigned int events, void *p),
+		void *p);
+
 #endif /* NETSURF_GTK_CALLBACK_H */
@@ -32,6 +32,8 @@ struct bitmap {
 	int width;
 	int height;
 	unsigned int state;
+	bool mean_valid; /**< mean holds the current channel means */
+	unsigned int mean[4]; /**< mean of each channel */
 };
 
 static void *bitmap_create(int width, int height, unsigned int state)
@@ -111,6 +113,7 @@ static void bitmap_modified(void *bitmap)
 {
 	struct bitmap *bmap = bitmap;
 	bmap->state |= BITMAP_MODIFIED;
+	bmap->mean_valid = false;
 }
 
 static int bitmap_get_width(void *bitmap)
@@ -132,6 +135,42 @@ static nserror bitmap_render(struct bitmap *bitmap,
 	return NSERROR_OK;
 }
 
+/* exported interface documented in monkey/bitmap.h */
+void monkey_bitmap_get_mean(struct bitmap *bitmap, unsigned int mean[4])
+{
+	unsigned long long sum[4] = { 0, 0, 0, 0 };
+	unsigned char *pixel;
+	int x, y, chan;
+
+	if (!bitmap->mean_valid) {
+		for (y = 0; y < bitmap->height; y++) {
+			pixel = (unsigned char *)bitmap->ptr +
+				(bitmap_get_rowstride(bitmap) * y);
+			for (x = 0; x < bitmap->width; x++) {
+				for (chan = 0; chan < 4; chan++) {
+					sum[chan] += pixel[chan];
+				}
+				pixel += 4;
+			}
+		}
+
+		for (chan = 0; chan < 4; chan++) {
+			if ((bitmap->width > 0) && (bitmap->height > 0)) {
+				bitmap->mean[chan] = sum[chan] /
+					((unsigned long long)bitmap->width *
+					 bitmap->height);
+			} else {
+				bitmap->mean[chan] = 0;
+			}
+		}
+		bitmap->mean_valid = true;
+	}
+
+	for (chan = 0; chan < 4; chan++) {
+		mean[chan] = bitmap->mean[chan];
+	}
+}
+
 static struct gui_bitmap_table bitmap_table = {
 	.create = bitmap_create,
 	.destroy = bitmap_destroy,
@@ -19,6 +19,20 @@
 #ifndef NS_MONKEY_BITMAP_H
 #define NS_MONKEY_BITMAP_H
 
+struct bitmap;
+
 extern struct gui_bitmap_table *monkey_bitmap_table;
 
+/**
+ * Get the mean value of each channel of a bitmap
+ *
+ * This allows tests to check the decoded content of plotted
+ * bitmaps. The mean is computed once and kept until the bitmap is
+ * next marked modified.
+ *
+ * \param bitmap The bitmap to examine
+ * \param mean Updated with the mean red, green, blue and alpha values
+ */
+void monkey_bitmap_get_mean(struct bitmap *bitmap, unsigned int mean[4]);
+
 #endif /* NS_MONKEY_BITMAP_H */
@@ -697,6 +697,26 @@ monkey_window_handle_click(int argc, char **argv)
 	}
 }
 
+static void
+monkey_window_handle_resize(int argc, char **argv)
+{
+	struct gui_window *gw;
+	if (argc != 8) {
+		moutf(MOUT_ERROR, "WINDOW RESIZE ARGS BAD");
+		return;
+	}
+
+	gw = monkey_find_window_by_num(atoi(argv[3]));
+
+	if (gw == NULL) {
+		moutf(MOUT_ERROR, "WINDOW NUM BAD");
+	} else {
+		gw->width = atoi(argv[5]);
+		gw->height = atoi(argv[7]);
+		browser_window_schedule_reformat(gw->bw);
+	}
+}
+
 void
 monkey_window_handle_command(int argc, char **argv)
 {
@@ -719,6 +739,8 @@ monkey_window_handle_command(int argc, char **argv)
 		monkey_window_handle_exec(argc, argv);
 	} else if (strcmp(argv[1], "CLICK") == 0) {
 		monkey_window_handle_click(argc, argv);
+	} else if (strcmp(argv[1], "RESIZE") == 0) {
+		monkey_window_handle_resize(argc, argv);
 	} else {
 		moutf(MOUT_ERROR, "WINDOW COMMAND UNKNOWN %s\n", argv[1]);
 	}
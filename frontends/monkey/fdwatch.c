@@ -0,0 +1,238 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * File descriptor readiness watches using epoll.
+ *
+ * The epoll descriptor is added to the select set of the main loop
+ * and becomes readable when any watched descriptor is ready.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "utils/errors.h"
+#include "utils/log.h"
+#include "netsurf/misc.h"
+
+#include "monkey/fdwatch.h"
+
+#ifdef MONKEY_FD_WATCH
+
+#include <sys/epoll.h>
+
+/** maximum number of events processed in one run */
+#define MAX_EVENTS 64
+
+/**
+ * watched file descriptor
+ */
+struct fd_watch {
+	unsigned int events; /**< events being waited for, 0 if unused */
+	void (*callback)(int fd, unsigned int events, void *p);
+	void *p;
+};
+
+/** epoll descriptor */
+static int watch_epfd = -1;
+
+/** watches indexed by file descriptor */
+static struct fd_watch *watches = NULL;
+
+/** number of entries in watches */
+static int watch_count = 0;
+
+/**
+ * ensure there is a watch entry for a descriptor
+ */
+static nserror ensure_watch(int fd)
+{
+	struct fd_watch *nwatches;
+	int ncount;
+
+	if (fd < watch_count) {
+		return NSERROR_OK;
+	}
+
+	ncount = fd + 16;
+	nwatches = realloc(watches, ncount * sizeof(struct fd_watch));
+	if (nwatches == NULL) {
+		return NSERROR_NOMEM;
+	}
+	memset(nwatches + watch_count, 0,
+	       (ncount - watch_count) * sizeof(struct fd_watch));
+
+	watches = nwatches;
+	watch_count = ncount;
+
+	return NSERROR_OK;
+}
+
+/* exported interface documented in monkey/fdwatch.h */
+nserror
+monkey_fd_watch(int fd,
+		unsigned int events,
+		void (*callback)(int fd, unsigned int events, void *p),
+		void *p)
+{
+	struct epoll_event ev;
+	nserror res;
+	int op;
+
+	if (fd < 0) {
+		return NSERROR_BAD_PARAMETER;
+	}
+
+	if (events == 0) {
+		if ((fd < watch_count) && (watches[fd].events != 0)) {
+			/* the descriptor may already have been closed */
+			epoll_ctl(watch_epfd, EPOLL_CTL_DEL, fd, NULL);
+			watches[fd].events = 0;
+		}
+		return NSERROR_OK;
+	}
+
+	if (watch_epfd == -1) {
+		watch_epfd = epoll_create1(EPOLL_CLOEXEC);
+		if (watch_epfd == -1) {
+			NSLOG(netsurf, ERROR, "Unable to create epoll: %s",
+			      strerror(errno));
+			return NSERROR_INIT_FAILED;
+		}
+	}
+
+	res = ensure_watch(fd);
+	if (res != NSERROR_OK) {
+		return res;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	if ((events & GUI_FD_READ) != 0) {
+		ev.events |= EPOLLIN;
+	}
+	if ((events & GUI_FD_WRITE) != 0) {
+		ev.events |= EPOLLOUT;
+	}
+	ev.data.fd = fd;
+
+	op = (watches[fd].events != 0) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	if (epoll_ctl(watch_epfd, op, fd, &ev) == -1) {
+		if ((op == EPOLL_CTL_ADD) && (errno == EEXIST)) {
+			op = EPOLL_CTL_MOD;
+		} else if ((op == EPOLL_CTL_MOD) && (errno == ENOENT)) {
+			/* descriptor number was closed and reused */
+			op = EPOLL_CTL_ADD;
+		} else {
+			return NSERROR_INVALID;
+		}
+		if (epoll_ctl(watch_epfd, op, fd, &ev) == -1) {
+			return NSERROR_INVALID;
+		}
+	}
+
+	watches[fd].events = events;
+	watches[fd].callback = callback;
+	watches[fd].p = p;
+
+	return NSERROR_OK;
+}
+
+/* exported interface documented in monkey/fdwatch.h */
+int monkey_fd_watch_fd(void)
+{
+	return watch_epfd;
+}
+
+/* exported interface documented in monkey/fdwatch.h */
+void monkey_fd_watch_run(void)
+{
+	struct epoll_event evs[MAX_EVENTS];
+	unsigned int events;
+	int count;
+	int idx;
+	int fd;
+
+	count = epoll_wait(watch_epfd, evs, MAX_EVENTS, 0);
+
+	for (idx = 0; idx < count; idx++) {
+		fd = evs[idx].data.fd;
+
+		/* an earlier callback may have removed this watch */
+		if ((fd >= watch_count) || (watches[fd].events == 0)) {
+			continue;
+		}
+
+		events = 0;
+		if ((evs[idx].events & (EPOLLIN | EPOLLHUP)) != 0) {
+			events |= GUI_FD_READ;
+		}
+		if ((evs[idx].events & EPOLLOUT) != 0) {
+			events |= GUI_FD_WRITE;
+		}
+		if ((evs[idx].events & EPOLLERR) != 0) {
+			events |= GUI_FD_ERROR;
+		}
+
+		watches[fd].callback(fd, events, watches[fd].p);
+	}
+}
+
+/* exported interface documented in monkey/fdwatch.h */
+void monkey_fd_watch_finalise(void)
+{
+	if (watch_epfd != -1) {
+		close(watch_epfd);
+		watch_epfd = -1;
+	}
+	free(watches);
+	watches = NULL;
+	watch_count = 0;
+}
+
+#else
+
+/* exported interface documented in monkey/fdwatch.h */
+nserror
+monkey_fd_watch(int fd,
+		unsigned int events,
+		void (*callback)(int fd, unsigned int events, void *p),
+		void *p)
+{
+	return NSERROR_NOT_IMPLEMENTED;
+}
+
+/* exported interface documented in monkey/fdwatch.h */
+int monkey_fd_watch_fd(void)
+{
+	return -1;
+}
+
+/* exported interface documented in monkey/fdwatch.h */
+void monkey_fd_watch_run(void)
+{
+}
+
+/* exported interface documented in monkey/fdwatch.h */
+void monkey_fd_watch_finalise(void)
+{
+}
+
+#endif
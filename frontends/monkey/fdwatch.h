@@ -0,0 +1,57 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NETSURF_MONKEY_FDWATCH_H
+#define NETSURF_MONKEY_FDWATCH_H
+
+#ifdef __linux__
+/** File descriptor watches are available */
+#define MONKEY_FD_WATCH 1
+#endif
+
+/**
+ * Watch a file descriptor for readiness.
+ *
+ * \param fd The file descriptor to watch.
+ * \param events Bitmask of gui_fd_event to wait for or 0 to stop watching.
+ * \param callback Function called when the descriptor is ready.
+ * \param p user parameter, passed to callback function
+ * \return NSERROR_OK on success or appropriate error code.
+ */
+nserror monkey_fd_watch(int fd, unsigned int events,
+			void (*callback)(int fd, unsigned int events, void *p),
+			void *p);
+
+/**
+ * Get the descriptor which becomes readable when watches are ready.
+ *
+ * @return The descriptor or -1 if nothing is being watched.
+ */
+int monkey_fd_watch_fd(void);
+
+/**
+ * Call the callbacks of all ready watched descriptors.
+ */
+void monkey_fd_watch_run(void);
+
+/**
+ * Remove all watches and release resources.
+ */
+void monkey_fd_watch_finalise(void);
+
+#endif
@@ -46,6 +46,7 @@
 #include "monkey/filetype.h"
 #include "monkey/fetch.h"
 #include "monkey/schedule.h"
+#include "monkey/fdwatch.h"
 #include "monkey/bitmap.h"
 #include "monkey/layout.h"
 
@@ -196,6 +197,7 @@ static void monkey_quit(void)
 {
 	urldb_save_cookies(nsoption_charp(cookie_jar));
 	urldb_save(nsoption_charp(url_file));
+	urldb_save_snapshot(nsoption_charp(url_snapshot_file));
 	monkey_fetch_filetype_fin();
 }
 
@@ -227,6 +229,8 @@ static nserror set_defaults(struct nsoption_s *defaults)
 	nsoption_setnull_charp(cookie_file, strdup("~/.netsurf/Cookies"));
 	nsoption_setnull_charp(cookie_jar, strdup("~/.netsurf/Cookies"));
 	nsoption_setnull_charp(url_file, strdup("~/.netsurf/URLs"));
+	nsoption_setnull_charp(url_snapshot_file,
+			       strdup("~/.netsurf/URLs.snapshot"));
 
 	return NSERROR_OK;
 }
@@ -245,6 +249,9 @@ static bool nslog_stream_configure(FILE *fptr)
 
 static struct gui_misc_table monkey_misc_table = {
 	.schedule = monkey_schedule,
+#ifdef MONKEY_FD_WATCH
+	.fd_watch = monkey_fd_watch,
+#endif
 
 	.quit = monkey_quit,
 	.launch_url = gui_launch_url,
@@ -257,6 +264,7 @@ static void monkey_run(void)
 	fd_set read_fd_set, write_fd_set, exc_fd_set;
 	int max_fd;
 	int rdy_fd;
+	int watch_fd;
 	int schedtm;
 	struct timeval tv;
 	struct timeval* timeout;
@@ -276,6 +284,15 @@ static void monkey_run(void)
 		FD_SET(0, &read_fd_set);
 		FD_SET(0, &exc_fd_set);
 
+		/* add watched descriptors to the set */
+		watch_fd = monkey_fd_watch_fd();
+		if (watch_fd >= 0) {
+			FD_SET(watch_fd, &read_fd_set);
+			if (watch_fd > max_fd) {
+				max_fd = watch_fd;
+			}
+		}
+
 		/* setup timeout */
 		switch (schedtm) {
 		case -1:
@@ -309,6 +326,9 @@ static void monkey_run(void)
 			NSLOG(netsurf, CRITICAL, "Unable to select: %s", strerror(errno));
 			monkey_done = true;
 		} else if (rdy_fd > 0) {
+			if ((watch_fd >= 0) && FD_ISSET(watch_fd, &read_fd_set)) {
+				monkey_fd_watch_run();
+			}
 			if (FD_ISSET(0, &read_fd_set)) {
 				monkey_process_command();
 			}
@@ -401,7 +421,8 @@ main(int argc, char **argv)
 	filepath_sfinddef(respaths, buf, "mime.types", "/etc/");
 	monkey_fetch_filetype_init(buf);
 
-	urldb_load(nsoption_charp(url_file));
+	urldb_load_with_snapshot(nsoption_charp(url_file),
+				 nsoption_charp(url_snapshot_file));
 	urldb_load_cookies(nsoption_charp(cookie_file));
 
 	/* Free resource paths now we're done finding resources */
@@ -443,6 +464,7 @@ main(int argc, char **argv)
 	monkey_kill_browser_windows();
 
 	netsurf_exit();
+	monkey_fd_watch_finalise();
 	moutf(MOUT_GENERIC, "FINISHED");
 
 	/* finalise options */
@@ -21,8 +21,10 @@
 #include "utils/utils.h"
 #include "utils/errors.h"
 #include "netsurf/plotters.h"
+#include "netsurf/bitmap.h"
 
 #include "monkey/output.h"
+#include "monkey/bitmap.h"
 
 /**
  * \brief Sets a clip rectangle for subsequent plot operations.
@@ -220,8 +222,17 @@ monkey_plot_bitmap(const struct redraw_context *ctx,
 		   colour bg,
 		   bitmap_flags_t flags)
 {
-	moutf(MOUT_PLOT, "BITMAP X %d Y %d WIDTH %d HEIGHT %d",
-	      x, y, width, height);
+	unsigned int mean[4];
+
+	monkey_bitmap_get_mean(bitmap, mean);
+
+	moutf(MOUT_PLOT, "BITMAP X %d Y %d WIDTH %d HEIGHT %d "
+	      "SOURCE_WIDTH %d SOURCE_HEIGHT %d "
+	      "MEAN_RED %u MEAN_GREEN %u MEAN_BLUE %u MEAN_ALPHA %u",
+	      x, y, width, height,
+	      monkey_bitmap_table->get_width(bitmap),
+	      monkey_bitmap_table->get_height(bitmap),
+	      mean[0], mean[1], mean[2], mean[3]);
 	return NSERROR_OK;
 }
 
@@ -30,6 +30,15 @@ struct gui_window;
 struct ssl_cert_info;
 struct nsurl;
 
+/**
+ * File descriptor readiness events.
+ */
+enum gui_fd_event {
+	GUI_FD_READ = 1, /**< Descriptor is readable */
+	GUI_FD_WRITE = 2, /**< Descriptor is writable */
+	GUI_FD_ERROR = 4, /**< Descriptor has an error condition */
+};
+
 /**
  * Graphical user interface browser misc function table.
  *
@@ -132,6 +141,29 @@ struct gui_misc_table {
 	 */
 	void (*pdf_password)(char **owner_pass, char **user_pass, char *path);
 
+	/**
+	 * Watch a file descriptor for readiness.
+	 *
+	 * Fetchers which are driven by network activity register
+	 * their sockets here instead of being polled. A further call
+	 * for the same descriptor replaces the previous watch. Error
+	 * conditions are always reported.
+	 *
+	 * If this entry is not provided fetchers are polled and their
+	 * descriptors are available through fetch_fdset().
+	 *
+	 * \param fd The file descriptor to watch.
+	 * \param events Bitmask of ::gui_fd_event to wait for or 0 to
+	 *               stop watching the descriptor.
+	 * \param callback Function called with the descriptor and the
+	 *                 events it is ready for.
+	 * \param p user parameter passed to callback function
+	 * \return NSERROR_OK on sucess or appropriate error on faliure
+	 */
+	nserror (*fd_watch)(int fd, unsigned int events,
+			    void (*callback)(int fd, unsigned int events, void *p),
+			    void *p);
+
 };
 
 #endif
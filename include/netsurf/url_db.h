@@ -44,11 +44,29 @@ struct url_data {
 /**
  * Import an URL database from file, replacing any existing database
  *
+ * The file may either be in the text format written by urldb_save()
+ * or a snapshot written by urldb_save_snapshot().
+ *
  * \param filename Name of file containing data
  */
 nserror urldb_load(const char *filename);
 
 
+/**
+ * Import an URL database, preferring an up to date snapshot
+ *
+ * The text format file remains the database shared with older
+ * versions and other frontends, a snapshot is saved alongside it.
+ * The snapshot is only loaded when it is at least as recent as the
+ * text file, so history saved by a version which does not write
+ * snapshots is picked up from the text file.
+ *
+ * \param filename Name of text format file containing data
+ * \param snapshot Name of snapshot file
+ */
+nserror urldb_load_with_snapshot(const char *filename, const char *snapshot);
+
+
 /**
  * Export the current database to file
  *
@@ -57,6 +75,21 @@ nserror urldb_load(const char *filename);
 nserror urldb_save(const char *filename);
 
 
+/**
+ * Save the current database to a snapshot file
+ *
+ * A snapshot is a binary image of the database which may be loaded
+ * with urldb_load() much faster than the text format. Path data for
+ * each host is only expanded when it is first accessed.
+ *
+ * Snapshots cannot be read by older versions so should be saved in
+ * addition to the text format, see urldb_load_with_snapshot().
+ *
+ * \param filename Name of file to save to
+ */
+nserror urldb_save_snapshot(const char *filename);
+
+
 /**
  * Iterate over entries in the database which match the given prefix
  *
@@ -0,0 +1,311 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Test ancestor bloom filter for CSS selection.
+ *
+ * The filter is checked against ancestor searches made by walking up a
+ * document tree whose element names depend on their depth.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <check.h>
+#include <dom/dom.h>
+
+#include "utils/errors.h"
+#include "css/ancestors.h"
+
+/** depth of the test tree */
+#define TREE_DEPTH 11
+
+/** names of elements at each depth of the test tree */
+static const char *depth_names[TREE_DEPTH] = {
+	"html", "BODY", "div", "section", "article", "ul",
+	"li", "p", "span", "a", "em"
+};
+
+/** names which no element in the test tree has */
+static const char *absent_names[] = {
+	"table", "tr", "td", "form", "nav", "header", "footer", "aside",
+	"h1", "h2", "h3", "blockquote", "pre", "code", "dl", "dt",
+	"dd", "ol", "strong", "label", "select", "option", "textarea",
+	"fieldset", "legend", "figure", "figcaption", "main", "address",
+	"caption", "thead", "tbody"
+};
+
+#define ABSENT_COUNT (sizeof(absent_names) / sizeof(absent_names[0]))
+
+/**
+ * Test tree
+ */
+struct test_tree {
+	dom_document *doc; /**< document owning the tree */
+	dom_node **nodes; /**< elements in document order */
+	unsigned int count; /**< number of elements */
+	unsigned int allocated; /**< size of nodes array */
+};
+
+static dom_node *create_element(dom_document *doc, const char *name)
+{
+	dom_element *element;
+	dom_string *str;
+	dom_exception err;
+
+	err = dom_string_create((const uint8_t *)name, strlen(name), &str);
+	ck_assert(err == DOM_NO_ERR);
+	err = dom_document_create_element(doc, str, &element);
+	ck_assert(err == DOM_NO_ERR);
+	dom_string_unref(str);
+
+	return (dom_node *)element;
+}
+
+/**
+ * Add an element and its descendants to a tree, in document order
+ */
+static void
+create_subtree(struct test_tree *tree, dom_node *parent, unsigned int depth)
+{
+	dom_node *element, *result;
+	dom_exception err;
+	unsigned int children;
+	unsigned int idx;
+
+	element = create_element(tree->doc, depth_names[depth]);
+	err = dom_node_append_child(parent, element, &result);
+	ck_assert(err == DOM_NO_ERR);
+	dom_node_unref(result);
+
+	ck_assert(tree->count < tree->allocated);
+	tree->nodes[tree->count++] = element;
+
+	if (depth + 1 < TREE_DEPTH) {
+		children = (depth < 2) ? 1 : 3;
+		for (idx = 0; idx < children; idx++) {
+			create_subtree(tree, element, depth + 1);
+		}
+	}
+}
+
+static void create_tree(struct test_tree *tree)
+{
+	dom_exception err;
+
+	err = dom_implementation_create_document(DOM_IMPLEMENTATION_HTML,
+			NULL, NULL, NULL, NULL, NULL, &tree->doc);
+	ck_assert(err == DOM_NO_ERR);
+
+	tree->count = 0;
+	tree->allocated = 40000;
+	tree->nodes = malloc(sizeof(dom_node *) * tree->allocated);
+	ck_assert(tree->nodes != NULL);
+
+	create_subtree(tree, (dom_node *)tree->doc, 0);
+}
+
+static void destroy_tree(struct test_tree *tree)
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < tree->count; idx++) {
+		dom_node_unref(tree->nodes[idx]);
+	}
+	free(tree->nodes);
+	dom_node_unref(tree->doc);
+}
+
+/**
+ * Search for a named ancestor by walking up the tree
+ */
+static bool walk_has_ancestor(dom_node *n, const char *name)
+{
+	dom_node *node, *parent;
+	dom_node_type type;
+	dom_string *node_name;
+	bool found = false;
+
+	dom_node_get_parent_node(n, &node);
+	while (node != NULL && found == false) {
+		dom_node_get_node_type(node, &type);
+		if (type == DOM_ELEMENT_NODE) {
+			dom_node_get_node_name(node, &node_name);
+			found = (dom_string_byte_length(node_name) ==
+					strlen(name)) &&
+				(strncasecmp(dom_string_data(node_name), name,
+					strlen(name)) == 0);
+			dom_string_unref(node_name);
+		}
+
+		dom_node_get_parent_node(node, &parent);
+		dom_node_unref(node);
+		node = parent;
+	}
+	if (node != NULL) {
+		dom_node_unref(node);
+	}
+
+	return found;
+}
+
+/**
+ * Check the filter never rejects an ancestor an element has
+ *
+ * \return the number of absent names the filter rejected
+ */
+static unsigned int
+check_element(struct nscss_ancestor_filter *filter, dom_node *n)
+{
+	unsigned int rejected = 0;
+	unsigned int idx;
+
+	for (idx = 0; idx < TREE_DEPTH; idx++) {
+		const char *name = depth_names[idx];
+
+		if (walk_has_ancestor(n, name)) {
+			ck_assert(nscss_ancestor_filter_may_have(filter,
+					name, strlen(name)));
+		}
+	}
+
+	for (idx = 0; idx < ABSENT_COUNT; idx++) {
+		const char *name = absent_names[idx];
+
+		if (!nscss_ancestor_filter_may_have(filter,
+				name, strlen(name))) {
+			rejected++;
+		}
+	}
+
+	return rejected;
+}
+
+/**
+ * The root element has no ancestors and names match caselessly.
+ */
+START_TEST(ancestors_root_test)
+{
+	struct nscss_ancestor_filter *filter;
+	struct test_tree tree;
+
+	create_tree(&tree);
+	ck_assert(nscss_ancestor_filter_create(&filter) == NSERROR_OK);
+
+	nscss_ancestor_filter_enter(filter, tree.nodes[0]);
+	ck_assert(!nscss_ancestor_filter_may_have(filter, "html", 4));
+
+	nscss_ancestor_filter_enter(filter, tree.nodes[1]);
+	ck_assert(nscss_ancestor_filter_may_have(filter, "HTML", 4));
+
+	nscss_ancestor_filter_enter(filter, tree.nodes[2]);
+	ck_assert(nscss_ancestor_filter_may_have(filter, "html", 4));
+	ck_assert(nscss_ancestor_filter_may_have(filter, "body", 4));
+
+	nscss_ancestor_filter_destroy(filter);
+	destroy_tree(&tree);
+}
+END_TEST
+
+/**
+ * Elements entered in document order have their ancestors.
+ */
+START_TEST(ancestors_order_test)
+{
+	struct nscss_ancestor_filter *filter;
+	struct test_tree tree;
+	unsigned int rejected = 0;
+	unsigned int idx;
+
+	create_tree(&tree);
+	ck_assert(nscss_ancestor_filter_create(&filter) == NSERROR_OK);
+
+	for (idx = 0; idx < tree.count; idx += 7) {
+		nscss_ancestor_filter_enter(filter, tree.nodes[idx]);
+		rejected += check_element(filter, tree.nodes[idx]);
+	}
+
+	/* most absent names are rejected */
+	ck_assert(rejected > ((tree.count / 7) * ABSENT_COUNT * 3) / 4);
+
+	nscss_ancestor_filter_destroy(filter);
+	destroy_tree(&tree);
+}
+END_TEST
+
+/**
+ * Elements entered out of order have their ancestors.
+ */
+START_TEST(ancestors_disorder_test)
+{
+	struct nscss_ancestor_filter *filter;
+	struct test_tree tree;
+	unsigned int idx;
+
+	create_tree(&tree);
+	ck_assert(nscss_ancestor_filter_create(&filter) == NSERROR_OK);
+
+	for (idx = 0; idx < 2000; idx++) {
+		dom_node *n = tree.nodes[(idx * 7919) % tree.count];
+
+		nscss_ancestor_filter_enter(filter, n);
+		check_element(filter, n);
+	}
+
+	nscss_ancestor_filter_destroy(filter);
+	destroy_tree(&tree);
+}
+END_TEST
+
+static TCase *ancestors_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Filtering");
+
+	tcase_add_test(tc, ancestors_root_test);
+	tcase_add_test(tc, ancestors_order_test);
+	tcase_add_test(tc, ancestors_disorder_test);
+
+	return tc;
+}
+
+static Suite *ancestors_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("Ancestor filter");
+
+	suite_add_tcase(s, ancestors_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(ancestors_suite_create());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Test arena allocator operations.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+#include "utils/arena.h"
+
+/** size of the blocks used by the tests */
+#define TEST_BLOCK_SIZE 1024
+
+/** number of destructors called */
+static unsigned int destructor_count;
+
+/** order destructors were called in */
+static int destructor_order[8];
+
+static void test_destructor(void *ptr)
+{
+	destructor_order[destructor_count++] = *(int *)ptr;
+}
+
+/**
+ * Allocations are aligned and do not overlap.
+ */
+START_TEST(arena_alloc_test)
+{
+	struct arena *arena;
+	unsigned char *ptr[64];
+	unsigned int idx;
+
+	arena = arena_create(TEST_BLOCK_SIZE);
+	ck_assert(arena != NULL);
+
+	for (idx = 0; idx < 64; idx++) {
+		ptr[idx] = arena_alloc(arena, idx + 1);
+		ck_assert(ptr[idx] != NULL);
+		ck_assert_int_eq((uintptr_t)ptr[idx] % sizeof(void *), 0);
+		memset(ptr[idx], idx, idx + 1);
+	}
+
+	for (idx = 0; idx < 64; idx++) {
+		ck_assert_int_eq(ptr[idx][0], idx);
+		ck_assert_int_eq(ptr[idx][idx], idx);
+	}
+
+	arena_destroy(arena);
+}
+END_TEST
+
+/**
+ * Allocations larger than a block are satisfied.
+ */
+START_TEST(arena_large_test)
+{
+	struct arena *arena;
+	unsigned char *small;
+	unsigned char *large;
+	unsigned char *after;
+	size_t size;
+
+	arena = arena_create(TEST_BLOCK_SIZE);
+	ck_assert(arena != NULL);
+
+	small = arena_alloc(arena, 16);
+	ck_assert(small != NULL);
+	size = arena_size(arena);
+
+	large = arena_alloc(arena, TEST_BLOCK_SIZE * 4);
+	ck_assert(large != NULL);
+	memset(large, 0xaa, TEST_BLOCK_SIZE * 4);
+	ck_assert(arena_size(arena) >= size + TEST_BLOCK_SIZE * 4);
+
+	/* the partly used block continues to be used */
+	size = arena_size(arena);
+	after = arena_alloc(arena, 16);
+	ck_assert(after != NULL);
+	ck_assert_int_eq(arena_size(arena), size);
+	ck_assert(after == small + 16);
+
+	arena_destroy(arena);
+}
+END_TEST
+
+/**
+ * Destructors are called in reverse order of allocation.
+ */
+START_TEST(arena_destructor_test)
+{
+	struct arena *arena;
+	int *value;
+	int idx;
+
+	destructor_count = 0;
+
+	arena = arena_create(TEST_BLOCK_SIZE);
+	ck_assert(arena != NULL);
+
+	for (idx = 0; idx < 4; idx++) {
+		value = arena_alloc_destructor(arena, sizeof(int),
+					       test_destructor);
+		ck_assert(value != NULL);
+		*value = idx;
+
+		/* allocations without destructors are interleaved */
+		ck_assert(arena_alloc(arena, 24) != NULL);
+	}
+
+	ck_assert_int_eq(destructor_count, 0);
+
+	arena_destroy(arena);
+
+	ck_assert_int_eq(destructor_count, 4);
+	for (idx = 0; idx < 4; idx++) {
+		ck_assert_int_eq(destructor_order[idx], 3 - idx);
+	}
+}
+END_TEST
+
+/**
+ * String and memory duplication.
+ */
+START_TEST(arena_dup_test)
+{
+	struct arena *arena;
+	const char data[] = "abc\0def";
+	char *str;
+	char *mem;
+	char *zero;
+
+	arena = arena_create(0);
+	ck_assert(arena != NULL);
+
+	str = arena_strdup(arena, "hello world");
+	ck_assert_str_eq(str, "hello world");
+
+	str = arena_strndup(arena, "hello world", 5);
+	ck_assert_str_eq(str, "hello");
+
+	mem = arena_memdup(arena, data, sizeof(data));
+	ck_assert(memcmp(mem, data, sizeof(data)) == 0);
+
+	zero = arena_zalloc(arena, 100);
+	ck_assert_int_eq(zero[0], 0);
+	ck_assert_int_eq(zero[99], 0);
+
+	arena_destroy(arena);
+}
+END_TEST
+
+static TCase *arena_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Allocation");
+
+	tcase_add_test(tc, arena_alloc_test);
+	tcase_add_test(tc, arena_large_test);
+	tcase_add_test(tc, arena_destructor_test);
+	tcase_add_test(tc, arena_dup_test);
+
+	return tc;
+}
+
+static Suite *arena_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("Arena allocator");
+
+	suite_add_tcase(s, arena_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(arena_suite_create());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -113,6 +113,37 @@ START_TEST(bloom_insert_empty_str_test)
 }
 END_TEST
 
+/**
+ * copy test
+ *
+ * A copy holds the entries of the original and is independent of it.
+ */
+START_TEST(bloom_copy_test)
+{
+	struct bloom_filter *a;
+	struct bloom_filter *b;
+	a = bloom_create(BLOOM_SIZE);
+	ck_assert(a != NULL);
+	b = bloom_create(BLOOM_SIZE);
+	ck_assert(b != NULL);
+
+	bloom_insert_str(a, "NetSurf", 7);
+	bloom_insert_str(b, "NotSurf", 7);
+	bloom_copy(b, a);
+
+	ck_assert(bloom_search_str(b, "NetSurf", 7));
+	ck_assert(!bloom_search_str(b, "NotSurf", 7));
+	ck_assert(bloom_items(b) == 1);
+
+	bloom_insert_str(b, "NotSurf", 7);
+	ck_assert(!bloom_search_str(a, "NotSurf", 7));
+	ck_assert(bloom_items(a) == 1);
+
+	bloom_destroy(b);
+	bloom_destroy(a);
+}
+END_TEST
+
 
 /**
  * Basic API creation test case
@@ -125,6 +156,7 @@ static TCase *bloom_api_case_create(void)
 
 	tcase_add_test(tc, bloom_create_test);
 	tcase_add_test(tc, bloom_insert_empty_str_test);
+	tcase_add_test(tc, bloom_copy_test);
 
 	return tc;
 }
@@ -0,0 +1,421 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Test compiled javascript bytecode cache.
+ *
+ * The backing store is replaced with a trivial in memory implementation
+ * so persistence of bytecode between runs can be checked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+#include "utils/errors.h"
+#include "utils/corestrings.h"
+#include "utils/nsurl.h"
+#include "desktop/gui_internal.h"
+#include "content/backing_store.h"
+#include "javascript/duktape/bytecode.h"
+
+/** maximum number of objects in the test backing store */
+#define STORE_OBJECTS 64
+
+/** size of test script sources */
+#define SOURCE_SIZE 4096
+
+/**
+ * Test backing store object
+ */
+struct store_object {
+	nsurl *url; /**< url object is stored under */
+	uint8_t *data; /**< object data */
+	size_t len; /**< length of object data */
+};
+
+static struct store_object store_objects[STORE_OBJECTS];
+
+static unsigned int store_writes;
+
+static struct store_object *store_find(nsurl *url)
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < STORE_OBJECTS; idx++) {
+		if ((store_objects[idx].url != NULL) &&
+		    nsurl_compare(store_objects[idx].url, url,
+				  NSURL_COMPLETE)) {
+			return &store_objects[idx];
+		}
+	}
+
+	return NULL;
+}
+
+static void store_free(struct store_object *obj)
+{
+	nsurl_unref(obj->url);
+	free(obj->data);
+	obj->url = NULL;
+	obj->data = NULL;
+}
+
+static nserror test_store(nsurl *url, enum backing_store_flags flags,
+		uint8_t *data, const size_t datalen)
+{
+	struct store_object *obj;
+
+	obj = store_find(url);
+	if (obj != NULL) {
+		store_free(obj);
+	} else {
+		for (obj = store_objects; obj->url != NULL; obj++) {
+			ck_assert(obj < &store_objects[STORE_OBJECTS - 1]);
+		}
+	}
+
+	obj->url = nsurl_ref(url);
+	obj->data = data;
+	obj->len = datalen;
+	store_writes++;
+
+	return NSERROR_OK;
+}
+
+static nserror test_fetch(nsurl *url, enum backing_store_flags flags,
+		uint8_t **data_out, size_t *datalen_out)
+{
+	struct store_object *obj;
+
+	obj = store_find(url);
+	if (obj == NULL) {
+		return NSERROR_NOT_FOUND;
+	}
+
+	*data_out = obj->data;
+	*datalen_out = obj->len;
+
+	return NSERROR_OK;
+}
+
+static nserror test_release(nsurl *url, enum backing_store_flags flags)
+{
+	return NSERROR_OK;
+}
+
+static nserror test_invalidate(nsurl *url)
+{
+	struct store_object *obj;
+
+	obj = store_find(url);
+	if (obj == NULL) {
+		return NSERROR_NOT_FOUND;
+	}
+	store_free(obj);
+
+	return NSERROR_OK;
+}
+
+static struct gui_llcache_table test_llcache_table = {
+	.store = test_store,
+	.fetch = test_fetch,
+	.release = test_release,
+	.invalidate = test_invalidate,
+};
+
+static struct netsurf_table test_table;
+
+struct netsurf_table *guit = NULL;
+
+/**
+ * Test script
+ */
+struct test_script {
+	char url[64]; /**< url of script */
+	uint8_t src[SOURCE_SIZE]; /**< script source */
+	uint8_t bytecode[SOURCE_SIZE / 2]; /**< pretend compiled bytecode */
+};
+
+static void make_script(struct test_script *script, unsigned int n,
+		unsigned int version)
+{
+	unsigned int idx;
+
+	snprintf(script->url, sizeof(script->url),
+		 "http://example.com/script%u.js", n);
+	for (idx = 0; idx < SOURCE_SIZE; idx++) {
+		script->src[idx] = 'a' + ((idx * 7 + n + version) % 26);
+	}
+	for (idx = 0; idx < sizeof(script->bytecode); idx++) {
+		script->bytecode[idx] = (idx * 13 + n * 3 + version) & 0xff;
+	}
+}
+
+/**
+ * Find a script's bytecode and check it is the bytecode stored
+ */
+static bool find_script(struct test_script *script)
+{
+	struct dukky_bytecode_key key;
+	const uint8_t *bytecode;
+	size_t len;
+	nserror res;
+
+	ck_assert(dukky_bytecode_key_init(script->url, script->src,
+			SOURCE_SIZE, &key) == NSERROR_OK);
+	res = dukky_bytecode_find(&key, &bytecode, &len);
+	dukky_bytecode_key_fini(&key);
+
+	if (res != NSERROR_OK) {
+		return false;
+	}
+
+	ck_assert_uint_eq(len, sizeof(script->bytecode));
+	ck_assert(memcmp(bytecode, script->bytecode, len) == 0);
+
+	return true;
+}
+
+static void store_script(struct test_script *script)
+{
+	struct dukky_bytecode_key key;
+
+	ck_assert(dukky_bytecode_key_init(script->url, script->src,
+			SOURCE_SIZE, &key) == NSERROR_OK);
+	ck_assert(dukky_bytecode_store(&key, script->bytecode,
+			sizeof(script->bytecode)) == NSERROR_OK);
+	dukky_bytecode_key_fini(&key);
+}
+
+/* Fixtures */
+
+static void bytecode_create(void)
+{
+	ck_assert_int_eq(corestrings_init(), NSERROR_OK);
+
+	memset(store_objects, 0, sizeof(store_objects));
+	store_writes = 0;
+
+	test_table.llcache = &test_llcache_table;
+	guit = &test_table;
+}
+
+static void bytecode_teardown(void)
+{
+	unsigned int idx;
+
+	dukky_bytecode_finalise();
+
+	for (idx = 0; idx < STORE_OBJECTS; idx++) {
+		if (store_objects[idx].url != NULL) {
+			store_free(&store_objects[idx]);
+		}
+	}
+
+	guit = NULL;
+
+	corestrings_fini();
+}
+
+
+/**
+ * Only scripts with a URL of sufficient size are cached.
+ */
+START_TEST(bytecode_key_test)
+{
+	struct dukky_bytecode_key key;
+	struct test_script script;
+
+	make_script(&script, 0, 0);
+
+	ck_assert(dukky_bytecode_key_init("?inline script?", script.src,
+			SOURCE_SIZE, &key) == NSERROR_NOT_FOUND);
+	ck_assert(dukky_bytecode_key_init(NULL, script.src,
+			SOURCE_SIZE, &key) == NSERROR_NOT_FOUND);
+	ck_assert(dukky_bytecode_key_init(script.url, script.src,
+			16, &key) == NSERROR_NOT_FOUND);
+
+	ck_assert(dukky_bytecode_key_init(script.url, script.src,
+			SOURCE_SIZE, &key) == NSERROR_OK);
+	ck_assert_uint_eq(key.length, SOURCE_SIZE);
+	dukky_bytecode_key_fini(&key);
+}
+END_TEST
+
+/**
+ * Stored bytecode is found for the same source only.
+ */
+START_TEST(bytecode_memory_test)
+{
+	struct test_script script;
+
+	make_script(&script, 1, 0);
+	ck_assert(find_script(&script) == false);
+
+	store_script(&script);
+	ck_assert(find_script(&script) == true);
+	ck_assert_uint_eq(store_writes, 1);
+
+	/* a changed script at the same URL is not found */
+	make_script(&script, 1, 1);
+	ck_assert(find_script(&script) == false);
+
+	store_script(&script);
+	ck_assert(find_script(&script) == true);
+	ck_assert_uint_eq(store_writes, 2);
+}
+END_TEST
+
+/**
+ * Bytecode is retrieved from the backing store after a restart.
+ */
+START_TEST(bytecode_persist_test)
+{
+	struct test_script script;
+
+	make_script(&script, 2, 0);
+	store_script(&script);
+
+	/* drop the bytecode held in memory */
+	dukky_bytecode_finalise();
+
+	ck_assert(find_script(&script) == true);
+
+	/* previous version of script is not used */
+	dukky_bytecode_finalise();
+	make_script(&script, 2, 1);
+	ck_assert(find_script(&script) == false);
+}
+END_TEST
+
+/**
+ * Corrupted bytecode in the backing store is rejected and removed.
+ */
+START_TEST(bytecode_corrupt_test)
+{
+	struct test_script script;
+	unsigned int idx;
+
+	make_script(&script, 3, 0);
+	store_script(&script);
+	dukky_bytecode_finalise();
+
+	for (idx = 0; idx < STORE_OBJECTS; idx++) {
+		if (store_objects[idx].url != NULL) {
+			store_objects[idx].data[store_objects[idx].len - 1] ^= 1;
+		}
+	}
+
+	ck_assert(find_script(&script) == false);
+	for (idx = 0; idx < STORE_OBJECTS; idx++) {
+		ck_assert(store_objects[idx].url == NULL);
+	}
+}
+END_TEST
+
+/**
+ * Bytecode is not written with the backing store disabled.
+ */
+START_TEST(bytecode_no_store_test)
+{
+	struct test_script script;
+
+	test_table.llcache = null_llcache_table;
+
+	make_script(&script, 4, 0);
+	store_script(&script);
+	ck_assert(find_script(&script) == true);
+	ck_assert_uint_eq(store_writes, 0);
+
+	dukky_bytecode_finalise();
+	ck_assert(find_script(&script) == false);
+}
+END_TEST
+
+/**
+ * The least recently used bytecode is evicted from memory.
+ */
+START_TEST(bytecode_evict_test)
+{
+	struct test_script script;
+	unsigned int idx;
+
+	test_table.llcache = null_llcache_table;
+
+	for (idx = 0; idx < 100; idx++) {
+		make_script(&script, idx, 0);
+		store_script(&script);
+
+		/* keep the first script in use */
+		make_script(&script, 0, 0);
+		ck_assert(find_script(&script) == true);
+	}
+
+	make_script(&script, 1, 0);
+	ck_assert(find_script(&script) == false);
+
+	make_script(&script, 99, 0);
+	ck_assert(find_script(&script) == true);
+}
+END_TEST
+
+
+static TCase *bytecode_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Bytecode cache");
+
+	tcase_add_checked_fixture(tc, bytecode_create, bytecode_teardown);
+
+	tcase_add_test(tc, bytecode_key_test);
+	tcase_add_test(tc, bytecode_memory_test);
+	tcase_add_test(tc, bytecode_persist_test);
+	tcase_add_test(tc, bytecode_corrupt_test);
+	tcase_add_test(tc, bytecode_no_store_test);
+	tcase_add_test(tc, bytecode_evict_test);
+
+	return tc;
+}
+
+static Suite *bytecode_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("Javascript bytecode cache");
+
+	suite_add_tcase(s, bytecode_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(bytecode_suite_create());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
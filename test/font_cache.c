@@ -0,0 +1,532 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Test text measurement cache operations.
+ *
+ * The cache is placed in front of a layout table which measures every
+ * byte as a fixed width and counts the requests that reach it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <libwapcaplet/libwapcaplet.h>
+
+#include "utils/errors.h"
+#include "utils/nsoption.h"
+#include "netsurf/plot_style.h"
+#include "netsurf/layout.h"
+#include "html/font_cache.h"
+
+/** width of each byte measured by the test layout table */
+#define CHAR_WIDTH 10
+
+/** memory limit used by the eviction tests */
+#define SMALL_LIMIT 4096
+
+/* Stubs */
+nserror nslog_set_filter_by_options() { return NSERROR_OK; }
+
+/******************************************************************************
+ * Test layout table                                                          *
+ ******************************************************************************/
+
+/** number of width requests that reached the test layout table */
+static unsigned int width_calls;
+
+/** number of split requests that reached the test layout table */
+static unsigned int split_calls;
+
+static nserror
+test_width(const plot_font_style_t *fstyle,
+	   const char *string,
+	   size_t length,
+	   int *width)
+{
+	width_calls++;
+
+	if ((length == 4) && (memcmp(string, "fail", 4) == 0)) {
+		return NSERROR_INVALID;
+	}
+
+	*width = length * CHAR_WIDTH;
+
+	return NSERROR_OK;
+}
+
+static nserror
+test_position(const plot_font_style_t *fstyle,
+	      const char *string,
+	      size_t length,
+	      int x,
+	      size_t *char_offset,
+	      int *actual_x)
+{
+	*char_offset = x / CHAR_WIDTH;
+	if (*char_offset > length) {
+		*char_offset = length;
+	}
+	*actual_x = *char_offset * CHAR_WIDTH;
+
+	return NSERROR_OK;
+}
+
+static nserror
+test_split(const plot_font_style_t *fstyle,
+	   const char *string,
+	   size_t length,
+	   int x,
+	   size_t *char_offset,
+	   int *actual_x)
+{
+	split_calls++;
+
+	return test_position(fstyle, string, length, x, char_offset, actual_x);
+}
+
+static struct gui_layout_table test_layout_table = {
+	.width = test_width,
+	.position = test_position,
+	.split = test_split,
+};
+
+/******************************************************************************
+ * The actual test code                                                       *
+ ******************************************************************************/
+
+/** font style used by tests */
+static const plot_font_style_t test_fstyle = {
+	.family = PLOT_FONT_FAMILY_SANS_SERIF,
+	.size = 12 * PLOT_STYLE_SCALE,
+	.weight = 400,
+	.flags = FONTF_NONE,
+	.background = 0xffffff,
+	.foreground = 0x000000,
+};
+
+/**
+ * Measure a nul terminated string through the cache
+ */
+static int cache_width(const plot_font_style_t *fstyle, const char *text)
+{
+	int width = -1;
+
+	ck_assert_int_eq(font_cache_layout_table->width(fstyle,
+							text,
+							strlen(text),
+							&width),
+			 NSERROR_OK);
+
+	return width;
+}
+
+/* Fixtures */
+
+static void font_cache_create(void)
+{
+	width_calls = 0;
+	split_calls = 0;
+
+	ck_assert_int_eq(font_cache_init(&test_layout_table, 0), NSERROR_OK);
+}
+
+static void font_cache_small_create(void)
+{
+	width_calls = 0;
+	split_calls = 0;
+
+	ck_assert_int_eq(font_cache_init(&test_layout_table, SMALL_LIMIT),
+			 NSERROR_OK);
+}
+
+static void font_cache_teardown(void)
+{
+	font_cache_fini();
+}
+
+/**
+ * Repeated width requests are answered from the cache.
+ */
+START_TEST(font_cache_width_test)
+{
+	struct font_cache_stats stats;
+
+	ck_assert_int_eq(cache_width(&test_fstyle, "word"), 4 * CHAR_WIDTH);
+	ck_assert_int_eq(cache_width(&test_fstyle, "word"), 4 * CHAR_WIDTH);
+	ck_assert_int_eq(cache_width(&test_fstyle, "words"), 5 * CHAR_WIDTH);
+	ck_assert_int_eq(cache_width(&test_fstyle, "word"), 4 * CHAR_WIDTH);
+
+	ck_assert_int_eq(width_calls, 2);
+
+	font_cache_get_stats(&stats);
+	ck_assert_int_eq(stats.width_hit, 2);
+	ck_assert_int_eq(stats.width_miss, 2);
+	ck_assert_int_eq(stats.entries, 2);
+}
+END_TEST
+
+/**
+ * Style members which affect metrics form part of the key.
+ */
+START_TEST(font_cache_style_test)
+{
+	plot_font_style_t fstyle = test_fstyle;
+
+	cache_width(&fstyle, "word");
+
+	/* colours do not change text metrics */
+	fstyle.foreground = 0xff0000;
+	fstyle.background = 0x00ff00;
+	cache_width(&fstyle, "word");
+	ck_assert_int_eq(width_calls, 1);
+
+	fstyle.size = 14 * PLOT_STYLE_SCALE;
+	cache_width(&fstyle, "word");
+	ck_assert_int_eq(width_calls, 2);
+
+	fstyle.weight = 700;
+	cache_width(&fstyle, "word");
+	ck_assert_int_eq(width_calls, 3);
+
+	fstyle.flags = FONTF_ITALIC;
+	cache_width(&fstyle, "word");
+	ck_assert_int_eq(width_calls, 4);
+
+	fstyle.family = PLOT_FONT_FAMILY_MONOSPACE;
+	cache_width(&fstyle, "word");
+	ck_assert_int_eq(width_calls, 5);
+
+	cache_width(&fstyle, "word");
+	ck_assert_int_eq(width_calls, 5);
+}
+END_TEST
+
+/**
+ * Font family names form part of the key.
+ */
+START_TEST(font_cache_families_test)
+{
+	plot_font_style_t fstyle = test_fstyle;
+	lwc_string *families_a[2] = { NULL, NULL };
+	lwc_string *families_ab[3] = { NULL, NULL, NULL };
+	lwc_string *family_a;
+	lwc_string *family_b;
+
+	ck_assert(lwc_intern_string("Alpha", 5, &family_a) == lwc_error_ok);
+	ck_assert(lwc_intern_string("Beta", 4, &family_b) == lwc_error_ok);
+
+	families_a[0] = family_a;
+	families_ab[0] = family_a;
+	families_ab[1] = family_b;
+
+	cache_width(&fstyle, "word");
+
+	fstyle.families = families_a;
+	cache_width(&fstyle, "word");
+	ck_assert_int_eq(width_calls, 2);
+
+	fstyle.families = families_ab;
+	cache_width(&fstyle, "word");
+	ck_assert_int_eq(width_calls, 3);
+
+	/* the cache holds references to the family names */
+	lwc_string_unref(family_a);
+	lwc_string_unref(family_b);
+
+	fstyle.families = families_a;
+	cache_width(&fstyle, "word");
+	fstyle.families = families_ab;
+	cache_width(&fstyle, "word");
+	fstyle.families = NULL;
+	cache_width(&fstyle, "word");
+	ck_assert_int_eq(width_calls, 3);
+}
+END_TEST
+
+/**
+ * Split requests are answered from the cache for the same width.
+ */
+START_TEST(font_cache_split_test)
+{
+	struct font_cache_stats stats;
+	const char *text = "a line of text to split";
+	size_t offset;
+	int actual_x;
+	int loop;
+
+	for (loop = 0; loop < 3; loop++) {
+		ck_assert_int_eq(font_cache_layout_table->split(&test_fstyle,
+				text, strlen(text), 55, &offset, &actual_x),
+				 NSERROR_OK);
+		ck_assert_int_eq(offset, 5);
+		ck_assert_int_eq(actual_x, 50);
+	}
+	ck_assert_int_eq(split_calls, 1);
+
+	ck_assert_int_eq(font_cache_layout_table->split(&test_fstyle,
+			text, strlen(text), 75, &offset, &actual_x),
+			 NSERROR_OK);
+	ck_assert_int_eq(offset, 7);
+	ck_assert_int_eq(actual_x, 70);
+	ck_assert_int_eq(split_calls, 2);
+
+	/* width and split of the same text share an entry */
+	ck_assert_int_eq(cache_width(&test_fstyle, text),
+			 strlen(text) * CHAR_WIDTH);
+
+	font_cache_get_stats(&stats);
+	ck_assert_int_eq(stats.split_hit, 2);
+	ck_assert_int_eq(stats.split_miss, 2);
+	ck_assert_int_eq(stats.width_miss, 1);
+	ck_assert_int_eq(stats.entries, 1);
+}
+END_TEST
+
+/**
+ * Failed measurements are not cached.
+ */
+START_TEST(font_cache_error_test)
+{
+	int width;
+
+	ck_assert_int_eq(font_cache_layout_table->width(&test_fstyle,
+							"fail", 4, &width),
+			 NSERROR_INVALID);
+	ck_assert_int_eq(font_cache_layout_table->width(&test_fstyle,
+							"fail", 4, &width),
+			 NSERROR_INVALID);
+	ck_assert_int_eq(width_calls, 2);
+}
+END_TEST
+
+/**
+ * Flushing discards every entry.
+ */
+START_TEST(font_cache_flush_test)
+{
+	struct font_cache_stats stats;
+
+	cache_width(&test_fstyle, "word");
+	font_cache_flush();
+
+	font_cache_get_stats(&stats);
+	ck_assert_int_eq(stats.entries, 0);
+	ck_assert_int_eq(stats.size, 0);
+
+	cache_width(&test_fstyle, "word");
+	ck_assert_int_eq(width_calls, 2);
+}
+END_TEST
+
+/**
+ * Changing a configured font face discards every entry.
+ */
+START_TEST(font_cache_faces_test)
+{
+	struct font_cache_stats stats;
+	unsigned int generation;
+
+	ck_assert_int_eq(nsoption_init(NULL, NULL, NULL), NSERROR_OK);
+
+	generation = font_cache_update_faces();
+	cache_width(&test_fstyle, "word");
+
+	/* unchanged faces keep the entries and generation */
+	ck_assert_uint_eq(font_cache_update_faces(), generation);
+	cache_width(&test_fstyle, "word");
+	ck_assert_int_eq(width_calls, 1);
+
+	nsoption_set_charp(font_sans, strdup("Test Sans"));
+	ck_assert_uint_ne(font_cache_update_faces(), generation);
+
+	font_cache_get_stats(&stats);
+	ck_assert_int_eq(stats.entries, 0);
+
+	cache_width(&test_fstyle, "word");
+	ck_assert_int_eq(width_calls, 2);
+
+	ck_assert_int_eq(nsoption_finalise(NULL, NULL), NSERROR_OK);
+}
+END_TEST
+
+/**
+ * The cache stays within its memory limit keeping recent entries.
+ */
+START_TEST(font_cache_limit_test)
+{
+	struct font_cache_stats stats;
+	char word[32];
+	unsigned int idx;
+
+	for (idx = 0; idx < 1000; idx++) {
+		snprintf(word, sizeof(word), "word%u", idx);
+		cache_width(&test_fstyle, word);
+
+		font_cache_get_stats(&stats);
+		ck_assert(stats.size <= SMALL_LIMIT);
+	}
+	ck_assert_int_eq(width_calls, 1000);
+	ck_assert(stats.entries < 1000);
+
+	/* most recent entry is kept */
+	cache_width(&test_fstyle, "word999");
+	ck_assert_int_eq(width_calls, 1000);
+
+	/* oldest entry was evicted */
+	cache_width(&test_fstyle, "word0");
+	ck_assert_int_eq(width_calls, 1001);
+}
+END_TEST
+
+/**
+ * Entries in use are kept in preference to unused ones.
+ */
+START_TEST(font_cache_lru_test)
+{
+	char word[32];
+	unsigned int idx;
+
+	cache_width(&test_fstyle, "keep");
+
+	for (idx = 0; idx < 1000; idx++) {
+		snprintf(word, sizeof(word), "word%u", idx);
+		cache_width(&test_fstyle, word);
+		cache_width(&test_fstyle, "keep");
+	}
+	ck_assert_int_eq(width_calls, 1001);
+}
+END_TEST
+
+/**
+ * Repeated layout of a paragraph is mostly answered from the cache.
+ */
+START_TEST(font_cache_hit_rate_test)
+{
+	const char *paragraph = "the quick brown fox jumps over the lazy dog "
+		"and the lazy dog sleeps in the sun while the fox runs "
+		"over the hill and into the woods where the dog cannot follow";
+	struct font_cache_stats stats;
+	const char *word;
+	const char *end;
+	const char *line;
+	size_t offset;
+	int actual_x;
+	int width;
+	int pass;
+	int x;
+
+	/* every pass measures each word and splits the paragraph into lines */
+	for (pass = 0; pass < 16; pass++) {
+		for (word = paragraph; *word != '\0'; word = end) {
+			end = strchr(word, ' ');
+			if (end == NULL) {
+				end = word + strlen(word);
+			}
+			font_cache_layout_table->width(&test_fstyle,
+						       word, end - word,
+						       &width);
+			font_cache_layout_table->width(&test_fstyle,
+						       " ", 1, &width);
+			if (*end == ' ') {
+				end++;
+			}
+		}
+
+		/* break into lines, the window is resized every fourth pass */
+		x = ((pass % 4) == 3) ? 500 : 300;
+		for (line = paragraph; *line != '\0'; line += offset) {
+			font_cache_layout_table->split(&test_fstyle,
+						       line,
+						       strlen(line),
+						       x, &offset, &actual_x);
+		}
+	}
+
+	font_cache_get_stats(&stats);
+
+	/* only the first pass reaches the layout table for widths */
+	ck_assert_int_eq(stats.width_miss, width_calls);
+	ck_assert(stats.width_hit > stats.width_miss * 10);
+	ck_assert(stats.split_hit > stats.split_miss);
+}
+END_TEST
+
+static TCase *font_cache_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Measurement");
+
+	tcase_add_checked_fixture(tc,
+				  font_cache_create,
+				  font_cache_teardown);
+
+	tcase_add_test(tc, font_cache_width_test);
+	tcase_add_test(tc, font_cache_style_test);
+	tcase_add_test(tc, font_cache_families_test);
+	tcase_add_test(tc, font_cache_split_test);
+	tcase_add_test(tc, font_cache_error_test);
+	tcase_add_test(tc, font_cache_flush_test);
+	tcase_add_test(tc, font_cache_faces_test);
+	tcase_add_test(tc, font_cache_hit_rate_test);
+
+	return tc;
+}
+
+static TCase *font_cache_limit_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Memory limit");
+
+	tcase_add_checked_fixture(tc,
+				  font_cache_small_create,
+				  font_cache_teardown);
+
+	tcase_add_test(tc, font_cache_limit_test);
+	tcase_add_test(tc, font_cache_lru_test);
+
+	return tc;
+}
+
+static Suite *font_cache_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("Text measurement cache");
+
+	suite_add_tcase(s, font_cache_case_create());
+	suite_add_tcase(s, font_cache_limit_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(font_cache_suite_create());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
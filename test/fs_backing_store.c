@@ -0,0 +1,291 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Test filesystem backing store operations.
+ *
+ * The store is exercised through its operation table in a scratch
+ * directory below the test root.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <check.h>
+
+#include "utils/errors.h"
+#include "utils/corestrings.h"
+#include "utils/file.h"
+#include "utils/nsurl.h"
+#include "netsurf/misc.h"
+#include "desktop/gui_internal.h"
+#include "content/backing_store.h"
+
+#ifndef TESTROOT
+#define TESTROOT "/tmp"
+#endif
+
+/** log2 number of entries in the eviction order test store */
+#define ORDER_ENTRY_BITS 8
+
+/** size of each object stored */
+#define OBJECT_SIZE 64
+
+/******************************************************************************
+ * Stubs for interfaces the backing store depends upon                        *
+ ******************************************************************************/
+
+/* netsurf/misc.h */
+static nserror test_schedule(int t, void (*callback)(void *p), void *p)
+{
+	/* control maintenance is performed on finalise */
+	return NSERROR_OK;
+}
+
+static struct gui_misc_table test_misc_table = {
+	.schedule = test_schedule,
+};
+
+static struct netsurf_table test_table = {
+	.misc = &test_misc_table,
+};
+
+struct netsurf_table *guit = NULL;
+
+/******************************************************************************
+ * The actual test code                                                       *
+ ******************************************************************************/
+
+/** path to the scratch store */
+static char store_path[64];
+
+static int remove_cb(const char *fpath, const struct stat *sb,
+		     int typeflag, struct FTW *ftwbuf)
+{
+	return remove(fpath);
+}
+
+/**
+ * Create a test url for a given index
+ */
+static nsurl *test_url(unsigned int idx)
+{
+	char buf[64];
+	nsurl *url;
+
+	snprintf(buf, sizeof(buf), "http://test%u.example.com/obj/%u", idx % 97, idx);
+	ck_assert_int_eq(nsurl_create(buf, &url), NSERROR_OK);
+
+	return url;
+}
+
+/**
+ * Store an object whose content is derived from its index
+ */
+static nserror test_store(unsigned int idx)
+{
+	uint8_t *data;
+	nsurl *url;
+	nserror res;
+
+	data = malloc(OBJECT_SIZE);
+	ck_assert(data != NULL);
+	memset(data, idx & 0xff, OBJECT_SIZE);
+
+	url = test_url(idx);
+	res = filesystem_llcache_table->store(url, BACKING_STORE_NONE,
+					      data, OBJECT_SIZE);
+	if (res == NSERROR_OK) {
+		filesystem_llcache_table->release(url, BACKING_STORE_NONE);
+	} else if (res == NSERROR_PERMISSION) {
+		/* identifier collision, store did not take the data */
+		free(data);
+	}
+	nsurl_unref(url);
+
+	return res;
+}
+
+/**
+ * Fetch an object and check its content
+ */
+static nserror test_fetch(unsigned int idx)
+{
+	uint8_t *data;
+	size_t datalen;
+	nsurl *url;
+	nserror res;
+
+	url = test_url(idx);
+	res = filesystem_llcache_table->fetch(url, BACKING_STORE_NONE,
+					      &data, &datalen);
+	if (res == NSERROR_OK) {
+		ck_assert_int_eq(datalen, OBJECT_SIZE);
+		ck_assert_int_eq(data[0], idx & 0xff);
+		ck_assert_int_eq(data[OBJECT_SIZE - 1], idx & 0xff);
+		filesystem_llcache_table->release(url, BACKING_STORE_NONE);
+	}
+	nsurl_unref(url);
+
+	return res;
+}
+
+/**
+ * Initialise a scratch store
+ */
+static void store_create(unsigned int entry_bits, size_t hysteresis)
+{
+	struct llcache_store_parameters params = {
+		.limit = 1024 * 1024 * 1024,
+		.hysteresis = hysteresis,
+		.entry_size = entry_bits,
+		.address_size = 24,
+	};
+
+	snprintf(store_path, sizeof(store_path), TESTROOT"/fsbstest%d",
+		 getpid());
+	params.path = store_path;
+
+	ck_assert_int_eq(filesystem_llcache_table->initialise(&params),
+			 NSERROR_OK);
+}
+
+/* Fixtures */
+
+static void fs_backing_store_create(void)
+{
+	ck_assert_int_eq(corestrings_init(), NSERROR_OK);
+
+	test_table.file = default_file_table;
+	guit = &test_table;
+}
+
+static void fs_backing_store_teardown(void)
+{
+	filesystem_llcache_table->finalise();
+
+	nftw(store_path, remove_cb, 16, FTW_DEPTH | FTW_PHYS);
+
+	guit = NULL;
+
+	corestrings_fini();
+}
+
+/**
+ * Stored objects are retrieved intact.
+ */
+START_TEST(fs_backing_store_fetch_test)
+{
+	unsigned int idx;
+
+	store_create(ORDER_ENTRY_BITS, 0);
+
+	for (idx = 0; idx < 16; idx++) {
+		ck_assert_int_eq(test_store(idx), NSERROR_OK);
+	}
+
+	for (idx = 0; idx < 16; idx++) {
+		ck_assert_int_eq(test_fetch(idx), NSERROR_OK);
+	}
+
+	ck_assert_int_eq(test_fetch(16), NSERROR_NOT_FOUND);
+}
+END_TEST
+
+/**
+ * Eviction removes the least used entries first.
+ */
+START_TEST(fs_backing_store_evict_order_test)
+{
+	unsigned int entry_count = (1 << ORDER_ENTRY_BITS) - 1;
+	unsigned int idx;
+	unsigned int loop;
+	unsigned int evicted = 0;
+
+	/* evict approximately eight entries at a time */
+	store_create(ORDER_ENTRY_BITS, 8 * OBJECT_SIZE);
+
+	/* fill the store */
+	for (idx = 0; idx < entry_count; idx++) {
+		ck_assert_int_eq(test_store(idx), NSERROR_OK);
+	}
+
+	/* make every other entry more valuable */
+	for (loop = 0; loop < 2; loop++) {
+		for (idx = 0; idx < entry_count; idx += 2) {
+			ck_assert_int_eq(test_fetch(idx), NSERROR_OK);
+		}
+	}
+
+	/* storing into a full store evicts entries */
+	ck_assert_int_eq(test_store(entry_count), NSERROR_OK);
+	ck_assert_int_eq(test_fetch(entry_count), NSERROR_OK);
+
+	for (idx = 0; idx < entry_count; idx++) {
+		if (test_fetch(idx) != NSERROR_OK) {
+			/* only less used entries may be evicted */
+			ck_assert_int_eq(idx & 1, 1);
+			evicted++;
+		}
+	}
+	ck_assert(evicted > 0);
+}
+END_TEST
+
+static TCase *fs_backing_store_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Store");
+
+	tcase_add_checked_fixture(tc,
+				  fs_backing_store_create,
+				  fs_backing_store_teardown);
+
+	tcase_add_test(tc, fs_backing_store_fetch_test);
+	tcase_add_test(tc, fs_backing_store_evict_order_test);
+
+	return tc;
+}
+
+static Suite *fs_backing_store_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("Filesystem backing store");
+
+	suite_add_tcase(s, fs_backing_store_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(fs_backing_store_suite_create());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
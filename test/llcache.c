@@ -16,345 +16,942 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/**
+ * \file
+ * Test low level cache operations.
+ *
+ * The fetch layer is replaced with a trivial implementation which
+ * completes fetches only when the test asks it to, allowing the cache
+ * object lifecycle to be driven directly.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <check.h>
 
-#include "content/fetch.h"
-#include "content/llcache.h"
-#include "utils/ring.h"
-#include "utils/nsurl.h"
-#include "utils/url.h"
+#include "utils/errors.h"
 #include "utils/corestrings.h"
+#include "utils/messages.h"
+#include "utils/nsurl.h"
 #include "utils/utils.h"
+#include "netsurf/misc.h"
+#include "desktop/gui_internal.h"
+#include "content/fetch.h"
+#include "content/backing_store.h"
+#include "content/llcache.h"
+#include "content/urldb.h"
+
+/** Number of distinct objects used by the large cache tests */
+#define MANY_OBJECT_COUNT 20000
+
+/** Size of the object used by the large object tests */
+#define LARGE_OBJECT_SIZE (32 * 1024 * 1024)
+
+/** Size of each chunk of a large object the fetcher delivers */
+#define LARGE_CHUNK_SIZE (16 * 1024)
+
+/** Number of chunks delivered between each run of scheduled callbacks */
+#define LARGE_CHUNKS_PER_RUN 64
+
+/** maximum number of pending scheduled callbacks */
+#define MAX_SCHEDULED 16
+
+/** maximum number of objects the test backing store records */
+#define MAX_STORED 16
+
+#define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
 
 /******************************************************************************
- * Things that we'd reasonably expect to have to implement                    *
+ * Stubs for interfaces the low level cache depends upon                      *
  ******************************************************************************/
 
-bool verbose_log;
+/** A scheduled callback */
+struct test_schedule {
+	void (*callback)(void *p);
+	void *p;
+	int t;
+};
 
-/* utils/utils.h */
-char *filename_from_path(char *path)
+static struct test_schedule scheduled[MAX_SCHEDULED];
+
+/* netsurf/misc.h */
+static nserror test_schedule(int t, void (*callback)(void *p), void *p)
 {
-	char *leafname;
+	unsigned int idx;
+	unsigned int slot = MAX_SCHEDULED;
+
+	for (idx = 0; idx < MAX_SCHEDULED; idx++) {
+		if ((scheduled[idx].callback == callback) &&
+		    (scheduled[idx].p == p)) {
+			/* rescheduling replaces existing entry */
+			scheduled[idx].callback = NULL;
+		}
+		if ((scheduled[idx].callback == NULL) &&
+		    (slot == MAX_SCHEDULED)) {
+			slot = idx;
+		}
+	}
 
-	leafname = strrchr(path, '/');
-	if (!leafname)
-		leafname = path;
-	else
-		leafname += 1;
+	if (t < 0) {
+		return NSERROR_OK;
+	}
+
+	ck_assert(slot != MAX_SCHEDULED);
 
-	return strdup(leafname);
+	scheduled[slot].callback = callback;
+	scheduled[slot].p = p;
+	scheduled[slot].t = t;
+
+	return NSERROR_OK;
 }
 
-/* utils/schedule.h */
-void schedule(int t, schedule_callback_fn cb, void *pw)
+/**
+ * Run all callbacks scheduled to run immediately.
+ */
+static void test_run_scheduled(void)
 {
+	unsigned int idx;
+	void (*callback)(void *p);
+
+	for (idx = 0; idx < MAX_SCHEDULED; idx++) {
+		if ((scheduled[idx].callback != NULL) &&
+		    (scheduled[idx].t == 0)) {
+			callback = scheduled[idx].callback;
+			scheduled[idx].callback = NULL;
+			callback(scheduled[idx].p);
+		}
+	}
 }
 
-/* utils/schedule.h */
-void schedule_remove(schedule_callback_fn cb, void *pw)
+static struct gui_misc_table test_misc_table = {
+	.schedule = test_schedule,
+};
+
+static struct netsurf_table test_table = {
+	.misc = &test_misc_table,
+};
+
+struct netsurf_table *guit = NULL;
+
+/* utils/messages.h */
+const char *messages_get(const char *key)
 {
+	return key;
 }
 
-/* content/fetch.h */
-const char *fetch_filetype(const char *unix_path)
+/* content/urldb.h */
+const char *urldb_get_auth_details(nsurl *url, const char *realm)
 {
 	return NULL;
 }
 
-/* content/fetch.h */
-char *fetch_mimetype(const char *ro_path)
+/* content/urldb.h */
+bool urldb_set_hsts_policy(nsurl *url, const char *header)
 {
-	return NULL;
+	return true;
 }
 
-/* utils/url.h */
-char *path_to_url(const char *path)
+/* content/urldb.h */
+bool urldb_get_hsts_enabled(nsurl *url)
 {
-	int urllen = strlen(path) + FILE_SCHEME_PREFIX_LEN + 1;
-	char *url = malloc(urllen);
+	return false;
+}
+
+/**
+ * Test fetch.
+ *
+ * Fetches are held on a list until the test completes them.
+ */
+struct fetch {
+	nsurl *url;
+	fetch_callback callback;
+	void *p;
+	struct fetch *next;
+};
 
-	if (url == NULL) {
-		return NULL;
+/** list of fetches which have not been completed */
+static struct fetch *fetch_list;
+
+/** total number of fetches started */
+static unsigned int fetch_count;
+
+/* content/fetch.h */
+nserror fetch_start(nsurl *url, nsurl *referer, fetch_callback callback,
+		    void *p, bool only_2xx, const char *post_urlenc,
+		    const struct fetch_multipart_data *post_multipart,
+		    bool verifiable, bool downgrade_tls,
+		    const char *headers[], enum fetch_priority priority,
+		    struct fetch **fetch_out)
+{
+	struct fetch *fetch;
+
+	fetch = calloc(1, sizeof(*fetch));
+	if (fetch == NULL) {
+		return NSERROR_NOMEM;
 	}
 
-	if (*path == '/') {
-		path++; /* file: paths are already absolute */
-	} 
+	fetch->url = nsurl_ref(url);
+	fetch->callback = callback;
+	fetch->p = p;
+	fetch->next = fetch_list;
+	fetch_list = fetch;
 
-	snprintf(url, urllen, "%s%s", FILE_SCHEME_PREFIX, path);
+	fetch_count++;
 
-	return url;
+	*fetch_out = fetch;
+
+	return NSERROR_OK;
 }
 
-/* utils/url.h */
-char *url_to_path(const char *url)
+/**
+ * Remove a fetch from the pending list and free it.
+ */
+static void test_fetch_free(struct fetch *fetch)
 {
-	char *url_path;
-	char *path = NULL;
+	struct fetch **prev;
 
-	if (url_unescape(url, 0, NULL, &url_path) == NSERROR_OK) {
-		/* return the absolute path including leading / */
-		path = strdup(url_path + (FILE_SCHEME_PREFIX_LEN - 1));
-		free(url_path);
+	for (prev = &fetch_list; *prev != NULL; prev = &(*prev)->next) {
+		if (*prev == fetch) {
+			*prev = fetch->next;
+			break;
+		}
 	}
 
-	return path;
+	nsurl_unref(fetch->url);
+	free(fetch);
 }
 
-/******************************************************************************
- * Things that are absolutely not reasonable, and should disappear            *
- ******************************************************************************/
+/* content/fetch.h */
+void fetch_abort(struct fetch *f)
+{
+	test_fetch_free(f);
+}
+
+/* content/fetch.h */
+bool fetch_can_fetch(const nsurl *url)
+{
+	return true;
+}
+
+/* content/fetch.h */
+long fetch_http_code(struct fetch *fetch)
+{
+	return 200;
+}
+
+/* content/fetch.h */
+struct fetch_multipart_data *
+fetch_multipart_data_clone(const struct fetch_multipart_data *list)
+{
+	return NULL;
+}
 
-#include "desktop/cookie_manager.h"
+/* content/fetch.h */
+void fetch_multipart_data_destroy(struct fetch_multipart_data *list)
+{
+}
 
-/* desktop/cookie_manager.h -- used by urldb 
+/**
+ * Complete every outstanding fetch.
  *
- * URLdb should have a cookies update event + handler registration
+ * Each fetch is sent a cacheable response header set, a small body
+ * and is then finished.
  */
-bool cookie_manager_add(const struct cookie_data *data)
+static void test_fetch_complete_all(void)
 {
-	return true;
+	static const char *headers[] = {
+		"HTTP/1.1 200 OK",
+		"Content-Type: text/plain",
+		"Cache-Control: max-age=3600",
+	};
+	fetch_msg msg;
+	struct fetch *fetch;
+	unsigned int idx;
+
+	while (fetch_list != NULL) {
+		fetch = fetch_list;
+
+		for (idx = 0; idx < NELEMS(headers); idx++) {
+			msg.type = FETCH_HEADER;
+			msg.data.header_or_data.buf =
+				(const uint8_t *)headers[idx];
+			msg.data.header_or_data.len = strlen(headers[idx]);
+			fetch->callback(&msg, fetch->p);
+		}
+
+		msg.type = FETCH_DATA;
+		msg.data.header_or_data.buf =
+			(const uint8_t *)nsurl_access(fetch->url);
+		msg.data.header_or_data.len = nsurl_length(fetch->url);
+		fetch->callback(&msg, fetch->p);
+
+		/* the fetcher frees itself once the fetch is finished */
+		msg.type = FETCH_FINISHED;
+		fetch->callback(&msg, fetch->p);
+
+		test_fetch_free(fetch);
+	}
 }
 
-/* desktop/cookie_manager.h -- used by urldb 
- *
- * URLdb should have a cookies removal handler registration
+/**
+ * Get the byte at an offset within the large test object.
  */
-void cookie_manager_remove(const struct cookie_data *data)
+static inline uint8_t test_large_byte(size_t offset)
 {
+	return (uint8_t)(offset % 251);
 }
 
-/* image/bitmap.h -- used by urldb 
- *
- * URLdb shouldn't care about bitmaps. 
- * This is because the legacy RO thumbnail stuff was hacked in and must die.
+/**
+ * Fill a chunk of the large test object.
  */
-void bitmap_destroy(void *bitmap)
+static void test_large_chunk(uint8_t *chunk, size_t offset)
 {
+	size_t idx;
+
+	for (idx = 0; idx < LARGE_CHUNK_SIZE; idx++) {
+		chunk[idx] = test_large_byte(offset + idx);
+	}
 }
-/* image/image.h -- used by urldb 
+
+/**
+ * Send the headers of a large object to the outstanding fetch.
  *
- * URLdb shouldn't care about bitmaps. 
- * This is because the legacy RO thumbnail stuff was hacked in and must die.
+ * \param fetch The fetch to send the headers to.
+ * \param content_length Content-Length header value or NULL for none.
+ * \param content_encoding Content-Encoding header value or NULL for none.
  */
-bool image_bitmap_plot(struct bitmap *bitmap, struct content_redraw_data *data, 
-		const struct rect *clip, const struct redraw_context *ctx)
+static void
+test_fetch_large_headers(struct fetch *fetch,
+			 const char *content_length,
+			 const char *content_encoding)
 {
-	return true;
+	char header[64];
+	fetch_msg msg;
+
+	msg.type = FETCH_HEADER;
+	msg.data.header_or_data.buf = (const uint8_t *)"HTTP/1.1 200 OK";
+	msg.data.header_or_data.len = SLEN("HTTP/1.1 200 OK");
+	fetch->callback(&msg, fetch->p);
+
+	if (content_length != NULL) {
+		snprintf(header, sizeof(header),
+			 "Content-Length: %s", content_length);
+		msg.data.header_or_data.buf = (const uint8_t *)header;
+		msg.data.header_or_data.len = strlen(header);
+		fetch->callback(&msg, fetch->p);
+	}
+
+	if (content_encoding != NULL) {
+		snprintf(header, sizeof(header),
+			 "Content-Encoding: %s", content_encoding);
+		msg.data.header_or_data.buf = (const uint8_t *)header;
+		msg.data.header_or_data.len = strlen(header);
+		fetch->callback(&msg, fetch->p);
+	}
 }
 
-/* content/fetchers/fetch_file.h -- used by fetcher core
+/**
+ * Complete the outstanding fetch with a large body.
  *
- * Simpler to stub this than haul in all the file fetcher's dependencies
+ * The body is delivered in chunks, running the scheduled callbacks
+ * periodically so users are sent the data while it is fetched.
+ *
+ * \param content_length Content-Length header value or NULL for none.
+ * \param content_encoding Content-Encoding header value or NULL for none.
  */
-void fetch_file_register(void)
+static void
+test_fetch_complete_large(const char *content_length,
+			  const char *content_encoding)
 {
+	uint8_t *chunk;
+	fetch_msg msg;
+	struct fetch *fetch;
+	size_t offset;
+	unsigned int chunks = 0;
+
+	fetch = fetch_list;
+	ck_assert(fetch != NULL);
+
+	test_fetch_large_headers(fetch, content_length, content_encoding);
+
+	chunk = malloc(LARGE_CHUNK_SIZE);
+	ck_assert(chunk != NULL);
+
+	msg.type = FETCH_DATA;
+	for (offset = 0; offset < LARGE_OBJECT_SIZE; offset += LARGE_CHUNK_SIZE) {
+		test_large_chunk(chunk, offset);
+		msg.data.header_or_data.buf = chunk;
+		msg.data.header_or_data.len = LARGE_CHUNK_SIZE;
+		fetch->callback(&msg, fetch->p);
+
+		if ((++chunks % LARGE_CHUNKS_PER_RUN) == 0) {
+			test_run_scheduled();
+		}
+	}
+
+	free(chunk);
+
+	msg.type = FETCH_FINISHED;
+	fetch->callback(&msg, fetch->p);
+
+	test_fetch_free(fetch);
 }
 
+/**
+ * Test backing store.
+ *
+ * Records the order objects are stored in and never returns them.
+ */
+struct test_stored {
+	nsurl *url;
+	enum backing_store_flags flags;
+	uint8_t *data;
+};
 
-/******************************************************************************
- * test: protocol handler                                                     *
- ******************************************************************************/
+static struct test_stored stored[MAX_STORED];
+static unsigned int stored_count;
 
-typedef struct test_context {
-	struct fetch *parent;
+static nserror test_store_initialise(const struct llcache_store_parameters *parameters)
+{
+	return NSERROR_OK;
+}
 
-	bool aborted;
-	bool locked;
+static nserror test_store_finalise(void)
+{
+	unsigned int idx;
 
-	struct test_context *r_prev;
-	struct test_context *r_next;
-} test_context;
+	for (idx = 0; idx < stored_count; idx++) {
+		nsurl_unref(stored[idx].url);
+		free(stored[idx].data);
+	}
+	stored_count = 0;
 
-static test_context *ring;
+	return NSERROR_OK;
+}
 
-bool test_initialise(lwc_string *scheme)
+static nserror test_store_store(nsurl *url, enum backing_store_flags flags,
+				uint8_t *data, const size_t datalen)
 {
-	/* Nothing to do */
-	return true;
+	ck_assert(stored_count < MAX_STORED);
+
+	stored[stored_count].url = nsurl_ref(url);
+	stored[stored_count].flags = flags;
+	stored[stored_count].data = data;
+	stored_count++;
+
+	return NSERROR_OK;
 }
 
-bool test_can_fetch(const nsurl *url)
+static nserror test_store_fetch(nsurl *url, enum backing_store_flags flags,
+				uint8_t **data, size_t *datalen)
 {
-	/* Nothing to do */
-	return true;
+	return NSERROR_NOT_FOUND;
 }
 
-void test_finalise(lwc_string *scheme)
+static nserror test_store_release(nsurl *url, enum backing_store_flags flags)
 {
-	/* Nothing to do */
+	unsigned int idx;
+
+	for (idx = 0; idx < stored_count; idx++) {
+		if ((stored[idx].flags == flags) &&
+		    (stored[idx].data != NULL) &&
+		    nsurl_compare(stored[idx].url, url, NSURL_COMPLETE)) {
+			free(stored[idx].data);
+			stored[idx].data = NULL;
+			return NSERROR_OK;
+		}
+	}
+
+	return NSERROR_NOT_FOUND;
 }
 
-void *test_setup_fetch(struct fetch *parent, nsurl *url, bool only_2xx,
-		bool downgrade_tls, const char *post_urlenc,
-		const struct fetch_multipart_data *post_multipart,
-		const char **headers)
+static nserror test_store_invalidate(nsurl *url)
 {
-	test_context *ctx = calloc(1, sizeof(test_context));
+	return NSERROR_OK;
+}
+
+static struct gui_llcache_table test_llcache_table = {
+	.initialise = test_store_initialise,
+	.finalise = test_store_finalise,
+	.store = test_store_store,
+	.fetch = test_store_fetch,
+	.release = test_store_release,
+	.invalidate = test_store_invalidate,
+};
+
+/******************************************************************************
+ * The actual test code                                                       *
+ ******************************************************************************/
+
+/** number of handles which have seen a done event */
+static unsigned int done_count;
 
-	if (ctx == NULL)
-		return NULL;
+/** number of bytes of data events seen */
+static size_t had_data_count;
 
-	ctx->parent = parent;
+/** all data events held the expected large object data */
+static bool had_data_valid;
+
+/** users force their objects to be streamed once they have headers */
+static bool stream_on_headers;
+
+static nserror event_handler(llcache_handle *handle,
+		const llcache_event *event, void *pw)
+{
+	size_t idx;
 
-	RING_INSERT(ring, ctx);
+	if (event->type == LLCACHE_EVENT_DONE) {
+		done_count++;
+	} else if (event->type == LLCACHE_EVENT_HAD_HEADERS) {
+		if (stream_on_headers) {
+			llcache_handle_force_stream(handle);
+		}
+	} else if (event->type == LLCACHE_EVENT_HAD_DATA) {
+		for (idx = 0; idx < event->data.data.len; idx++) {
+			if (event->data.data.buf[idx] !=
+			    test_large_byte(had_data_count + idx)) {
+				had_data_valid = false;
+				break;
+			}
+		}
+		had_data_count += event->data.data.len;
+	}
 
-	return ctx;
+	return NSERROR_OK;
 }
 
-bool test_start_fetch(void *handle)
+/**
+ * Create a test url for a given index
+ */
+static nsurl *test_url(unsigned int idx)
 {
-	/* Nothing to do */
-	return true;
+	char buf[64];
+	nsurl *url;
+
+	snprintf(buf, sizeof(buf), "http://test%u.example.com/obj/%u", idx % 97, idx);
+	ck_assert_int_eq(nsurl_create(buf, &url), NSERROR_OK);
+
+	return url;
 }
 
-void test_abort_fetch(void *handle)
+/**
+ * Retrieve a handle for a test url
+ */
+static llcache_handle *test_retrieve(unsigned int idx)
 {
-	test_context *ctx = handle;
+	llcache_handle *handle;
+	nsurl *url;
+	nserror res;
+
+	url = test_url(idx);
+
+	res = llcache_handle_retrieve(url, 0, NULL, NULL,
+				      event_handler, NULL, &handle);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	nsurl_unref(url);
 
-	ctx->aborted = true;
+	return handle;
 }
 
-void test_free_fetch(void *handle)
+/* Fixtures */
+
+static void llcache_create(void)
 {
-	test_context *ctx = handle;
+	struct llcache_parameters params = {
+		.limit = 64 * 1024 * 1024,
+		.minimum_lifetime = 120,
+		.minimum_bandwidth = 512 * 1024,
+		.maximum_bandwidth = 2 * 1024 * 1024,
+		.time_quantum = 10000,
+		.fetch_attempts = 1,
+	};
+
+	ck_assert_int_eq(corestrings_init(), NSERROR_OK);
+
+	test_table.llcache = null_llcache_table;
+	guit = &test_table;
+	stored_count = 0;
 
-	RING_REMOVE(ring, ctx);
+	memset(scheduled, 0, sizeof(scheduled));
+	fetch_count = 0;
+	done_count = 0;
+	had_data_count = 0;
+	had_data_valid = true;
+	stream_on_headers = false;
 
-	free(ctx);
+	ck_assert_int_eq(llcache_initialise(&params), NSERROR_OK);
 }
 
-void test_process(test_context *ctx)
+static void llcache_teardown(void)
 {
-	/** \todo Implement */
+	llcache_finalise();
+
+	/* fetches which were not completed are owned by the test */
+	while (fetch_list != NULL) {
+		test_fetch_free(fetch_list);
+	}
+
+	guit = NULL;
+
+	corestrings_fini();
 }
 
-void test_poll(lwc_string *scheme)
+/**
+ * Retrieving the same url twice yields the same object.
+ */
+START_TEST(llcache_retrieve_test)
 {
-	test_context *ctx, *next;
+	llcache_handle *handle;
+	llcache_handle *handle2;
 
-	if (ring == NULL)
-		return;
+	handle = test_retrieve(0);
+	ck_assert_int_eq(fetch_count, 1);
 
-	ctx = ring;
-	do {
-		next = ctx->r_next;
+	test_fetch_complete_all();
+	test_run_scheduled();
+	ck_assert_int_eq(done_count, 1);
 
-		if (ctx->locked)
-			continue;
+	handle2 = test_retrieve(0);
+	ck_assert_int_eq(fetch_count, 1);
+	ck_assert(llcache_handle_references_same_object(handle, handle2));
 
-		if (ctx->aborted == false) {
-			test_process(ctx);
-		}
+	test_run_scheduled();
+	ck_assert_int_eq(done_count, 2);
 
-		fetch_remove_from_queues(ctx->parent);
-		fetch_free(ctx->parent);
-	} while ((ctx = next) != ring && ring != NULL);
+	llcache_handle_release(handle2);
+	llcache_handle_release(handle);
 }
+END_TEST
 
-/******************************************************************************
- * The actual test code                                                       *
- ******************************************************************************/
-
-nserror query_handler(const llcache_query *query, void *pw,
-		llcache_query_response cb, void *cbpw)
+/**
+ * Distinct urls yield distinct objects.
+ */
+START_TEST(llcache_retrieve_distinct_test)
 {
-	/* I'm too lazy to actually implement this. It should queue the query, 
-	 * then deliver the response from main(). */
+	llcache_handle *handle;
+	llcache_handle *handle2;
 
-	return NSERROR_OK;
+	handle = test_retrieve(0);
+	handle2 = test_retrieve(1);
+	ck_assert_int_eq(fetch_count, 2);
+	ck_assert(!llcache_handle_references_same_object(handle, handle2));
+
+	llcache_handle_release(handle2);
+	llcache_handle_release(handle);
 }
+END_TEST
 
-nserror event_handler(llcache_handle *handle, 
-		const llcache_event *event, void *pw)
+/**
+ * Many objects in the cache are each found again without refetching.
+ */
+START_TEST(llcache_many_objects_test)
 {
-	static char *event_names[] = {
-		"HAD_HEADERS", "HAD_DATA", "DONE", "ERROR", "PROGRESS"
-	};
-	bool *done = pw;
+	llcache_handle **handles;
+	llcache_handle *handle;
+	unsigned int idx;
 
-	if (event->type != LLCACHE_EVENT_PROGRESS)
-		fprintf(stdout, "%p : %s\n", handle, event_names[event->type]);
+	handles = calloc(MANY_OBJECT_COUNT, sizeof(llcache_handle *));
+	ck_assert(handles != NULL);
 
-	/* Inform main() that the fetch completed */
-	if (event->type == LLCACHE_EVENT_DONE)
-		*done = true;
+	for (idx = 0; idx < MANY_OBJECT_COUNT; idx++) {
+		handles[idx] = test_retrieve(idx);
+	}
+	ck_assert_int_eq(fetch_count, MANY_OBJECT_COUNT);
+
+	test_fetch_complete_all();
+	test_run_scheduled();
+	ck_assert_int_eq(done_count, MANY_OBJECT_COUNT);
+
+	/* retrieve in reverse order to avoid any list order effects */
+	for (idx = MANY_OBJECT_COUNT; idx > 0; idx--) {
+		handle = test_retrieve(idx - 1);
+		ck_assert(llcache_handle_references_same_object(
+				  handle, handles[idx - 1]));
+		llcache_handle_release(handle);
+	}
+	ck_assert_int_eq(fetch_count, MANY_OBJECT_COUNT);
 
-	return NSERROR_OK;
+	/* release every other handle and purge the unused objects */
+	for (idx = 0; idx < MANY_OBJECT_COUNT; idx += 2) {
+		llcache_handle_release(handles[idx]);
+		handles[idx] = NULL;
+	}
+	test_run_scheduled();
+	llcache_clean(true);
+
+	/* purged objects must be fetched again, others must not */
+	for (idx = 0; idx < MANY_OBJECT_COUNT; idx++) {
+		handle = test_retrieve(idx);
+		if (handles[idx] != NULL) {
+			ck_assert(llcache_handle_references_same_object(
+					  handle, handles[idx]));
+			llcache_handle_release(handles[idx]);
+		}
+		handles[idx] = handle;
+	}
+	ck_assert_int_eq(fetch_count,
+			 MANY_OBJECT_COUNT + (MANY_OBJECT_COUNT / 2));
+
+	for (idx = 0; idx < MANY_OBJECT_COUNT; idx++) {
+		llcache_handle_release(handles[idx]);
+	}
+	free(handles);
 }
+END_TEST
 
-int main(int argc, char **argv)
+/**
+ * Objects are persisted most reused first.
+ */
+START_TEST(llcache_persist_order_test)
 {
-	nserror error;
+	llcache_handle *handles[4];
 	llcache_handle *handle;
-	llcache_handle *handle2;
-	lwc_string *scheme;
+	unsigned int idx;
+	unsigned int data_count = 0;
 	nsurl *url;
-	bool done = false;
 
-	/* Initialise subsystems */
-	fetch_init();
+	test_table.llcache = &test_llcache_table;
 
-	if (lwc_intern_string("test", SLEN("test"), &scheme) != lwc_error_ok) {
-		fprintf(stderr, "Failed to intern \"test\"\n");
-		return 1;
+	for (idx = 0; idx < NELEMS(handles); idx++) {
+		handles[idx] = test_retrieve(idx);
 	}
+	test_fetch_complete_all();
+	test_run_scheduled();
 
-	fetch_add_fetcher(scheme, test_initialise, test_can_fetch,
-			test_setup_fetch, test_start_fetch, test_abort_fetch,
-			test_free_fetch, test_poll, test_finalise);
-
-	/* Initialise low-level cache */
-	error = llcache_initialise(query_handler, NULL, 1024 * 1024);
-	if (error != NSERROR_OK) {
-		fprintf(stderr, "llcache_initialise: %d\n", error);
-		return 1;
+	/* reuse one object more than the others */
+	for (idx = 0; idx < 3; idx++) {
+		handle = test_retrieve(2);
+		llcache_handle_release(handle);
 	}
+	handle = test_retrieve(1);
+	llcache_handle_release(handle);
 
-	if (nsurl_create("http://www.netsurf-browser.org", &url) != NSERROR_OK) {
-		fprintf(stderr, "Failed creating url\n");
-		return 1;
+	for (idx = 0; idx < NELEMS(handles); idx++) {
+		llcache_handle_release(handles[idx]);
 	}
+	test_run_scheduled();
 
-	/* Retrieve an URL from the low-level cache (may trigger fetch) */
-	error = llcache_handle_retrieve(url, 
-			LLCACHE_RETRIEVE_VERIFIABLE, NULL, NULL,
-			event_handler, &done, &handle);
-	if (error != NSERROR_OK) {
-		fprintf(stderr, "llcache_handle_retrieve: %d\n", error);
-		return 1;
-	}
+	/* exceeding the cache limit causes objects to be persisted */
+	llcache_clean(true);
 
-	/* Poll relevant components */
-	while (done == false) {
-		llcache_poll();
+	for (idx = 0; idx < stored_count; idx++) {
+		if (stored[idx].flags != BACKING_STORE_NONE) {
+			continue;
+		}
+		switch (data_count++) {
+		case 0:
+			url = test_url(2);
+			break;
+		case 1:
+			url = test_url(1);
+			break;
+		default:
+			url = NULL;
+			break;
+		}
+		if (url != NULL) {
+			ck_assert(nsurl_compare(stored[idx].url, url,
+						NSURL_COMPLETE));
+			nsurl_unref(url);
+		}
 	}
+	ck_assert_int_eq(data_count, NELEMS(handles));
+}
+END_TEST
 
-	done = false;
-	error = llcache_handle_retrieve(url,
-			LLCACHE_RETRIEVE_VERIFIABLE, NULL, NULL,
-			event_handler, &done, &handle2);
-	if (error != NSERROR_OK) {
-		fprintf(stderr, "llcache_handle_retrieve: %d\n", error);
-		return 1;
+/**
+ * Large object header variations
+ */
+struct large_object_test {
+	const char *name;		/**< Description of the variation */
+	const char *content_length;	/**< Content-Length header or NULL */
+	const char *content_encoding;	/**< Content-Encoding header or NULL */
+};
+
+static const struct large_object_test large_object_test_vec[] = {
+	{ "exact length", "33554432", NULL },
+	{ "unknown length", NULL, NULL },
+	{ "encoded length", "1048576", "gzip" },
+	{ "short length", "16777216", NULL },
+	{ "overstated length", "67108864", NULL },
+};
+
+/**
+ * Large objects are received and their source retrieved intact.
+ */
+START_TEST(llcache_large_object_test)
+{
+	const struct large_object_test *tst = &large_object_test_vec[_i];
+	llcache_handle *handle;
+	const uint8_t *data;
+	size_t size;
+	size_t idx;
+	unsigned int runs;
+
+	handle = test_retrieve(0);
+	ck_assert_int_eq(fetch_count, 1);
+
+	test_fetch_complete_large(tst->content_length, tst->content_encoding);
+
+	/* the source is gathered into one buffer when the fetch completes */
+	data = llcache_handle_get_source_data(handle, &size);
+	ck_assert(data != NULL);
+	ck_assert_int_eq(size, LARGE_OBJECT_SIZE);
+
+	/* remaining data is emitted a segment at a time */
+	for (runs = 0; (done_count == 0) && (runs < 1024); runs++) {
+		test_run_scheduled();
 	}
+	ck_assert_int_eq(done_count, 1);
+	ck_assert_int_eq(had_data_count, LARGE_OBJECT_SIZE);
+	ck_assert(had_data_valid);
+
+	data = llcache_handle_get_source_data(handle, &size);
+	ck_assert(data != NULL);
+	ck_assert_int_eq(size, LARGE_OBJECT_SIZE);
+	for (idx = 0; idx < size; idx++) {
+		if (data[idx] != test_large_byte(idx)) {
+			break;
+		}
+	}
+	ck_assert_int_eq(idx, LARGE_OBJECT_SIZE);
 
-	while (done == false) {
-		llcache_poll();
+	llcache_handle_release(handle);
+}
+END_TEST
+
+/**
+ * Streamed large objects are sent to the user as they are fetched
+ * and are not retained.
+ */
+START_TEST(llcache_large_stream_test)
+{
+	const struct large_object_test *tst = &large_object_test_vec[_i];
+	llcache_handle *handle;
+	struct fetch *fetch;
+	fetch_msg msg;
+	uint8_t *chunk;
+	size_t offset;
+	size_t size;
+
+	stream_on_headers = true;
+
+	handle = test_retrieve(0);
+	fetch = fetch_list;
+	ck_assert(fetch != NULL);
+
+	test_fetch_large_headers(fetch, tst->content_length,
+				 tst->content_encoding);
+
+	chunk = malloc(LARGE_CHUNK_SIZE);
+	ck_assert(chunk != NULL);
+
+	/* the first chunk is sent once the user has the headers */
+	msg.type = FETCH_DATA;
+	msg.data.header_or_data.buf = chunk;
+	msg.data.header_or_data.len = LARGE_CHUNK_SIZE;
+	test_large_chunk(chunk, 0);
+	fetch->callback(&msg, fetch->p);
+	test_run_scheduled();
+	ck_assert_int_eq(had_data_count, LARGE_CHUNK_SIZE);
+
+	/* subsequent chunks are sent as they arrive */
+	for (offset = LARGE_CHUNK_SIZE;
+	     offset < LARGE_OBJECT_SIZE;
+	     offset += LARGE_CHUNK_SIZE) {
+		test_large_chunk(chunk, offset);
+		fetch->callback(&msg, fetch->p);
+		ck_assert_int_eq(had_data_count, offset + LARGE_CHUNK_SIZE);
 	}
 
-	fprintf(stdout, "%p, %p -> %d\n", handle, handle2,
-			llcache_handle_references_same_object(handle, handle2));
+	free(chunk);
+
+	msg.type = FETCH_FINISHED;
+	fetch->callback(&msg, fetch->p);
+	test_fetch_free(fetch);
+
+	test_run_scheduled();
+	ck_assert_int_eq(done_count, 1);
+	ck_assert_int_eq(had_data_count, LARGE_OBJECT_SIZE);
+	ck_assert(had_data_valid);
+
+	/* no source was retained */
+	llcache_handle_get_source_data(handle, &size);
+	ck_assert_int_eq(size, 0);
 
-	/* Cleanup */
-	llcache_handle_release(handle2);
 	llcache_handle_release(handle);
+}
+END_TEST
+
+static TCase *llcache_large_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Large object");
+
+	tcase_add_checked_fixture(tc, llcache_create, llcache_teardown);
+
+	tcase_add_loop_test(tc,
+			    llcache_large_object_test,
+			    0, NELEMS(large_object_test_vec));
+
+	tcase_add_loop_test(tc,
+			    llcache_large_stream_test,
+			    0, NELEMS(large_object_test_vec));
+
+	return tc;
+}
+
+static TCase *llcache_persist_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Persist");
+
+	tcase_add_checked_fixture(tc, llcache_create, llcache_teardown);
+
+	tcase_add_test(tc, llcache_persist_order_test);
+
+	return tc;
+}
 
-	fetch_quit();
+static TCase *llcache_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Retrieve");
+
+	tcase_add_checked_fixture(tc, llcache_create, llcache_teardown);
+
+	tcase_add_test(tc, llcache_retrieve_test);
+	tcase_add_test(tc, llcache_retrieve_distinct_test);
+	tcase_add_test(tc, llcache_many_objects_test);
+
+	return tc;
+}
+
+static Suite *llcache_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("Low level cache");
+
+	suite_add_tcase(s, llcache_case_create());
+	suite_add_tcase(s, llcache_persist_case_create());
+	suite_add_tcase(s, llcache_large_case_create());
 
-	return 0;
+	return s;
 }
 
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(llcache_suite_create());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -431,6 +431,30 @@ def run_test_step_action_wait_loading(ctx, step):
     win = ctx['windows'][step['window']]
     win.wait_start_loading()
 
+def run_test_check_bitmap_decoded(bitmaps, expected):
+    """check a plotted bitmap has the expected size and mean colour
+
+    The mean of each channel may differ by the tolerance to allow for
+    differences between image decoding library versions.
+    """
+    tolerance = int(expected.get('tolerance', 4))
+    print("        Check bitmap decoded as {}".format(repr(expected)))
+    for bitmap in bitmaps:
+        fields = dict(zip(bitmap[0::2], bitmap[1::2]))
+        if 'MEAN_RED' not in fields:
+            continue
+        if ((int(fields['SOURCE_WIDTH']) != int(expected['width'])) or
+                (int(fields['SOURCE_HEIGHT']) != int(expected['height']))):
+            continue
+        mean = [int(fields[chan]) for chan in
+                ('MEAN_RED', 'MEAN_GREEN', 'MEAN_BLUE', 'MEAN_ALPHA')]
+        if all(abs(got - want) <= tolerance
+               for got, want in zip(mean, expected['mean'])):
+            return
+        print("        Bitmap mean {}".format(repr(mean)))
+    raise AssertionError("No bitmap decoded as {}".format(repr(expected)))
+
+
 def run_test_step_action_plot_check(ctx, step):
     print(get_indent(ctx) + "Action: " + step["action"])
     assert_browser(ctx)
@@ -440,10 +464,12 @@ def run_test_step_action_plot_check(ctx, step):
     else:
         checks = {}
     all_text_list = []
+    text_plots = []
     bitmaps = []
     for plot in win.redraw():
         if plot[0] == 'TEXT':
             all_text_list.extend(plot[6:])
+            text_plots.append((int(plot[2]), int(plot[4]), " ".join(plot[6:])))
         if plot[0] == 'BITMAP':
             bitmaps.append(plot[1:])
     all_text = " ".join(all_text_list)
@@ -454,9 +480,16 @@ def run_test_step_action_plot_check(ctx, step):
         elif 'text-not-contains' in check.keys():
             print("        Check {} NOT in {}".format(repr(check['text-not-contains']), repr(all_text)))
             assert check['text-not-contains'] not in all_text
+        elif 'text-position' in check.keys():
+            expected = check['text-position']
+            print("        Check {} plotted at x {}".format(repr(expected['text']), expected['x']))
+            assert any(expected['text'] in text and x == int(expected['x'])
+                       for x, _y, text in text_plots), repr(text_plots)
         elif 'bitmap-count' in check.keys():
             print("        Check bitmap count is {}".format(int(check['bitmap-count'])))
             assert len(bitmaps) == int(check['bitmap-count'])
+        elif 'bitmap-decoded' in check.keys():
+            run_test_check_bitmap_decoded(bitmaps, check['bitmap-decoded'])
         else:
             raise AssertionError("Unknown check: {}".format(repr(check)))
 
@@ -588,6 +621,26 @@ def run_test_step_action_js_exec(ctx, step):
     win.js_exec(cmd)
 
 
+def run_test_step_action_window_resize(ctx, step):
+    print(get_indent(ctx) + "Action: " + step["action"])
+    assert_browser(ctx)
+    tag = step['window']
+    width = int(step['width'])
+    height = int(step['height'])
+    print(get_indent(ctx) + "        " + tag + " Resize to {}x{}".format(width, height))
+    win = ctx['windows'].get(tag)
+    assert win is not None
+    win.resize(width, height)
+
+
+def run_test_step_action_options(ctx, step):
+    print(get_indent(ctx) + "Action: " + step["action"])
+    assert_browser(ctx)
+    for option in step.get('options', []):
+        print(get_indent(ctx) + "        " + option)
+        ctx['browser'].pass_options(option)
+
+
 def run_test_step_action_page_info_state(ctx, step):
     print(get_indent(ctx) + "Action: " + step["action"])
     assert_browser(ctx)
@@ -629,6 +682,8 @@ STEP_HANDLERS = {
     "clear-log":     run_test_step_action_clear_log,
     "wait-log":      run_test_step_action_wait_log,
     "js-exec":       run_test_step_action_js_exec,
+    "window-resize": run_test_step_action_window_resize,
+    "options":       run_test_step_action_options,
     "page-info-state":
                      run_test_step_action_page_info_state,
     "quit":          run_test_step_action_quit,
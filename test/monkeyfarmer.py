@@ -489,6 +489,9 @@ class BrowserWindow:
     def js_exec(self, src):
         self.browser.farmer.tell_monkey("WINDOW EXEC WIN %s %s" % (self.winid, src))
 
+    def resize(self, width, height):
+        self.browser.farmer.tell_monkey("WINDOW RESIZE WIN %s WIDTH %s HEIGHT %s" % (self.winid, width, height))
+
     def handle(self, action, *args):
         handler = getattr(self, "handle_window_" + action, None)
         if handler is not None:
@@ -0,0 +1,290 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Test counting of element siblings for CSS selection.
+ *
+ * Counts made with a sibling position cache are compared with those
+ * made by walking the siblings, over a table whose rows are separated
+ * by whitespace text and occasional elements of another name.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <dom/dom.h>
+
+#include "utils/errors.h"
+#include "css/siblings.h"
+
+/** number of rows in the test table */
+#define TEST_ROWS 200
+
+/** number of cells in each table row */
+#define ROW_CELLS 3
+
+/**
+ * Test table
+ */
+struct test_table {
+	dom_document *doc; /**< document owning the table */
+	dom_element *tbody; /**< table body */
+	dom_node **rows; /**< rows and other elements in the body */
+	unsigned int row_count; /**< number of entries in rows */
+	dom_node **cells; /**< cells of each row */
+};
+
+/**
+ * Append a new node to a parent
+ */
+static void append_node(dom_node *parent, dom_node *child)
+{
+	dom_node *result;
+	dom_exception err;
+
+	err = dom_node_append_child(parent, child, &result);
+	ck_assert(err == DOM_NO_ERR);
+	dom_node_unref(result);
+}
+
+static dom_element *create_element(dom_document *doc, const char *name)
+{
+	dom_element *element;
+	dom_string *str;
+	dom_exception err;
+
+	err = dom_string_create((const uint8_t *)name, strlen(name), &str);
+	ck_assert(err == DOM_NO_ERR);
+	err = dom_document_create_element(doc, str, &element);
+	ck_assert(err == DOM_NO_ERR);
+	dom_string_unref(str);
+
+	return element;
+}
+
+static void append_whitespace(dom_document *doc, dom_node *parent)
+{
+	dom_text *text;
+	dom_string *str;
+	dom_exception err;
+
+	err = dom_string_create((const uint8_t *)"\n  ", 3, &str);
+	ck_assert(err == DOM_NO_ERR);
+	err = dom_document_create_text_node(doc, str, &text);
+	ck_assert(err == DOM_NO_ERR);
+	dom_string_unref(str);
+
+	append_node(parent, (dom_node *)text);
+	dom_node_unref(text);
+}
+
+/**
+ * Create a table body of rows separated by whitespace, with every
+ * seventh entry a script element rather than a row.
+ */
+static void create_table(struct test_table *table, unsigned int rows)
+{
+	dom_exception err;
+	unsigned int idx;
+	unsigned int cell;
+
+	err = dom_implementation_create_document(DOM_IMPLEMENTATION_HTML,
+			NULL, NULL, NULL, NULL, NULL, &table->doc);
+	ck_assert(err == DOM_NO_ERR);
+
+	table->tbody = create_element(table->doc, "tbody");
+	table->row_count = rows;
+	table->rows = malloc(sizeof(dom_node *) * rows);
+	table->cells = malloc(sizeof(dom_node *) * rows * ROW_CELLS);
+	ck_assert(table->rows != NULL && table->cells != NULL);
+
+	for (idx = 0; idx < rows; idx++) {
+		dom_element *row;
+
+		append_whitespace(table->doc, (dom_node *)table->tbody);
+
+		row = create_element(table->doc,
+				(idx % 7 == 3) ? "script" : "tr");
+		append_node((dom_node *)table->tbody, (dom_node *)row);
+		table->rows[idx] = (dom_node *)row;
+
+		for (cell = 0; cell < ROW_CELLS; cell++) {
+			dom_element *td;
+
+			td = create_element(table->doc,
+					(cell == 0) ? "th" : "td");
+			append_node((dom_node *)row, (dom_node *)td);
+			table->cells[idx * ROW_CELLS + cell] = (dom_node *)td;
+		}
+	}
+}
+
+static void destroy_table(struct test_table *table)
+{
+	unsigned int idx;
+
+	for (idx = 0; idx < table->row_count * ROW_CELLS; idx++) {
+		dom_node_unref(table->cells[idx]);
+	}
+	for (idx = 0; idx < table->row_count; idx++) {
+		dom_node_unref(table->rows[idx]);
+	}
+	free(table->cells);
+	free(table->rows);
+	dom_node_unref(table->tbody);
+	dom_node_unref(table->doc);
+}
+
+/**
+ * Check cached counts of a node's siblings against walked counts.
+ */
+static void check_counts(struct nscss_sibling_cache *cache, dom_node *n)
+{
+	int32_t cached, walked;
+	unsigned int mode;
+
+	for (mode = 0; mode < 4; mode++) {
+		bool same_name = (mode & 1) != 0;
+		bool after = (mode & 2) != 0;
+
+		ck_assert(nscss_count_siblings(cache, n, same_name, after,
+				&cached) == NSERROR_OK);
+		ck_assert(nscss_count_siblings(NULL, n, same_name, after,
+				&walked) == NSERROR_OK);
+		ck_assert_int_eq(cached, walked);
+	}
+}
+
+/**
+ * Counts without a cache are correct at the ends of the table.
+ */
+START_TEST(siblings_walk_test)
+{
+	struct test_table table;
+	int32_t count;
+
+	create_table(&table, TEST_ROWS);
+
+	ck_assert(nscss_count_siblings(NULL, table.rows[0], false, false,
+			&count) == NSERROR_OK);
+	ck_assert_int_eq(count, 0);
+
+	ck_assert(nscss_count_siblings(NULL, table.rows[0], false, true,
+			&count) == NSERROR_OK);
+	ck_assert_int_eq(count, TEST_ROWS - 1);
+
+	/* every seventh entry from the fourth is a script */
+	ck_assert(nscss_count_siblings(NULL, table.rows[TEST_ROWS - 2],
+			true, false, &count) == NSERROR_OK);
+	ck_assert_int_eq(count, TEST_ROWS - 2 - (TEST_ROWS - 2 - 4) / 7 - 1);
+
+	ck_assert(nscss_count_siblings(NULL, table.cells[ROW_CELLS - 1],
+			true, false, &count) == NSERROR_OK);
+	ck_assert_int_eq(count, ROW_CELLS - 2);
+
+	destroy_table(&table);
+}
+END_TEST
+
+/**
+ * Cached counts are correct in document order.
+ */
+START_TEST(siblings_cache_order_test)
+{
+	struct nscss_sibling_cache *cache;
+	struct test_table table;
+	unsigned int idx;
+	unsigned int cell;
+
+	create_table(&table, TEST_ROWS);
+	ck_assert(nscss_sibling_cache_create(&cache) == NSERROR_OK);
+
+	for (idx = 0; idx < TEST_ROWS; idx++) {
+		check_counts(cache, table.rows[idx]);
+		for (cell = 0; cell < ROW_CELLS; cell++) {
+			check_counts(cache, table.cells[idx * ROW_CELLS + cell]);
+		}
+	}
+
+	nscss_sibling_cache_destroy(cache);
+	destroy_table(&table);
+}
+END_TEST
+
+/**
+ * Cached counts are correct in reverse and scattered orders.
+ */
+START_TEST(siblings_cache_disorder_test)
+{
+	struct nscss_sibling_cache *cache;
+	struct test_table table;
+	unsigned int idx;
+
+	create_table(&table, TEST_ROWS);
+	ck_assert(nscss_sibling_cache_create(&cache) == NSERROR_OK);
+
+	for (idx = TEST_ROWS; idx > 0; idx--) {
+		check_counts(cache, table.rows[idx - 1]);
+	}
+
+	for (idx = 0; idx < TEST_ROWS; idx++) {
+		check_counts(cache, table.rows[(idx * 37) % TEST_ROWS]);
+	}
+
+	nscss_sibling_cache_destroy(cache);
+	destroy_table(&table);
+}
+END_TEST
+
+static TCase *siblings_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Counting");
+
+	tcase_add_test(tc, siblings_walk_test);
+	tcase_add_test(tc, siblings_cache_order_test);
+	tcase_add_test(tc, siblings_cache_disorder_test);
+
+	return tc;
+}
+
+static Suite *siblings_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("Sibling counting");
+
+	suite_add_tcase(s, siblings_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(siblings_suite_create());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,466 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Test compiled text search patterns.
+ *
+ * Matches are checked against the backtracking matcher previously used
+ * for every search.
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+
+#include "utils/utils.h"
+#include "utils/strmatch.h"
+
+/**
+ * Literal and wildcard match test vector
+ */
+struct match_test {
+	const char *pattern;
+	bool case_sens;
+	const char *string;
+	int offset; /**< expected offset of match or -1 for none */
+	size_t length; /**< expected length of match */
+};
+
+static const struct match_test match_tests[] = {
+	{ "a", true, "bcda", 3, 1 },
+	{ "a", true, "bcdA", -1, 0 },
+	{ "a", false, "bcdA", 3, 1 },
+	{ "1", false, "x1y", 1, 1 },
+	{ "ab", true, "xaaby", 2, 2 },
+	{ "needle", true, "haystack with a needle in it", 16, 6 },
+	{ "NEEDLE", false, "haystack with a needle in it", 16, 6 },
+	{ "NEEDLE", true, "haystack with a needle in it", -1, 0 },
+	{ "needle", true, "needl", -1, 0 },
+	{ "needle", true, "needle", 0, 6 },
+	{ "abcab", true, "abcaabcab", 4, 5 },
+	{ "caf\xc3\xa9", true, "le caf\xc3\xa9 noir", 3, 5 },
+	{ "a#c", true, "xxabcxx", 2, 3 },
+	{ "a*c", true, "xxabbbcxx", 2, 5 },
+	{ "A*C", false, "xxabbbcxx", 2, 5 },
+	{ "*b", true, "aab", 2, 1 },
+	{ "a*z", true, "abc", -1, 0 },
+};
+
+
+/**
+ * The backtracking matcher previously used for all searches
+ */
+static const char *reference_find(const char *string, int s_len,
+		const char *pattern, int p_len, bool case_sens,
+		unsigned int *m_len)
+{
+	struct { const char *ss, *s, *p; bool first; } context[16];
+	const char *ep = pattern + p_len;
+	const char *es = string  + s_len;
+	const char *p = pattern - 1;
+	const char *ss = string;
+	const char *s = string;
+	bool first = true;
+	int top = 0;
+
+	while (p < ep) {
+		bool matches;
+		if (p < pattern || *p == '*') {
+			char ch;
+			do p++; while (p < ep && *p == '*');
+			if (p >= ep) break;
+			ch = *p;
+			if (ch != '#') {
+				if (!case_sens) ch = toupper(ch);
+				while (s < es) {
+					if (case_sens) {
+						if (*s == ch) break;
+					} else if (toupper(*s) == ch)
+						break;
+					s++;
+				}
+			}
+			if (s < es) {
+				if (top < 16) {
+					context[top].ss = ss;
+					context[top].s  = s + 1;
+					context[top].p  = p - 1;
+					context[top].first = first;
+					top++;
+				}
+				if (first) {
+					ss = s;
+					first = false;
+				}
+				matches = true;
+			} else {
+				matches = false;
+			}
+		} else if (s < es) {
+			char ch = *p;
+			if (ch == '#')
+				matches = true;
+			else {
+				if (case_sens)
+					matches = (*s == ch);
+				else
+					matches = (toupper(*s) == toupper(ch));
+			}
+			if (matches && first) {
+				ss = s;
+				first = false;
+			}
+		} else {
+			matches = false;
+		}
+
+		if (matches) {
+			p++; s++;
+		} else {
+			if (--top < 0)
+				return NULL;
+			ss = context[top].ss;
+			s  = context[top].s;
+			p  = context[top].p;
+			first = context[top].first;
+		}
+	}
+
+	*m_len = max(s - ss, 1);
+	return ss;
+}
+
+/**
+ * Count matches searching from the end of each, as the search does
+ */
+static size_t count_matches(const struct strmatch *matcher,
+		const char *string, size_t len)
+{
+	const char *pos = string;
+	size_t count = 0;
+	size_t match_len;
+
+	while ((pos = strmatch_find(matcher, pos, len - (pos - string),
+			&match_len)) != NULL) {
+		pos += match_len;
+		count++;
+	}
+
+	return count;
+}
+
+static size_t count_reference_matches(const char *pattern, bool case_sens,
+		const char *string, size_t len)
+{
+	const char *pos = string;
+	size_t count = 0;
+	unsigned int match_len;
+
+	while (len - (pos - string) > 0 &&
+	       (pos = reference_find(pos, len - (pos - string), pattern,
+			strlen(pattern), case_sens, &match_len)) != NULL) {
+		pos += match_len;
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * Generate random text from a small alphabet so matches are frequent
+ */
+static void random_text(char *text, size_t len, const char *alphabet)
+{
+	size_t alen = strlen(alphabet);
+	size_t idx;
+
+	for (idx = 0; idx < len; idx++) {
+		text[idx] = alphabet[rand() % alen];
+	}
+	text[len] = '\0';
+}
+
+
+/**
+ * Matches are found at the expected position.
+ */
+START_TEST(strmatch_find_test)
+{
+	const struct match_test *tst = &match_tests[_i];
+	struct strmatch *matcher;
+	const char *pos;
+	size_t match_len;
+	nserror res;
+
+	res = strmatch_create(tst->pattern, strlen(tst->pattern),
+			tst->case_sens, &matcher);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	pos = strmatch_find(matcher, tst->string, strlen(tst->string),
+			&match_len);
+	if (tst->offset < 0) {
+		ck_assert(pos == NULL);
+	} else {
+		ck_assert(pos != NULL);
+		ck_assert_int_eq(pos - tst->string, tst->offset);
+		ck_assert_int_eq(match_len, tst->length);
+
+		ck_assert(strmatch_prefix(matcher, pos,
+				strlen(pos), &match_len));
+		ck_assert_int_eq(match_len, tst->length);
+	}
+
+	strmatch_destroy(matcher);
+}
+END_TEST
+
+/**
+ * Matches are those found by the backtracking matcher.
+ */
+START_TEST(strmatch_reference_test)
+{
+	static const char *patterns[] = {
+		"a", "ab", "aba", "abc", "bca", "Ab", "aAb", "abcab",
+		"abcabc", "cab ", " a", "a#b", "a*b", "#", "ab*c#a"
+	};
+	char text[512];
+	unsigned int idx;
+	int round;
+
+	srand(_i + 1);
+
+	for (round = 0; round < 200; round++) {
+		random_text(text, rand() % (sizeof(text) - 1),
+				"abcABC ");
+
+		for (idx = 0; idx < NOF_ELEMENTS(patterns); idx++) {
+			struct strmatch *matcher;
+			bool case_sens = (round & 1) ? true : false;
+
+			ck_assert_int_eq(strmatch_create(patterns[idx],
+					strlen(patterns[idx]), case_sens,
+					&matcher), NSERROR_OK);
+
+			ck_assert_int_eq(count_matches(matcher, text,
+							strlen(text)),
+					count_reference_matches(patterns[idx],
+							case_sens, text,
+							strlen(text)));
+
+			strmatch_destroy(matcher);
+		}
+	}
+}
+END_TEST
+
+/**
+ * Non-ASCII characters match case insensitively.
+ */
+START_TEST(strmatch_folded_test)
+{
+	const char *text = "Tr\xc3\xa8s CAF\xc3\x89 cr\xc3\xa8me";
+	struct strmatch *matcher;
+	const char *pos;
+	size_t match_len;
+
+	ck_assert_int_eq(strmatch_create("caf\xc3\xa9", 5, false, &matcher),
+			NSERROR_OK);
+	pos = strmatch_find(matcher, text, strlen(text), &match_len);
+	ck_assert(pos != NULL);
+	ck_assert_int_eq(pos - text, 6);
+	ck_assert_int_eq(match_len, 5);
+	strmatch_destroy(matcher);
+
+	ck_assert_int_eq(strmatch_create("caf\xc3\xa9", 5, true, &matcher),
+			NSERROR_OK);
+	pos = strmatch_find(matcher, text, strlen(text), &match_len);
+	ck_assert(pos == NULL);
+	strmatch_destroy(matcher);
+}
+END_TEST
+
+/**
+ * Refinement is only permitted where it finds every match.
+ */
+START_TEST(strmatch_refines_test)
+{
+	static const struct {
+		const char *pattern;
+		const char *refined;
+		bool case_sens;
+		bool refines;
+	} tests[] = {
+		{ "ab", "abc", true, true },
+		{ "ab", "ab", true, true },
+		{ "ab", "ABc", false, true },
+		{ "ab", "ABc", true, false },
+		{ "ab", "ac", true, false },
+		{ "abc", "ab", true, false },
+		{ "aa", "aab", true, false }, /* matches of aa overlap */
+		{ "aba", "abac", true, false },
+		{ "ab", "ab*c", true, false },
+		{ "a*", "a*b", true, false },
+	};
+	unsigned int idx;
+
+	for (idx = 0; idx < NOF_ELEMENTS(tests); idx++) {
+		struct strmatch *matcher;
+		struct strmatch *refined;
+
+		ck_assert_int_eq(strmatch_create(tests[idx].pattern,
+				strlen(tests[idx].pattern),
+				tests[idx].case_sens, &matcher), NSERROR_OK);
+		ck_assert_int_eq(strmatch_create(tests[idx].refined,
+				strlen(tests[idx].refined),
+				tests[idx].case_sens, &refined), NSERROR_OK);
+
+		ck_assert(strmatch_refines(matcher, refined) ==
+				tests[idx].refines);
+
+		strmatch_destroy(refined);
+		strmatch_destroy(matcher);
+	}
+}
+END_TEST
+
+/**
+ * Refined matches are those a new search finds.
+ */
+START_TEST(strmatch_refine_matches_test)
+{
+	static const char *patterns[] = {
+		"ab", "abc", "abca", "abcab", "abcabc",
+		"b", "bc", "bca", "bcaa", "bcaab"
+	};
+	const char *matches[1024];
+	char text[1024];
+	unsigned int idx;
+	int round;
+
+	srand(_i + 1);
+
+	for (round = 0; round < 200; round++) {
+		struct strmatch *matcher = NULL;
+		unsigned int nmatches = 0;
+
+		random_text(text, sizeof(text) - 1, "abc");
+
+		for (idx = 0; idx < NOF_ELEMENTS(patterns); idx++) {
+			struct strmatch *refined;
+			unsigned int kept = 0;
+			const char *end = text;
+			size_t match_len;
+			unsigned int m;
+
+			ck_assert_int_eq(strmatch_create(patterns[idx],
+					strlen(patterns[idx]), true,
+					&refined), NSERROR_OK);
+
+			if (matcher == NULL ||
+			    !strmatch_refines(matcher, refined)) {
+				strmatch_destroy(matcher);
+				matcher = refined;
+				nmatches = 0;
+				end = text;
+				while (nmatches < NOF_ELEMENTS(matches) &&
+				       (end = strmatch_find(matcher, end,
+						sizeof(text) - 1 - (end - text),
+						&match_len)) != NULL) {
+					matches[nmatches++] = end;
+					end += match_len;
+				}
+				continue;
+			}
+
+			/* refine as the search does */
+			for (m = 0; m < nmatches; m++) {
+				if (matches[m] >= end &&
+				    strmatch_prefix(refined, matches[m],
+						sizeof(text) - 1 -
+						(matches[m] - text),
+						&match_len)) {
+					matches[kept++] = matches[m];
+					end = matches[m] + match_len;
+				}
+			}
+			nmatches = kept;
+
+			ck_assert_int_eq(nmatches, count_matches(refined,
+					text, sizeof(text) - 1));
+
+			strmatch_destroy(matcher);
+			matcher = refined;
+		}
+
+		strmatch_destroy(matcher);
+	}
+}
+END_TEST
+
+static TCase *strmatch_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Matching");
+
+	tcase_add_loop_test(tc, strmatch_find_test,
+			0, NOF_ELEMENTS(match_tests));
+	tcase_add_loop_test(tc, strmatch_reference_test, 0, 4);
+	tcase_add_test(tc, strmatch_folded_test);
+
+	return tc;
+}
+
+static TCase *strmatch_refine_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Refinement");
+
+	tcase_add_test(tc, strmatch_refines_test);
+	tcase_add_loop_test(tc, strmatch_refine_matches_test, 0, 4);
+
+	return tc;
+}
+
+static Suite *strmatch_suite_create(void)
+{
+	Suite *s;
+	s = suite_create("Search pattern");
+
+	suite_add_tcase(s, strmatch_case_create());
+	suite_add_tcase(s, strmatch_refine_case_create());
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int number_failed;
+	SRunner *sr;
+
+	sr = srunner_create(strmatch_suite_create());
+
+	srunner_run_all(sr, CK_ENV);
+
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
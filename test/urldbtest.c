@@ -26,7 +26,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <utime.h>
 #include <check.h>
 
 #include <libwapcaplet/libwapcaplet.h>
@@ -710,6 +712,260 @@ static TCase *urldb_session_case_create(void)
 	return tc;
 }
 
+/**
+ * Snapshot round trip test
+ *
+ * A snapshot of the loaded database is saved and loaded again and the
+ * text export must match the reference output.
+ */
+START_TEST(urldb_snapshot_session_test)
+{
+	nserror res;
+	char *snapnam;
+	char *outnam;
+
+	/* writing output requires options initialising */
+	res = nsoption_init(NULL, NULL, NULL);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	res = urldb_load(test_urldb_path);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	snapnam = strdup(testnam(NULL));
+	res = urldb_save_snapshot(snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	urldb_destroy();
+
+	res = urldb_load(snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	/* saving a snapshot while paths are held in one */
+	res = urldb_save_snapshot(snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	urldb_destroy();
+
+	res = urldb_load(snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	/* export as text and check it matches the reference */
+	outnam = testnam(NULL);
+	res = urldb_save(outnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	ck_assert_int_eq(cmp(outnam, test_urldb_out_path), 0);
+
+	unlink(outnam);
+	unlink(snapnam);
+	free(snapnam);
+
+	/* finalise options */
+	res = nsoption_finalise(NULL, NULL);
+	ck_assert_int_eq(res, NSERROR_OK);
+}
+END_TEST
+
+/**
+ * Replace every occurrence of a string in a file
+ *
+ * The replacement must be the same length as the string replaced.
+ */
+static void file_replace(const char *filename, const char *str, const char *rep)
+{
+	size_t len = strlen(str);
+	uint8_t *data;
+	uint8_t *pos;
+	size_t size;
+	FILE *fp;
+
+	ck_assert_uint_eq(strlen(rep), len);
+
+	fp = fopen(filename, "r+b");
+	ck_assert(fp != NULL);
+	ck_assert_int_eq(fseek(fp, 0, SEEK_END), 0);
+	size = ftell(fp);
+	data = malloc(size);
+	ck_assert(data != NULL);
+	ck_assert_int_eq(fseek(fp, 0, SEEK_SET), 0);
+	ck_assert_uint_eq(fread(data, 1, size, fp), size);
+
+	for (pos = data; pos + len <= data + size; pos++) {
+		if (memcmp(pos, str, len) == 0) {
+			memcpy(pos, rep, len);
+		}
+	}
+
+	ck_assert_int_eq(fseek(fp, 0, SEEK_SET), 0);
+	ck_assert_uint_eq(fwrite(data, 1, size, fp), size);
+	fclose(fp);
+	free(data);
+}
+
+/**
+ * Snapshot with a repeated host test
+ *
+ * A snapshot holding two records for the same host is loaded and the
+ * paths of both records must be present.
+ */
+START_TEST(urldb_snapshot_repeated_host_test)
+{
+	const char *urls[] = {
+		"http://www.aaa.example.com/one.html",
+		"http://www.bbb.example.com/two.html",
+		"http://www.aaa.example.com/two.html",
+	};
+	const struct url_data *data;
+	char *snapnam;
+	unsigned int idx;
+	nserror res;
+	nsurl *url;
+
+	/* writing output requires options initialising */
+	res = nsoption_init(NULL, NULL, NULL);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	for (idx = 0; idx < 2; idx++) {
+		url = make_url(urls[idx]);
+		ck_assert(urldb_add_url(url) == true);
+		res = urldb_update_url_visit_data(url);
+		ck_assert_int_eq(res, NSERROR_OK);
+		nsurl_unref(url);
+	}
+
+	snapnam = strdup(testnam(NULL));
+	res = urldb_save_snapshot(snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	urldb_destroy();
+
+	/* make both host records name the same host */
+	file_replace(snapnam, "www.bbb.example.com", "www.aaa.example.com");
+
+	res = urldb_load(snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	/* both records paths are present on the host */
+	url = make_url(urls[0]);
+	data = urldb_get_url_data(url);
+	ck_assert(data != NULL);
+	ck_assert_int_eq(data->visits, 1);
+	nsurl_unref(url);
+
+	url = make_url(urls[2]);
+	data = urldb_get_url_data(url);
+	ck_assert(data != NULL);
+	ck_assert_int_eq(data->visits, 1);
+	nsurl_unref(url);
+
+	unlink(snapnam);
+	free(snapnam);
+
+	/* finalise options */
+	res = nsoption_finalise(NULL, NULL);
+	ck_assert_int_eq(res, NSERROR_OK);
+}
+END_TEST
+
+/**
+ * set the modification time of a file relative to now
+ */
+static void file_age(const char *filename, time_t age)
+{
+	struct utimbuf times;
+
+	times.actime = times.modtime = time(NULL) - age;
+	ck_assert_int_eq(utime(filename, &times), 0);
+}
+
+/**
+ * Snapshot alongside text database test
+ *
+ * The snapshot is only loaded in place of the text database when it is
+ * at least as recent.
+ */
+START_TEST(urldb_snapshot_with_text_test)
+{
+	const struct url_data *data;
+	char *textnam;
+	char *snapnam;
+	nserror res;
+	nsurl *url;
+
+	/* writing output requires options initialising */
+	res = nsoption_init(NULL, NULL, NULL);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	url = make_url("http://www.example.com/snapshot.html");
+
+	textnam = strdup(testnam(NULL));
+	snapnam = strdup(testnam(NULL));
+
+	/* the snapshot does not hold the unvisited url, the text database does */
+	ck_assert(urldb_add_url(url) == true);
+	res = urldb_save_snapshot(snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+	res = urldb_update_url_visit_data(url);
+	ck_assert_int_eq(res, NSERROR_OK);
+	res = urldb_save(textnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+
+	/* a text database saved after the snapshot is loaded */
+	urldb_destroy();
+	file_age(snapnam, 60);
+	res = urldb_load_with_snapshot(textnam, snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+	data = urldb_get_url_data(url);
+	ck_assert(data != NULL);
+	ck_assert_int_eq(data->visits, 1);
+
+	/* an up to date snapshot is loaded */
+	urldb_destroy();
+	file_age(textnam, 120);
+	res = urldb_load_with_snapshot(textnam, snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+	ck_assert(urldb_get_url_data(url) == NULL);
+
+	/* the text database is loaded without a snapshot */
+	urldb_destroy();
+	unlink(snapnam);
+	res = urldb_load_with_snapshot(textnam, snapnam);
+	ck_assert_int_eq(res, NSERROR_OK);
+	data = urldb_get_url_data(url);
+	ck_assert(data != NULL);
+	ck_assert_int_eq(data->visits, 1);
+
+	nsurl_unref(url);
+	unlink(textnam);
+	free(textnam);
+	free(snapnam);
+
+	/* finalise options */
+	res = nsoption_finalise(NULL, NULL);
+	ck_assert_int_eq(res, NSERROR_OK);
+}
+END_TEST
+
+/**
+ * Test case for url database snapshots
+ */
+static TCase *urldb_snapshot_case_create(void)
+{
+	TCase *tc;
+	tc = tcase_create("Snapshot");
+
+	/* ensure corestrings are initialised and finalised for every test */
+	tcase_add_checked_fixture(tc,
+				  urldb_create,
+				  urldb_teardown);
+
+	tcase_add_test(tc, urldb_snapshot_session_test);
+	tcase_add_test(tc, urldb_snapshot_repeated_host_test);
+	tcase_add_test(tc, urldb_snapshot_with_text_test);
+
+	return tc;
+}
+
 static int cb_count;
 
 static bool urldb_iterate_entries_cb(nsurl *url, const struct url_data *data)
@@ -1134,6 +1390,7 @@ static Suite *urldb_suite_create(void)
 	suite_add_tcase(s, urldb_api_case_create());
 	suite_add_tcase(s, urldb_add_get_case_create());
 	suite_add_tcase(s, urldb_session_case_create());
+	suite_add_tcase(s, urldb_snapshot_case_create());
 	suite_add_tcase(s, urldb_case_create());
 	suite_add_tcase(s, urldb_cookie_case_create());
 	suite_add_tcase(s, urldb_original_case_create());
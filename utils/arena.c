@@ -0,0 +1,267 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Arena allocator implementation.
+ *
+ * Allocations are made from the head block until it is exhausted when
+ * a new head block is allocated. Allocations larger than a quarter of
+ * the block size are given a block of their own which is placed behind
+ * the head so the remainder of the head block is not wasted.
+ *
+ * Allocations with a destructor are preceded by a record linking them
+ * into a list which is walked when the arena is destroyed.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/utils.h"
+#include "utils/arena.h"
+
+/** Default size of arena blocks */
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+/** Alignment satisfying every type allocated from an arena */
+typedef union {
+	void *p;
+	long long ll;
+	long double ld;
+	void (*fn)(void);
+} arena_align_t;
+
+/** Round a size up to the allocation alignment */
+#define ARENA_ALIGN(size) \
+	(((size) + sizeof(arena_align_t) - 1) & ~(sizeof(arena_align_t) - 1))
+
+/**
+ * Block of arena memory
+ */
+struct arena_block {
+	struct arena_block *next; /**< next block in arena */
+	size_t size; /**< size of the block data in bytes */
+	size_t used; /**< bytes of the block data in use */
+	arena_align_t data[FLEX_ARRAY_LEN_DECL]; /**< block data */
+};
+
+/**
+ * Record of an allocation with a destructor
+ */
+struct arena_destructor_record {
+	/** previous allocation with a destructor */
+	struct arena_destructor_record *next;
+	/** destructor for allocation */
+	arena_destructor *destructor;
+};
+
+/**
+ * Arena
+ */
+struct arena {
+	struct arena_block *blocks; /**< head block, allocations made here */
+	struct arena_destructor_record *destructors; /**< destructor list */
+	size_t block_size; /**< size of blocks data in bytes */
+	size_t size; /**< total size of all blocks in bytes */
+};
+
+
+/**
+ * Allocate a block and link it into an arena.
+ *
+ * \param arena Arena to add block to.
+ * \param size Size of the block data in bytes.
+ * \param head Whether the block becomes the head block.
+ * \return The new block or NULL on memory exhaustion.
+ */
+static struct arena_block *
+arena_block_create(struct arena *arena, size_t size, bool head)
+{
+	struct arena_block *block;
+
+	block = malloc(sizeof(struct arena_block) + size);
+	if (block == NULL) {
+		return NULL;
+	}
+
+	block->size = size;
+	block->used = 0;
+
+	if (head || (arena->blocks == NULL)) {
+		block->next = arena->blocks;
+		arena->blocks = block;
+	} else {
+		block->next = arena->blocks->next;
+		arena->blocks->next = block;
+	}
+
+	arena->size += sizeof(struct arena_block) + size;
+
+	return block;
+}
+
+
+/* exported interface documented in utils/arena.h */
+struct arena *arena_create(size_t block_size)
+{
+	struct arena *arena;
+
+	arena = malloc(sizeof(struct arena));
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	arena->blocks = NULL;
+	arena->destructors = NULL;
+	arena->block_size = ARENA_ALIGN((block_size != 0) ?
+			block_size : ARENA_DEFAULT_BLOCK_SIZE);
+	arena->size = sizeof(struct arena);
+
+	return arena;
+}
+
+
+/* exported interface documented in utils/arena.h */
+void arena_destroy(struct arena *arena)
+{
+	struct arena_destructor_record *record;
+	struct arena_block *block;
+
+	if (arena == NULL) {
+		return;
+	}
+
+	for (record = arena->destructors; record != NULL;
+			record = record->next) {
+		record->destructor((char *)record +
+				ARENA_ALIGN(sizeof(*record)));
+	}
+
+	while (arena->blocks != NULL) {
+		block = arena->blocks;
+		arena->blocks = block->next;
+		free(block);
+	}
+
+	free(arena);
+}
+
+
+/* exported interface documented in utils/arena.h */
+void *arena_alloc(struct arena *arena, size_t size)
+{
+	struct arena_block *block = arena->blocks;
+	void *ptr;
+
+	size = ARENA_ALIGN(size);
+
+	if ((block == NULL) || ((block->size - block->used) < size)) {
+		if (size > (arena->block_size / 4)) {
+			/* large allocations get a block to themselves */
+			block = arena_block_create(arena, size, false);
+		} else {
+			block = arena_block_create(arena,
+					arena->block_size, true);
+		}
+		if (block == NULL) {
+			return NULL;
+		}
+	}
+
+	ptr = (char *)block->data + block->used;
+	block->used += size;
+
+	return ptr;
+}
+
+
+/* exported interface documented in utils/arena.h */
+void *arena_alloc_destructor(struct arena *arena, size_t size,
+		arena_destructor *destructor)
+{
+	struct arena_destructor_record *record;
+
+	record = arena_alloc(arena, ARENA_ALIGN(sizeof(*record)) + size);
+	if (record == NULL) {
+		return NULL;
+	}
+
+	record->destructor = destructor;
+	record->next = arena->destructors;
+	arena->destructors = record;
+
+	return (char *)record + ARENA_ALIGN(sizeof(*record));
+}
+
+
+/* exported interface documented in utils/arena.h */
+void *arena_zalloc(struct arena *arena, size_t size)
+{
+	void *ptr;
+
+	ptr = arena_alloc(arena, size);
+	if (ptr != NULL) {
+		memset(ptr, 0, size);
+	}
+
+	return ptr;
+}
+
+
+/* exported interface documented in utils/arena.h */
+void *arena_memdup(struct arena *arena, const void *ptr, size_t size)
+{
+	void *dup;
+
+	dup = arena_alloc(arena, size);
+	if (dup != NULL) {
+		memcpy(dup, ptr, size);
+	}
+
+	return dup;
+}
+
+
+/* exported interface documented in utils/arena.h */
+char *arena_strndup(struct arena *arena, const char *str, size_t len)
+{
+	char *dup;
+
+	dup = arena_alloc(arena, len + 1);
+	if (dup != NULL) {
+		memcpy(dup, str, len);
+		dup[len] = '\0';
+	}
+
+	return dup;
+}
+
+
+/* exported interface documented in utils/arena.h */
+char *arena_strdup(struct arena *arena, const char *str)
+{
+	return arena_strndup(arena, str, strlen(str));
+}
+
+
+/* exported interface documented in utils/arena.h */
+size_t arena_size(struct arena *arena)
+{
+	return arena->size;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Arena allocator interface.
+ *
+ * An arena hands out memory from large blocks by advancing a pointer.
+ * Individual allocations are never freed, instead every allocation is
+ * released together when the arena is destroyed. Allocations may have
+ * a destructor which is called when the arena is destroyed.
+ */
+
+#ifndef NETSURF_UTILS_ARENA_H
+#define NETSURF_UTILS_ARENA_H
+
+#include <stddef.h>
+
+struct arena;
+
+/**
+ * Destructor called for an allocation when its arena is destroyed.
+ *
+ * \param ptr The allocation being destroyed.
+ */
+typedef void (arena_destructor)(void *ptr);
+
+/**
+ * Create a new arena.
+ *
+ * \param block_size Size of the blocks allocations are made from or
+ *                   zero for the default.
+ * \return Handle for newly-created arena, or NULL on memory exhaustion.
+ */
+struct arena *arena_create(size_t block_size);
+
+/**
+ * Destroy an arena.
+ *
+ * The destructors of allocations are called in the reverse order to
+ * that in which the allocations were made, then all memory held by
+ * the arena is released.
+ *
+ * \param arena Arena to destroy.
+ */
+void arena_destroy(struct arena *arena);
+
+/**
+ * Allocate memory from an arena.
+ *
+ * The memory is suitably aligned for any type and is not initialised.
+ *
+ * \param arena Arena to allocate from.
+ * \param size Size of allocation in bytes.
+ * \return Pointer to allocation or NULL on memory exhaustion.
+ */
+void *arena_alloc(struct arena *arena, size_t size);
+
+/**
+ * Allocate memory from an arena with a destructor.
+ *
+ * \param arena Arena to allocate from.
+ * \param size Size of allocation in bytes.
+ * \param destructor Function called with the allocation when the
+ *                   arena is destroyed.
+ * \return Pointer to allocation or NULL on memory exhaustion.
+ */
+void *arena_alloc_destructor(struct arena *arena, size_t size,
+		arena_destructor *destructor);
+
+/**
+ * Allocate zero filled memory from an arena.
+ *
+ * \param arena Arena to allocate from.
+ * \param size Size of allocation in bytes.
+ * \return Pointer to allocation or NULL on memory exhaustion.
+ */
+void *arena_zalloc(struct arena *arena, size_t size);
+
+/**
+ * Duplicate memory into an arena.
+ *
+ * \param arena Arena to allocate from.
+ * \param ptr Memory to duplicate.
+ * \param size Size of memory in bytes.
+ * \return Pointer to duplicate or NULL on memory exhaustion.
+ */
+void *arena_memdup(struct arena *arena, const void *ptr, size_t size);
+
+/**
+ * Duplicate a string into an arena.
+ *
+ * \param arena Arena to allocate from.
+ * \param str NUL terminated string to duplicate.
+ * \return Pointer to duplicate or NULL on memory exhaustion.
+ */
+char *arena_strdup(struct arena *arena, const char *str);
+
+/**
+ * Duplicate a string of given length into an arena.
+ *
+ * The duplicate is NUL terminated.
+ *
+ * \param arena Arena to allocate from.
+ * \param str String to duplicate.
+ * \param len Length of string in bytes.
+ * \return Pointer to duplicate or NULL on memory exhaustion.
+ */
+char *arena_strndup(struct arena *arena, const char *str, size_t len);
+
+/**
+ * Get the memory held by an arena.
+ *
+ * \param arena Arena to query.
+ * \return Total size of the blocks held by the arena in bytes.
+ */
+size_t arena_size(struct arena *arena);
+
+#endif
@@ -21,7 +21,9 @@
  * Trivial bloom filter
  */
 
+#include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include "utils/bloom.h"
 #include "utils/utils.h"
 
@@ -73,6 +75,14 @@ void bloom_destroy(struct bloom_filter *b)
         free(b);
 }
 
+void bloom_copy(struct bloom_filter *dst, const struct bloom_filter *src)
+{
+	assert(dst->size == src->size);
+
+	memcpy(dst->filter, src->filter, src->size);
+	dst->items = src->items;
+}
+
 void bloom_insert_str(struct bloom_filter *b, const char *s, size_t z)
 {
 	uint32_t hash = fnv(s, z);
@@ -43,6 +43,14 @@ struct bloom_filter *bloom_create(size_t size);
  */
 void bloom_destroy(struct bloom_filter *b);
 
+/**
+ * Copy the contents of a bloom filter into another of the same size.
+ *
+ * \param dst Bloom filter to replace the contents of
+ * \param src Bloom filter to copy
+ */
+void bloom_copy(struct bloom_filter *dst, const struct bloom_filter *src);
+
 /**
  * Insert a string of given length (may include NULs) into the filter,
  * using an internal hash function.
@@ -0,0 +1,630 @@
+/*
+ * Copyright 2004 John M Bell <jmb202@ecs.soton.ac.uk>
+ * Copyright 2005 Adrian Lees <adrianl@users.sourceforge.net>
+ * Copyright 2009 Mark Benjamin <netsurf-browser.org.MarkBenjamin@dfgh.net>
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Compiled text search pattern implementation.
+ *
+ * Patterns without wildcards are literals, searched for with the
+ * Boyer-Moore-Horspool algorithm, or with memchr for short patterns
+ * whose first byte is unaffected by case. Literals are compared
+ * bytewise, ignoring the case of ASCII letters if required.
+ *
+ * Where utf8proc is available, literals containing non-ASCII
+ * characters which match case insensitively are compared a character
+ * at a time after folding both pattern and text to lower case.
+ *
+ * Patterns containing wildcards are matched by backtracking.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WITH_UTF8PROC
+#include <parserutils/charset/utf8.h>
+#include <libutf8proc/utf8proc.h>
+#endif
+
+#include "utils/utils.h"
+#include "utils/ascii.h"
+#include "utils/strmatch.h"
+
+/** Literals shorter than this are searched for by their first byte */
+#define STRMATCH_SCAN_MAX 4
+
+/** Nesting of wildcards the backtracking matcher can resume from */
+#define STRMATCH_WILDCARD_DEPTH 16
+
+/**
+ * Type of compiled pattern
+ */
+enum strmatch_type {
+	STRMATCH_LITERAL, /**< bytewise literal */
+	STRMATCH_FOLDED, /**< literal compared by folded character */
+	STRMATCH_WILDCARD, /**< pattern containing wildcards */
+};
+
+/**
+ * Compiled search pattern
+ */
+struct strmatch {
+	enum strmatch_type type; /**< type of pattern */
+	bool case_sens; /**< whether matches are case sensitive */
+	size_t border; /**< longest proper prefix which is also a suffix */
+	size_t skip[256]; /**< Horspool shift for each byte value */
+	uint32_t *folded; /**< folded characters for STRMATCH_FOLDED */
+	size_t folded_len; /**< number of folded characters */
+	size_t len; /**< length of pattern in bytes */
+	char pattern[FLEX_ARRAY_LEN_DECL]; /**< pattern, lower case if
+					    * ASCII case insensitive */
+};
+
+
+/**
+ * Fold a byte for comparison with a literal pattern
+ *
+ * \param matcher compiled pattern
+ * \param c byte to fold
+ * \return the folded byte
+ */
+static inline char strmatch_fold(const struct strmatch *matcher, char c)
+{
+	return matcher->case_sens ? c : ascii_to_lower(c);
+}
+
+
+/**
+ * Compare a literal pattern with a string of at least its length
+ */
+static inline bool
+strmatch_literal_equal(const struct strmatch *matcher, const char *string)
+{
+	size_t idx;
+
+	if (matcher->case_sens) {
+		return memcmp(string, matcher->pattern, matcher->len) == 0;
+	}
+
+	for (idx = 0; idx < matcher->len; idx++) {
+		if (ascii_to_lower(string[idx]) != matcher->pattern[idx]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * Find a literal pattern with the Boyer-Moore-Horspool algorithm
+ */
+static const char *
+strmatch_find_horspool(const struct strmatch *matcher,
+		       const char *string,
+		       size_t len)
+{
+	size_t last = matcher->len - 1;
+	const char *pos = string;
+	const char *end = string + len - last;
+
+	while (pos < end) {
+		unsigned char c = pos[last];
+
+		if ((strmatch_fold(matcher, c) == matcher->pattern[last]) &&
+		    strmatch_literal_equal(matcher, pos)) {
+			return pos;
+		}
+
+		pos += matcher->skip[c];
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Find a short literal pattern by scanning for its first byte
+ */
+static const char *
+strmatch_find_scan(const struct strmatch *matcher,
+		   const char *string,
+		   size_t len)
+{
+	const char *pos = string;
+	const char *end = string + len - (matcher->len - 1);
+
+	while (pos < end) {
+		pos = memchr(pos, matcher->pattern[0], end - pos);
+		if (pos == NULL) {
+			return NULL;
+		}
+
+		if (strmatch_literal_equal(matcher, pos)) {
+			return pos;
+		}
+
+		pos++;
+	}
+
+	return NULL;
+}
+
+
+#ifdef WITH_UTF8PROC
+
+/**
+ * Fold a character for case insensitive comparison
+ */
+static inline uint32_t strmatch_fold_ucs4(uint32_t c)
+{
+	if (c < 0x80) {
+		return ascii_to_lower(c);
+	}
+
+	return utf8proc_tolower(c);
+}
+
+
+/**
+ * Decode a character for comparison
+ *
+ * \param string string to decode from
+ * \param len length of string in bytes, at least one
+ * \param clen updated to the length of the character in bytes
+ * \return the character, or U+FFFD if the data is not valid UTF-8
+ */
+static inline uint32_t
+strmatch_decode(const char *string, size_t len, size_t *clen)
+{
+	uint32_t c;
+
+	if ((unsigned char)string[0] < 0x80) {
+		*clen = 1;
+		return string[0];
+	}
+
+	if (parserutils_charset_utf8_to_ucs4((const uint8_t *)string, len,
+			&c, clen) != PARSERUTILS_OK) {
+		*clen = 1;
+		return 0xfffd;
+	}
+
+	return c;
+}
+
+
+/**
+ * Match a folded literal at the start of a string
+ */
+static bool
+strmatch_prefix_folded(const struct strmatch *matcher,
+		       const char *string,
+		       size_t len,
+		       size_t *match_len)
+{
+	size_t offset = 0;
+	size_t idx;
+
+	for (idx = 0; idx < matcher->folded_len; idx++) {
+		size_t clen;
+		uint32_t c;
+
+		if (offset >= len) {
+			return false;
+		}
+
+		c = strmatch_decode(string + offset, len - offset, &clen);
+		if (strmatch_fold_ucs4(c) != matcher->folded[idx]) {
+			return false;
+		}
+
+		offset += clen;
+	}
+
+	*match_len = offset;
+
+	return true;
+}
+
+
+/**
+ * Find a folded literal in a string
+ */
+static const char *
+strmatch_find_folded(const struct strmatch *matcher,
+		     const char *string,
+		     size_t len,
+		     size_t *match_len)
+{
+	size_t offset = 0;
+
+	while (offset < len) {
+		size_t clen;
+
+		if (strmatch_prefix_folded(matcher, string + offset,
+				len - offset, match_len)) {
+			return string + offset;
+		}
+
+		strmatch_decode(string + offset, len - offset, &clen);
+		offset += clen;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Compile a folded literal pattern
+ *
+ * \param matcher compiled pattern with the pattern bytes present
+ * \return NSERROR_OK on success or NSERROR_NOMEM on memory exhaustion
+ */
+static nserror strmatch_create_folded(struct strmatch *matcher)
+{
+	size_t offset = 0;
+
+	/* never more characters than bytes */
+	matcher->folded = malloc(sizeof(uint32_t) * matcher->len);
+	if (matcher->folded == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	while (offset < matcher->len) {
+		size_t clen;
+		uint32_t c;
+
+		c = strmatch_decode(matcher->pattern + offset,
+				matcher->len - offset, &clen);
+		matcher->folded[matcher->folded_len++] = strmatch_fold_ucs4(c);
+		offset += clen;
+	}
+
+	return NSERROR_OK;
+}
+
+#endif
+
+
+/**
+ * Find the first match of a pattern containing wildcards
+ *
+ * \param  string     the string to be searched (unterminated)
+ * \param  s_len      length of the string to be searched
+ * \param  pattern    the pattern for which we are searching (unterminated)
+ * \param  p_len      length of pattern
+ * \param  case_sens  true iff case sensitive match required
+ * \param  m_len      accepts length of match in bytes
+ * \return pointer to first match, NULL if none
+ */
+static const char *
+strmatch_find_wildcard(const char *string, size_t s_len,
+		       const char *pattern, size_t p_len, bool case_sens,
+		       size_t *m_len)
+{
+	struct {
+		const char *ss, *s, *p;
+		bool first;
+	} context[STRMATCH_WILDCARD_DEPTH];
+	const char *ep = pattern + p_len;
+	const char *es = string  + s_len;
+	const char *p = pattern - 1;  /* a virtual '*' before the pattern */
+	const char *ss = string;
+	const char *s = string;
+	bool first = true;
+	int top = 0;
+
+	while (p < ep) {
+		bool matches;
+		if (p < pattern || *p == '*') {
+			char ch;
+
+			/* skip any further asterisks; one is the same as many
+			*/
+			do p++; while (p < ep && *p == '*');
+
+			/* if we're at the end of the pattern, yes, it matches
+			*/
+			if (p >= ep) break;
+
+			/* anything matches a # so continue matching from
+			   here, and stack a context that will try to match
+			   the wildcard against the next character */
+
+			ch = *p;
+			if (ch != '#') {
+				/* scan forwards until we find a match for
+				   this char */
+				if (!case_sens) ch = ascii_to_upper(ch);
+				while (s < es) {
+					if (case_sens) {
+						if (*s == ch) break;
+					} else if (ascii_to_upper(*s) == ch)
+						break;
+					s++;
+				}
+			}
+
+			if (s < es) {
+				/* remember where we are in case the match
+				   fails; we may then resume */
+				if (top < STRMATCH_WILDCARD_DEPTH) {
+					context[top].ss = ss;
+					context[top].s  = s + 1;
+					context[top].p  = p - 1;
+					/* ptr to last asterisk */
+					context[top].first = first;
+					top++;
+				}
+
+				if (first) {
+					ss = s;
+					/* remember first non-'*' char */
+					first = false;
+				}
+
+				matches = true;
+			} else {
+				matches = false;
+			}
+
+		} else if (s < es) {
+			char ch = *p;
+			if (ch == '#')
+				matches = true;
+			else {
+				if (case_sens)
+					matches = (*s == ch);
+				else
+					matches = (ascii_to_upper(*s) ==
+						   ascii_to_upper(ch));
+			}
+			if (matches && first) {
+				ss = s;  /* remember first non-'*' char */
+				first = false;
+			}
+		} else {
+			matches = false;
+		}
+
+		if (matches) {
+			p++; s++;
+		} else {
+			/* doesn't match,
+			 * resume with stacked context if we have one */
+			if (--top < 0)
+				return NULL;  /* no match, give up */
+
+			ss = context[top].ss;
+			s  = context[top].s;
+			p  = context[top].p;
+			first = context[top].first;
+		}
+	}
+
+	/* end of pattern reached */
+	*m_len = max(s - ss, 1);
+	return ss;
+}
+
+
+/* exported interface documented in utils/strmatch.h */
+nserror strmatch_create(const char *pattern, size_t len, bool case_sens,
+		struct strmatch **matcher_out)
+{
+	struct strmatch *matcher;
+	size_t *border;
+	size_t idx;
+
+	matcher = malloc(sizeof(struct strmatch) + len + 1);
+	if (matcher == NULL) {
+		return NSERROR_NOMEM;
+	}
+
+	matcher->type = STRMATCH_LITERAL;
+	matcher->case_sens = case_sens;
+	matcher->border = 0;
+	matcher->folded = NULL;
+	matcher->folded_len = 0;
+	matcher->len = len;
+	memcpy(matcher->pattern, pattern, len);
+	matcher->pattern[len] = '\0';
+
+	for (idx = 0; idx < len; idx++) {
+		if (pattern[idx] == '*' || pattern[idx] == '#') {
+			matcher->type = STRMATCH_WILDCARD;
+			*matcher_out = matcher;
+			return NSERROR_OK;
+		}
+	}
+
+#ifdef WITH_UTF8PROC
+	if (case_sens == false) {
+		for (idx = 0; idx < len; idx++) {
+			if ((unsigned char)pattern[idx] >= 0x80) {
+				matcher->type = STRMATCH_FOLDED;
+				break;
+			}
+		}
+
+		if (matcher->type == STRMATCH_FOLDED) {
+			if (strmatch_create_folded(matcher) != NSERROR_OK) {
+				free(matcher);
+				return NSERROR_NOMEM;
+			}
+			*matcher_out = matcher;
+			return NSERROR_OK;
+		}
+	}
+#endif
+
+	if (case_sens == false) {
+		for (idx = 0; idx < len; idx++) {
+			matcher->pattern[idx] = ascii_to_lower(pattern[idx]);
+		}
+	}
+
+	/* Horspool shift; a byte shifts by its distance from the end of
+	 * the pattern, excluding the last byte, or the pattern length
+	 */
+	for (idx = 0; idx < 256; idx++) {
+		matcher->skip[idx] = len;
+	}
+	for (idx = 0; idx + 1 < len; idx++) {
+		unsigned char c = matcher->pattern[idx];
+
+		matcher->skip[c] = len - 1 - idx;
+		if (case_sens == false) {
+			matcher->skip[(unsigned char)ascii_to_upper(c)] =
+				len - 1 - idx;
+		}
+	}
+
+	/* Knuth-Morris-Pratt failure function for the border length */
+	if (len > 1) {
+		border = malloc(sizeof(size_t) * len);
+		if (border == NULL) {
+			free(matcher);
+			return NSERROR_NOMEM;
+		}
+
+		border[0] = 0;
+		for (idx = 1; idx < len; idx++) {
+			size_t k = border[idx - 1];
+
+			while (k > 0 &&
+			       matcher->pattern[idx] != matcher->pattern[k]) {
+				k = border[k - 1];
+			}
+			if (matcher->pattern[idx] == matcher->pattern[k]) {
+				k++;
+			}
+			border[idx] = k;
+		}
+
+		matcher->border = border[len - 1];
+		free(border);
+	}
+
+	*matcher_out = matcher;
+
+	return NSERROR_OK;
+}
+
+
+/* exported interface documented in utils/strmatch.h */
+void strmatch_destroy(struct strmatch *matcher)
+{
+	if (matcher != NULL) {
+		free(matcher->folded);
+		free(matcher);
+	}
+}
+
+
+/* exported interface documented in utils/strmatch.h */
+const char *strmatch_find(const struct strmatch *matcher,
+		const char *string, size_t len, size_t *match_len)
+{
+	const char *pos;
+
+	switch (matcher->type) {
+	case STRMATCH_WILDCARD:
+		return strmatch_find_wildcard(string, len,
+				matcher->pattern, matcher->len,
+				matcher->case_sens, match_len);
+
+#ifdef WITH_UTF8PROC
+	case STRMATCH_FOLDED:
+		return strmatch_find_folded(matcher, string, len, match_len);
+#endif
+
+	default:
+		break;
+	}
+
+	if ((matcher->len == 0) || (len < matcher->len)) {
+		return NULL;
+	}
+
+	if ((matcher->len < STRMATCH_SCAN_MAX) &&
+	    (matcher->case_sens || !ascii_is_alpha(matcher->pattern[0]))) {
+		pos = strmatch_find_scan(matcher, string, len);
+	} else {
+		pos = strmatch_find_horspool(matcher, string, len);
+	}
+
+	if (pos != NULL) {
+		*match_len = matcher->len;
+	}
+
+	return pos;
+}
+
+
+/* exported interface documented in utils/strmatch.h */
+bool strmatch_prefix(const struct strmatch *matcher,
+		const char *string, size_t len, size_t *match_len)
+{
+	switch (matcher->type) {
+	case STRMATCH_WILDCARD:
+		return strmatch_find_wildcard(string, len,
+				matcher->pattern, matcher->len,
+				matcher->case_sens, match_len) == string;
+
+#ifdef WITH_UTF8PROC
+	case STRMATCH_FOLDED:
+		return strmatch_prefix_folded(matcher, string, len, match_len);
+#endif
+
+	default:
+		break;
+	}
+
+	if ((matcher->len == 0) || (len < matcher->len) ||
+	    (strmatch_literal_equal(matcher, string) == false)) {
+		return false;
+	}
+
+	*match_len = matcher->len;
+
+	return true;
+}
+
+
+/* exported interface documented in utils/strmatch.h */
+bool strmatch_refines(const struct strmatch *matcher,
+		const struct strmatch *refined)
+{
+	/* Without a border the matches of a literal cannot overlap, so
+	 * searching from the end of each match finds every occurrence,
+	 * and an extended literal can only occur where those do.
+	 */
+	return (matcher->type == STRMATCH_LITERAL) &&
+		(refined->type == STRMATCH_LITERAL) &&
+		(matcher->case_sens == refined->case_sens) &&
+		(matcher->len > 0) &&
+		(matcher->border == 0) &&
+		(refined->len >= matcher->len) &&
+		(memcmp(matcher->pattern, refined->pattern,
+			matcher->len) == 0);
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2026 The NetSurf Browser Project
+ *
+ * This file is part of NetSurf, http://www.netsurf-browser.org/
+ *
+ * NetSurf is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * NetSurf is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * Compiled text search pattern interface.
+ *
+ * A pattern is compiled once and may then be searched for in any
+ * number of strings. Patterns may contain the wildcards '*', which
+ * matches any run of characters, and '#', which matches any single
+ * character.
+ */
+
+#ifndef NETSURF_UTILS_STRMATCH_H
+#define NETSURF_UTILS_STRMATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utils/errors.h"
+
+struct strmatch;
+
+/**
+ * Compile a search pattern.
+ *
+ * \param pattern The pattern, which need not be NUL terminated.
+ * \param len Length of the pattern in bytes.
+ * \param case_sens Whether the pattern matches case sensitively.
+ * \param matcher_out Updated to the compiled pattern on success.
+ * \return NSERROR_OK on success or NSERROR_NOMEM on memory exhaustion.
+ */
+nserror strmatch_create(const char *pattern, size_t len, bool case_sens,
+		struct strmatch **matcher_out);
+
+/**
+ * Destroy a compiled search pattern.
+ *
+ * \param matcher The compiled pattern to destroy.
+ */
+void strmatch_destroy(struct strmatch *matcher);
+
+/**
+ * Find the first match of a compiled pattern in a string.
+ *
+ * \param matcher The compiled pattern.
+ * \param string The string to search, which need not be NUL terminated.
+ * \param len Length of the string in bytes.
+ * \param match_len Updated to the length of the match in bytes.
+ * \return Pointer to the start of the first match or NULL if none.
+ */
+const char *strmatch_find(const struct strmatch *matcher,
+		const char *string, size_t len, size_t *match_len);
+
+/**
+ * Match a compiled pattern at the start of a string.
+ *
+ * \param matcher The compiled pattern.
+ * \param string The string to match, which need not be NUL terminated.
+ * \param len Length of the string in bytes.
+ * \param match_len Updated to the length of the match in bytes.
+ * \return true if the pattern matches at the start of the string.
+ */
+bool strmatch_prefix(const struct strmatch *matcher,
+		const char *string, size_t len, size_t *match_len);
+
+/**
+ * Determine whether matches of a pattern can be found from another's.
+ *
+ * This is the case when every match of the refined pattern begins
+ * where a match of the original pattern was found, searching from
+ * the end of each match, and so the refined matches may be found by
+ * testing those positions with strmatch_prefix. Typically the refined
+ * pattern is the original pattern extended with further characters.
+ *
+ * \param matcher The original compiled pattern.
+ * \param refined The refined compiled pattern.
+ * \return true if the refined matches may be found from the original.
+ */
+bool strmatch_refines(const struct strmatch *matcher,
+		const struct strmatch *refined);
+
+#endif